@@ -34,6 +34,8 @@
 
 #include <set>
 #include <fstream>
+#include <algorithm>
+#include <cstring>
 
 //For OBJDUMP
 #include <sstream>
@@ -57,141 +59,154 @@ Recording g_recording;
 
 ShellRenderer * g_shell_renderer = NULL;
 
+namespace
+{
+  // one recorded step, encoded and written by the recording's output worker
+  class RecordingStepOutput : public ElTopo::FrameOutput
+  {
+  public:
+    RecordingStepOutput(ElTopo::MeshRecordingWriter & writer, std::ostream & os, int step, const std::string & log, const ElTopo::SurfTrack & st) :
+      m_writer(writer),
+      m_os(os),
+      m_step(step),
+      m_log(log),
+      m_positions(st.get_positions()),
+      m_triangles(st.m_mesh.get_triangles()),
+      m_labels(st.m_mesh.get_triangle_labels())
+    { }
+    
+    virtual bool write()
+    {
+      m_writer.write_step(m_os, m_step, m_log, m_positions, m_triangles, m_labels);
+      return m_os.good();
+    }
+    
+  private:
+    ElTopo::MeshRecordingWriter & m_writer;
+    std::ostream & m_os;
+    int m_step;
+    std::string m_log;
+    std::vector<ElTopo::Vec3d> m_positions;
+    std::vector<ElTopo::Vec3st> m_triangles;
+    std::vector<ElTopo::Vec2i> m_labels;
+  };
+  
+  // the OBJ files of one frame, plus a snapshot in the raw recording format
+  class ObjFrameOutput : public ElTopo::MeshFrameOutput
+  {
+  public:
+    ObjFrameOutput(const ElTopo::SurfTrack & st, const std::string & rec_filename) :
+      ElTopo::MeshFrameOutput(st.m_mesh, st.get_positions()),
+      m_rec_filename(rec_filename)
+    { }
+    
+    virtual bool write()
+    {
+      bool good = ElTopo::MeshFrameOutput::write();
+      
+      std::ofstream of(m_rec_filename.c_str());
+      Recording::writeSurfTrack(of, get_positions(), get_mesh().get_triangles(), get_mesh().get_triangle_labels());
+      of.close();
+      
+      return good && of.good();
+    }
+    
+  private:
+    std::string m_rec_filename;
+  };
+}
+
 void Recording::writeSurfTrack(std::ostream & os, const ElTopo::SurfTrack & st)
 {
+  writeSurfTrack(os, st.get_positions(), st.m_mesh.get_triangles(), st.m_mesh.get_triangle_labels());
+}
+
+void Recording::writeSurfTrack(std::ostream & os, const std::vector<ElTopo::Vec3d> & positions, const std::vector<ElTopo::Vec3st> & triangles, const std::vector<ElTopo::Vec2i> & labels)
+{
+  // assemble the whole snapshot, then write it at once
+  std::vector<char> buffer;
+  
   size_t n;
 
-  n = st.m_mesh.nv();
-  os.write((char *)&n, sizeof (size_t));
+  n = positions.size();
+  buffer.insert(buffer.end(), (char *)&n, (char *)&n + sizeof (size_t));
   for (size_t i = 0; i < n; i++)
   {
-    ElTopo::Vec3d x = st.get_position(i);
-    os.write((char *)&(x[0]), sizeof (x[0]));
-    os.write((char *)&(x[1]), sizeof (x[1]));
-    os.write((char *)&(x[2]), sizeof (x[2]));
-    
-//    x = st.get_newposition(i);
-//    os.write((char *)&(x[0]), sizeof (x[0]));
-//    os.write((char *)&(x[1]), sizeof (x[1]));
-//    os.write((char *)&(x[2]), sizeof (x[2]));
-//    
-//    x = st.get_remesh_velocity(i);
-//    os.write((char *)&(x[0]), sizeof (x[0]));
-//    os.write((char *)&(x[1]), sizeof (x[1]));
-//    os.write((char *)&(x[2]), sizeof (x[2]));
-//    
-//    double mass = st.m_masses[i];
-//    os.write((char *)&mass, sizeof (mass));
-//    
-//    bool cl = st.m_mesh.m_vertex_constraint_labels[i];
-//    os.write((char *)&cl, sizeof (cl));
+    const ElTopo::Vec3d & x = positions[i];
+    buffer.insert(buffer.end(), (char *)&(x[0]), (char *)&(x[0]) + sizeof (x[0]) * 3);
   }
   
-  n = st.m_mesh.nt();
-  os.write((char *)&n, sizeof (size_t));
+  n = triangles.size();
+  buffer.insert(buffer.end(), (char *)&n, (char *)&n + sizeof (size_t));
   for (size_t i = 0; i < n; i++)
   {
-    ElTopo::Vec3st t = st.m_mesh.get_triangle(i);
-    os.write((char *)&(t[0]), sizeof (t[0]));
-    os.write((char *)&(t[1]), sizeof (t[1]));
-    os.write((char *)&(t[2]), sizeof (t[2]));
-    
-    ElTopo::Vec2i l = st.m_mesh.get_triangle_label(i);
-    os.write((char *)&(l[0]), sizeof (l[0]));
-    os.write((char *)&(l[1]), sizeof (l[1]));
+    const ElTopo::Vec3st & t = triangles[i];
+    buffer.insert(buffer.end(), (char *)&(t[0]), (char *)&(t[0]) + sizeof (t[0]) * 3);
+    
+    const ElTopo::Vec2i & l = labels[i];
+    buffer.insert(buffer.end(), (char *)&(l[0]), (char *)&(l[0]) + sizeof (l[0]) * 2);
   }
   
+  os.write(&buffer[0], buffer.size());
 }
 
 void Recording::readSurfTrack(std::istream & is, ElTopo::SurfTrack & st)
 {
-  // clear the mesh
-  for (size_t i = 0; i < st.m_mesh.nt(); i++)
-  {
-    if (st.m_mesh.get_triangle(i)[0] == st.m_mesh.get_triangle(i)[1])
-      continue;
-    st.remove_triangle(i);
-  }
+  ElTopo::RecordedMesh mesh;
   
-  for (size_t i = 0; i < st.m_mesh.nv(); i++)
-    st.remove_vertex(i);
+  size_t n = 0;
+  is.read((char *)&n, sizeof (size_t));
+  mesh.m_positions.resize(n);
+  if (n > 0)
+    is.read((char *)&(mesh.m_positions[0][0]), sizeof (double) * 3 * n);
   
-  size_t n;
-  n = st.m_mesh.nv();
+  n = 0;
   is.read((char *)&n, sizeof (size_t));
-//  std::cout << " nv = " << n << std::endl;
-  st.m_mesh.set_num_vertices(n);
-  std::vector<ElTopo::Vec3d> pos(n);
+  const size_t record_size = sizeof (size_t) * 3 + sizeof (int) * 2;
+  std::vector<char> buffer(n * record_size);
+  if (n > 0)
+    is.read(&buffer[0], buffer.size());
+  
+  mesh.m_triangles.resize(n);
+  mesh.m_labels.resize(n);
   for (size_t i = 0; i < n; i++)
   {
-    ElTopo::Vec3d x;
-    is.read((char *)&(x[0]), sizeof (x[0]));
-    is.read((char *)&(x[1]), sizeof (x[1]));
-    is.read((char *)&(x[2]), sizeof (x[2]));
-    pos[i] = x;
-    
-//    is.read((char *)&(x[0]), sizeof (x[0]));
-//    is.read((char *)&(x[1]), sizeof (x[1]));
-//    is.read((char *)&(x[2]), sizeof (x[2]));
-//    st.set_newposition(i, x);
-//    
-//    is.read((char *)&(x[0]), sizeof (x[0]));
-//    is.read((char *)&(x[1]), sizeof (x[1]));
-//    is.read((char *)&(x[2]), sizeof (x[2]));
-//    st.set_remesh_velocity(i, x);
-//    
-//    double mass;
-//    is.read((char *)&mass, sizeof (mass));
-//    st.m_masses[i] = mass;
-//    
-//    bool cl;
-//    is.read((char *)&cl, sizeof (cl));
-//    st.m_mesh.m_vertex_constraint_labels[i] = cl;
+    const char * record = &buffer[i * record_size];
+    memcpy(&(mesh.m_triangles[i][0]), record, sizeof (size_t) * 3);
+    memcpy(&(mesh.m_labels[i][0]), record + sizeof (size_t) * 3, sizeof (int) * 2);
   }
   
-  st.m_masses.resize(n);
-  for (size_t i = 0; i < n; i++)
-    st.m_masses[i] = ElTopo::Vec3d(1, 1, 1);
+  setSurfTrack(st, mesh);
+}
+
+void Recording::setSurfTrack(ElTopo::SurfTrack & st, const ElTopo::RecordedMesh & mesh)
+{
+  // replace the connectivity wholesale, rather than removing and adding elements one at a time
+  st.m_mesh.clear();
+  st.m_mesh.replace_all_triangles(mesh.m_triangles, mesh.m_labels);
   
-  st.set_all_positions(pos);
-  st.set_all_newpositions(pos);  
-  st.set_all_remesh_velocities(std::vector<ElTopo::Vec3d>(n, ElTopo::Vec3d(0)));
+  // trailing vertices may be unreferenced (deleted)
+  size_t nv = std::max(mesh.m_positions.size(), st.m_mesh.m_vertex_to_triangle_map.size());
+  st.m_mesh.set_num_vertices(nv);
   
-//  std::cout << "nv: " << pos.size() << " " << st.pm_velocities.size() << " " << st.m_mesh.m_vertex_constraint_labels.size() << " " << st.m_mesh.m_vertex_to_triangle_map.size() << std::endl;
-//  std::cout << "nv: " << st.m_mesh.nv() << std::endl;
+  st.m_masses.assign(nv, ElTopo::Vec3d(1, 1, 1));
+  st.pm_velocities.assign(nv, ElTopo::Vec3d(0));
+  st.m_velocities.resize(nv);
   
-  n = st.m_mesh.nt();
-  is.read((char *)&n, sizeof (size_t));
-//  std::cout << "nt = " << n << std::endl;
-  std::vector<ElTopo::Vec3st> tris;
-  std::vector<ElTopo::Vec2i> labels;
-  for (size_t i = 0; i < n; i++)
+  // sets the predicted positions too, and rebuilds the continuous broad phase over the new mesh
+  if (mesh.m_positions.size() == nv)
   {
-    ElTopo::Vec3st t;
-    is.read((char *)&(t[0]), sizeof (t[0]));
-    is.read((char *)&(t[1]), sizeof (t[1]));
-    is.read((char *)&(t[2]), sizeof (t[2]));
-    tris.push_back(t);
-    
-    ElTopo::Vec2i l;
-    is.read((char *)&(l[0]), sizeof (l[0]));
-    is.read((char *)&(l[1]), sizeof (l[1]));
-    labels.push_back(l);
+    st.set_all_positions(mesh.m_positions);
+  }
+  else
+  {
+    std::vector<ElTopo::Vec3d> positions(mesh.m_positions);
+    positions.resize(nv, ElTopo::Vec3d(0));
+    st.set_all_positions(positions);
   }
   
-  st.m_mesh.replace_all_triangles(tris, labels);
-//  for (size_t i = 0; i < n; i++)
-//    st.m_mesh.set_triangle_label(i, labels[i]);
-  
-  size_t nv = st.m_mesh.m_vertex_to_triangle_map.size();
-  st.pm_positions.resize(nv);
-  st.pm_newpositions.resize(nv);
-  st.pm_velocities.resize(nv);
-  st.m_velocities.resize(nv);
-
-//  std::cout << "nv: " << pos.size() << " " << st.pm_velocities.size() << " " << st.m_mesh.m_vertex_constraint_labels.size() << " " << st.m_mesh.m_vertex_to_triangle_map.size() << std::endl;
-//  std::cout << "nv: " << st.m_mesh.nv() << std::endl;
-  
+  if (st.m_collision_safety)
+    st.rebuild_static_broad_phase();
 }
 
 void Recording::recordSurfTrack(const ElTopo::SurfTrack & st)
@@ -209,90 +224,73 @@ void Recording::recordSurfTrack(const ElTopo::SurfTrack & st)
   {
     std::stringstream filename;
     filename << m_recording_name << "_" << m_current_frame << ".rec";
-    m_of.open(filename.str().c_str());
+    m_of.open(filename.str().c_str(), std::ios::binary);
       
     if (!m_of.is_open())
     {
       std::cout << "Cannot open recording frame file " << filename.str() << std::endl;
       return;
     }
+    
+    m_writer.begin_stream(m_of);
   }
   
-  m_of.write((char *)&m_current_step, sizeof (m_current_step));
-  
-  
-  size_t loglen = m_log.str().size();
-  m_of.write((char *)&loglen, sizeof (size_t));
-  m_of.write((char *)m_log.str().c_str(), loglen);
+  // encode and write a snapshot while the simulation goes on
+  m_output.push(new RecordingStepOutput(m_writer, m_of, m_current_step, m_log.str(), st));
   m_log.str("");
   
-  writeSurfTrack(m_of, st);
-  
   m_current_step++;
 }
 
+void Recording::closeFiles()
+{
+  m_output.flush();
+  
+  if (m_of.is_open())
+  {
+    m_writer.end_stream(m_of);
+    m_of.close();
+  }
+  
+  m_file.close();
+}
+
 void Recording::loadRecording(ElTopo::SurfTrack & st, int next)
 {
   if (!isPlaybackOn())
     return;
   
-  if (!m_if.is_open())
+  if (!m_file.is_open())
   {
     std::stringstream filename;
     filename << m_recording_name << "_" << m_current_frame << ".rec";
-    m_if.open(filename.str().c_str());
     
-    if (!m_if.is_open())
+    if (!m_file.open(filename.str()))
     {
-      std::cout << "Requested recording frame not found!" << std::endl;
+      std::cout << "Requested recording frame not found, or not in the recording format!" << std::endl;
       return;
     }
-    
-    m_step_pos.clear();
-    m_step_pos.push_back(m_if.tellg());
-    while (!m_if.eof())
-    {
-      int step = 0;
-      m_if.read((char *)&step, sizeof (step));
-      /////////
-//      readSurfTrack(m_if, st);
-      /////////
-      size_t n;
-      m_if.read((char *)&n, sizeof (n));  // skip log
-      m_if.seekg(n, ios_base::cur);
-      m_if.read((char *)&n, sizeof (n));  // skip vertices
-      m_if.seekg(sizeof (double) * 3 * n, ios_base::cur);
-      m_if.read((char *)&n, sizeof (n));  // skip faces
-      m_if.seekg((sizeof (size_t) * 3 + sizeof (int) * 2) * n, ios_base::cur);
-      /////////
-      m_if.peek();
-      if (!m_if.eof())
-        m_step_pos.push_back(m_if.tellg());
-    }
-    std::cout << "Recording file " << filename << " contains " << m_step_pos.size() << " steps." << std::endl;
-    
-    m_if.seekg(m_step_pos.front());
-    m_if.clear();
+    std::cout << "Recording file " << filename.str() << " contains " << m_file.steps().size() << " steps." << std::endl;
   }
   
-  assert(m_current_step < m_step_pos.size());
-//  std::cout << "Loading step " << (m_current_step + next) % m_step_pos.size() << std::endl;
-  m_if.seekg(m_step_pos[(m_current_step + m_step_pos.size() + next) % m_step_pos.size()]);
-  m_if.read((char *)&m_current_step, sizeof (m_current_step));
+  const std::vector<ElTopo::MeshRecordingStep> & steps = m_file.steps();
+  if (steps.empty())
+    return;
   
-  size_t loglen;
-  m_if.read((char *)&loglen, sizeof (size_t));
-  char * log = new char[loglen + 1];
-  m_if.read((char *)log, loglen);
-  *(log + loglen) = NULL;
+  assert(m_current_step < (int)steps.size());
+  size_t index = (m_current_step + steps.size() + next) % steps.size();
   
-  readSurfTrack(m_if, st);
-
-  m_if.peek();
-  if (m_if.eof())
-    m_if.close();
+  std::string log;
+  if (!m_file.read_step(index, log))
+  {
+    std::cout << "Failed to read step " << index << " of recording frame " << m_current_frame << std::endl;
+    return;
+  }
+  m_current_step = steps[index].m_step;
   
-  std::cout << "Loaded recording: step " << m_current_step << "/" << m_step_pos.size() << " of frame " << m_current_frame << std::endl;
+  setSurfTrack(st, m_file.current());
+  
+  std::cout << "Loaded recording: step " << m_current_step << "/" << steps.size() << " of frame " << m_current_frame << std::endl;
   std::cout << log << std::endl;
 }
 
@@ -301,7 +299,8 @@ DoubleBubbleTest::DoubleBubbleTest() :
   shell(NULL), 
   shellObj(NULL), 
   stepper(NULL),
-  svf(NULL)
+  svf(NULL),
+  m_frame_writer(2, 2)
 {
   addDynamicsProps();
   
@@ -373,6 +372,7 @@ DoubleBubbleTest::DoubleBubbleTest() :
   AddOption("shell-collision-spring-damping", "damping coefficient of the collision springs", 0.0);
   AddOption("shell-collision-proximity", "the collision spring rest length and distance at which to add springs", 0.0);
   AddOption("shell-collision-epsilon", "the distance tolerance for El Topo to flag a collision", 1e-5);
+  AddOption("shell-force-threads", "number of threads used to evaluate shell forces and Jacobians", 1);
 
   AddOption("shell-collision-object-file", "source SDF for object collision", "");
   AddOption("shell-collision-object-offset", "translation of the object", Vec3d(0,0,0));
@@ -607,6 +607,8 @@ void DoubleBubbleTest::Setup()
   bool eltopo_collisions = GetBoolOpt("shell-eltopo-collisions");
   shell->setElTopoCollisions(eltopo_collisions);
 
+  shell->setNumThreads(GetIntOpt("shell-force-threads"));
+
 //  bool thickness_evolution = GetBoolOpt("shell-update-thickness");
 //  shell->setThicknessUpdating(thickness_evolution);
 
@@ -901,7 +903,15 @@ void DoubleBubbleTest::AtEachTimestep()
     if ( g_obj_dump )
     {
         ElTopo::SurfTrack * st = mesh2surftrack();
-        ElTopo::SurfTrack & surface_tracker = *st;
+        
+        // the files are written in the background, from a snapshot of the mesh
+        std::stringstream rec_name;
+        rec_name << std::setfill('0');
+        rec_name << outputdirectory << "/" << "rec" << std::setw(6) << db_current_obj_frame << ".rec";
+        
+        ObjFrameOutput * output = new ObjFrameOutput(*st, rec_name.str());
+        
+        delete(st);
         
 #ifdef _MSC_VER
         _mkdir(outputdirectory.c_str());
@@ -917,7 +927,7 @@ void DoubleBubbleTest::AtEachTimestep()
             name << std::setfill('0');
             name << outputdirectory << "/" << "mesh_frame" << std::setw(6) << db_current_obj_frame << ".OBJ";
             
-            write_objfile(surface_tracker.m_mesh, surface_tracker.get_positions(), name.str().c_str());
+            output->add_objfile(name.str());
             std::cout << "Frame: " << db_current_obj_frame << "   Time: " << getTime() << "   OBJDump: " << name.str() << std::endl;
             
         } else if (RENDER_METHOD == 1)
@@ -930,7 +940,7 @@ void DoubleBubbleTest::AtEachTimestep()
                 name << std::setfill('0');
                 name << outputdirectory << "/" << "region" << std::setw(4) << i << "_frame" << std::setw(6) << db_current_obj_frame << ".OBJ";
 
-                write_objfile_per_region(surface_tracker.m_mesh, surface_tracker.get_positions(), i, excluding_regions, name.str().c_str());
+                output->add_objfile_per_region(i, excluding_regions, name.str());
                 std::cout << "Frame: " << db_current_obj_frame << "   Time: " << getTime() << "   OBJDump: " << name.str() << std::endl;
                 
                 excluding_regions.insert(i);
@@ -938,6 +948,8 @@ void DoubleBubbleTest::AtEachTimestep()
         } else if (RENDER_METHOD == 2)
         {
             // dump one OBJ per region pair
+            std::vector<ElTopo::Vec2i> region_pairs;
+            std::vector<std::string> region_pair_filenames;
             for (int i = 0; i < m_nregion; i++)
             {
                 for (int j = i + 1; j < m_nregion; j++)
@@ -946,11 +958,13 @@ void DoubleBubbleTest::AtEachTimestep()
                     name << std::setfill('0');
                     name << outputdirectory << "/" << "label_" << std::setw(4) << i << "_" << std::setw(4) << j << "_frame" << std::setw(6) << db_current_obj_frame << ".OBJ";
                     
-                    write_objfile_per_region_pair(surface_tracker.m_mesh, surface_tracker.get_positions(), ElTopo::Vec2i(i, j), name.str().c_str());
+                    region_pairs.push_back(ElTopo::Vec2i(i, j));
+                    region_pair_filenames.push_back(name.str());
                     std::cout << "Frame: " << db_current_obj_frame << "   Time: " << getTime() << "   OBJDump: " << name.str() << std::endl;
                 }
                 
             }
+            output->add_objfiles_per_region_pair(region_pairs, region_pair_filenames);
             
         } else if (RENDER_METHOD == 3)
         {
@@ -974,7 +988,7 @@ void DoubleBubbleTest::AtEachTimestep()
                 name << std::setfill('0');
                 name << outputdirectory << "/" << "region" << std::setw(4) << *i << "_frame" << std::setw(6) << db_current_obj_frame << ".OBJ";
                 
-                write_objfile_per_region(surface_tracker.m_mesh, surface_tracker.get_positions(), *i, excluding_regions, name.str().c_str());
+                output->add_objfile_per_region(*i, excluding_regions, name.str());
                 std::cout << "Frame: " << db_current_obj_frame << "   Time: " << getTime() << "   OBJDump: " << name.str() << std::endl;
                 g_shell_renderer->turnOnRegion(*i);
                 excluding_regions.insert(*i);
@@ -984,22 +998,12 @@ void DoubleBubbleTest::AtEachTimestep()
             name << std::setfill('0');
             name << outputdirectory << "/" << "rest_of_the_mesh_frame" << std::setw(6) << db_current_obj_frame << ".OBJ";
             
-            write_objfile_excluding_regions(surface_tracker.m_mesh, surface_tracker.get_positions(), regions, name.str().c_str());
+            output->add_objfile_excluding_regions(regions, name.str());
             std::cout << "Frame: " << db_current_obj_frame << "   Time: " << getTime() << "   OBJDump: " << name.str() << std::endl;
           
         }
         
-        {
-            std::stringstream name;
-            name << std::setfill('0');
-            name << outputdirectory << "/" << "rec" << std::setw(6) << db_current_obj_frame << ".rec";
-            
-            std::ofstream of(name.str().c_str());
-            Recording::writeSurfTrack(of, *st);
-            of.close();
-        }
-      
-        delete(st);
+        m_frame_writer.push(output);
 
         ++db_current_obj_frame;
     }
@@ -15,23 +15,29 @@
 #include <surftrack.h>
 #include <sstream>
 #include <iostream>
+#include <framewriter.h>
+#include <meshrecording.h>
 
 class Recording
 {
 public:
     Recording() : m_recording_name("rec"), m_current_frame(0), m_current_step(0), m_recording(false) { }
+    ~Recording() { closeFiles(); }
     
     void setRecordingName(const std::string & name) { m_recording_name = name; }
     const std::string & recordingName() const { return m_recording_name; }
     
-    void setCurrentFrame(int frame) { m_current_frame = frame; m_current_step = 0; m_of.close(); m_if.close(); }
+    void setCurrentFrame(int frame) { m_current_frame = frame; m_current_step = 0; closeFiles(); }
     int currentFrame() const { return m_current_frame; }
-    void setCurrentStep(int step) { m_current_step = step % m_step_pos.size(); }
+    void setCurrentStep(int step) { m_current_step = step % m_file.steps().size(); }
     int currentStep() const { return m_current_step; }
     
     void recordSurfTrack(const ElTopo::SurfTrack & st);
     void loadRecording(ElTopo::SurfTrack & st, int next = 0);
     
+    // finish the recording file being written, and unmap the one being played back
+    void closeFiles();
+    
     void turnOnRecording() { m_recording = true; m_playback = false; }
     void turnOffRecording() { m_recording = false; }
     bool isRecording() const { return m_recording; }
@@ -40,10 +46,20 @@ public:
     void turnOffPlayback() { m_playback = false; }
     bool isPlaybackOn() const { return m_playback; }
     
+    // recording format: a keyframe every few steps, deltas with positions quantized (0 = exact) in between
+    void setKeyframeInterval(unsigned int interval) { m_output.flush(); m_writer.set_keyframe_interval(interval); }
+    void setPositionQuantum(double quantum) { m_output.flush(); m_writer.set_position_quantum(quantum); }
+    void setCompression(bool compress) { m_output.flush(); m_writer.set_compression(compress); }
+    
 public:
+    // single mesh snapshots, in the raw format
     static void writeSurfTrack(std::ostream & os, const ElTopo::SurfTrack & st);
+    static void writeSurfTrack(std::ostream & os, const std::vector<ElTopo::Vec3d> & positions, const std::vector<ElTopo::Vec3st> & triangles, const std::vector<ElTopo::Vec2i> & labels);
     static void readSurfTrack(std::istream & is, ElTopo::SurfTrack & st);
     
+    // replace the whole mesh of st
+    static void setSurfTrack(ElTopo::SurfTrack & st, const ElTopo::RecordedMesh & mesh);
+    
 public:
     std::ostream & log() { return m_log; }
     
@@ -55,10 +71,13 @@ protected:
     bool m_recording;
     bool m_playback;
     
-    std::vector<std::streampos> m_step_pos;
+    ElTopo::MeshRecordingWriter m_writer;
+    
+    // steps are encoded and written to m_of in the background, in order
+    ElTopo::AsyncFrameWriter m_output;
     
     std::ofstream m_of;
-    std::ifstream m_if;
+    ElTopo::MeshRecordingFile m_file;
     
     std::stringstream m_log;
 };
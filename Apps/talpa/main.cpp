@@ -63,6 +63,7 @@
 #include <collisionpipeline.h>
 #include <broadphase.h>
 #include <eltopo.h>
+#include <framewriter.h>
 #include <iomesh.h>
 #include <meshrenderer.h>
 #include <runstats.h>
@@ -115,6 +116,7 @@ namespace ElTopo {
 char g_output_path[256];  // Where to write output data
 char g_base_output_path[256];  // Where to write output data
 int g_resume_frame;
+std::string g_ccd_candidate_dump;  // File in the output path to dump CCD candidates to, if not empty
 
 //extern unsigned int g_fluid_render_type;
 
@@ -196,6 +198,10 @@ namespace {
     FrameStepper* frame_stepper = NULL;
     int region_count;
     
+    // Frame files are written in the background.  A single worker writes them in order, so that the stats files are
+    // never overwritten by an older snapshot.
+    AsyncFrameWriter frame_writer( 1, 4 );
+    
 #ifdef USE_GUI
     
     bool display_driver = false;
@@ -535,7 +541,9 @@ namespace {
             
             char imp_stats_filename[256];
             sprintf( imp_stats_filename, "%s/aaa-imp-stats.txt", g_output_path );      
-            g_stats.write_to_file( imp_stats_filename );
+            std::ostringstream imp_stats;
+            g_stats.write_to_stream( imp_stats );
+            frame_writer.push( new TextFileOutput( imp_stats_filename, imp_stats.str() ) );
             
             // ---------- 
             // advance underlying simulation
@@ -608,11 +616,15 @@ namespace {
             for(size_t i = 0; i < scalar_masses.size(); ++i)
                scalar_masses[i] = g_surf->m_masses[i][0];
 
-            write_binary_file( g_surf->m_mesh, g_surf->get_positions(), scalar_masses, sim->m_curr_t, binary_filename ); 
+            MeshFrameOutput* frame_output = new MeshFrameOutput( g_surf->m_mesh, g_surf->get_positions() );
+            frame_output->add_binary_file( scalar_masses, sim->m_curr_t, binary_filename );
+            frame_writer.push( frame_output );
             
             char stats_filename[256];
             sprintf( stats_filename, "%s/aaa-stats.txt", g_output_path );      
-            g_stats.write_to_file( stats_filename );
+            std::ostringstream stats;
+            g_stats.write_to_stream( stats );
+            frame_writer.push( new TextFileOutput( stats_filename, stats.str() ) );
 
             
             
@@ -622,33 +634,23 @@ namespace {
         
         // dump one OBJ file per region pair
         std::vector<Vec2i> region_pairs;
+        std::vector<std::string> region_pair_filenames;
         for (int i = 0; i < region_count; i++)
         {
            for (int j = i + 1; j < region_count; j++)
            {
+              std::stringstream name;
+              name << std::setfill('0');
+              name << g_output_path << "/" << "label_" << std::setw(4) << i << "_" << std::setw(4) << j << "_frame" << std::setw(6) << frame_stepper->get_frame() << ".OBJ";
+
               region_pairs.push_back(Vec2i(i,j));
+              region_pair_filenames.push_back(name.str());
            }
         }
         
-        int length = region_pairs.size();
-        
-        #pragma omp parallel
-        {
-           #pragma omp for schedule(dynamic, 1)
-           for (int t = 0; t < length; t++)
-           {
-              Vec2i cur_pair = region_pairs[t];
-              int i = cur_pair[0], j = cur_pair[1];
-
-               std::stringstream name;
-               name << std::setfill('0');
-               name << g_output_path << "/" << "label_" << std::setw(4) << i << "_" << std::setw(4) << j << "_frame" << std::setw(6) << frame_stepper->get_frame() << ".OBJ";
-
-               //Disabled for speed.
-               write_objfile_per_region_pair(g_surf->m_mesh, g_surf->get_positions(), ElTopo::Vec2i(i, j), name.str().c_str());
-               //std::cout << "Frame: " << db_current_obj_frame << "   Time: " << getTime() << "   OBJDump: " << name.str() << std::endl;
-           }
-        }
+        MeshFrameOutput* obj_output = new MeshFrameOutput( g_surf->m_mesh, g_surf->get_positions() );
+        obj_output->add_objfiles_per_region_pair( region_pairs, region_pair_filenames );
+        frame_writer.push( obj_output );
         
         double sim_step_time = get_time_in_seconds() - start_time;
         g_stats.add_to_double( "total_sim_time", sim_step_time );
@@ -664,6 +666,7 @@ namespace {
         {         
             sim->m_running = false;
             std::cout << "total time steps: " << g_stats.get_int( "total_sim_steps" ) << std::endl;
+            frame_writer.flush();
         }
         
     }
@@ -737,6 +740,7 @@ namespace {
             advance_frame();
         }
         sim->m_running = false;
+        frame_writer.flush();
     }
     
     
@@ -1072,6 +1076,7 @@ namespace {
             pthread_mutex_unlock( &surf_mutex );   
             for(unsigned int s = 0; s < driver_list.size(); ++s)
                delete driver_list[s];
+            frame_writer.flush();
             exit(0);
         }
         
@@ -1757,6 +1762,7 @@ namespace {
         }
         
         region_count = script_init.region_count;
+        g_ccd_candidate_dump = script_init.ccd_candidate_dump;
 
         // Init frame stepper
         
@@ -2006,6 +2012,17 @@ int main(int argc, char **argv)
     
     set_up_output_path(resuming);
     
+#ifdef USE_CCD_PREFILTER
+    if ( !g_ccd_candidate_dump.empty() )
+    {
+        std::string dump_filename = std::string( g_output_path ) + "/" + g_ccd_candidate_dump;
+        if ( !set_ccd_candidate_dump_file( dump_filename ) )
+        {
+            std::cerr << "Could not open the CCD candidate dump " << dump_filename << std::endl;
+        }
+    }
+#endif
+    
     //
     // Make a copy of the input script in the output directory
     //
@@ -92,6 +92,29 @@ void ScriptInit::parse_surftrack_parameters( const ParseTree& surftrack_branch )
         surf_track_params.m_subdivision_scheme = new MidpointScheme();
     }
     
+    std::string broad_phase;
+    if ( surftrack_branch.get_string( "broad_phase", broad_phase ) )
+    {
+        if ( strcmp( broad_phase.c_str(), "hash" ) == 0 )
+        {
+            surf_track_params.m_broad_phase_type = BROAD_PHASE_HASH;
+        }
+        else if ( strcmp( broad_phase.c_str(), "bvh" ) == 0 )
+        {
+            surf_track_params.m_broad_phase_type = BROAD_PHASE_BVH;
+        }
+        else
+        {
+            surf_track_params.m_broad_phase_type = BROAD_PHASE_GRID;
+        }
+    }
+    
+    int parallel_edge_operations;
+    if ( surftrack_branch.get_int( "parallel_edge_operations", parallel_edge_operations ) )
+    {
+        surf_track_params.m_parallel_edge_operations = ( parallel_edge_operations != 0 );
+    }
+    
     int allow_vertex_movement;
     if ( surftrack_branch.get_int( "allow_vertex_movement", allow_vertex_movement ) )
     {
@@ -847,6 +870,8 @@ void ScriptInit::parse_script( const char* filename )
         output_path = std::string( "./" );
     }
     
+    tree.get_string( "ccd_candidate_dump", ccd_candidate_dump );
+    
     //
     // OpenGL camera
     //
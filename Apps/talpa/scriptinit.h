@@ -25,6 +25,7 @@ public:
     ScriptInit() :
     output_path(),
     output_path_is_relative(false),
+    ccd_candidate_dump(),
     frame_dt( UNINITIALIZED_DOUBLE ),
     sim_dt( UNINITIALIZED_DOUBLE ),
     end_sim_t( UNINITIALIZED_DOUBLE ),
@@ -82,6 +83,9 @@ public:
     std::string output_path;
     bool output_path_is_relative;
     
+    // File in the output directory to dump continuous collision candidates to, or empty
+    std::string ccd_candidate_dump;
+    
     double frame_dt;
     double sim_dt;
     double end_sim_t;
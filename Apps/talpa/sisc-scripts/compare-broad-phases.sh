@@ -0,0 +1,37 @@
+#!/bin/bash
+#
+# Run a talpa script once with each broad phase and print the broad phase update time of each run.
+#
+# Usage: compare-broad-phases.sh <talpa executable> <script> [output directory]
+#
+# The script is copied with "broad_phase grid|hash|bvh" added to its surftrack_parameters.  The times are read from
+# DynamicSurface:total_broad_phase_update_time in the aaa-stats.txt file of each run.
+#
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 <talpa executable> <script> [output directory]"
+    exit 1
+fi
+
+TALPA=$1
+SCRIPT=$2
+OUTPUT=${3:-/tmp/compare-broad-phases}
+
+for BROAD_PHASE in grid hash bvh; do
+    RUN_OUTPUT=$OUTPUT/$BROAD_PHASE
+    mkdir -p $RUN_OUTPUT
+
+    # add the broad phase right after the opening of surftrack_parameters
+    sed "/^surftrack_parameters/,/(/ s/(/(\n   broad_phase $BROAD_PHASE/" $SCRIPT > $RUN_OUTPUT/script.txt
+
+    # talpa only creates the last directory of relative_output_path
+    mkdir -p $RUN_OUTPUT/$(awk '/^relative_output_path/ { print $2 }' $SCRIPT)
+
+    $TALPA $RUN_OUTPUT/script.txt $RUN_OUTPUT > $RUN_OUTPUT/log.txt 2>&1
+
+    STATS=$(find $RUN_OUTPUT -name aaa-stats.txt | head -1)
+    UPDATE_TIME=$(grep "DynamicSurface:total_broad_phase_update_time" $STATS | awk '{ print $NF }')
+    SIM_TIME=$(grep "^total_sim_time" $STATS | awk '{ print $NF }')
+
+    echo "$BROAD_PHASE: broad phase update $UPDATE_TIME s, simulation $SIM_TIME s"
+done
@@ -33,7 +33,7 @@ void CollisionDetector::getCollisions(std::list<Collision*>& cllsns, CollisionFi
 {
     getReady(cllsns, collision_filter);
 
-    std::vector<BVHParallelizer*> steppers;
+    std::vector<BVHNodePair> pairs;
 
     BVHNodeType& root = m_bvh.GetNode(0);
     updateBoundingBox(m_bvh, m_elements, root);
@@ -51,11 +51,11 @@ void CollisionDetector::getCollisions(std::list<Collision*>& cllsns, CollisionFi
     // If tree has depth 1, detect collisions at this level.
     if (h.IsLeaf() || g.IsLeaf())
     {
-        steppers.reserve(3);
-        steppers.push_back(new BVHParallelizer(this, h, h));
-        steppers.push_back(new BVHParallelizer(this, h, g));
-        steppers.push_back(new BVHParallelizer(this, g, g));
-        MultithreadedStepper<std::vector<BVHParallelizer*> > (steppers, m_num_threads).Execute();
+        pairs.reserve(3);
+        pairs.push_back(BVHNodePair(&h, &h));
+        pairs.push_back(BVHNodePair(&h, &g));
+        pairs.push_back(BVHNodePair(&g, &g));
+        parallelComputeCollisions(pairs);
         return;
     }
 
@@ -67,18 +67,18 @@ void CollisionDetector::getCollisions(std::list<Collision*>& cllsns, CollisionFi
     // If tree has depth 2, detect collisions at this level.
     if (hh.IsLeaf() || hg.IsLeaf() || gh.IsLeaf() || gg.IsLeaf())
     {
-        steppers.reserve(10);
-        steppers.push_back(new BVHParallelizer(this, hh, hh));
-        steppers.push_back(new BVHParallelizer(this, hh, hg));
-        steppers.push_back(new BVHParallelizer(this, hh, gh));
-        steppers.push_back(new BVHParallelizer(this, hh, gg));
-        steppers.push_back(new BVHParallelizer(this, hg, hg));
-        steppers.push_back(new BVHParallelizer(this, hg, gh));
-        steppers.push_back(new BVHParallelizer(this, hg, gg));
-        steppers.push_back(new BVHParallelizer(this, gh, gh));
-        steppers.push_back(new BVHParallelizer(this, gh, gg));
-        steppers.push_back(new BVHParallelizer(this, gg, gg));
-        MultithreadedStepper<std::vector<BVHParallelizer*> > (steppers, m_num_threads).Execute();
+        pairs.reserve(10);
+        pairs.push_back(BVHNodePair(&hh, &hh));
+        pairs.push_back(BVHNodePair(&hh, &hg));
+        pairs.push_back(BVHNodePair(&hh, &gh));
+        pairs.push_back(BVHNodePair(&hh, &gg));
+        pairs.push_back(BVHNodePair(&hg, &hg));
+        pairs.push_back(BVHNodePair(&hg, &gh));
+        pairs.push_back(BVHNodePair(&hg, &gg));
+        pairs.push_back(BVHNodePair(&gh, &gh));
+        pairs.push_back(BVHNodePair(&gh, &gg));
+        pairs.push_back(BVHNodePair(&gg, &gg));
+        parallelComputeCollisions(pairs);
         return;
     }
 
@@ -91,47 +91,44 @@ void CollisionDetector::getCollisions(std::list<Collision*>& cllsns, CollisionFi
     BVHNodeType& ghg = m_bvh.GetNode(gh.ChildIndex() + 1);
     BVHNodeType& ggh = m_bvh.GetNode(gg.ChildIndex());
     BVHNodeType& ggg = m_bvh.GetNode(gg.ChildIndex() + 1);
-    steppers.reserve(36);
-    steppers.push_back(new BVHParallelizer(this, hhh, hhh));
-    steppers.push_back(new BVHParallelizer(this, hhh, hhg));
-    steppers.push_back(new BVHParallelizer(this, hhh, hgh));
-    steppers.push_back(new BVHParallelizer(this, hhh, hgg));
-    steppers.push_back(new BVHParallelizer(this, hhh, ghh));
-    steppers.push_back(new BVHParallelizer(this, hhh, ghg));
-    steppers.push_back(new BVHParallelizer(this, hhh, ggh));
-    steppers.push_back(new BVHParallelizer(this, hhh, ggg));
-    steppers.push_back(new BVHParallelizer(this, hhg, hhg));
-    steppers.push_back(new BVHParallelizer(this, hhg, hgh));
-    steppers.push_back(new BVHParallelizer(this, hhg, hgg));
-    steppers.push_back(new BVHParallelizer(this, hhg, ghh));
-    steppers.push_back(new BVHParallelizer(this, hhg, ghg));
-    steppers.push_back(new BVHParallelizer(this, hhg, ggh));
-    steppers.push_back(new BVHParallelizer(this, hhg, ggg));
-    steppers.push_back(new BVHParallelizer(this, hgh, hgh));
-    steppers.push_back(new BVHParallelizer(this, hgh, hgg));
-    steppers.push_back(new BVHParallelizer(this, hgh, ghh));
-    steppers.push_back(new BVHParallelizer(this, hgh, ghg));
-    steppers.push_back(new BVHParallelizer(this, hgh, ggh));
-    steppers.push_back(new BVHParallelizer(this, hgh, ggg));
-    steppers.push_back(new BVHParallelizer(this, hgg, hgg));
-    steppers.push_back(new BVHParallelizer(this, hgg, ghh));
-    steppers.push_back(new BVHParallelizer(this, hgg, ghg));
-    steppers.push_back(new BVHParallelizer(this, hgg, ggh));
-    steppers.push_back(new BVHParallelizer(this, hgg, ggg));
-    steppers.push_back(new BVHParallelizer(this, ghh, ghh));
-    steppers.push_back(new BVHParallelizer(this, ghh, ghg));
-    steppers.push_back(new BVHParallelizer(this, ghh, ggh));
-    steppers.push_back(new BVHParallelizer(this, ghh, ggg));
-    steppers.push_back(new BVHParallelizer(this, ghg, ghg));
-    steppers.push_back(new BVHParallelizer(this, ghg, ggh));
-    steppers.push_back(new BVHParallelizer(this, ghg, ggg));
-    steppers.push_back(new BVHParallelizer(this, ggh, ggh));
-    steppers.push_back(new BVHParallelizer(this, ggh, ggg));
-    steppers.push_back(new BVHParallelizer(this, ggg, ggg));
-    MultithreadedStepper<std::vector<BVHParallelizer*> > (steppers, m_num_threads).Execute();
-
-    for (std::vector<BVHParallelizer*>::iterator i = steppers.begin(); i != steppers.end(); i++)
-        delete *i;
+    pairs.reserve(36);
+    pairs.push_back(BVHNodePair(&hhh, &hhh));
+    pairs.push_back(BVHNodePair(&hhh, &hhg));
+    pairs.push_back(BVHNodePair(&hhh, &hgh));
+    pairs.push_back(BVHNodePair(&hhh, &hgg));
+    pairs.push_back(BVHNodePair(&hhh, &ghh));
+    pairs.push_back(BVHNodePair(&hhh, &ghg));
+    pairs.push_back(BVHNodePair(&hhh, &ggh));
+    pairs.push_back(BVHNodePair(&hhh, &ggg));
+    pairs.push_back(BVHNodePair(&hhg, &hhg));
+    pairs.push_back(BVHNodePair(&hhg, &hgh));
+    pairs.push_back(BVHNodePair(&hhg, &hgg));
+    pairs.push_back(BVHNodePair(&hhg, &ghh));
+    pairs.push_back(BVHNodePair(&hhg, &ghg));
+    pairs.push_back(BVHNodePair(&hhg, &ggh));
+    pairs.push_back(BVHNodePair(&hhg, &ggg));
+    pairs.push_back(BVHNodePair(&hgh, &hgh));
+    pairs.push_back(BVHNodePair(&hgh, &hgg));
+    pairs.push_back(BVHNodePair(&hgh, &ghh));
+    pairs.push_back(BVHNodePair(&hgh, &ghg));
+    pairs.push_back(BVHNodePair(&hgh, &ggh));
+    pairs.push_back(BVHNodePair(&hgh, &ggg));
+    pairs.push_back(BVHNodePair(&hgg, &hgg));
+    pairs.push_back(BVHNodePair(&hgg, &ghh));
+    pairs.push_back(BVHNodePair(&hgg, &ghg));
+    pairs.push_back(BVHNodePair(&hgg, &ggh));
+    pairs.push_back(BVHNodePair(&hgg, &ggg));
+    pairs.push_back(BVHNodePair(&ghh, &ghh));
+    pairs.push_back(BVHNodePair(&ghh, &ghg));
+    pairs.push_back(BVHNodePair(&ghh, &ggh));
+    pairs.push_back(BVHNodePair(&ghh, &ggg));
+    pairs.push_back(BVHNodePair(&ghg, &ghg));
+    pairs.push_back(BVHNodePair(&ghg, &ggh));
+    pairs.push_back(BVHNodePair(&ghg, &ggg));
+    pairs.push_back(BVHNodePair(&ggh, &ggh));
+    pairs.push_back(BVHNodePair(&ggh, &ggg));
+    pairs.push_back(BVHNodePair(&ggg, &ggg));
+    parallelComputeCollisions(pairs);
 
     //    STOP_TIMER("CollisionDetector::getContinuousTimeCollisions");
 }
@@ -15,7 +15,8 @@
 #include "BVH.hh"
 #include <list>
 #include <set>
-#include "../Threads/MultithreadedStepper.hh"
+#include "../Threads/Mutex.hh"
+#include "../Threads/ThreadPool.hh"
 
 namespace BASim
 {
@@ -73,30 +74,31 @@ protected:
     bool isVertexFixed(int vert_idx) const;
     bool isRodVertex(int vert) const;
 
+    typedef std::pair<const BVHNodeType*, const BVHNodeType*> BVHNodePair;
+
+    // parallel_for body testing the i-th pair of BVH nodes against each other
     class BVHParallelizer
     {
         CollisionDetectorBase* m_coldet;
-        const BVHNodeType& m_node_a;
-        const BVHNodeType& m_node_b;
+        const std::vector<BVHNodePair>& m_pairs;
 
     public:
-        BVHParallelizer(CollisionDetectorBase* coldet, const BVHNodeType& node_a, const BVHNodeType& node_b) :
-            m_coldet(coldet), m_node_a(node_a), m_node_b(node_b)
-        {
-            // std::cerr << "Constructing BVHParallelizer" << std::endl;
-        }
-
-        ~BVHParallelizer()
+        BVHParallelizer(CollisionDetectorBase* coldet, const std::vector<BVHNodePair>& pairs) :
+            m_coldet(coldet), m_pairs(pairs)
         {
         }
 
-        bool execute() const
+        void operator()(int i) const
         {
-            m_coldet->computeCollisions(m_node_a, m_node_b);
-
-            return true;
+            m_coldet->computeCollisions(*m_pairs[i].first, *m_pairs[i].second);
         }
     };
+
+    // Runs computeCollisions on every pair on the shared thread pool, using at most m_num_threads threads.
+    void parallelComputeCollisions(const std::vector<BVHNodePair>& pairs)
+    {
+        threads::parallel_for(0, pairs.size(), BVHParallelizer(this, pairs), 1, m_num_threads);
+    }
 };
 
 }
@@ -65,7 +65,7 @@ void RodMeshCollisionDetector::getCollisions(std::list<Collision*>& cllsns, Coll
 {
     getReady(cllsns, collision_filter);
 
-    std::vector<BVHParallelizer*> steppers;
+    std::vector<BVHNodePair> pairs;
 
     BVHNodeType& rod_root = m_rod_bvh.GetNode(0);
     DebugStream(g_log, "") << "Updating rods bounding box\n";
@@ -91,11 +91,11 @@ void RodMeshCollisionDetector::getCollisions(std::list<Collision*>& cllsns, Coll
 
     if (mesh_h.IsLeaf() || mesh_g.IsLeaf() || rod_h.IsLeaf() || rod_g.IsLeaf()) // Lazy!
     {
-        steppers.push_back(new BVHParallelizer(this, mesh_h, rod_h));
-        steppers.push_back(new BVHParallelizer(this, mesh_h, rod_g));
-        steppers.push_back(new BVHParallelizer(this, mesh_g, rod_h));
-        steppers.push_back(new BVHParallelizer(this, mesh_g, rod_g));
-        MultithreadedStepper<std::vector<BVHParallelizer*> > (steppers, m_num_threads).Execute();
+        pairs.push_back(BVHNodePair(&mesh_h, &rod_h));
+        pairs.push_back(BVHNodePair(&mesh_h, &rod_g));
+        pairs.push_back(BVHNodePair(&mesh_g, &rod_h));
+        pairs.push_back(BVHNodePair(&mesh_g, &rod_g));
+        parallelComputeCollisions(pairs);
         return;
     }
 
@@ -109,26 +109,23 @@ void RodMeshCollisionDetector::getCollisions(std::list<Collision*>& cllsns, Coll
     BVHNodeType& rod_gh = m_rod_bvh.GetNode(rod_g.ChildIndex());
     BVHNodeType& rod_gg = m_rod_bvh.GetNode(rod_g.ChildIndex() + 1);
 
-    steppers.push_back(new BVHParallelizer(this, mesh_hh, rod_hh));
-    steppers.push_back(new BVHParallelizer(this, mesh_hg, rod_hh));
-    steppers.push_back(new BVHParallelizer(this, mesh_gh, rod_hh));
-    steppers.push_back(new BVHParallelizer(this, mesh_gg, rod_hh));
-    steppers.push_back(new BVHParallelizer(this, mesh_hh, rod_hg));
-    steppers.push_back(new BVHParallelizer(this, mesh_hg, rod_hg));
-    steppers.push_back(new BVHParallelizer(this, mesh_gh, rod_hg));
-    steppers.push_back(new BVHParallelizer(this, mesh_gg, rod_hg));
-    steppers.push_back(new BVHParallelizer(this, mesh_hh, rod_gh));
-    steppers.push_back(new BVHParallelizer(this, mesh_hg, rod_gh));
-    steppers.push_back(new BVHParallelizer(this, mesh_gh, rod_gh));
-    steppers.push_back(new BVHParallelizer(this, mesh_gg, rod_gh));
-    steppers.push_back(new BVHParallelizer(this, mesh_hh, rod_gg));
-    steppers.push_back(new BVHParallelizer(this, mesh_hg, rod_gg));
-    steppers.push_back(new BVHParallelizer(this, mesh_gh, rod_gg));
-    steppers.push_back(new BVHParallelizer(this, mesh_gg, rod_gg));
-    MultithreadedStepper<std::vector<BVHParallelizer*> > (steppers, m_num_threads).Execute();
-
-    for (std::vector<BVHParallelizer*>::iterator i = steppers.begin(); i != steppers.end(); i++)
-        delete *i;
+    pairs.push_back(BVHNodePair(&mesh_hh, &rod_hh));
+    pairs.push_back(BVHNodePair(&mesh_hg, &rod_hh));
+    pairs.push_back(BVHNodePair(&mesh_gh, &rod_hh));
+    pairs.push_back(BVHNodePair(&mesh_gg, &rod_hh));
+    pairs.push_back(BVHNodePair(&mesh_hh, &rod_hg));
+    pairs.push_back(BVHNodePair(&mesh_hg, &rod_hg));
+    pairs.push_back(BVHNodePair(&mesh_gh, &rod_hg));
+    pairs.push_back(BVHNodePair(&mesh_gg, &rod_hg));
+    pairs.push_back(BVHNodePair(&mesh_hh, &rod_gh));
+    pairs.push_back(BVHNodePair(&mesh_hg, &rod_gh));
+    pairs.push_back(BVHNodePair(&mesh_gh, &rod_gh));
+    pairs.push_back(BVHNodePair(&mesh_gg, &rod_gh));
+    pairs.push_back(BVHNodePair(&mesh_hh, &rod_gg));
+    pairs.push_back(BVHNodePair(&mesh_hg, &rod_gg));
+    pairs.push_back(BVHNodePair(&mesh_gh, &rod_gg));
+    pairs.push_back(BVHNodePair(&mesh_gg, &rod_gg));
+    parallelComputeCollisions(pairs);
 }
 
 void RodMeshCollisionDetector::computeCollisions(const BVHNodeType& mesh_node, const BVHNodeType& rod_node)
@@ -2,64 +2,96 @@
 
 #include "BASim/src/IO/SerializationUtils.hh"
 
+#include <algorithm>
+#include <cstdio>
+
 namespace BASim {
 
+//Capacity given to freshly added rows. Incidence rows are short (2 for EV/EF, 3 for FE,
+//roughly 6 for VE), so most of them never need to move.
+static const unsigned int kInitialRowCapacity = 4;
+
 inline int signum(int val) {
   return (val >= 0 ? 1 : -1);
 }
 
-IncidenceMatrix::IncidenceMatrix() : 
-   n_rows(0), n_cols(0), m_indices(0)
+IncidenceMatrix::IncidenceMatrix() :
+   n_rows(0), n_cols(0), m_wasted(0)
 {
 }
 
-IncidenceMatrix::IncidenceMatrix(unsigned int rows, unsigned int cols) : 
-   n_rows(rows), n_cols(cols), 
-   m_indices(rows, std::vector<int>())
+IncidenceMatrix::IncidenceMatrix(unsigned int rows, unsigned int cols) :
+   n_rows(0), n_cols(cols), m_wasted(0)
 {
+   addRows(rows);
 }
 
-unsigned int IncidenceMatrix::getNumEntriesInRow(unsigned int row) const {
- assert(row < n_rows);
- return m_indices[row].size();
+unsigned int IncidenceMatrix::getIndexByCol(unsigned int i, unsigned int col) const {
+   const int* row = rowBegin(i);
+   for(unsigned int j = 0; j < m_rowLength[i]; ++j) {
+      if((unsigned int)abs(row[j]) - 1 == col )
+         return j;
+   }
+   return -1;
 }
 
-int IncidenceMatrix::getValueByIndex(unsigned int i, unsigned int index_in_row) const {
- assert(i < n_rows);
- assert(index_in_row < m_indices[i].size());
+void IncidenceMatrix::reserveRow(unsigned int i, unsigned int capacity) {
+   if(capacity <= m_rowCapacity[i])
+      return;
 
- return signum(m_indices[i][index_in_row]);
-}
+   //amortize the cleanup of abandoned slots over the moves that produced them. This has to
+   //happen before the row's new slot is set up, since compact() trims every row's slack.
+   if(m_wasted > (m_data.size() - m_wasted) / 2) {
+      compact();
+      if(capacity <= m_rowCapacity[i])
+         return;
+   }
+
+   unsigned int newCapacity = std::max(m_rowCapacity[i], kInitialRowCapacity);
+   while(newCapacity < capacity)
+      newCapacity *= 2;
 
-unsigned int IncidenceMatrix::getColByIndex(unsigned int i, unsigned int index_in_row) const {
-  assert(i < n_rows);
-  assert(index_in_row < m_indices[i].size());
+   //the last row in the array can simply be extended
+   if(m_rowStart[i] + m_rowCapacity[i] == m_data.size()) {
+      m_data.resize(m_rowStart[i] + newCapacity, 0);
+      m_rowCapacity[i] = newCapacity;
+      return;
+   }
 
-  return abs(m_indices[i][index_in_row]) - 1;
+   //otherwise move it to the end, abandoning its old slot
+   unsigned int newStart = m_data.size();
+   m_data.resize(newStart + newCapacity, 0);
+   std::copy(m_data.begin() + m_rowStart[i], m_data.begin() + m_rowStart[i] + m_rowLength[i], m_data.begin() + newStart);
+   m_wasted += m_rowCapacity[i];
+   m_rowStart[i] = newStart;
+   m_rowCapacity[i] = newCapacity;
 }
 
-unsigned int IncidenceMatrix::getIndexByCol(unsigned int i, unsigned int col) const {
-   for(unsigned int j = 0; j < m_indices[i].size(); ++j) {
-      if(abs(m_indices[i][j]) - 1 == col )
-         return j;
-   }
-   return -1;
+void IncidenceMatrix::resizeRow(unsigned int i, unsigned int length) {
+   reserveRow(i, length);
+
+   //new entries start out zeroed, as with std::vector::resize
+   int* row = rowBegin(i);
+   for(unsigned int j = m_rowLength[i]; j < length; ++j)
+      row[j] = 0;
+   m_rowLength[i] = length;
 }
 
 void IncidenceMatrix::setByIndex(unsigned int i, unsigned int index_in_row, unsigned int col, int value) {
    assert(value == 1 || value == -1);
-   if(index_in_row >= m_indices[i].size()) m_indices[i].resize(index_in_row+1);
+   if(index_in_row >= m_rowLength[i]) resizeRow(i, index_in_row+1);
 
-   m_indices[i][index_in_row] = (col+1)*value;
+   rowBegin(i)[index_in_row] = (col+1)*value;
 }
 
 
 void IncidenceMatrix::cycleRow(unsigned int i) {
-   int t = m_indices[i][0];
-   int row_len = m_indices[i].size();
+   int* row = rowBegin(i);
+   int t = row[0];
+   int row_len = m_rowLength[i];
    for(int j = 0; j < row_len-1; ++j)
-      m_indices[i][j] = m_indices[i][j+1];
-   m_indices[i][row_len-1] = t;
+      row[j] = row[j+1];
+   row[row_len-1] = t;
 }
 
 
@@ -71,29 +103,30 @@ void IncidenceMatrix::set(unsigned int i, unsigned int j, int new_val) {
    }
 
    assert(new_val == 1 || new_val == -1);
-  
+
    int colShift = j+1;
-   bool found = false;
-   for(unsigned int cur = 0; cur < m_indices[i].size(); ++cur) {
-      int& data_value = m_indices[i][cur];
+   int* row = rowBegin(i);
+   for(unsigned int cur = 0; cur < m_rowLength[i]; ++cur) {
+      int& data_value = row[cur];
       if(data_value == colShift || data_value == -colShift) {
          data_value = (new_val > 0? colShift : -colShift);
-         found = true;
-         break;
+         return;
       }
    }
 
-   if(!found)
-      m_indices[i].push_back(new_val>0?colShift:-colShift);
+   reserveRow(i, m_rowLength[i]+1);
+   m_data[m_rowStart[i] + m_rowLength[i]] = (new_val>0?colShift:-colShift);
+   ++m_rowLength[i];
 }
 
 int IncidenceMatrix::get(unsigned int i, unsigned int j) const {
    assert(i < n_rows && j < n_cols);
-  
+
    int colShift = j+1;
-   for(unsigned int k=0; k<m_indices[i].size(); ++k){
-      if(abs(m_indices[i][k])==(int)colShift){
-         return signum(m_indices[i][k]);
+   const int* row = rowBegin(i);
+   for(unsigned int k=0; k<m_rowLength[i]; ++k){
+      if(abs(row[k])==(int)colShift){
+         return signum(row[k]);
       }
    }
    return 0;
@@ -103,9 +136,14 @@ void IncidenceMatrix::zero(unsigned int i, unsigned int j) {
    assert(i<n_rows && j < n_cols);
 
    int colShift = j+1;
-   for(unsigned int k=0; k<m_indices[i].size(); ++k){
-      if(abs(m_indices[i][k])==colShift){
-         m_indices[i].erase(m_indices[i].begin()+k);
+   int* row = rowBegin(i);
+   unsigned int len = m_rowLength[i];
+   for(unsigned int k=0; k<len; ++k){
+      if(abs(row[k])==colShift){
+         //shift down to preserve the ordering of the remaining entries
+         for(unsigned int l = k; l+1 < len; ++l)
+            row[l] = row[l+1];
+         --m_rowLength[i];
          return;
       }
    }
@@ -113,10 +151,11 @@ void IncidenceMatrix::zero(unsigned int i, unsigned int j) {
 
 bool IncidenceMatrix::exists(unsigned int i, unsigned int j) const {
    assert(i<n_rows && j < n_cols);
-  
+
    int colShift = j+1;
-   for(unsigned int k=0; k<m_indices[i].size(); ++k){
-      if(abs(m_indices[i][k])==colShift){
+   const int* row = rowBegin(i);
+   for(unsigned int k=0; k<m_rowLength[i]; ++k){
+      if(abs(row[k])==colShift){
          return true;
       }
    }
@@ -124,8 +163,18 @@ bool IncidenceMatrix::exists(unsigned int i, unsigned int j) const {
 }
 
 void IncidenceMatrix::addRows(unsigned int rows) {
+   //new rows get their slack in one block at the end of the array
+   unsigned int start = m_data.size();
+   m_data.resize(start + rows*kInitialRowCapacity, 0);
+
+   //no reserve() here: rows are mostly added one at a time, and an exact reserve would
+   //reallocate the whole vector on every call instead of growing it geometrically
+   m_rowLength.resize(n_rows + rows, 0);
+   m_rowCapacity.resize(n_rows + rows, kInitialRowCapacity);
+   for(unsigned int r = 0; r < rows; ++r)
+      m_rowStart.push_back(start + r*kInitialRowCapacity);
+
    n_rows += rows;
-   m_indices.resize(n_rows);
 }
 
 void IncidenceMatrix::addCols(unsigned int cols) {
@@ -134,16 +183,36 @@ void IncidenceMatrix::addCols(unsigned int cols) {
 
 void IncidenceMatrix::zeroRow( unsigned int i )
 {
-   m_indices[i].clear();
+   //keep the capacity, since the row is likely to be reused
+   m_rowLength[i] = 0;
 }
 
-void IncidenceMatrix::printMatrix() const 
+void IncidenceMatrix::compact()
+{
+   unsigned int total = 0;
+   for(unsigned int i = 0; i < n_rows; ++i)
+      total += std::max(m_rowLength[i] + 1, kInitialRowCapacity);
+
+   std::vector<int> packed(total, 0);
+   unsigned int start = 0;
+   for(unsigned int i = 0; i < n_rows; ++i) {
+      std::copy(m_data.begin() + m_rowStart[i], m_data.begin() + m_rowStart[i] + m_rowLength[i], packed.begin() + start);
+      m_rowStart[i] = start;
+      m_rowCapacity[i] = std::max(m_rowLength[i] + 1, kInitialRowCapacity);
+      start += m_rowCapacity[i];
+   }
+
+   m_data.swap(packed);
+   m_wasted = 0;
+}
+
+void IncidenceMatrix::printMatrix() const
 {
    printf("Dimensions (%d,%d):\n", n_rows, n_cols);
-   for(unsigned int row = 0; row < m_indices.size(); ++row) {
+   for(unsigned int row = 0; row < n_rows; ++row) {
       printf("%d: ", row);
-      for(unsigned int i = 0; i < m_indices[row].size(); ++i)
-        printf("%c%d ", m_indices[row][i] > 0?'+':'-', abs(m_indices[row][i])-1);
+      for(unsigned int i = 0; i < m_rowLength[row]; ++i)
+        printf("%c%d ", getValueByIndex(row, i) > 0?'+':'-', getColByIndex(row, i));
       printf("\n");
    }
 }
@@ -156,10 +225,15 @@ void IncidenceMatrix::zeroAll()
 
 void IncidenceMatrix::serialize(std::ofstream& of, const IncidenceMatrix& val) {
    assert( of.is_open() );
-   
+
    serializeVal(of,val.n_rows);
    serializeVal(of,val.n_cols);
-   serializeVectorVectorInt(of, val.m_indices);
+
+   //keep the on-disk layout of the old vector-of-vectors storage
+   std::vector< std::vector<int> > indices(val.n_rows);
+   for(unsigned int i = 0; i < val.n_rows; ++i)
+      indices[i].assign(val.rowBegin(i), val.rowBegin(i) + val.m_rowLength[i]);
+   serializeVectorVectorInt(of, indices);
 }
 
 void IncidenceMatrix::load(std::ifstream& ifs, IncidenceMatrix& val) {
@@ -168,10 +242,17 @@ void IncidenceMatrix::load(std::ifstream& ifs, IncidenceMatrix& val) {
    int rows, cols;
    loadVal(ifs,rows);
    loadVal(ifs,cols);
-   val.n_rows = rows;
-   val.n_cols = cols;
-   loadVectorVectorInt(ifs, val.m_indices);
-   
+
+   std::vector< std::vector<int> > indices;
+   loadVectorVectorInt(ifs, indices);
+
+   val = IncidenceMatrix(0, cols);
+   val.addRows(indices.size());
+   for(unsigned int i = 0; i < indices.size(); ++i) {
+      val.resizeRow(i, indices[i].size());
+      std::copy(indices[i].begin(), indices[i].end(), val.rowBegin(i));
+   }
+   assert(val.n_rows == (unsigned int)rows);
 }
 
 
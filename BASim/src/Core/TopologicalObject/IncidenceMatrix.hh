@@ -2,34 +2,53 @@
 * \file IncidenceMatrix.hh
 *
 * \author batty@cs.columbia.edu
-* \date 04/07/2011 
+* \date 04/07/2011
 */
 
 #ifndef INCIDENCEMATRIX_HH
 #define INCIDENCEMATRIX_HH
 
 #include <cassert>
+#include <cstdlib>
 #include <vector>
 #include <fstream>
 
 namespace BASim {
 
-  //A simple std::vector-based sparse compressed row incidence matrix 
+  //A simple std::vector-based sparse compressed row incidence matrix
   //to store the topology of our simplex mesh structure.
   //It needs to be resize-able in order to add/delete simplices.
+  //
+  //All rows share one contiguous array. Each row owns a slot [start, start+capacity)
+  //in it, of which the first "length" entries are in use, so rows can grow in place
+  //until their slack runs out. A full row is moved to the end of the array with doubled
+  //capacity, leaving a hole; holes are reclaimed by compact(), which is also triggered
+  //automatically once they exceed half of the storage still owned by rows.
   class IncidenceMatrix {
 
-    //We could also swap this for a more highly tuned dynamic sparse matrix structure,
-    //if there's an appropriate one.
-
   private:
 
     //Matrix dimensions
     unsigned int n_rows, n_cols;
 
-    //For each row, a list of all column indices (sorted). The sign indicates whether the value is intended to be: +1 or -1.
+    //For each row, all column indices (sorted). The sign indicates whether the value is intended to be: +1 or -1.
     //NOTE: We shift all column indices up by 1, so the zero'th column is enabled to have a sign!
-    std::vector< std::vector<int> > m_indices; 
+    std::vector<int> m_data;
+
+    //Per-row slot within m_data
+    std::vector<unsigned int> m_rowStart;
+    std::vector<unsigned int> m_rowLength;
+    std::vector<unsigned int> m_rowCapacity;
+
+    //Number of entries in m_data no longer owned by any row
+    unsigned int m_wasted;
+
+    //Make room for at least the given number of entries in row i
+    void reserveRow(unsigned int i, unsigned int capacity);
+    void resizeRow(unsigned int i, unsigned int length);
+
+    int* rowBegin(unsigned int i) { return &m_data[0] + m_rowStart[i]; }
+    const int* rowBegin(unsigned int i) const { return &m_data[0] + m_rowStart[i]; }
 
   public:
     IncidenceMatrix();
@@ -50,19 +69,33 @@ namespace BASim {
     void zeroAll();
 
     //Constant-time access within the row, by row-index rather than column number
-    unsigned int getNumEntriesInRow(unsigned int row) const;
-    unsigned int getColByIndex(unsigned int i, unsigned int index_in_row) const;
-    int getValueByIndex(unsigned int i, unsigned int index_in_row) const;
-    
+    unsigned int getNumEntriesInRow(unsigned int row) const {
+      assert(row < n_rows);
+      return m_rowLength[row];
+    }
+    unsigned int getColByIndex(unsigned int i, unsigned int index_in_row) const {
+      assert(i < n_rows);
+      assert(index_in_row < m_rowLength[i]);
+      return abs(m_data[m_rowStart[i] + index_in_row]) - 1;
+    }
+    int getValueByIndex(unsigned int i, unsigned int index_in_row) const {
+      assert(i < n_rows);
+      assert(index_in_row < m_rowLength[i]);
+      return m_data[m_rowStart[i] + index_in_row] >= 0 ? 1 : -1;
+    }
+
     unsigned int getIndexByCol(unsigned int i, unsigned int col) const;
 
     void setByIndex(unsigned int i, unsigned int index_in_row, unsigned int col, int value);
-    
+
     void cycleRow(unsigned int i);
-    
+
+    //Pack all rows contiguously again, keeping a little slack in each one.
+    void compact();
+
     //Debugging
     void printMatrix() const;
-    
+
     //Serialization
     static void serialize(std::ofstream& of, const IncidenceMatrix& val);
     static void load(std::ifstream& ifs, IncidenceMatrix& val);
@@ -23,6 +23,8 @@ TopologicalObject::TopologicalObject()
   m_nf = 0;
   m_nt = 0;
 
+  m_topologyRevision = 0;
+
   m_validTE = false;
   m_validET = false;
   m_validVF = false;
@@ -85,8 +87,11 @@ VertexHandle TopologicalObject::addVertex()
   }
 
   m_nv += 1;
+  ++m_topologyRevision;
 
-  m_validVF = false;
+  //keep the cached vertex-face adjacency in step; a recycled slot already has an empty row
+  if(m_validVF && m_nbrsVF.getNumRows() < numVertexSlots())
+    m_nbrsVF.addRows(numVertexSlots() - m_nbrsVF.getNumRows());
 
   return VertexHandle(new_index);
 }
@@ -146,7 +151,7 @@ TopologicalObject::addEdge(const VertexHandle& v0, const VertexHandle& v1)
 
   //adjust edge count
   m_ne += 1;
-
+  ++m_topologyRevision;
   
   return EdgeHandle(new_index);
 }
@@ -250,9 +255,10 @@ TopologicalObject::addFace(const EdgeHandle& e0,
   m_EF.set(e2.idx(), new_index, flip2?-1:1);
 
   m_nf += 1;
+  ++m_topologyRevision;
   
-  //invalidate the relevant cached neighbour data
-  m_validVF = false;
+  //patch the relevant cached neighbour data
+  addFaceToNbrsVF(FaceHandle(new_index));
   
   return FaceHandle(new_index);
 }
@@ -317,6 +323,7 @@ TopologicalObject::addTet(const FaceHandle& f0,
   m_FT.set(f3.idx(), new_index, flip3?1:-1);
 
   m_nt += 1;
+  ++m_topologyRevision;
 
   //invalidate the relevant cached neighbour data
   m_validTV = false;
@@ -341,8 +348,9 @@ bool TopologicalObject::deleteVertex(const VertexHandle& vertex)
 
   //adjust the vertex count
   m_nv -= 1;
+  ++m_topologyRevision;
   
-  m_validVF = false;
+  //an orphaned vertex has no incident faces, so the cached vertex-face data is unaffected
 
   return true;
 }
@@ -374,6 +382,7 @@ bool TopologicalObject::deleteEdge(const EdgeHandle& edge, bool recurse)
 
   //adjust the edge count
   m_ne -= 1;
+  ++m_topologyRevision;
 
   return true;
 }
@@ -386,6 +395,9 @@ bool TopologicalObject::deleteFace(const FaceHandle& face, bool recurse)
   if(m_FT.getNumEntriesInRow(face.idx()) != 0)
     return false;
 
+  //patch cached relationships while the face's vertices can still be looked up
+  removeFaceFromNbrsVF(face);
+
   //determine the corresponding edges
   unsigned int loop_end = m_FE.getNumEntriesInRow(face.idx());
   for(unsigned int i = 0; i < loop_end; ++i) {
@@ -405,9 +417,7 @@ bool TopologicalObject::deleteFace(const FaceHandle& face, bool recurse)
 
   //adjust the face count
   m_nf -= 1;
-
-  //invalidate cached relationships
-  m_validVF = false;
+  ++m_topologyRevision;
 
   return true;
 }
@@ -437,6 +447,7 @@ bool TopologicalObject::deleteTet(const tet_handle& tet, bool recurse) {
 
   //adjust the tet count
   m_nt -= 1;
+  ++m_topologyRevision;
   
   //invalidate cached relationships
   m_validTV = false;
@@ -620,6 +631,35 @@ void TopologicalObject::compute_nbrsVF() const {
 
 }
 
+void TopologicalObject::addFaceToNbrsVF(const FaceHandle& face) const {
+  //nothing to patch if the cache will be rebuilt from scratch anyway
+  if(!m_validVF)
+    return;
+
+  if(m_nbrsVF.getNumCols() < numFaceSlots())
+    m_nbrsVF.addCols(numFaceSlots() - m_nbrsVF.getNumCols());
+
+  //each vertex is seen twice (once per edge using it), but set() ignores repeats
+  unsigned int loop_end = m_FE.getNumEntriesInRow(face.idx());
+  for(unsigned int e = 0; e < loop_end; ++e) {
+    unsigned int edge_idx = m_FE.getColByIndex(face.idx(), e);
+    m_nbrsVF.set(m_EV.getColByIndex(edge_idx, 0), face.idx(), 1);
+    m_nbrsVF.set(m_EV.getColByIndex(edge_idx, 1), face.idx(), 1);
+  }
+}
+
+void TopologicalObject::removeFaceFromNbrsVF(const FaceHandle& face) const {
+  if(!m_validVF)
+    return;
+
+  unsigned int loop_end = m_FE.getNumEntriesInRow(face.idx());
+  for(unsigned int e = 0; e < loop_end; ++e) {
+    unsigned int edge_idx = m_FE.getColByIndex(face.idx(), e);
+    m_nbrsVF.zero(m_EV.getColByIndex(edge_idx, 0), face.idx());
+    m_nbrsVF.zero(m_EV.getColByIndex(edge_idx, 1), face.idx());
+  }
+}
+
 VertexHandle TopologicalObject::collapseEdge(const EdgeHandle& eh, const VertexHandle& vertToRemove, std::vector<EdgeHandle>& deletedEdges) {
   
   VertexHandle fromV = fromVertex(eh);
@@ -647,6 +687,18 @@ VertexHandle TopologicalObject::collapseEdge(const EdgeHandle& eh, const VertexH
   bool success = deleteEdge(eh, false);
   assert(success);
   
+  //the remaining faces around the eliminated vertex are about to be relabelled to use 
+  //the kept vertex, so move them over in the cached vertex-face data too.
+  //(Faces that used both vertices contained the collapsing edge and are already gone.)
+  if(m_validVF) {
+    std::vector<int> movedFaces;
+    unsigned int loop_endVF = m_nbrsVF.getNumEntriesInRow(vertToRemove.idx());
+    for(unsigned int f = 0; f < loop_endVF; ++f)
+      movedFaces.push_back(m_nbrsVF.getColByIndex(vertToRemove.idx(), f));
+    m_nbrsVF.zeroRow(vertToRemove.idx());
+    for(unsigned int f = 0; f < movedFaces.size(); ++f)
+      m_nbrsVF.set(vertToKeep, movedFaces[f], 1);
+  }
   
   //determine all existing edges using the vertex being eliminated
   std::vector< std::pair<int,int> > edgeIndices;
@@ -741,9 +793,6 @@ VertexHandle TopologicalObject::collapseEdge(const EdgeHandle& eh, const VertexH
     assert(success);
   }
   
-  //invalidate the relevant cached neighbour data
-  m_validVF = false;
-
   success = deleteVertex(vertToRemove);
   assert(success);
   
@@ -801,6 +850,14 @@ void TopologicalObject::loadStructure(std::ifstream& ifs, TopologicalObject& obj
   loadVectorUint(ifs, dead);
   obj.m_deadTets.assign(dead.begin(), dead.end());
 
+  //the cached neighbour data no longer matches the loaded structure
+  obj.m_validVF = false;
+  obj.m_validTV = false;
+  obj.m_validVT = false;
+  obj.m_validTE = false;
+  obj.m_validET = false;
+  ++obj.m_topologyRevision;
+
 }
 
 } //namespace BASim
@@ -90,6 +90,9 @@ public:
   unsigned int edgeIncidentFaces(const EdgeHandle& e) const { return m_EF.getNumEntriesInRow(e.idx()); }
   unsigned int faceIncidentTets(const FaceHandle& f) const { return m_FT.getNumEntriesInRow(f.idx()); }
 
+  /** Counter that changes with every topology edit, so that external copies of the mesh can detect that they are stale */
+  unsigned int getTopologyRevision() const { return m_topologyRevision; }
+
   /** Add a vertex to the object */
   VertexHandle addVertex();
   /** Add an edge that connects the two given vertices, directed from v0 to v1 */
@@ -336,6 +339,8 @@ protected:
 
   int m_nv, m_ne, m_nf, m_nt;
 
+  unsigned int m_topologyRevision;
+
   //New Topological Data Structure (Incidence graph, a la "Building Your Own DEC At Home", Elcott & Schroder 2005
   
   //Fundamental mesh data
@@ -365,6 +370,11 @@ protected:
   mutable IncidenceMatrix m_nbrsTE, m_nbrsET;
 
   void compute_nbrsVF() const;
+
+  //Local updates of the vertex-face cache, so that topology edits don't force a full 
+  //recompute on the next VertexFaceIterator. These are no-ops while the cache is invalid.
+  void addFaceToNbrsVF(const FaceHandle& face) const;
+  void removeFaceFromNbrsVF(const FaceHandle& face) const;
   /*void compute_nbrsTV();
   void compute_nbrsVT();
   void compute_nbrsTE();
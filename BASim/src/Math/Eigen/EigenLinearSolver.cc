@@ -5,35 +5,71 @@
 
 namespace BASim {
 
-   EigenLinearSolver::EigenLinearSolver(MatrixBase& A)
-      : LinearSolverBase(A)
+   int EigenLinearSolver::s_numSolves = 0;
+   int EigenLinearSolver::s_numAnalyses = 0;
+
+   EigenLinearSolver::EigenLinearSolver(MatrixBase& A, bool reusePattern)
+      : LinearSolverBase(A), m_reusePattern(reusePattern), m_analyzed(false), m_patternRows(0)
 
    {
       assert(m_A.rows() == m_A.cols());
    }
 
+   bool EigenLinearSolver::samePattern(const ColMatrix& matrix) const
+   {
+      if(matrix.rows() != m_patternRows || matrix.nonZeros() != (int)m_patternInner.size())
+         return false;
+
+      const ColMatrix::Index* outer = matrix.outerIndexPtr();
+      for(int i = 0; i <= matrix.outerSize(); ++i)
+         if(outer[i] != m_patternOuter[i])
+            return false;
+
+      const ColMatrix::Index* inner = matrix.innerIndexPtr();
+      for(unsigned int i = 0; i < m_patternInner.size(); ++i)
+         if(inner[i] != m_patternInner[i])
+            return false;
+
+      return true;
+   }
+
+   void EigenLinearSolver::storePattern(const ColMatrix& matrix)
+   {
+      m_patternRows = matrix.rows();
+      m_patternOuter.assign(matrix.outerIndexPtr(), matrix.outerIndexPtr() + matrix.outerSize() + 1);
+      m_patternInner.assign(matrix.innerIndexPtr(), matrix.innerIndexPtr() + matrix.nonZeros());
+   }
 
    int EigenLinearSolver::solve(VecXd& x, const VecXd& b)
    {
-      const Eigen::SparseMatrix<Scalar>& matrix = smart_cast<EigenSparseMatrix&>(m_A).getEigenMatrix();
+      //The solver wants column-major storage; the matrix is symmetric, so this is just a copy
+      ColMatrix matrix = smart_cast<EigenSparseMatrix&>(m_A).getEigenMatrix();
+      matrix.makeCompressed();
 
-      Eigen::SimplicialLDLT< Eigen::SparseMatrix<Scalar> > llt_of_A;
-      llt_of_A.compute(matrix);
+      ++s_numSolves;
+      if(!m_reusePattern || !m_analyzed || !samePattern(matrix)) {
+         m_ldlt.analyzePattern(matrix);
+         storePattern(matrix);
+         m_analyzed = true;
+         ++s_numAnalyses;
+      }
+      m_ldlt.factorize(matrix);
 
-      if(llt_of_A.info() != Eigen::Success) {
-         // decomposition failed
+      if(m_ldlt.info() != Eigen::Success) {
+         // decomposition failed; analyze from scratch next time
          std::cout << "Eigen's LDLT Decomposition failed\n";
+         m_analyzed = false;
          return -1;
       }
-      x = llt_of_A.solve(b);
-      if(!llt_of_A.info() != Eigen::Success) {
+      x = m_ldlt.solve(b);
+      if(m_ldlt.info() != Eigen::Success) {
          // solving failed
          std::cout << "Eigen's LDLT solve failed\n";
          return -1;
       }
 
-      std::cout << "Solve successful\n";
+      std::cout << "Solve successful (" << s_numAnalyses << " pattern analyses in " << s_numSolves << " solves)\n";
       return 0;
    }
 
-}
\ No newline at end of file
+}
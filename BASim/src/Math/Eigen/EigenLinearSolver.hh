@@ -9,15 +9,22 @@
 #define EIGENLINEARSOLVER_HH
 
 #include "BASim/src/Math/LinearSolverBase.hh"
+#include <Eigen/Sparse>
 
 namespace BASim {
 
-/** Linear solver that uses PETSc. */
+/** Linear solver that uses Eigen's sparse LDLt factorization.
+ *
+ * Unless disabled, the ordering and symbolic analysis are kept across
+ * calls to solve(), and are only redone when the sparsity pattern of the
+ * matrix changes (typically after remeshing). Otherwise only the numeric
+ * factorization is recomputed.
+ */
 class EigenLinearSolver : public LinearSolverBase
 {
 public:
 
-  EigenLinearSolver (MatrixBase& A);
+  EigenLinearSolver (MatrixBase& A, bool reusePattern = true);
 
   ~EigenLinearSolver ()
   {
@@ -27,6 +34,34 @@ public:
   
   int solve(VecXd& x, const VecXd& b);
 
+  void setReusePattern(bool reuse) { m_reusePattern = reuse; m_analyzed = false; }
+  bool getReusePattern() const { return m_reusePattern; }
+
+  /** Statistics summed over all instances, since a new solver is created
+   * whenever the number of degrees of freedom changes. */
+  static int getNumSolves() { return s_numSolves; }
+  static int getNumAnalyses() { return s_numAnalyses; }
+  static void resetStatistics() { s_numSolves = 0; s_numAnalyses = 0; }
+
+protected:
+
+  typedef Eigen::SparseMatrix<Scalar> ColMatrix;
+
+  bool samePattern(const ColMatrix& matrix) const;
+  void storePattern(const ColMatrix& matrix);
+
+  Eigen::SimplicialLDLt<ColMatrix> m_ldlt;
+
+  bool m_reusePattern;
+  bool m_analyzed;
+
+  //Fingerprint of the pattern m_ldlt was analyzed for: the compressed column structure
+  int m_patternRows;
+  std::vector<ColMatrix::Index> m_patternOuter;
+  std::vector<ColMatrix::Index> m_patternInner;
+
+  static int s_numSolves;
+  static int s_numAnalyses;
 };
 
 } // namespace BASim
@@ -1,37 +1,140 @@
 #include "EigenSparseMatrix.hh"
 
+#include <algorithm>
+
 namespace BASim {
 
 int EigenSparseMatrix::setZero()
 {
   if(m_pattern_fixed) {
-    //iterate through the matrix and explicitly zero the entries (this should leave the structure intact?)
-    for (int k=0; k<m_dynamic.outerSize(); ++k) {
-      for (Eigen::SparseMatrix<Scalar,Eigen::RowMajor>::InnerIterator it(m_dynamic,k); it; ++it)
-      {
-        m_dynamic.coeffRef(it.row(), it.col()) = 0;
-      }
-    }
+    //zero the values in place, leaving the structure (and the scatter offsets into it) intact
+    if(m_dynamic.nonZeros() > 0)
+      std::fill(m_dynamic.valuePtr(), m_dynamic.valuePtr() + m_dynamic.nonZeros(), Scalar(0));
   }
   else {
     m_triplets.clear();
+    m_blocks.clear();
+    m_blockIndices.clear();
+    m_scatter.clear();
   }
+  m_cursor = 0;
 
   return 0;
 }
 
 int EigenSparseMatrix::resetNonzeros() {
 
-  //m_dynamic = Eigen::SparseMatrix<Scalar,Eigen::RowMajor>(m_rows, m_cols);
-  m_pattern_fixed = false;
+  //The current pattern is kept as a guess for the next assembly, and is only
+  //rebuilt if the blocks added don't match the ones it was built from.
+  setZero();
+  return 0;
+}
+
+const int* EigenSparseMatrix::nextBlock(const int* rows, int nrows, const int* cols, int ncols)
+{
+  if(m_pattern_fixed) {
+    if(m_cursor < m_blocks.size()) {
+      const AssemblyBlock& block = m_blocks[m_cursor];
+      if(block.nrows == nrows && block.ncols == ncols &&
+         std::equal(rows, rows + nrows, m_blockIndices.begin() + block.indexStart) &&
+         std::equal(cols, cols + ncols, m_blockIndices.begin() + block.indexStart + nrows)) {
+        ++m_cursor;
+        return &m_scatter[block.scatterStart];
+      }
+    }
+    unfixPattern();
+  }
+
+  recordBlock(rows, nrows, cols, ncols);
+  return NULL;
+}
+
+void EigenSparseMatrix::recordBlock(const int* rows, int nrows, const int* cols, int ncols)
+{
+  AssemblyBlock block;
+  block.indexStart = m_blockIndices.size();
+  block.nrows = nrows;
+  block.ncols = ncols;
+  block.scatterStart = m_scatter.size();
+  m_blocks.push_back(block);
+
+  m_blockIndices.insert(m_blockIndices.end(), rows, rows + nrows);
+  m_blockIndices.insert(m_blockIndices.end(), cols, cols + ncols);
+  m_scatter.resize(m_scatter.size() + nrows*ncols, -1);
+  ++m_cursor;
+}
+
+void EigenSparseMatrix::computeScatter()
+{
+  m_dynamic.makeCompressed();
+  const int* outer = m_dynamic.outerIndexPtr();
+  const int* inner = m_dynamic.nonZeros() > 0 ? m_dynamic.innerIndexPtr() : NULL;
+
+  for(unsigned int b = 0; b < m_blocks.size(); ++b) {
+    const AssemblyBlock& block = m_blocks[b];
+    const int* rows = &m_blockIndices[block.indexStart];
+    const int* cols = rows + block.nrows;
+    int* scatter = &m_scatter[block.scatterStart];
+    for(int i = 0; i < block.nrows; ++i) {
+      for(int j = 0; j < block.ncols; ++j, ++scatter) {
+        if(rows[i] < 0 || cols[j] < 0) {
+          *scatter = -1;
+          continue;
+        }
+        const int* p = std::lower_bound(inner + outer[rows[i]], inner + outer[rows[i]+1], cols[j]);
+        assert(p != inner + outer[rows[i]+1] && *p == cols[j]);
+        *scatter = p - inner;
+      }
+    }
+  }
+}
+
+void EigenSparseMatrix::unfixPattern()
+{
+  //Turn what the blocks matched so far contributed back into triplets. Each entry is
+  //cleared once read, so that entries shared by several blocks are only counted once.
+  Scalar* data = m_dynamic.valuePtr();
   m_triplets.clear();
-   return 0;
+  for(unsigned int b = 0; b < m_cursor; ++b) {
+    const AssemblyBlock& block = m_blocks[b];
+    const int* rows = &m_blockIndices[block.indexStart];
+    const int* cols = rows + block.nrows;
+    const int* scatter = &m_scatter[block.scatterStart];
+    for(int i = 0; i < block.nrows; ++i) {
+      for(int j = 0; j < block.ncols; ++j, ++scatter) {
+        if(*scatter < 0) continue;
+        m_triplets.push_back( Eigen::Triplet<Scalar>(rows[i], cols[j], data[*scatter]) );
+        data[*scatter] = 0;
+      }
+    }
+  }
+
+  //keep the recording of the matched prefix; whatever follows is recorded afresh
+  if(m_cursor < m_blocks.size()) {
+    m_blockIndices.resize(m_blocks[m_cursor].indexStart);
+    m_scatter.resize(m_blocks[m_cursor].scatterStart);
+    m_blocks.resize(m_cursor);
+  }
+  m_pattern_fixed = false;
+}
+
+//The stored value of entry (row, col), or NULL if it is not in the pattern
+static Scalar* findEntry(Eigen::SparseMatrix<Scalar,Eigen::RowMajor>& m, int row, int col)
+{
+  const int* outer = m.outerIndexPtr();
+  const int* inner = m.innerIndexPtr();
+  int end = m.isCompressed() ? outer[row+1] : outer[row] + m.innerNonZeroPtr()[row];
+  const int* p = std::lower_bound(inner + outer[row], inner + end, col);
+  if(p == inner + end || *p != col)
+    return NULL;
+  return m.valuePtr() + (p - inner);
 }
 
 int EigenSparseMatrix::zeroRows(const IntArray& idx, Scalar diag)
 {
   
   //NOTE: This zeros rows AND symmetric columns, since that seems quickest.
+  //Only entries already in the pattern are touched: an insertion would invalidate the scatter offsets.
   for(unsigned int i = 0; i < idx.size(); ++i) {
     int row = idx[i];
     //iterate across the row zeroing entries
@@ -39,11 +142,15 @@ int EigenSparseMatrix::zeroRows(const IntArray& idx, Scalar diag)
     {
       int col = it.col();
       if(col != row) {
-        m_dynamic.coeffRef(row, col) = 0; //zero it out
-        m_dynamic.coeffRef(col, row) = 0; //zero the opposite assuming symmetry, since doing zeroCols properly is slower.
+        it.valueRef() = 0; //zero it out
+        
+        //zero the opposite assuming symmetry, since doing zeroCols properly is slower.
+        Scalar* mirror = findEntry(m_dynamic, col, row);
+        if(mirror)
+          *mirror = 0;
       }
       else
-        m_dynamic.coeffRef(row, col) = diag;
+        it.valueRef() = diag;
     }
   }
   /*
@@ -76,9 +183,15 @@ int EigenSparseMatrix::finalize()
 }
 
 int EigenSparseMatrix::finalizeNonzeros() {
+  //fewer blocks than last time: rebuild, so the pattern doesn't keep entries nothing adds to
+  if(m_pattern_fixed && m_cursor != m_blocks.size())
+    unfixPattern();
+
   if(!m_pattern_fixed) {
     m_pattern_fixed = true;
     m_dynamic.setFromTriplets(m_triplets.begin(), m_triplets.end());
+    m_triplets.clear();
+    computeScatter();
   }
   return 0;
 }
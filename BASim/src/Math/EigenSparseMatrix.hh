@@ -29,6 +29,7 @@ public:
   int add(const IntArray& rowIdx, const IntArray& colIdx, const MatXd& values);
   int add(const IndexArray& rowIdx, const IndexArray& colIdx,
           const MatXd& values);
+  int addBlock(const int* indices, int n, const Scalar* values, int stride, Scalar scale);
   int scale(Scalar val);
   int setZero();
   int zeroRows(const IntArray& idx, Scalar diag = 1.0);
@@ -53,6 +54,20 @@ public:
   Eigen::SparseMatrix<Scalar,Eigen::RowMajor>& getEigenMatrix() { return m_dynamic; }
 
 protected:
+
+  //One add() call, as recorded while the pattern was being built
+  struct AssemblyBlock {
+    int indexStart;   //rows, then columns, in m_blockIndices
+    int nrows, ncols;
+    int scatterStart; //offsets of the entries (row by row) in m_scatter
+  };
+
+  //Returns the value-array offsets for the block if it matches the next recorded one, or NULL after
+  //recording it (in which case its entries must be added as triplets).
+  const int* nextBlock(const int* rows, int nrows, const int* cols, int ncols);
+  void recordBlock(const int* rows, int nrows, const int* cols, int ncols);
+  void computeScatter();
+  void unfixPattern();
   
   //build matrix as a list of triplets
   std::vector< Eigen::Triplet<Scalar> > m_triplets;
@@ -61,6 +76,16 @@ protected:
   Eigen::SparseMatrix<Scalar, Eigen::RowMajor> m_dynamic;
 
   bool m_pattern_fixed;
+
+  //Assembly recording. Each add() is logged as a block while the pattern is built from triplets; once
+  //it is fixed, every block entry gets its offset in the value array. A later assembly that issues the
+  //same sequence of blocks (i.e. as long as the topology doesn't change) then adds straight into the
+  //values. If the sequence diverges, the entries added so far are turned back into triplets and the
+  //pattern is rebuilt at the next finalizeNonzeros().
+  std::vector<AssemblyBlock> m_blocks;
+  std::vector<int> m_blockIndices;
+  std::vector<int> m_scatter;
+  unsigned int m_cursor;
   
 };
 
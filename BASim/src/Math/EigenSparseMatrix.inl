@@ -6,12 +6,12 @@
  */
 
 inline EigenSparseMatrix::EigenSparseMatrix(int s)
-  : MatrixBase(s, s), m_dynamic(s,s), m_pattern_fixed(false)
+  : MatrixBase(s, s), m_dynamic(s,s), m_pattern_fixed(false), m_cursor(0)
 {
 }
 
 inline EigenSparseMatrix::EigenSparseMatrix(int r, int c, int nnz)
-  : MatrixBase(r, c), m_dynamic(r,c), m_pattern_fixed(false)
+  : MatrixBase(r, c), m_dynamic(r,c), m_pattern_fixed(false), m_cursor(0)
 {
   //nnz is est #per row, so multiply to get a good estimate.
   m_triplets.reserve(nnz);
@@ -19,7 +19,8 @@ inline EigenSparseMatrix::EigenSparseMatrix(int r, int c, int nnz)
 }
 
 inline EigenSparseMatrix::EigenSparseMatrix(const EigenSparseMatrix& M)
-  : MatrixBase(m_rows, m_cols), m_dynamic(M.m_dynamic), m_triplets(M.m_triplets), m_pattern_fixed(M.m_pattern_fixed)
+  : MatrixBase(m_rows, m_cols), m_dynamic(M.m_dynamic), m_triplets(M.m_triplets), m_pattern_fixed(M.m_pattern_fixed),
+    m_blocks(M.m_blocks), m_blockIndices(M.m_blockIndices), m_scatter(M.m_scatter), m_cursor(M.m_cursor)
 {
 }
 
@@ -45,8 +46,11 @@ inline int EigenSparseMatrix::set(int r, int c, Scalar val)
 
 inline int EigenSparseMatrix::add(int r, int c, Scalar val)
 {
-  if(m_pattern_fixed)
-    m_dynamic.coeffRef(r,c) += val;
+  const int* scatter = nextBlock(&r, 1, &c, 1);
+  if(scatter) {
+    if(scatter[0] >= 0)
+      m_dynamic.valuePtr()[scatter[0]] += val;
+  }
   else
     m_triplets.push_back( Eigen::Triplet<Scalar>(r,c,val) );
   
@@ -56,10 +60,17 @@ inline int EigenSparseMatrix::add(int r, int c, Scalar val)
 inline int EigenSparseMatrix::add(const IntArray& rowIdx, const IntArray& colIdx,
                             const MatXd& values)
 {
-  if(m_pattern_fixed) {
+  if(rowIdx.empty() || colIdx.empty())
+    return 0;
+
+  const int* scatter = nextBlock(&rowIdx[0], rowIdx.size(), &colIdx[0], colIdx.size());
+  if(scatter) {
+    Scalar* data = m_dynamic.valuePtr();
     for(unsigned int i = 0; i < rowIdx.size(); ++i) {
       for(unsigned int j = 0; j < colIdx.size(); ++j) {
-        m_dynamic.coeffRef(rowIdx[i], colIdx[j]) += values(i,j);
+        if(*scatter >= 0)
+          data[*scatter] += values(i,j);
+        ++scatter;
       }
     }
   }
@@ -77,10 +88,17 @@ inline int EigenSparseMatrix::add(const IntArray& rowIdx, const IntArray& colIdx
 inline int EigenSparseMatrix::add(const IndexArray& rowIdx, const IndexArray& colIdx,
                             const MatXd& values)
 {
-  if(m_pattern_fixed) {
+  if(rowIdx.size() == 0 || colIdx.size() == 0)
+    return 0;
+
+  const int* scatter = nextBlock(rowIdx.data(), rowIdx.size(), colIdx.data(), colIdx.size());
+  if(scatter) {
+    Scalar* data = m_dynamic.valuePtr();
     for(int i = 0; i < rowIdx.size(); ++i) {
       for(int j = 0; j < colIdx.size(); ++j) {
-        m_dynamic.coeffRef(rowIdx[i], colIdx[j]) += values(i,j);
+        if(*scatter >= 0)
+          data[*scatter] += values(i,j);
+        ++scatter;
       }
     }
   }
@@ -95,6 +113,34 @@ inline int EigenSparseMatrix::add(const IndexArray& rowIdx, const IndexArray& co
   return 0;
 }
 
+inline int EigenSparseMatrix::addBlock(const int* indices, int n, const Scalar* values, int stride, Scalar scale)
+{
+  if(n == 0)
+    return 0;
+
+  const int* scatter = nextBlock(indices, n, indices, n);
+  if(scatter) {
+    Scalar* data = m_dynamic.valuePtr();
+    for(int i = 0; i < n; ++i) {
+      for(int j = 0; j < n; ++j, ++scatter) {
+        if(*scatter >= 0)
+          data[*scatter] += scale * values[j*stride + i];
+      }
+    }
+  }
+  else {
+    for(int i = 0; i < n; ++i) {
+      if(indices[i] < 0) continue;
+      for(int j = 0; j < n; ++j) {
+        if(indices[j] < 0) continue;
+        m_triplets.push_back( Eigen::Triplet<Scalar>(indices[i],indices[j],scale * values[j*stride + i]) );
+      }
+    }
+  }
+
+  return 0;
+}
+
 inline bool EigenSparseMatrix::isApproxSymmetric( Scalar eps ) const 
 {
   //TODO Fill this in.
@@ -38,6 +38,25 @@ public:
     virtual int add(int i, int j, Scalar val) = 0;
     virtual int add(const IntArray& rowIdx, const IntArray& colIdx, const MatXd& values) = 0;
     virtual int add(const IndexArray& rowIdx, const IndexArray& colIdx, const MatXd& values) = 0;
+
+    /**
+     * Adds scale * values to the square block whose rows and columns are both given by indices[0..n).
+     * values is a column-major array with leading dimension stride, so that a fixed-size element matrix
+     * (or its top-left corner) can be passed directly. Negative indices are skipped.
+     */
+    virtual int addBlock(const int* indices, int n, const Scalar* values, int stride, Scalar scale)
+    {
+        for (int j = 0; j < n; ++j)
+        {
+            if (indices[j] < 0)
+                continue;
+            for (int i = 0; i < n; ++i)
+                if (indices[i] >= 0)
+                    add(indices[i], indices[j], scale * values[j * stride + i]);
+        }
+        return 0;
+    }
+
     virtual void edgeStencilAdd(int start, const Eigen::Matrix<Scalar, 6, 6>& localJ) = 0;
     virtual void vertexStencilAdd(int start, const Eigen::Matrix<Scalar, 11, 11>& localJ) = 0;
     virtual void pointStencilAdd(int start, const Eigen::Matrix<Scalar, 3, 3>& localJ) = 0;
@@ -6,8 +6,10 @@
 #include "BASim/src/Collisions/ElTopo/ccd_wrapper.hh"
 //#include "BASim/src/Physics/DeformableObjects/Shells/CSTMembraneForce.hh"
 #include "BASim/src/Math/Math.hh"
+#include "BASim/src/Math/MatrixBase.hh"
 #include "BASim/src/Physics/DeformableObjects/Shells/ShellVertexPointSpringForce.hh"
 #include "BASim/src/Physics/DeformableObjects/Shells/ShellStickyRepulsionForce.hh"
+#include "BASim/src/Physics/DeformableObjects/Shells/ShellElTopoMirror.hh"
 #include "BASim/src/Collisions/ElTopo/collisionqueries.hh"
 
 #include "BASim/src/Collisions/ElTopo/array3.hh"
@@ -22,30 +24,41 @@
 namespace BASim {
   
 ElasticShell::ElasticShell(DeformableObject* object, const FaceProperty<char>& shellFaces, Scalar timestep, SteppingCallback * stepping_callback) : 
-  PhysicalModel(*object), m_obj(object), 
-    m_active_faces(shellFaces), 
+  PhysicalModel(*object),
+    m_remesh_t1transition(false),
+    m_remesh_smooth_subdivision(false),
 //    m_undef_xi(object),
 //    m_damping_undef_xi(object),
 //    m_vertex_masses(object),
 //    m_edge_masses(object),
 //    m_thicknesses(object),
-    m_face_regions(object),
-    m_vertex_constraint_labels(object),
 //    m_volumes(object),
 //    m_xi(object), 
 //    m_xi_vel(object),
+    m_do_remeshing(false),
+    m_remesh_edge_max_len(0),
+    m_remesh_edge_min_len(0),
+    m_remeshing_iters(0),
+//    m_momentum_conserving_remesh(false)
+//    m_do_thickness_updates(true),
+    m_do_eltopo_collisions(false),
 //    m_density(1),
-    m_collision_epsilon(1e-5),
+    m_active_faces(shellFaces), 
+    m_face_regions(object),
+    m_vertex_constraint_labels(object),
+    m_obj(object), 
     m_vert_point_springs(NULL),
     m_repulsion_springs(NULL),
+    m_collision_epsilon(1e-5),
+    m_ground_collisions(false),
     m_sphere_collisions(false),
     m_object_collisions(false),
-    m_ground_collisions(false),
-    m_do_eltopo_collisions(false),
-//    m_do_thickness_updates(true),
-//    m_momentum_conserving_remesh(false)
-    m_stepping_callback(stepping_callback)
+    m_stepping_callback(stepping_callback),
+    m_mesheventcallback(NULL),
+    m_num_threads(1)
 {
+  m_eltopo_mirror = new ShellElTopoMirror(*this);
+
   m_vert_point_springs = new ShellVertexPointSpringForce(*this, "VertPointSprings", timestep);
   m_repulsion_springs = new ShellStickyRepulsionForce(*this, "RepulsionSprings", timestep);
 
@@ -59,6 +72,7 @@ ElasticShell::~ElasticShell() {
   for(unsigned int i = 0; i < m_shell_forces.size(); ++i)
     delete m_shell_forces[i];
   
+  delete m_eltopo_mirror;
 }
 
 void ElasticShell::computeConservativeForcesEnergy( VecXd& force , Scalar& energy)
@@ -69,8 +83,15 @@ void ElasticShell::computeConservativeForcesEnergy( VecXd& force , Scalar& energ
   VecXd curr_force(force.size());
   for (fIt = forces.begin(); fIt != forces.end(); ++fIt) {
     curr_force.setZero();
-    (*fIt)->globalForce(curr_force);
-    energy += (*fIt)->globalEnergy();
+    int count = m_num_threads > 1 ? (*fIt)->prepareElements() : 0;
+    if(count > 0) {
+      parallelForce(**fIt, count, curr_force);
+      energy += parallelEnergy(**fIt, count);
+    }
+    else {
+      (*fIt)->globalForce(curr_force);
+      energy += (*fIt)->globalEnergy();
+    }
     force += curr_force;
   }
 
@@ -84,7 +105,11 @@ void ElasticShell::computeForces( VecXd& force )
   VecXd curr_force(force.size());
   for (fIt = forces.begin(); fIt != forces.end(); ++fIt) {
     curr_force.setZero();
-    (*fIt)->globalForce(curr_force);
+    int count = m_num_threads > 1 ? (*fIt)->prepareElements() : 0;
+    if(count > 0)
+      parallelForce(**fIt, count, curr_force);
+    else
+      (*fIt)->globalForce(curr_force);
     
     force += curr_force;
   }
@@ -96,8 +121,85 @@ void ElasticShell::computeJacobian( Scalar scale, MatrixBase& J )
   const std::vector<ElasticShellForce*>& forces = getForces();
   std::vector<ElasticShellForce*>::const_iterator fIt;
 
-  for (fIt = forces.begin(); fIt != forces.end(); ++fIt)
-    (*fIt)->globalJacobian(scale, J);
+  for (fIt = forces.begin(); fIt != forces.end(); ++fIt) {
+    int count = m_num_threads > 1 ? (*fIt)->prepareElements() : 0;
+    if(count > 0)
+      parallelJacobian(**fIt, count, scale, J);
+    else
+      (*fIt)->globalJacobian(scale, J);
+  }
+}
+
+//The element range [0, count) is cut into one contiguous chunk per thread. The chunk 
+//boundaries depend only on count and m_num_threads, and per-chunk results are combined 
+//in chunk order, so the sums do not depend on how OpenMP schedules the chunks.
+static inline int chunkBoundary(int count, int num_chunks, int c)
+{
+  return (int)(((long long)count * c) / num_chunks);
+}
+
+Scalar ElasticShell::parallelEnergy( const ElasticShellForce& shellForce, int count ) const
+{
+  int num_chunks = std::min(m_num_threads, count);
+  std::vector<Scalar> partial(num_chunks, 0);
+
+#pragma omp parallel for schedule(static) num_threads(num_chunks)
+  for(int c = 0; c < num_chunks; ++c)
+    partial[c] = shellForce.elementRangeEnergy(chunkBoundary(count, num_chunks, c), chunkBoundary(count, num_chunks, c+1));
+
+  Scalar energy = 0;
+  for(int c = 0; c < num_chunks; ++c)
+    energy += partial[c];
+  return energy;
+}
+
+void ElasticShell::parallelForce( const ElasticShellForce& shellForce, int count, VecXd& force ) const
+{
+  int num_chunks = std::min(m_num_threads, count);
+  std::vector<VecXd> partial(num_chunks);
+
+#pragma omp parallel for schedule(static) num_threads(num_chunks)
+  for(int c = 0; c < num_chunks; ++c) {
+    partial[c].setZero(force.size());
+    shellForce.elementRangeForce(chunkBoundary(count, num_chunks, c), chunkBoundary(count, num_chunks, c+1), partial[c]);
+  }
+
+  //reduce per dof, always summing the chunks in the same order
+  int ndof = force.size();
+#pragma omp parallel for schedule(static) num_threads(m_num_threads)
+  for(int i = 0; i < ndof; ++i)
+    for(int c = 0; c < num_chunks; ++c)
+      force[i] += partial[c][i];
+}
+
+void ElasticShell::parallelJacobian( const ElasticShellForce& shellForce, int count, Scalar scale, MatrixBase& J ) const
+{
+  //Element blocks are computed in parallel one batch at a time, then added to J serially
+  //in element order. The order of addBlock calls is the same as for a serial loop, so
+  //matrices with a fixed block pattern (EigenSparseMatrix) keep scattering directly.
+  const int batch_size = 1024 * m_num_threads;
+  int n = shellForce.elementBlockSize();
+  int batch = std::min(batch_size, count);
+  
+  std::vector<int> indices(batch * n);
+  std::vector<Scalar> blocks(batch * n * n);
+  std::vector<char> valid(batch);
+
+  for(int begin = 0; begin < count; begin += batch_size) {
+    int end = std::min(begin + batch_size, count);
+    int num_chunks = std::min(m_num_threads, end - begin);
+
+#pragma omp parallel for schedule(static) num_threads(num_chunks)
+    for(int c = 0; c < num_chunks; ++c) {
+      int cb = chunkBoundary(end - begin, num_chunks, c);
+      int ce = chunkBoundary(end - begin, num_chunks, c+1);
+      shellForce.elementRangeJacobian(begin + cb, begin + ce, &indices[cb * n], &blocks[cb * n * n], &valid[cb]);
+    }
+
+    for(int e = 0; e < end - begin; ++e)
+      if(valid[e])
+        J.addBlock(&indices[e * n], n, &blocks[e * n * n], n, scale);
+  }
 }
 
 const std::vector<ElasticShellForce*>& ElasticShell::getForces() const
@@ -444,69 +546,12 @@ void ElasticShell::startStep(Scalar time, Scalar timestep)
 
 void ElasticShell::resolveCollisions(Scalar timestep) {
   std::cout << "Resolving collisions with El Topo\n";
-  //Convert the data to the form required by El Topo!
-  std::vector<ElTopo::Vec3d> vert_new, vert_old;
-  std::vector<ElTopo::Vec3st> tri_data;
-  std::vector<ElTopo::Vec3d> masses;
-
-  DeformableObject& mesh = getDefoObj();
-
-  //Index mappings between us and El Topo
-  VertexProperty<int> vert_numbers(&mesh);
-  FaceProperty<int> face_numbers(&mesh);
-  std::vector<VertexHandle> reverse_vertmap;
-  std::vector<FaceHandle> reverse_trimap;
-
-  //walk through vertices, create linear list, store numbering
-  int id = 0;
-  for(VertexIterator vit = mesh.vertices_begin(); vit != mesh.vertices_end(); ++vit) {
-    VertexHandle vh = *vit;
-    Vec3d vert = getVertexPosition(vh);
-    Vec3d old_vert = getVertexDampingUndeformed(vh);
-//    Scalar mass = getMass(vh);
-    ElTopo::Vec3d mass(1, 1, 1);
-
-    vert_new.push_back(ElTopo::Vec3d(vert[0], vert[1], vert[2]));
-    vert_old.push_back(ElTopo::Vec3d(old_vert[0], old_vert[1], old_vert[2]));
-    for (int i = 0; i < 3; i++)
-      if (getDefoObj().isConstrainedInDirection(vh, i))
-        mass[i] = numeric_limits<Scalar>::infinity();
-    masses.push_back(mass);
-    vert_numbers[vh] = id;
-    reverse_vertmap.push_back(vh);
-
-    ++id;
-  }
-
-  //walk through triangles, creating linear list, using the vertex numbering assigned above
-  id = 0;
-  for(FaceIterator fit = mesh.faces_begin(); fit != mesh.faces_end(); ++fit) {
-    FaceHandle fh = *fit;
-    ElTopo::Vec3st tri;
-    int i = 0;
-    for(FaceVertexIterator fvit = mesh.fv_iter(fh); fvit; ++fvit) {
-      VertexHandle vh = *fvit;
-      tri[i] = vert_numbers[vh];
-      ++i;
-    }
-    tri_data.push_back(tri);
-    face_numbers[fh] = id;
-    reverse_trimap.push_back(fh);
-    ++id;
-  }
 
-
-  // build a DynamicSurface
-  Scalar friction_coeff = 0;
-  ElTopo::DynamicSurface dynamic_surface( vert_old, tri_data, std::vector<ElTopo::Vec2i>(tri_data.size(), ElTopo::Vec2i(0, 0)), masses, m_collision_epsilon, friction_coeff, true, false );
-
-  dynamic_surface.set_all_newpositions( vert_new );
+  //Bring the persistent El Topo mesh up to date, moving from the start-of-step ("damping undeformed") 
+  //configuration to the current one
+  ElTopo::SurfTrack& dynamic_surface = m_eltopo_mirror->sync(getRemeshingParameters(false), true, timestep);
+  dynamic_surface.rebuild_continuous_broad_phase();
     
-//    for (size_t i = 0; i < vert_old.size(); i++)
-//        std::cout << "old vertex " << i << ": " << vert_old[i] << std::endl;
-//    for (size_t i = 0; i < vert_new.size(); i++)
-//        std::cout << "new vertex " << i << ": " << vert_new[i] << std::endl;
-  
   // advance by dt
   double actual_dt;
   dynamic_surface.integrate( timestep, actual_dt );
@@ -515,20 +560,7 @@ void ElasticShell::resolveCollisions(Scalar timestep) {
   // the dt used may be different than specified (if we cut the time step)
   
   //figure out what the actual velocities were, and update the mesh data
-  for(unsigned int i = 0; i < vert_new.size(); ++i) {
-    VertexHandle vh = reverse_vertmap[i];
-    ElTopo::Vec3d pos = dynamic_surface.get_position(i);
-    ElTopo::Vec3d vel = (pos - vert_old[i]) / timestep;
-    Vec3d new_pos(pos[0], pos[1], pos[2]);
-    Vec3d new_vel(vel[0], vel[1], vel[2]);
-    setVertexPosition(vh, new_pos);
-    setVertexVelocity(vh, new_vel);
-
-    if(isnan(pos[0]) || isnan(pos[1]) || isnan(pos[2]))
-      std::cout << "ElTopo Failed: NaN vertex\n";
-    if(isinf(pos[0]) || isinf(pos[1]) || isinf(pos[2]))
-      std::cout << "ElTopo Failed: Inf vertex\n";
-  }
+  m_eltopo_mirror->applyPositions(timestep);
 
 }
 
@@ -707,34 +739,7 @@ void ElasticShell::endStep(Scalar time, Scalar timestep) {
     m_stepping_callback->beforeEndStep();
   
   // remove faces completely inside BB walls
-  for (FaceIterator fit = m_obj->faces_begin(); fit != m_obj->faces_end(); ++fit)
-  {
-    FaceVertexIterator fvit = m_obj->fv_iter(*fit); assert(fvit);
-    Vec3d x0 = getVertexPosition(*fvit); ++fvit; assert(fvit);
-    Vec3d x1 = getVertexPosition(*fvit); ++fvit; assert(fvit);
-    Vec3d x2 = getVertexPosition(*fvit); ++fvit; assert(!fvit);
-    
-    //    if (x0.y() == 0 || x1.y() == 0 || x2.y() == 0)
-    //      std::cout << "face: " << x0 << " " << x1 << " " << x2 << std::endl;
-    
-    int w0 = onBBWall(x0);
-    int w1 = onBBWall(x1);
-    int w2 = onBBWall(x2);
-    if (((w0 & w1) & w2) != 0)
-    {
-      //      std::cout << "face: " << x0 << " " << x1 << " " << x2 << std::endl;
-      m_obj->deleteFace(*fit, false);
-    }
-  }
-  
-  // prune orphan edges and vertices
-  for (EdgeIterator eit = m_obj->edges_begin(); eit != m_obj->edges_end(); ++eit)
-    if (m_obj->edgeIncidentFaces(*eit) == 0)
-      m_obj->deleteEdge(*eit, true);
-  
-  for (VertexIterator vit = m_obj->vertices_begin(); vit != m_obj->vertices_end(); ++vit)
-    if (m_obj->vertexIncidentEdges(*vit) == 0)
-      m_obj->deleteVertex(*vit);
+  deleteBBWallFaces();
   
   
   std::cout << "Starting endStep.\n";
@@ -1103,131 +1108,13 @@ bool ElasticShell::shouldFracture (const EdgeHandle & eh) const{
 void ElasticShell::remesh(Scalar timestep, bool initial)
 {
   // remove faces completely inside BB walls
-  for (FaceIterator fit = m_obj->faces_begin(); fit != m_obj->faces_end(); ++fit)
-  {
-    FaceVertexIterator fvit = m_obj->fv_iter(*fit); assert(fvit);
-    Vec3d x0 = getVertexPosition(*fvit); ++fvit; assert(fvit);
-    Vec3d x1 = getVertexPosition(*fvit); ++fvit; assert(fvit);
-    Vec3d x2 = getVertexPosition(*fvit); ++fvit; assert(!fvit);
-    
-    //    if (x0.y() == 0 || x1.y() == 0 || x2.y() == 0)
-    //      std::cout << "face: " << x0 << " " << x1 << " " << x2 << std::endl;
-    
-    int w0 = onBBWall(x0);
-    int w1 = onBBWall(x1);
-    int w2 = onBBWall(x2);
-    if (((w0 & w1) & w2) != 0)
-    {
-      //      std::cout << "face: " << x0 << " " << x1 << " " << x2 << std::endl;
-      m_obj->deleteFace(*fit, false);
-    }
-  }
-  
-  // prune orphan edges and vertices
-  for (EdgeIterator eit = m_obj->edges_begin(); eit != m_obj->edges_end(); ++eit)
-    if (m_obj->edgeIncidentFaces(*eit) == 0)
-      m_obj->deleteEdge(*eit, true);
-  
-  for (VertexIterator vit = m_obj->vertices_begin(); vit != m_obj->vertices_end(); ++vit)
-    if (m_obj->vertexIncidentEdges(*vit) == 0)
-      m_obj->deleteVertex(*vit);
+  deleteBBWallFaces();
   
     
-  //Set up a SurfTrack, run remeshing, render the new mesh
-  ElTopo::SurfTrackInitializationParameters construction_parameters;
-  construction_parameters.m_proximity_epsilon = m_collision_epsilon;
-  construction_parameters.m_merge_proximity_epsilon = 0.02 * m_remesh_edge_min_len;
-  construction_parameters.m_allow_vertex_movement_during_collapse = true;
-  construction_parameters.m_perform_smoothing = false;
-  construction_parameters.m_min_edge_length = m_remesh_edge_min_len;
-  construction_parameters.m_max_edge_length = m_remesh_edge_max_len;
-  construction_parameters.m_max_volume_change = 1e-4 * m_remesh_edge_min_len * m_remesh_edge_min_len * m_remesh_edge_min_len;
-  construction_parameters.m_min_triangle_angle = initial ? 0 : 3;
-  construction_parameters.m_max_triangle_angle = initial ? 180 : 177;
-  construction_parameters.m_large_triangle_angle_to_split = 160;
-  construction_parameters.m_min_triangle_area = 0.02*m_remesh_edge_min_len*m_remesh_edge_min_len;
-  construction_parameters.m_verbose = false;
-  construction_parameters.m_allow_non_manifold = true;
-  construction_parameters.m_allow_topology_changes = true;
-  construction_parameters.m_collision_safety = true;
-  construction_parameters.m_remesh_boundaries = true;
-  construction_parameters.m_t1_transition_enabled = m_remesh_t1transition;
-  construction_parameters.m_velocity_field_callback = NULL;
-    construction_parameters.m_pull_apart_distance = m_remesh_edge_min_len / 2;// (initial ? 0.1 : 0.02) * m_remesh_edge_min_len;
-  
-  ElTopo::SubdivisionScheme * mb = new ElTopo::ModifiedButterflyScheme();
-  ElTopo::SubdivisionScheme * mp = new ElTopo::MidpointScheme();
-  construction_parameters.m_subdivision_scheme = (m_remesh_smooth_subdivision ? mb : mp);
-  //construction_parameters.m_subdivision_scheme = new ElTopo::QuadraticErrorMinScheme();
-  //construction_parameters.m_subdivision_scheme = new ElTopo::ButterflyScheme();
-  //construction_parameters.m_subdivision_scheme = new ElTopo::ModifiedButterflyScheme();
-
-  construction_parameters.m_use_curvature_when_collapsing = false;
-  construction_parameters.m_use_curvature_when_splitting = false;
-  //construction_parameters.m_max_curvature_multiplier = 1000;
-  //construction_parameters.m_min_curvature_multiplier = 1.0;
-
-  std::vector<ElTopo::Vec3d> vert_data;
-  std::vector<ElTopo::Vec3d> vert_vel;
-  std::vector<ElTopo::Vec3st> tri_data;
-  std::vector<ElTopo::Vec2i> tri_labels;
-  std::vector<ElTopo::Vec3d> masses;
-
-  DeformableObject& mesh = getDefoObj();
-  
-  //Index mappings between us and El Topo, used in remesh()
-  VertexProperty<int> vert_numbers(&mesh);
-  FaceProperty<int> face_numbers(&mesh);
-  std::vector<VertexHandle> reverse_vertmap;
-  std::vector<FaceHandle> reverse_trimap;
-  
-  reverse_vertmap.reserve(m_obj->nv());
-  reverse_trimap.reserve(m_obj->nt());  
-  
-  vert_data.reserve(m_obj->nv());
-  tri_data.reserve(m_obj->nt());
-  tri_labels.reserve(m_obj->nt());
-  masses.reserve(m_obj->nv());
-
-  //walk through vertices, create linear list, store numbering
-  int id = 0;
-  for(VertexIterator vit = mesh.vertices_begin(); vit != mesh.vertices_end(); ++vit) {
-    VertexHandle vh = *vit;
-    Vec3d vert = getVertexPosition(vh);
-
-    vert_data.push_back(ElTopo::Vec3d(vert[0], vert[1], vert[2]));
-    Vec3d vel = getVertexVelocity(vh);
-    vert_vel.push_back(ElTopo::Vec3d(vel[0], vel[1], vel[2]) * timestep);
-      
-    ElTopo::Vec3d mass(1, 1, 1);
-    assert(getDefoObj().isConstrained(vh) == (getVertexConstraintLabel(vh) != 0));
-    for (int i = 0; i < 3; i++)
-      if (getDefoObj().isConstrainedInDirection(vh, i))
-        mass[i] = numeric_limits<Scalar>::infinity();
-    masses.push_back(mass);
-      
-    vert_numbers[vh] = id;
-    reverse_vertmap.push_back(vh);
-    ++id;
-  }
-
-  //walk through tris, creating linear list, using the vertex numbering assigned above
-  id = 0;
-  for(FaceIterator fit = mesh.faces_begin(); fit != mesh.faces_end(); ++fit) {
-    FaceHandle fh = *fit;
-    ElTopo::Vec3st tri;
-    int i = 0;
-    for(FaceVertexIterator fvit = mesh.fv_iter(fh); fvit; ++fvit) {
-      VertexHandle vh = *fvit;
-      tri[i] = vert_numbers[vh];
-      ++i;
-    }
-    tri_data.push_back(tri);
-    tri_labels.push_back(ElTopo::Vec2i(m_face_regions[fh].x(), m_face_regions[fh].y()));
-    face_numbers[fh] = id;
-    reverse_trimap.push_back(fh);
-    ++id;
-  }
+  //Bring the persistent El Topo mesh up to date, run remeshing, and replay the changes onto our mesh
+  ElTopo::SurfTrack& surface_tracker = m_eltopo_mirror->sync(getRemeshingParameters(initial), false, timestep);
+  surface_tracker.m_solid_vertices_callback = this;
+  surface_tracker.m_mesheventcallback = m_mesheventcallback;
 
   //constrain all the vertices in faces that are used by collision springs to prevent remeshing there,
   //as well as the associated opposite vertex.
@@ -1235,108 +1122,28 @@ void ElasticShell::remesh(Scalar timestep, bool initial)
   std::vector<FaceHandle> faces;
   std::vector<Vec3d> coords;
   m_repulsion_springs->getSpringLists(verts, faces, coords);
+  ElTopo::Vec3d infinite_mass(numeric_limits<Scalar>::infinity(), numeric_limits<Scalar>::infinity(), numeric_limits<Scalar>::infinity());
   for(unsigned int i = 0; i < faces.size(); ++i) {
     FaceVertexIterator fvit = getDefoObj().fv_iter(faces[i]);
     //vertices of the face...
     for(;fvit; ++fvit) {
       VertexHandle vh = *fvit;
-      masses[vert_numbers[vh]][0] = numeric_limits<Scalar>::infinity();
-      masses[vert_numbers[vh]][1] = numeric_limits<Scalar>::infinity();
-      masses[vert_numbers[vh]][2] = numeric_limits<Scalar>::infinity();
+      surface_tracker.m_masses[m_eltopo_mirror->getVertexIndex(vh)] = infinite_mass;
     }
     //and the other vertex
-    masses[vert_numbers[verts[i]]][0] = numeric_limits<Scalar>::infinity();
-    masses[vert_numbers[verts[i]]][1] = numeric_limits<Scalar>::infinity();
-    masses[vert_numbers[verts[i]]][2] = numeric_limits<Scalar>::infinity();
+    surface_tracker.m_masses[m_eltopo_mirror->getVertexIndex(verts[i])] = infinite_mass;
   }
 
+  //the masses decide which elements are solid, so the broad phase can only be brought up to date now
+  surface_tracker.rebuild_static_broad_phase();
+
   std::cout << "Calling surface improvement\n";
   
-  ElTopo::SurfTrack surface_tracker( vert_data, tri_data, tri_labels, masses, construction_parameters ); 
-  surface_tracker.m_solid_vertices_callback = this;
-  surface_tracker.m_mesheventcallback = m_mesheventcallback;
-  surface_tracker.set_all_remesh_velocities(vert_vel);
-    
-//    for (size_t i = 0; i < vert_data.size(); i++)
-//        std::cout << "vertex " << i << ": " << vert_data[i] << std::endl;
-    
-    //remove faces that are completely within a BB wall (equivalent to a flap face if BB walls are triangulated). these faces result in collision handling difficulties when they collide within BB walls.
-    for (size_t i = 0; i < surface_tracker.m_mesh.nt(); i++)
-    {
-        ElTopo::Vec3st tri = surface_tracker.m_mesh.get_triangle(i);
-        if (tri[0] == tri[1] && tri[0] == tri[2])
-            continue;
-        
-        ElTopo::Vec3d v0 = surface_tracker.get_position(tri[0]);
-        ElTopo::Vec3d v1 = surface_tracker.get_position(tri[1]);
-        ElTopo::Vec3d v2 = surface_tracker.get_position(tri[2]);
-        
-        Vec3d x0(v0[0], v0[1], v0[2]);
-        Vec3d x1(v1[0], v1[1], v1[2]);
-        Vec3d x2(v2[0], v2[1], v2[2]);
-        
-        int onwall0 = onBBWall(x0);
-        int onwall1 = onBBWall(x1);
-        int onwall2 = onBBWall(x2);
-        if ((onwall0 & onwall1 & onwall2) != 0)
-        {
-            surface_tracker.remove_triangle(i);
-        }
-    }
-  
   for(int i = 0; i < m_remeshing_iters; ++i) {
     surface_tracker.topology_changes();
     surface_tracker.improve_mesh();
   }
   
-  // copy ElTopo mesh back, instead of repeating the operation history incrementally.
-  // this is possible because ElasticShell doesn't keep any other information that ElTopo doesn't have
-  
-  for (FaceIterator fit = m_obj->faces_begin(); fit != m_obj->faces_end(); ++fit)
-    m_obj->deleteFace(*fit, true);
-
-  assert(m_obj->nv() == 0);
-  assert(m_obj->ne() == 0);
-  assert(m_obj->nf() == 0);
-  
-  reverse_vertmap.resize(surface_tracker.m_mesh.nv());
-  reverse_trimap.resize(surface_tracker.m_mesh.nt());
-  
-  for (size_t i = 0; i < surface_tracker.m_mesh.nv(); i++)
-  {
-    if (surface_tracker.m_mesh.m_vertex_to_edge_map[i].size() == 0 ||
-        surface_tracker.m_mesh.m_vertex_to_triangle_map[i].size() == 0)
-    {
-      // dead vertex
-      reverse_vertmap[i] = VertexHandle();
-      continue;
-    }
-    VertexHandle v = m_obj->addVertex();
-    ElTopo::Vec3d x = surface_tracker.get_position(i);
-    setVertexPosition(v, Vec3d(x[0], x[1], x[2]));
-    setVertexVelocity(v, Vec3d(0, 0, 0));
-    vert_numbers[v] = i;
-    reverse_vertmap[i] = v;
-  }
-  
-  for (size_t i = 0; i < surface_tracker.m_mesh.nt(); i++)
-  {
-    ElTopo::Vec3st tri = surface_tracker.m_mesh.get_triangle(i);
-    if (tri[0] == tri[1] || tri[0] == tri[2] || tri[1] == tri[2])
-    {
-      // dead face
-      reverse_trimap[i] = FaceHandle();
-      continue; 
-    }
-    FaceHandle f = m_obj->addFace(reverse_vertmap[tri[0]], reverse_vertmap[tri[1]], reverse_vertmap[tri[2]]);
-    setFaceLabel(f, Vec2i(surface_tracker.m_mesh.get_triangle_label(i)[0], surface_tracker.m_mesh.get_triangle_label(i)[1]));
-    m_active_faces[f] = 1;
-    
-    face_numbers[f] = i;
-    reverse_trimap[i] = f;
-  }
-
-  
   std::cout << "El Topo performed " << surface_tracker.m_mesh_change_history.size() << " improvement operations:\n";
   for(unsigned int j = 0; j < surface_tracker.m_mesh_change_history.size(); ++j) 
   {
@@ -1344,6 +1151,9 @@ void ElasticShell::remesh(Scalar timestep, bool initial)
     std::cout << "Event type = " << event.m_type << std::endl;
   }
 
+  // replay the triangles El Topo added and removed onto our mesh, rather than copying the whole mesh back
+  m_eltopo_mirror->applyTopologyChanges();
+
     double minangle = M_PI;
     double maxangle = 0;
     
@@ -1392,6 +1202,16 @@ void ElasticShell::remesh(Scalar timestep, bool initial)
     std::cout << "minangle = " << minangle * 180 / M_PI << " maxangle = " << maxangle * 180 / M_PI << " minedge = " << minedge << " maxedge = " << maxedge << std::endl;
     
   // remove faces completely inside BB walls
+  deleteBBWallFaces();
+  
+
+}
+
+void ElasticShell::deleteBBWallFaces()
+{
+  //remove faces that are completely within a BB wall (equivalent to a flap face if BB walls are triangulated). 
+  //these faces result in collision handling difficulties when they collide within BB walls.
+  std::vector<FaceHandle> faces_to_delete;
   for (FaceIterator fit = m_obj->faces_begin(); fit != m_obj->faces_end(); ++fit)
   {
     FaceVertexIterator fvit = m_obj->fv_iter(*fit); assert(fvit);
@@ -1399,29 +1219,51 @@ void ElasticShell::remesh(Scalar timestep, bool initial)
     Vec3d x1 = getVertexPosition(*fvit); ++fvit; assert(fvit);
     Vec3d x2 = getVertexPosition(*fvit); ++fvit; assert(!fvit);
     
-//    if (x0.y() == 0 || x1.y() == 0 || x2.y() == 0)
-//      std::cout << "face: " << x0 << " " << x1 << " " << x2 << std::endl;
-    
     int w0 = onBBWall(x0);
     int w1 = onBBWall(x1);
     int w2 = onBBWall(x2);
     if (((w0 & w1) & w2) != 0)
-    {
-//      std::cout << "face: " << x0 << " " << x1 << " " << x2 << std::endl;
-      m_obj->deleteFace(*fit, false);
-    }
+      faces_to_delete.push_back(*fit);
   }
   
-  // prune orphan edges and vertices
-  for (EdgeIterator eit = m_obj->edges_begin(); eit != m_obj->edges_end(); ++eit)
-    if (m_obj->edgeIncidentFaces(*eit) == 0)
-      m_obj->deleteEdge(*eit, true);
-  
-  for (VertexIterator vit = m_obj->vertices_begin(); vit != m_obj->vertices_end(); ++vit)
-    if (m_obj->vertexIncidentEdges(*vit) == 0)
-      m_obj->deleteVertex(*vit);
+  //the mirror prunes the orphaned edges and vertices along with each face, and keeps El Topo in step
+  for (size_t i = 0; i < faces_to_delete.size(); i++)
+    m_eltopo_mirror->deleteFace(faces_to_delete[i]);
+}
+
+ElTopo::SurfTrackInitializationParameters ElasticShell::getRemeshingParameters(bool initial)
+{
+  ElTopo::SurfTrackInitializationParameters construction_parameters;
+  construction_parameters.m_proximity_epsilon = m_collision_epsilon;
+  construction_parameters.m_merge_proximity_epsilon = 0.02 * m_remesh_edge_min_len;
+  construction_parameters.m_allow_vertex_movement_during_collapse = true;
+  construction_parameters.m_perform_smoothing = false;
+  construction_parameters.m_min_edge_length = m_remesh_edge_min_len;
+  construction_parameters.m_max_edge_length = m_remesh_edge_max_len;
+  construction_parameters.m_max_volume_change = 1e-4 * m_remesh_edge_min_len * m_remesh_edge_min_len * m_remesh_edge_min_len;
+  construction_parameters.m_min_triangle_angle = initial ? 0 : 3;
+  construction_parameters.m_max_triangle_angle = initial ? 180 : 177;
+  construction_parameters.m_large_triangle_angle_to_split = 160;
+  construction_parameters.m_min_triangle_area = 0.02*m_remesh_edge_min_len*m_remesh_edge_min_len;
+  construction_parameters.m_verbose = false;
+  construction_parameters.m_allow_non_manifold = true;
+  construction_parameters.m_allow_topology_changes = true;
+  construction_parameters.m_collision_safety = true;
+  construction_parameters.m_remesh_boundaries = true;
+  construction_parameters.m_t1_transition_enabled = m_remesh_t1transition;
+  construction_parameters.m_velocity_field_callback = NULL;
+  construction_parameters.m_pull_apart_distance = m_remesh_edge_min_len / 2;// (initial ? 0.1 : 0.02) * m_remesh_edge_min_len;
   
+  construction_parameters.m_subdivision_scheme = m_eltopo_mirror->getSubdivisionScheme(m_remesh_smooth_subdivision);
+  //construction_parameters.m_subdivision_scheme = new ElTopo::QuadraticErrorMinScheme();
+  //construction_parameters.m_subdivision_scheme = new ElTopo::ButterflyScheme();
+
+  construction_parameters.m_use_curvature_when_collapsing = false;
+  construction_parameters.m_use_curvature_when_splitting = false;
+  //construction_parameters.m_max_curvature_multiplier = 1000;
+  //construction_parameters.m_min_curvature_multiplier = 1.0;
 
+  return construction_parameters;
 }
 
 int ElasticShell::onBBWall(const Vec3d & pos) const
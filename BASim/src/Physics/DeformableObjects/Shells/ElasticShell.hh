@@ -24,6 +24,7 @@ class DeformableObject;
 class ElasticShellForce;
 class ShellVertexPointSpringForce;
 class ShellStickyRepulsionForce;
+class ShellElTopoMirror;
 
 class ElasticShell : public PhysicalModel, public ElTopo::SurfTrack::SolidVerticesCallback {
 
@@ -91,6 +92,11 @@ public:
     m_do_eltopo_collisions = enable;
   }
 
+  //Number of threads used to evaluate forces that expose element ranges (see ElasticShellForce).
+  //Results are bit-reproducible for a fixed thread count; 1 keeps the serial global* path.
+  void setNumThreads(int num_threads) { m_num_threads = std::max(num_threads, 1); }
+  int getNumThreads() const { return m_num_threads; }
+
   //All DOFs at once
   // these methods should have be removed because position access is now provided by DeformableObject; but 
   // too much code in other parts of the codebase need to change because they depend on this, so these
@@ -208,12 +214,20 @@ public:
     void setMeshEventCallback(ElTopo::SurfTrack::MeshEventCallback * cb) { m_mesheventcallback = cb; }
     
 protected:
+  //parallel evaluation over the element ranges of a single force
+  Scalar parallelEnergy(const ElasticShellForce& shellForce, int count) const;
+  void parallelForce(const ElasticShellForce& shellForce, int count, VecXd& force) const;
+  void parallelJacobian(const ElasticShellForce& shellForce, int count, Scalar scale, MatrixBase& J) const;
 
   void performTearing(const EdgeHandle & eh);
 
   void resolveCollisions(Scalar timestep);
   void updateThickness();
 
+  //El Topo settings shared by remeshing and collision resolution
+  ElTopo::SurfTrackInitializationParameters getRemeshingParameters(bool initial);
+  void deleteBBWallFaces();
+
   void performSplit(const EdgeHandle& eh, const Vec3d& newpos, VertexHandle& newVert);
   void performCollapse(const EdgeHandle& eh, const VertexHandle& vert_to_remove, const VertexHandle& vert_to_keep, const Vec3d& new_position);
   bool performFlip(const EdgeHandle& eh, const FaceHandle f0, const FaceHandle& f1, FaceHandle & new_f0, FaceHandle & new_f1, EdgeHandle& newEdge);
@@ -322,6 +336,12 @@ protected:
 
   // other callbacks
   ElTopo::SurfTrack::MeshEventCallback * m_mesheventcallback;
+
+  // persistent El Topo copy of the mesh, used for remeshing and collision resolution
+  ShellElTopoMirror * m_eltopo_mirror;
+
+  // threads used for force and Jacobian evaluation
+  int m_num_threads;
 };
 
 }
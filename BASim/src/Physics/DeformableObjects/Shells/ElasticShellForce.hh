@@ -26,6 +26,17 @@ public:
   virtual void globalForce(VecXd& force) const = 0;
   virtual void globalJacobian(Scalar scale, MatrixBase& Jacobian) const = 0;
 
+  //Element-range interface used by ElasticShell's parallel evaluation. A force whose
+  //prepareElements() returns a positive element count is evaluated over disjoint
+  //[begin, end) element ranges on several threads; other forces go through the global* 
+  //calls above. Each element contributes at most one Jacobian block of elementBlockSize()
+  //dofs, written column-major into blocks; valid[e] is set to zero for skipped elements.
+  virtual int prepareElements() { return 0; }
+  virtual int elementBlockSize() const { return 0; }
+  virtual Scalar elementRangeEnergy(int begin, int end) const { return 0; }
+  virtual void elementRangeForce(int begin, int end, VecXd& force) const {}
+  virtual void elementRangeJacobian(int begin, int end, int* indices, Scalar* blocks, char* valid) const {}
+
   virtual void setDebug(bool flag) {_debugFlag = flag; }
   
   virtual void update() {};
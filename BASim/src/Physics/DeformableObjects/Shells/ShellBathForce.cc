@@ -128,13 +128,7 @@ void ShellBathForce::globalJacobian( Scalar scale, MatrixBase& Jacobian ) const
     jac = part1 + part2; 
 
     //Scatter back into the main matrix
-    for(int i = 0; i < 9; ++i) {
-      int ind0 = indices[i];
-      for(int j = 0; j < 9; ++j) {
-        int ind1 = indices[j];
-        Jacobian.add(ind0,ind1, scale*jac(i,j));
-      }
-    }
+    Jacobian.addBlock(&indices[0], 9, jac.data(), jac.rows(), scale);
     
   }
   
@@ -0,0 +1,395 @@
+#include "BASim/src/Physics/DeformableObjects/Shells/ShellElTopoMirror.hh"
+#include "BASim/src/Physics/DeformableObjects/Shells/ElasticShell.hh"
+
+#include <limits>
+
+namespace BASim {
+
+//El Topo's arrays only ever grow between defrags; compact them once this fraction of the slots is dead.
+static const double DEFRAG_DEAD_FRACTION = 0.5;
+
+//Compare everything that is baked into the SurfTrack and its sub-objects at construction time.
+//The triangle angle bounds are left out, since they are read live and can be changed in place.
+static bool sameConstructionParameters(const ElTopo::SurfTrackInitializationParameters& a, const ElTopo::SurfTrackInitializationParameters& b)
+{
+  return a.m_proximity_epsilon == b.m_proximity_epsilon &&
+         a.m_friction_coefficient == b.m_friction_coefficient &&
+         a.m_min_triangle_area == b.m_min_triangle_area &&
+         a.m_t1_transition_enabled == b.m_t1_transition_enabled &&
+         a.m_velocity_field_callback == b.m_velocity_field_callback &&
+         a.m_improve_collision_epsilon == b.m_improve_collision_epsilon &&
+         a.m_use_fraction == b.m_use_fraction &&
+         a.m_min_edge_length == b.m_min_edge_length &&
+         a.m_max_edge_length == b.m_max_edge_length &&
+         a.m_max_volume_change == b.m_max_volume_change &&
+         a.m_large_triangle_angle_to_split == b.m_large_triangle_angle_to_split &&
+         a.m_use_curvature_when_splitting == b.m_use_curvature_when_splitting &&
+         a.m_use_curvature_when_collapsing == b.m_use_curvature_when_collapsing &&
+         a.m_min_curvature_multiplier == b.m_min_curvature_multiplier &&
+         a.m_max_curvature_multiplier == b.m_max_curvature_multiplier &&
+         a.m_allow_vertex_movement_during_collapse == b.m_allow_vertex_movement_during_collapse &&
+         a.m_perform_smoothing == b.m_perform_smoothing &&
+         a.m_merge_proximity_epsilon == b.m_merge_proximity_epsilon &&
+         a.m_subdivision_scheme == b.m_subdivision_scheme &&
+         a.m_collision_safety == b.m_collision_safety &&
+         a.m_allow_topology_changes == b.m_allow_topology_changes &&
+         a.m_allow_non_manifold == b.m_allow_non_manifold &&
+         a.m_perform_improvement == b.m_perform_improvement &&
+         a.m_remesh_boundaries == b.m_remesh_boundaries &&
+         a.m_pull_apart_distance == b.m_pull_apart_distance &&
+         a.m_localized_intersection_checks == b.m_localized_intersection_checks &&
+         a.m_intersection_check_epsilon == b.m_intersection_check_epsilon &&
+         a.m_full_intersection_check_interval == b.m_full_intersection_check_interval &&
+         a.m_broad_phase_type == b.m_broad_phase_type &&
+         a.m_parallel_edge_operations == b.m_parallel_edge_operations &&
+         a.m_verbose == b.m_verbose;
+}
+
+ShellElTopoMirror::ShellElTopoMirror(ElasticShell& shell) :
+  m_shell(shell), m_obj(shell.getDefoObj()),
+  m_tracker(NULL),
+  m_vert_numbers(&shell.getDefoObj()),
+  m_face_numbers(&shell.getDefoObj()),
+  m_revision(0), m_revision_valid(false)
+{
+}
+
+ShellElTopoMirror::~ShellElTopoMirror()
+{
+  delete m_tracker;
+}
+
+bool ShellElTopoMirror::isSynced() const
+{
+  return m_tracker != NULL && m_revision_valid && m_revision == m_obj.getTopologyRevision();
+}
+
+ElTopo::SurfTrack& ShellElTopoMirror::sync(const ElTopo::SurfTrackInitializationParameters& params, bool start_of_step_positions, Scalar timestep)
+{
+  if(!isSynced() || !sameConstructionParameters(params, m_params))
+    rebuild(params);
+
+  pushVertexData(start_of_step_positions, timestep);
+
+  m_tracker->m_min_triangle_angle = params.m_min_triangle_angle;
+  m_tracker->m_max_triangle_angle = params.m_max_triangle_angle;
+  m_params = params;
+
+  return *m_tracker;
+}
+
+void ShellElTopoMirror::rebuild(const ElTopo::SurfTrackInitializationParameters& params)
+{
+  std::cout << "Rebuilding El Topo mesh\n";
+
+  delete m_tracker;
+  m_tracker = NULL;
+
+  std::vector<ElTopo::Vec3d> vert_data;
+  std::vector<ElTopo::Vec3st> tri_data;
+  std::vector<ElTopo::Vec2i> tri_labels;
+  std::vector<ElTopo::Vec3d> masses;
+
+  vert_data.reserve(m_obj.nv());
+  masses.reserve(m_obj.nv());
+  tri_data.reserve(m_obj.nf());
+  tri_labels.reserve(m_obj.nf());
+
+  m_vert_numbers.assign(-1);
+  m_face_numbers.assign(-1);
+  m_reverse_vertmap.clear();
+  m_reverse_trimap.clear();
+  m_reverse_vertmap.reserve(m_obj.nv());
+  m_reverse_trimap.reserve(m_obj.nf());
+
+  //walk through vertices, create linear list, store numbering
+  //(vertex data is filled in properly by pushVertexData)
+  int id = 0;
+  for(VertexIterator vit = m_obj.vertices_begin(); vit != m_obj.vertices_end(); ++vit) {
+    VertexHandle vh = *vit;
+    Vec3d vert = m_shell.getVertexPosition(vh);
+    vert_data.push_back(ElTopo::Vec3d(vert[0], vert[1], vert[2]));
+    masses.push_back(ElTopo::Vec3d(1, 1, 1));
+
+    m_vert_numbers[vh] = id;
+    m_reverse_vertmap.push_back(vh);
+    ++id;
+  }
+
+  //walk through tris, creating linear list, using the vertex numbering assigned above
+  id = 0;
+  for(FaceIterator fit = m_obj.faces_begin(); fit != m_obj.faces_end(); ++fit) {
+    FaceHandle fh = *fit;
+    ElTopo::Vec3st tri;
+    int i = 0;
+    for(FaceVertexIterator fvit = m_obj.fv_iter(fh); fvit; ++fvit) {
+      tri[i] = m_vert_numbers[*fvit];
+      ++i;
+    }
+    tri_data.push_back(tri);
+    Vec2i label = m_shell.getFaceLabel(fh);
+    tri_labels.push_back(ElTopo::Vec2i(label.x(), label.y()));
+
+    m_face_numbers[fh] = id;
+    m_reverse_trimap.push_back(fh);
+    ++id;
+  }
+
+  m_tracker = new ElTopo::SurfTrack(vert_data, tri_data, tri_labels, masses, params);
+
+  m_revision = m_obj.getTopologyRevision();
+  m_revision_valid = true;
+}
+
+void ShellElTopoMirror::pushVertexData(bool start_of_step_positions, Scalar timestep)
+{
+  ElTopo::SurfTrack& st = *m_tracker;
+  size_t nv = st.get_num_vertices();
+  assert(m_reverse_vertmap.size() == nv);
+
+  std::vector<ElTopo::Vec3d> remesh_vel(nv, ElTopo::Vec3d(0, 0, 0));
+  for(size_t i = 0; i < nv; ++i) {
+    VertexHandle vh = m_reverse_vertmap[i];
+    if(!vh.isValid()) {
+      //dead El Topo vertex; keep it still
+      st.pm_newpositions[i] = st.pm_positions[i];
+      continue;
+    }
+
+    Vec3d x = m_shell.getVertexPosition(vh);
+    Vec3d x_start = start_of_step_positions ? m_shell.getVertexDampingUndeformed(vh) : x;
+    ElTopo::Vec3d start(x_start[0], x_start[1], x_start[2]);
+    if(st.pm_positions[i] != start)
+      st.mark_vertex_changed(i);
+    st.pm_positions[i] = start;
+    st.pm_newpositions[i] = ElTopo::Vec3d(x[0], x[1], x[2]);
+
+    ElTopo::Vec3d mass(1, 1, 1);
+    for (int k = 0; k < 3; k++)
+      if (m_obj.isConstrainedInDirection(vh, k))
+        mass[k] = std::numeric_limits<Scalar>::infinity();
+    st.m_masses[i] = mass;
+
+    Vec3d vel = m_shell.getVertexVelocity(vh);
+    remesh_vel[i] = ElTopo::Vec3d(vel[0], vel[1], vel[2]) * timestep;
+  }
+  st.set_all_remesh_velocities(remesh_vel);
+
+  //labels may have been changed on the shell side
+  assert(m_reverse_trimap.size() == st.m_mesh.nt());
+  for(size_t i = 0; i < m_reverse_trimap.size(); ++i) {
+    FaceHandle fh = m_reverse_trimap[i];
+    if(!fh.isValid())
+      continue;
+    Vec2i label = m_shell.getFaceLabel(fh);
+    st.m_mesh.set_triangle_label(i, ElTopo::Vec2i(label.x(), label.y()));
+  }
+}
+
+void ShellElTopoMirror::applyTopologyChanges()
+{
+  assert(m_tracker != NULL);
+  ElTopo::SurfTrack& st = *m_tracker;
+  const std::vector<ElTopo::TriangleUpdateEvent>& history = st.m_triangle_change_history;
+
+  m_reverse_vertmap.resize(st.get_num_vertices(), VertexHandle());
+  m_reverse_trimap.resize(st.m_mesh.nt(), FaceHandle());
+
+  //Removals first. Shell vertices orphaned by them go away with their last face; unmap them before
+  //anything is added, since the shell recycles vertex slots.
+  std::vector<VertexHandle> touched_verts;
+  for(size_t j = 0; j < history.size(); ++j) {
+    if(!history[j].m_is_remove)
+      continue;
+
+    size_t t = history[j].m_triangle_index;
+    FaceHandle fh = m_reverse_trimap[t];
+    if(!fh.isValid()) //created and destroyed within this batch
+      continue;
+
+    for(FaceVertexIterator fvit = m_obj.fv_iter(fh); fvit; ++fvit)
+      touched_verts.push_back(*fvit);
+
+    m_obj.deleteFace(fh, true);
+    m_face_numbers[fh] = -1;
+    m_reverse_trimap[t] = FaceHandle();
+  }
+
+  for(size_t j = 0; j < touched_verts.size(); ++j) {
+    VertexHandle vh = touched_verts[j];
+    if(m_obj.vertexExists(vh) || m_vert_numbers[vh] < 0)
+      continue;
+    m_reverse_vertmap[m_vert_numbers[vh]] = VertexHandle();
+    m_vert_numbers[vh] = -1;
+  }
+
+  //Then the triangles that were created and are still alive, along with any new vertices they use
+  for(size_t j = 0; j < history.size(); ++j) {
+    if(history[j].m_is_remove)
+      continue;
+
+    size_t t = history[j].m_triangle_index;
+    if(st.m_mesh.triangle_is_deleted(t) || m_reverse_trimap[t].isValid())
+      continue;
+
+    const ElTopo::Vec3st& tri = st.m_mesh.get_triangle(t);
+    VertexHandle verts[3];
+    for(int k = 0; k < 3; ++k) {
+      if(!m_reverse_vertmap[tri[k]].isValid()) {
+        VertexHandle vh = m_obj.addVertex();
+        m_vert_numbers[vh] = tri[k];
+        m_reverse_vertmap[tri[k]] = vh;
+      }
+      verts[k] = m_reverse_vertmap[tri[k]];
+    }
+
+    FaceHandle fh = m_obj.addFace(verts[0], verts[1], verts[2]);
+    m_face_numbers[fh] = t;
+    m_reverse_trimap[t] = fh;
+  }
+
+  //Geometry and labels can change without any triangle being replaced (smoothing, vertex movement
+  //during collapses, flap removal), so copy those back everywhere.
+  for(size_t i = 0; i < m_reverse_vertmap.size(); ++i) {
+    VertexHandle vh = m_reverse_vertmap[i];
+    if(!vh.isValid())
+      continue;
+    ElTopo::Vec3d x = st.get_position(i);
+    m_shell.setVertexPosition(vh, Vec3d(x[0], x[1], x[2]));
+    m_shell.setVertexVelocity(vh, Vec3d(0, 0, 0));
+  }
+
+  for(size_t i = 0; i < m_reverse_trimap.size(); ++i) {
+    FaceHandle fh = m_reverse_trimap[i];
+    if(!fh.isValid())
+      continue;
+    ElTopo::Vec2i label = st.m_mesh.get_triangle_label(i);
+    m_shell.setFaceLabel(fh, Vec2i(label[0], label[1]));
+    m_shell.setFaceActive(fh);
+  }
+
+  clearHistory();
+  defragIfSparse();
+
+  m_revision = m_obj.getTopologyRevision();
+  m_revision_valid = true;
+}
+
+void ShellElTopoMirror::applyPositions(Scalar timestep)
+{
+  assert(m_tracker != NULL);
+  ElTopo::SurfTrack& st = *m_tracker;
+
+  //figure out what the actual velocities were, and update the mesh data
+  for(size_t i = 0; i < m_reverse_vertmap.size(); ++i) {
+    VertexHandle vh = m_reverse_vertmap[i];
+    if(!vh.isValid())
+      continue;
+
+    ElTopo::Vec3d pos = st.get_position(i);
+    Vec3d old_pos = m_shell.getVertexDampingUndeformed(vh);
+    Vec3d new_pos(pos[0], pos[1], pos[2]);
+    m_shell.setVertexPosition(vh, new_pos);
+    m_shell.setVertexVelocity(vh, (new_pos - old_pos) / timestep);
+
+    if(isnan(pos[0]) || isnan(pos[1]) || isnan(pos[2]))
+      std::cout << "ElTopo Failed: NaN vertex\n";
+    if(isinf(pos[0]) || isinf(pos[1]) || isinf(pos[2]))
+      std::cout << "ElTopo Failed: Inf vertex\n";
+  }
+
+  //integration only records vertex events, if any
+  clearHistory();
+}
+
+void ShellElTopoMirror::deleteFace(const FaceHandle& f)
+{
+  if(!isSynced() || m_face_numbers[f] < 0) {
+    //the mirror is stale anyway, and will be rebuilt on the next sync
+    m_obj.deleteFace(f, true);
+    return;
+  }
+
+  std::vector<VertexHandle> verts;
+  for(FaceVertexIterator fvit = m_obj.fv_iter(f); fvit; ++fvit)
+    verts.push_back(*fvit);
+
+  m_tracker->remove_triangle(m_face_numbers[f]);
+  m_reverse_trimap[m_face_numbers[f]] = FaceHandle();
+  m_face_numbers[f] = -1;
+
+  //El Topo drops orphaned edges by itself, but vertices have to be removed explicitly
+  m_obj.deleteFace(f, true);
+  for(size_t j = 0; j < verts.size(); ++j) {
+    VertexHandle vh = verts[j];
+    if(m_obj.vertexExists(vh))
+      continue;
+    m_tracker->remove_vertex(m_vert_numbers[vh]);
+    m_reverse_vertmap[m_vert_numbers[vh]] = VertexHandle();
+    m_vert_numbers[vh] = -1;
+  }
+
+  //these edits are already reflected on both sides
+  clearHistory();
+  m_revision = m_obj.getTopologyRevision();
+}
+
+void ShellElTopoMirror::clearHistory()
+{
+  m_tracker->m_vertex_change_history.clear();
+  m_tracker->m_triangle_change_history.clear();
+  m_tracker->m_mesh_change_history.clear();
+}
+
+void ShellElTopoMirror::defragIfSparse()
+{
+  ElTopo::SurfTrack& st = *m_tracker;
+
+  size_t dead = 0;
+  for(size_t i = 0; i < m_reverse_vertmap.size(); ++i)
+    dead += m_reverse_vertmap[i].isValid() ? 0 : 1;
+  for(size_t i = 0; i < m_reverse_trimap.size(); ++i)
+    dead += m_reverse_trimap[i].isValid() ? 0 : 1;
+
+  if(dead <= DEFRAG_DEAD_FRACTION * (m_reverse_vertmap.size() + m_reverse_trimap.size()))
+    return;
+
+  //shell vertices without faces have no El Topo counterpart that survives the defrag
+  for(size_t i = 0; i < m_reverse_vertmap.size(); ++i) {
+    VertexHandle vh = m_reverse_vertmap[i];
+    if(vh.isValid() && st.m_mesh.vertex_is_deleted(i)) {
+      m_vert_numbers[vh] = -1;
+      m_reverse_vertmap[i] = VertexHandle();
+    }
+  }
+
+  st.defrag_mesh();
+
+  //the defrag maps hold (old, new) index pairs; the vertex one is indexed by old index, and is only
+  //meaningful for live vertices, the triangle one is indexed by new index
+  std::vector<VertexHandle> vertmap(st.get_num_vertices());
+  for(size_t i = 0; i < m_reverse_vertmap.size(); ++i) {
+    VertexHandle vh = m_reverse_vertmap[i];
+    if(!vh.isValid())
+      continue;
+    size_t j = st.m_defragged_vertex_map[i][1];
+    vertmap[j] = vh;
+    m_vert_numbers[vh] = j;
+  }
+
+  std::vector<FaceHandle> trimap(st.m_mesh.nt());
+  for(size_t j = 0; j < st.m_defragged_triangle_map.size(); ++j) {
+    FaceHandle fh = m_reverse_trimap[st.m_defragged_triangle_map[j][0]];
+    trimap[j] = fh;
+    if(fh.isValid())
+      m_face_numbers[fh] = j;
+  }
+
+  m_reverse_vertmap.swap(vertmap);
+  m_reverse_trimap.swap(trimap);
+
+  //defragging renumbers through remove/add events, which are not real changes
+  clearHistory();
+}
+
+}
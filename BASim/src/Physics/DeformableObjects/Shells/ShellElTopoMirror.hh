@@ -0,0 +1,91 @@
+/**
+ * \file ShellElTopoMirror.hh
+ */
+#ifndef SHELLELTOPOMIRROR_HH
+#define SHELLELTOPOMIRROR_HH
+
+#include "BASim/src/Core/TopologicalObject/TopObjProperty.hh"
+#include "BASim/src/Physics/DeformableObjects/DeformableObject.hh"
+#include "surftrack.h"
+#include "subdivisionscheme.h"
+
+//A long-lived El Topo copy of an ElasticShell's mesh, shared by remeshing and collision resolution.
+//
+//The SurfTrack and the index maps between the two meshes are kept across time steps. Each step
+//only the vertex data is pushed into El Topo, and only the triangles El Topo added or removed
+//are replayed onto the shell. Topology edits made to the shell by anybody else are detected
+//through the object's topology revision, and cause the mirror to be rebuilt from scratch.
+
+namespace BASim {
+
+class ElasticShell;
+
+class ShellElTopoMirror {
+
+public:
+  ShellElTopoMirror(ElasticShell& shell);
+  ~ShellElTopoMirror();
+
+  //Bring the El Topo mesh up to date with the shell and return it. Positions are taken from the damping
+  //"undeformed" configuration if requested (the start-of-step state for collision resolution), otherwise
+  //from the current configuration; predicted positions are always the current ones. Masses are infinite
+  //along constrained directions, and remeshing velocities are the displacements over the timestep.
+  //The broad phase is not rebuilt here, since callers typically adjust masses first.
+  ElTopo::SurfTrack& sync(const ElTopo::SurfTrackInitializationParameters& params, bool start_of_step_positions, Scalar timestep);
+
+  //Replay the triangles El Topo added and removed since the last sync onto the shell, and copy back positions
+  //and face labels. New faces are made active, and all velocities are zeroed.
+  void applyTopologyChanges();
+
+  //Copy El Topo's current positions back onto the shell, setting velocities to the change in position
+  //since the start of the step.
+  void applyPositions(Scalar timestep);
+
+  //Delete a face from the shell, together with any edges and vertices it leaves orphaned, and
+  //mirror the deletion in El Topo so that the two stay in sync.
+  void deleteFace(const FaceHandle& f);
+
+  //Force a rebuild on the next sync
+  void invalidate() { m_revision_valid = false; }
+
+  //Index maps; -1 / invalid handles denote unmapped elements
+  int getVertexIndex(const VertexHandle& v) const { return m_vert_numbers[v]; }
+  VertexHandle getVertexHandle(size_t i) const { return i < m_reverse_vertmap.size() ? m_reverse_vertmap[i] : VertexHandle(); }
+  int getFaceIndex(const FaceHandle& f) const { return m_face_numbers[f]; }
+  FaceHandle getFaceHandle(size_t i) const { return i < m_reverse_trimap.size() ? m_reverse_trimap[i] : FaceHandle(); }
+
+  ElTopo::SubdivisionScheme* getSubdivisionScheme(bool smooth) { return smooth ? (ElTopo::SubdivisionScheme*)&m_butterfly : (ElTopo::SubdivisionScheme*)&m_midpoint; }
+
+protected:
+
+  bool isSynced() const;
+
+  void rebuild(const ElTopo::SurfTrackInitializationParameters& params);
+  void pushVertexData(bool start_of_step_positions, Scalar timestep);
+  void clearHistory();
+  void defragIfSparse();
+
+  ElasticShell& m_shell;
+  DeformableObject& m_obj;
+
+  ElTopo::SurfTrack* m_tracker;
+  ElTopo::SurfTrackInitializationParameters m_params;
+
+  //Subdivision schemes handed to the SurfTrack, which keeps pointers to them
+  ElTopo::ModifiedButterflyScheme m_butterfly;
+  ElTopo::MidpointScheme m_midpoint;
+
+  //Index mappings between us and El Topo
+  VertexProperty<int> m_vert_numbers;
+  FaceProperty<int> m_face_numbers;
+  std::vector<VertexHandle> m_reverse_vertmap;
+  std::vector<FaceHandle> m_reverse_trimap;
+
+  //The shell's topology revision as of the last time the two meshes were known to match
+  unsigned int m_revision;
+  bool m_revision_valid;
+};
+
+}
+
+#endif //SHELLELTOPOMIRROR_HH
@@ -189,9 +189,7 @@ void ShellLinearSurfaceTensionForce ::globalJacobian( Scalar scale, MatrixBase&
 //    else
 //      elementJacobian(deformed, m_shell.getVolume(f1), 0, localMatrix);
 
-    for (int i = 0; i < (f2.isValid()?12:9); ++i)
-      for(int j = 0; j < (f2.isValid()?12:9); ++j)
-        Jacobian.add(indices[i], indices[j], scale * localMatrix(i,j));
+    Jacobian.addBlock(&indices[0], f2.isValid()?12:9, localMatrix.data(), localMatrix.rows(), scale);
 
   }
   
@@ -303,9 +303,7 @@ void ShellLinearSurfaceTensionForce2 ::globalJacobian( Scalar scale, MatrixBase&
     elementJacobian(vertices, faces, volumes, incidentFacesPerVertex, isBdryVertex, localMatrix);
     
     std::cout << "Scattering Jacobian\n";
-    for (unsigned int i = 0; i < 3*vertices.size(); ++i)
-      for(unsigned int j = 0; j < 3*vertices.size(); ++j)
-        Jacobian.add(indices[i], indices[j], scale * localMatrix(i,j));
+    Jacobian.addBlock(&indices[0], 3*vertices.size(), localMatrix.data(), localMatrix.rows(), scale);
 
   }
   std::cout << "Done global Jacobian\n";
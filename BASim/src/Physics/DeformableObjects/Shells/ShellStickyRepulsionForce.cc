@@ -105,13 +105,18 @@ adreal<NumRepulsionDof,DO_HESS,Real> RepulsionEnergy(const ShellStickyRepulsionF
 }
 
 Scalar ShellStickyRepulsionForce::globalEnergy() const
+{
+  return elementRangeEnergy(0, m_faces.size());
+}
+
+Scalar ShellStickyRepulsionForce::elementRangeEnergy( int begin, int end ) const
 {
   Scalar energy = 0;
   std::vector<int> indices(NumRepulsionDof );
   std::vector<Vec3d> deformed(NumRepulsionVerts );
   std::vector<Vec3d> undef_damp(NumRepulsionVerts );
 
-  for (unsigned int i = 0; i < m_faces.size(); ++i) {
+  for (int i = begin; i < end; ++i) {
     const FaceHandle& fh = m_faces[i];
     const VertexHandle& vh = m_vertices[i];
 
@@ -122,6 +127,11 @@ Scalar ShellStickyRepulsionForce::globalEnergy() const
 }
 
 void ShellStickyRepulsionForce::globalForce( VecXd& force )  const
+{
+  elementRangeForce(0, m_faces.size(), force);
+}
+
+void ShellStickyRepulsionForce::elementRangeForce( int begin, int end, VecXd& force ) const
 {
 
   std::vector<int> indices(NumRepulsionDof );
@@ -129,7 +139,7 @@ void ShellStickyRepulsionForce::globalForce( VecXd& force )  const
   std::vector<Vec3d> undeformed_damp(NumRepulsionVerts );
   Eigen::Matrix<Scalar, NumRepulsionDof , 1> localForce;
 
-  for (unsigned int f = 0; f < m_faces.size(); ++f) {
+  for (int f = begin; f < end; ++f) {
     const FaceHandle& fh = m_faces[f];
     const VertexHandle& vh = m_vertices[f];
    
@@ -176,9 +186,7 @@ void ShellStickyRepulsionForce::globalJacobian( Scalar scale, MatrixBase& Jacobi
     if(!valid) continue;
     
     elementJacobian(deformed, m_barycoords[f], m_stiffnesses[f], m_restlen[f], localMatrix);
-    for (unsigned int i = 0; i < indices.size(); ++i)
-      for(unsigned int j = 0; j < indices.size(); ++j)
-        Jacobian.add(indices[i], indices[j], scale * localMatrix(i,j));
+    Jacobian.addBlock(&indices[0], indices.size(), localMatrix.data(), localMatrix.rows(), scale);
 
     
     Vec3d facePt = undeformed_damp[0]*m_barycoords[f][0] + 
@@ -188,10 +196,41 @@ void ShellStickyRepulsionForce::globalJacobian( Scalar scale, MatrixBase& Jacobi
     normal.normalize();
     Scalar damp_restlen = fabs((facePt - undeformed_damp[3]).dot(normal));
     elementJacobian(deformed, m_barycoords[f], m_damping[f], damp_restlen, localMatrix);
-    for (unsigned int i = 0; i < indices.size(); ++i)
-      for(unsigned int j = 0; j < indices.size(); ++j)
-        Jacobian.add(indices[i], indices[j], scale / m_timestep * localMatrix(i,j));
+    Jacobian.addBlock(&indices[0], indices.size(), localMatrix.data(), localMatrix.rows(), scale / m_timestep);
+
+  }
+  
+}
+
+void ShellStickyRepulsionForce::elementRangeJacobian( int begin, int end, int* indices, Scalar* blocks, char* valid ) const
+{
+  std::vector<int> localIndices(NumRepulsionDof );
+  std::vector<Vec3d> deformed(NumRepulsionVerts );
+  std::vector<Vec3d> undeformed_damp(NumRepulsionVerts );
+
+  Eigen::Matrix<Scalar, NumRepulsionDof , NumRepulsionDof > localMatrix, dampingMatrix;
+
+  for (int f = begin; f < end; ++f, indices += NumRepulsionDof, blocks += NumRepulsionDof*NumRepulsionDof, ++valid) {
+    const FaceHandle& fh = m_faces[f];
+    const VertexHandle& vh = m_vertices[f];
+
+    *valid = gatherDOFs(fh, vh, deformed, undeformed_damp, localIndices);
+    if(!*valid) continue;
+    
+    //elastic and viscous parts share the dofs, so they go out as one block
+    elementJacobian(deformed, m_barycoords[f], m_stiffnesses[f], m_restlen[f], localMatrix);
+    
+    Vec3d facePt = undeformed_damp[0]*m_barycoords[f][0] + 
+      undeformed_damp[1]*m_barycoords[f][1] +   
+      undeformed_damp[2]*m_barycoords[f][2];
+    Vec3d normal = (undeformed_damp[2] - undeformed_damp[0]).cross(undeformed_damp[1] - undeformed_damp[0]);
+    normal.normalize();
+    Scalar damp_restlen = fabs((facePt - undeformed_damp[3]).dot(normal));
+    elementJacobian(deformed, m_barycoords[f], m_damping[f], damp_restlen, dampingMatrix);
+    localMatrix += (1.0 / m_timestep) * dampingMatrix;
 
+    std::copy(localIndices.begin(), localIndices.end(), indices);
+    std::copy(localMatrix.data(), localMatrix.data() + NumRepulsionDof*NumRepulsionDof, blocks);
   }
   
 }
@@ -37,6 +37,12 @@ public:
   Scalar globalEnergy() const;
   void globalForce(VecXd& force) const;
   void globalJacobian(Scalar scale, MatrixBase& Jacobian) const;
+
+  int prepareElements() { return m_faces.size(); }
+  int elementBlockSize() const { return NumRepulsionDof; }
+  Scalar elementRangeEnergy(int begin, int end) const;
+  void elementRangeForce(int begin, int end, VecXd& force) const;
+  void elementRangeJacobian(int begin, int end, int* indices, Scalar* blocks, char* valid) const;
   
   void addSpring(const FaceHandle& fh, const VertexHandle& vh, const Vec3d& baryCoords, Scalar stiffness, Scalar damping, Scalar restlen);
   void clearSprings();
@@ -129,15 +129,72 @@ void ShellSurfaceTensionForce::globalJacobian( Scalar scale, MatrixBase& Jacobia
     if(!valid) continue;
 
     elementJacobian(deformed, localMatrix);
-    for (unsigned int i = 0; i < indices.size(); ++i)
-      for(unsigned int j = 0; j < indices.size(); ++j)
-        Jacobian.add(indices[i], indices[j], scale * localMatrix(i,j));
+    Jacobian.addBlock(&indices[0], indices.size(), localMatrix.data(), localMatrix.rows(), scale);
 
   }
   
 }
 
 
+int ShellSurfaceTensionForce::prepareElements()
+{
+  m_elements.clear();
+  if(m_surface_tension_coeff == 0) return 0;
+
+  FaceIterator fit = m_shell.getDefoObj().faces_begin();
+  for (;fit != m_shell.getDefoObj().faces_end(); ++fit)
+    m_elements.push_back(*fit);
+
+  return m_elements.size();
+}
+
+Scalar ShellSurfaceTensionForce::elementRangeEnergy( int begin, int end ) const
+{
+  Scalar energy = 0;
+  std::vector<int> indices(9);
+  std::vector<Vec3d> deformed(3);
+
+  for (int e = begin; e < end; ++e) {
+    bool valid = gatherDOFs(m_elements[e], deformed, indices);
+    if(!valid) continue;
+
+    energy += elementEnergy(deformed);
+  }
+  return energy;
+}
+
+void ShellSurfaceTensionForce::elementRangeForce( int begin, int end, VecXd& force ) const
+{
+  std::vector<int> indices(9);
+  std::vector<Vec3d> deformed(3);
+  Eigen::Matrix<Scalar, 9, 1> localForce;
+
+  for (int e = begin; e < end; ++e) {
+    bool valid = gatherDOFs(m_elements[e], deformed, indices);
+    if(!valid) continue;
+
+    elementForce(deformed, localForce);
+    for (unsigned int i = 0; i < indices.size(); ++i)
+      force(indices[i]) += localForce(i);
+  }
+}
+
+void ShellSurfaceTensionForce::elementRangeJacobian( int begin, int end, int* indices, Scalar* blocks, char* valid ) const
+{
+  std::vector<int> localIndices(9);
+  std::vector<Vec3d> deformed(3);
+  Eigen::Matrix<Scalar, 9, 9> localMatrix;
+
+  for (int e = begin; e < end; ++e, indices += 9, blocks += 81, ++valid) {
+    *valid = gatherDOFs(m_elements[e], deformed, localIndices);
+    if(!*valid) continue;
+
+    elementJacobian(deformed, localMatrix);
+    std::copy(localIndices.begin(), localIndices.end(), indices);
+    std::copy(localMatrix.data(), localMatrix.data() + 81, blocks);
+  }
+}
+
 Scalar ShellSurfaceTensionForce::elementEnergy(const std::vector<Vec3d>& deformed) const
 {
   
@@ -38,6 +38,12 @@ public:
   Scalar globalEnergy() const;
   void globalForce(VecXd& force) const;
   void globalJacobian(Scalar scale, MatrixBase& Jacobian) const;
+
+  int prepareElements();
+  int elementBlockSize() const { return NumSTDof; }
+  Scalar elementRangeEnergy(int begin, int end) const;
+  void elementRangeForce(int begin, int end, VecXd& force) const;
+  void elementRangeJacobian(int begin, int end, int* indices, Scalar* blocks, char* valid) const;
   
 protected:
 public:
@@ -51,6 +57,9 @@ public:
   
   Scalar m_surface_tension_coeff;
 
+  //faces in iteration order, refreshed by prepareElements()
+  std::vector<FaceHandle> m_elements;
+
 };
 
 
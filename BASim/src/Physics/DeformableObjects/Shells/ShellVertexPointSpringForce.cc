@@ -61,13 +61,18 @@ adreal<NumSpringDofs,DO_HESS,Real> VertPointSpringEnergy(const ShellVertexPointS
 }
 
 Scalar ShellVertexPointSpringForce::globalEnergy() const
+{
+  return elementRangeEnergy(0, m_vertices.size());
+}
+
+Scalar ShellVertexPointSpringForce::elementRangeEnergy( int begin, int end ) const
 {
   Scalar energy = 0;
   std::vector<int> indices(NumSpringDofs);
   std::vector<Vec3d> deformed(NumSpringVerts);
   std::vector<Vec3d> undef_damp(NumSpringVerts);
 
-  for (unsigned int i = 0; i < m_vertices.size(); ++i) {
+  for (int i = begin; i < end; ++i) {
     const VertexHandle& vh = m_vertices[i];
 
     gatherDOFs(vh, deformed, undef_damp, indices);
@@ -77,6 +82,11 @@ Scalar ShellVertexPointSpringForce::globalEnergy() const
 }
 
 void ShellVertexPointSpringForce::globalForce( VecXd& force )  const
+{
+  elementRangeForce(0, m_vertices.size(), force);
+}
+
+void ShellVertexPointSpringForce::elementRangeForce( int begin, int end, VecXd& force ) const
 {
 
   std::vector<int> indices(NumSpringDofs);
@@ -84,7 +94,7 @@ void ShellVertexPointSpringForce::globalForce( VecXd& force )  const
   std::vector<Vec3d> undeformed_damp(NumSpringVerts);
   Eigen::Matrix<Scalar, NumSpringDofs, 1> localForce;
 
-  for (unsigned int f = 0; f < m_vertices.size(); ++f) {
+  for (int f = begin; f < end; ++f) {
     const VertexHandle& vh = m_vertices[f];
    
     bool valid = gatherDOFs(vh, deformed, undeformed_damp, indices);
@@ -123,17 +133,39 @@ void ShellVertexPointSpringForce::globalJacobian( Scalar scale, MatrixBase& Jaco
     if(!valid) continue;
     
     elementJacobian(deformed, m_positions[f], m_stiffnesses[f], m_restlen[f], localMatrix);
-    for (unsigned int i = 0; i < indices.size(); ++i)
-      for(unsigned int j = 0; j < indices.size(); ++j)
-        Jacobian.add(indices[i], indices[j], scale * localMatrix(i,j));
+    Jacobian.addBlock(&indices[0], indices.size(), localMatrix.data(), localMatrix.rows(), scale);
 
     //viscosity/damping
     Scalar damp_restlen = (undeformed_damp[0]-m_positions[f]).norm();
     elementJacobian(deformed, m_positions[f], m_damping[f], damp_restlen, localMatrix);
-    for (unsigned int i = 0; i < indices.size(); ++i)
-      for(unsigned int j = 0; j < indices.size(); ++j)
-        Jacobian.add(indices[i], indices[j], scale / m_timestep * localMatrix(i,j));
+    Jacobian.addBlock(&indices[0], indices.size(), localMatrix.data(), localMatrix.rows(), scale / m_timestep);
+
+  }
+  
+}
+
+void ShellVertexPointSpringForce::elementRangeJacobian( int begin, int end, int* indices, Scalar* blocks, char* valid ) const
+{
+  std::vector<int> localIndices(NumSpringDofs);
+  std::vector<Vec3d> deformed(NumSpringVerts);
+  std::vector<Vec3d> undeformed_damp(NumSpringVerts);
+
+  Eigen::Matrix<Scalar, NumSpringDofs, NumSpringDofs> localMatrix, dampingMatrix;
+
+  for (int f = begin; f < end; ++f, indices += NumSpringDofs, blocks += NumSpringDofs*NumSpringDofs, ++valid) {
+    const VertexHandle& vh = m_vertices[f];
+
+    *valid = gatherDOFs(vh, deformed, undeformed_damp, localIndices);
+    if(!*valid) continue;
+    
+    //elastic and viscous parts share the dofs, so they go out as one block
+    elementJacobian(deformed, m_positions[f], m_stiffnesses[f], m_restlen[f], localMatrix);
+    Scalar damp_restlen = (undeformed_damp[0]-m_positions[f]).norm();
+    elementJacobian(deformed, m_positions[f], m_damping[f], damp_restlen, dampingMatrix);
+    localMatrix += (1.0 / m_timestep) * dampingMatrix;
 
+    std::copy(localIndices.begin(), localIndices.end(), indices);
+    std::copy(localMatrix.data(), localMatrix.data() + NumSpringDofs*NumSpringDofs, blocks);
   }
   
 }
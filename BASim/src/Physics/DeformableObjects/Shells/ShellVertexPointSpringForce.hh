@@ -38,6 +38,12 @@ public:
   Scalar globalEnergy() const;
   void globalForce(VecXd& force) const;
   void globalJacobian(Scalar scale, MatrixBase& Jacobian) const;
+
+  int prepareElements() { return m_vertices.size(); }
+  int elementBlockSize() const { return NumSpringDofs; }
+  Scalar elementRangeEnergy(int begin, int end) const;
+  void elementRangeForce(int begin, int end, VecXd& force) const;
+  void elementRangeJacobian(int begin, int end, int* indices, Scalar* blocks, char* valid) const;
   
   void addSpring(const VertexHandle& vh, const Vec3d& position, Scalar stiffness, Scalar damping, Scalar restlen);
 
@@ -939,10 +939,8 @@ void ShellVolumeForce::globalJacobian( Scalar scale, MatrixBase& Jacobian ) cons
 //    std::cout << " local force = " << localForce << std::endl;
     
     if(labels[0] != -1) {
-      for (unsigned int i = 0; i < indices.size(); ++i)
-        for(unsigned int j = 0; j < indices.size(); ++j)
-          if (indices[i] >= 0 && indices[j] >= 0)
-            Jacobian.add(indices[i], indices[j], +m_strength * scale * ((volumes[labels[0]] - m_target_volumes[labels[0]]) * localMatrix(i,j)));
+      Jacobian.addBlock(&indices[0], indices.size(), localMatrix.data(), localMatrix.rows(),
+                        +m_strength * scale * (volumes[labels[0]] - m_target_volumes[labels[0]]));
 //      for (unsigned int i = 0; i < indices.size(); ++i)
 //        for (int j = 0; j < obj.ndof(); ++j)
 //          if (indices[i] >= 0)
@@ -950,10 +948,8 @@ void ShellVolumeForce::globalJacobian( Scalar scale, MatrixBase& Jacobian ) cons
     }
 
     if(labels[1] != -1) {
-      for (unsigned int i = 0; i < indices.size(); ++i)
-        for(unsigned int j = 0; j < indices.size(); ++j)
-          if (indices[i] >= 0 && indices[j] >= 0)
-            Jacobian.add(indices[i], indices[j], -m_strength * scale * ((volumes[labels[1]] - m_target_volumes[labels[1]]) * localMatrix(i,j)));
+      Jacobian.addBlock(&indices[0], indices.size(), localMatrix.data(), localMatrix.rows(),
+                        -m_strength * scale * (volumes[labels[1]] - m_target_volumes[labels[1]]));
 //      for (unsigned int i = 0; i < indices.size(); ++i)
 //        for (int j = 0; j < obj.ndof(); ++j)
 //          if (indices[i] >= 0)
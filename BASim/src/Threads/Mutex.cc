@@ -43,33 +43,30 @@ struct Mutex::Impl
     Impl() :
         m_owner(0)
     {
-// TODO:THREADING      
-      
-//#ifdef WETA_DEBUG
-//        int status =
-//#endif
-//        pthread_mutexattr_init(&m_attr);
-//        CHECK_STATUS( status, pthread_mutexattr_init );
-//#ifdef WETA_DEBUG
-//        status = pthread_mutexattr_settype( &m_attr, PTHREAD_MUTEX_ERRORCHECK_NP );
-//        CHECK_STATUS( status, pthread_mutexattr_settype );
-//#endif
-//
-//#ifdef WETA_DEBUG
-//        status =
-//#endif
-//        pthread_mutex_init(&m_mutex, &m_attr);
-//        CHECK_STATUS( status, pthread_mutex_init );
+#ifdef WETA_DEBUG
+        int status =
+#endif
+        pthread_mutexattr_init(&m_attr);
+        CHECK_STATUS( status, pthread_mutexattr_init );
+#ifdef WETA_DEBUG
+        status = pthread_mutexattr_settype( &m_attr, PTHREAD_MUTEX_ERRORCHECK_NP );
+        CHECK_STATUS( status, pthread_mutexattr_settype );
+#endif
+
+#ifdef WETA_DEBUG
+        status =
+#endif
+        pthread_mutex_init(&m_mutex, &m_attr);
+        CHECK_STATUS( status, pthread_mutex_init );
     }
     ~Impl()
     {
-// TODO:THREADING
-      
-//#ifdef WETA_DEBUG
-//        int status =
-//#endif
-//        pthread_mutex_destroy(&m_mutex);
-//        CHECK_STATUS( status, pthread_mutex_destroy );
+#ifdef WETA_DEBUG
+        int status =
+#endif
+        pthread_mutex_destroy(&m_mutex);
+        CHECK_STATUS( status, pthread_mutex_destroy );
+        pthread_mutexattr_destroy(&m_attr);
     }
 
     pthread_mutex_t m_mutex;
@@ -77,6 +74,16 @@ struct Mutex::Impl
     long int m_owner;
 };
 
+// Owner tracking is only available on Linux
+static inline long int current_thread_id()
+{
+#ifdef __linux__
+    return syscall(__NR_gettid);
+#else
+    return 0;
+#endif
+}
+
 Mutex::Mutex() :
     m_impl(new Impl)
 {
@@ -93,45 +100,35 @@ long int Mutex::Owner() const
 
 void Mutex::Lock()
 {
-// TODO:THREADING
-  
-//#ifdef WETA_DEBUG
-//    int status =
-//#endif
-//    pthread_mutex_lock(&m_impl->m_mutex);
-//    CHECK_STATUS( status, pthread_mutex_lock );
-//    //m_impl->m_owner = mach_thread_self(); //OS_MACOSX
-//    m_impl->m_owner = syscall(__NR_gettid); //OS_LINUX
+#ifdef WETA_DEBUG
+    int status =
+#endif
+    pthread_mutex_lock(&m_impl->m_mutex);
+    CHECK_STATUS( status, pthread_mutex_lock );
+    m_impl->m_owner = current_thread_id();
 }
 
 void Mutex::Unlock()
 {  
-// TODO:THREADING
-  
-//#ifdef WETA_DEBUG
-//    int status =
-//#endif
-//    pthread_mutex_unlock(&m_impl->m_mutex);
-//    CHECK_STATUS( status, pthread_mutex_unlock );
-//    m_impl->m_owner = 0; // WARNING: assumes the mutex is not recursive
+    m_impl->m_owner = 0; // WARNING: assumes the mutex is not recursive
+#ifdef WETA_DEBUG
+    int status =
+#endif
+    pthread_mutex_unlock(&m_impl->m_mutex);
+    CHECK_STATUS( status, pthread_mutex_unlock );
 }
 
 bool Mutex::TryLock()
 {
-  
-// TODO:THREADING
-  
-//    int status = pthread_mutex_trylock(&m_impl->m_mutex);
-//    if (status == 0)
-//    {
-//        //m_impl->m_owner = mach_thread_self(); //OS_MACOSX
-//        m_impl->m_owner = syscall(__NR_gettid); //OS_LINUX
-//        return true;
-//    }
-//    if (status == EBUSY)
-//        return false; CHECK_STATUS( status, pthread_mutex_trylock );
-//    return false;
-   return false;
+    int status = pthread_mutex_trylock(&m_impl->m_mutex);
+    if (status == 0)
+    {
+        m_impl->m_owner = current_thread_id();
+        return true;
+    }
+    if (status == EBUSY)
+        return false; CHECK_STATUS( status, pthread_mutex_trylock );
+    return false;
 }
 
 } // namespace threads
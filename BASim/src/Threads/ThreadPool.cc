@@ -0,0 +1,290 @@
+/**
+ * \file ThreadPool.cc
+ *
+ * \section DESCRIPTION
+ *
+ * ThreadPool implementation
+ */
+
+#include "ThreadPool.hh"
+#include <pthread.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <deque>
+#include <iostream>
+#include <assert.h>
+
+namespace BASim
+{
+namespace threads
+{
+
+static inline long atomic_add(volatile long* value, long delta)
+{
+    return __sync_add_and_fetch(value, delta);
+}
+
+struct ThreadPool::Impl
+{
+    struct QueuedTask
+    {
+        QueuedTask(Task* task = NULL, TaskGroup* group = NULL) :
+            m_task(task), m_group(group)
+        {
+        }
+
+        Task* m_task;
+        TaskGroup* m_group;
+    };
+
+    // One lock per deque: the owner and occasional thieves are the only contenders
+    struct WorkQueue
+    {
+        pthread_mutex_t m_mutex;
+        std::deque<QueuedTask> m_tasks;
+    };
+
+    struct WorkerArgs
+    {
+        ThreadPool* m_pool;
+        Impl* m_impl;
+        long m_index;
+    };
+
+    // Deques 0 to m_num_workers-1 belong to the workers, the last one is shared by outside threads
+    std::vector<WorkQueue*> m_queues;
+    std::vector<pthread_t> m_threads;
+    pthread_key_t m_worker_key;
+
+    // Tasks queued but not yet started; workers sleep when it drops to zero
+    volatile long m_queued;
+    volatile long m_sleepers;
+    bool m_shutdown;
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_work_cond;
+    pthread_cond_t m_done_cond;
+
+    // Index of the deque the calling thread pushes to
+    int ownQueue() const
+    {
+        void* worker = pthread_getspecific(m_worker_key);
+        return worker ? (int) ((long) worker - 1) : (int) m_queues.size() - 1;
+    }
+
+    bool pop(int q, QueuedTask& qt, bool back)
+    {
+        WorkQueue& queue = *m_queues[q];
+        pthread_mutex_lock(&queue.m_mutex);
+        bool found = !queue.m_tasks.empty();
+        if (found)
+        {
+            if (back)
+            {
+                qt = queue.m_tasks.back();
+                queue.m_tasks.pop_back();
+            }
+            else
+            {
+                qt = queue.m_tasks.front();
+                queue.m_tasks.pop_front();
+            }
+        }
+        pthread_mutex_unlock(&queue.m_mutex);
+        if (found)
+            atomic_add(&m_queued, -1);
+        return found;
+    }
+};
+
+static pthread_once_t s_pool_once = PTHREAD_ONCE_INIT;
+static ThreadPool* s_pool = NULL;
+
+static int default_num_threads()
+{
+    const char* env = getenv("BASIM_NUM_THREADS");
+    if (env && atoi(env) > 0)
+        return atoi(env);
+#ifndef _MSC_VER
+    return std::max((int) sysconf(_SC_NPROCESSORS_ONLN), 1);
+#else
+    return 1; //TODO CPU count detection on windows
+#endif
+}
+
+ThreadPool& ThreadPool::instance()
+{
+    struct Creator
+    {
+        static void create()
+        {
+            static ThreadPool pool(default_num_threads() - 1);
+            s_pool = &pool;
+        }
+    };
+    pthread_once(&s_pool_once, Creator::create);
+    return *s_pool;
+}
+
+ThreadPool::ThreadPool(int num_workers) :
+    m_num_workers(num_workers), m_impl(new Impl)
+{
+    m_impl->m_queued = 0;
+    m_impl->m_sleepers = 0;
+    m_impl->m_shutdown = false;
+    pthread_mutex_init(&m_impl->m_mutex, NULL);
+    pthread_cond_init(&m_impl->m_work_cond, NULL);
+    pthread_cond_init(&m_impl->m_done_cond, NULL);
+    pthread_key_create(&m_impl->m_worker_key, NULL);
+
+    m_impl->m_queues.resize(m_num_workers + 1);
+    for (size_t q = 0; q < m_impl->m_queues.size(); ++q)
+    {
+        m_impl->m_queues[q] = new Impl::WorkQueue;
+        pthread_mutex_init(&m_impl->m_queues[q]->m_mutex, NULL);
+    }
+
+    m_impl->m_threads.resize(m_num_workers);
+    for (int t = 0; t < m_num_workers; ++t)
+    {
+        Impl::WorkerArgs* args = new Impl::WorkerArgs;
+        args->m_pool = this;
+        args->m_impl = m_impl;
+        args->m_index = t;
+        pthread_create(&m_impl->m_threads[t], NULL, worker_main, static_cast<void*> (args));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    pthread_mutex_lock(&m_impl->m_mutex);
+    m_impl->m_shutdown = true;
+    pthread_cond_broadcast(&m_impl->m_work_cond);
+    pthread_mutex_unlock(&m_impl->m_mutex);
+
+    for (int t = 0; t < m_num_workers; ++t)
+        pthread_join(m_impl->m_threads[t], NULL);
+
+    for (size_t q = 0; q < m_impl->m_queues.size(); ++q)
+    {
+        pthread_mutex_destroy(&m_impl->m_queues[q]->m_mutex);
+        delete m_impl->m_queues[q];
+    }
+    pthread_key_delete(m_impl->m_worker_key);
+    pthread_cond_destroy(&m_impl->m_done_cond);
+    pthread_cond_destroy(&m_impl->m_work_cond);
+    pthread_mutex_destroy(&m_impl->m_mutex);
+    delete m_impl;
+}
+
+void ThreadPool::submit(Task* task, TaskGroup* group)
+{
+    Impl::WorkQueue& queue = *m_impl->m_queues[m_impl->ownQueue()];
+    pthread_mutex_lock(&queue.m_mutex);
+    queue.m_tasks.push_back(Impl::QueuedTask(task, group));
+    pthread_mutex_unlock(&queue.m_mutex);
+
+    // Full barrier: either we see the sleeper, or the sleeper sees the new task
+    atomic_add(&m_impl->m_queued, 1);
+    if (atomic_add(&m_impl->m_sleepers, 0) > 0)
+    {
+        pthread_mutex_lock(&m_impl->m_mutex);
+        pthread_cond_signal(&m_impl->m_work_cond);
+        pthread_mutex_unlock(&m_impl->m_mutex);
+    }
+}
+
+bool ThreadPool::runOne()
+{
+    int own = m_impl->ownQueue();
+    int num_queues = m_impl->m_queues.size();
+
+    Impl::QueuedTask qt;
+    bool found = m_impl->pop(own, qt, true);
+    for (int i = 1; !found && i < num_queues; ++i)
+        found = m_impl->pop((own + i) % num_queues, qt, false);
+    if (!found)
+        return false;
+
+    qt.m_task->execute();
+    taskDone(*qt.m_group);
+    return true;
+}
+
+void ThreadPool::taskDone(TaskGroup& group)
+{
+    if (atomic_add(&group.m_pending, -1) == 0)
+    {
+        pthread_mutex_lock(&m_impl->m_mutex);
+        pthread_cond_broadcast(&m_impl->m_done_cond);
+        pthread_mutex_unlock(&m_impl->m_mutex);
+    }
+}
+
+void ThreadPool::wait(TaskGroup& group)
+{
+    while (atomic_add(&group.m_pending, 0) > 0)
+    {
+        if (runOne())
+            continue;
+
+        // Nothing left to steal: the group's remaining tasks are running on other threads
+        pthread_mutex_lock(&m_impl->m_mutex);
+        while (atomic_add(&group.m_pending, 0) > 0 && atomic_add(&m_impl->m_queued, 0) == 0)
+            pthread_cond_wait(&m_impl->m_done_cond, &m_impl->m_mutex);
+        pthread_mutex_unlock(&m_impl->m_mutex);
+    }
+}
+
+void* ThreadPool::worker_main(void* varg)
+{
+    Impl::WorkerArgs* args = static_cast<Impl::WorkerArgs*> (varg);
+    ThreadPool* pool = args->m_pool;
+    Impl* impl = args->m_impl;
+    pthread_setspecific(impl->m_worker_key, reinterpret_cast<void*> (args->m_index + 1));
+    delete args;
+
+    for (;;)
+    {
+        if (pool->runOne())
+            continue;
+
+        pthread_mutex_lock(&impl->m_mutex);
+        atomic_add(&impl->m_sleepers, 1);
+        while (!impl->m_shutdown && atomic_add(&impl->m_queued, 0) == 0)
+            pthread_cond_wait(&impl->m_work_cond, &impl->m_mutex);
+        atomic_add(&impl->m_sleepers, -1);
+        bool shutdown = impl->m_shutdown;
+        pthread_mutex_unlock(&impl->m_mutex);
+
+        if (shutdown)
+            break;
+    }
+
+    return NULL;
+}
+
+TaskGroup::TaskGroup() :
+    m_pending(0)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    wait();
+}
+
+void TaskGroup::run(Task* task)
+{
+    assert(task != NULL);
+    atomic_add(&m_pending, 1);
+    ThreadPool::instance().submit(task, this);
+}
+
+void TaskGroup::wait()
+{
+    if (atomic_add(&m_pending, 0) > 0)
+        ThreadPool::instance().wait(*this);
+}
+
+} // namespace threads
+} // namespace BASim
@@ -0,0 +1,169 @@
+/**
+ * \file ThreadPool.hh
+ *
+ * \section DESCRIPTION
+ *
+ * Process-wide pool of worker threads with per-worker task deques and work stealing,
+ * plus the TaskGroup and parallel_for interfaces built on top of it.
+ */
+
+#ifndef THREADS_THREADPOOL_HH
+#define THREADS_THREADPOOL_HH
+
+#include <vector>
+#include <algorithm>
+
+namespace BASim
+{
+namespace threads
+{
+
+/// A unit of work for the thread pool. Tasks are not owned by the pool.
+class Task
+{
+public:
+    virtual ~Task()
+    {
+    }
+
+    virtual void execute() = 0;
+};
+
+class TaskGroup;
+
+/**
+ * Worker threads are started once, on first use, and live until the process exits. Each
+ * worker owns a deque: it pushes and pops its own tasks at the back, while idle workers
+ * steal from the front of the other deques. Threads that are not pool workers submit
+ * into a shared deque that everybody steals from. A thread waiting on a TaskGroup runs
+ * queued tasks instead of blocking, so groups may be nested freely.
+ *
+ * The number of workers is one less than the number of online processors, since the
+ * submitting thread takes part in the work. It can be overridden with the
+ * BASIM_NUM_THREADS environment variable (total threads, including the caller).
+ */
+class ThreadPool
+{
+public:
+    static ThreadPool& instance();
+
+    /// Number of threads that can run tasks concurrently, counting the caller.
+    int concurrency() const
+    {
+        return m_num_workers + 1;
+    }
+
+private:
+    ThreadPool(int num_workers);
+    ~ThreadPool();
+
+    // Copy forbidden
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    void submit(Task* task, TaskGroup* group);
+    bool runOne();
+    void wait(TaskGroup& group);
+    void taskDone(TaskGroup& group);
+
+    struct Impl;
+    static void* worker_main(void* arg);
+
+    int m_num_workers;
+    Impl* m_impl;
+
+    friend class TaskGroup;
+};
+
+/// A set of tasks submitted to the pool that can be waited on together.
+class TaskGroup
+{
+public:
+    TaskGroup();
+    /// Waits for the remaining tasks.
+    ~TaskGroup();
+
+    /// Queues task for execution. The task must stay alive until wait() returns.
+    void run(Task* task);
+    /// Returns once every task of the group has executed, helping with queued work meanwhile.
+    void wait();
+
+private:
+    // Copy forbidden
+    TaskGroup(const TaskGroup&);
+    TaskGroup& operator=(const TaskGroup&);
+
+    volatile long m_pending;
+
+    friend class ThreadPool;
+};
+
+template<typename BodyT>
+class ParallelForTask: public Task
+{
+    const BodyT* m_body;
+    int m_begin;
+    int m_end;
+
+public:
+    ParallelForTask() :
+        m_body(NULL), m_begin(0), m_end(0)
+    {
+    }
+
+    ParallelForTask(const BodyT& body, int begin, int end) :
+        m_body(&body), m_begin(begin), m_end(end)
+    {
+    }
+
+    void execute()
+    {
+        for (int i = m_begin; i < m_end; ++i)
+            (*m_body)(i);
+    }
+};
+
+/**
+ * Calls body(i) for every i in [begin, end), possibly concurrently and in any order. The
+ * range is cut into contiguous chunks of at least grain_size indices, about four per
+ * thread so that stealing can even out unequal chunk costs. body must be thread-safe.
+ *
+ * A positive max_threads below the pool's concurrency cuts the range into at most
+ * max_threads chunks instead, so that no more than max_threads threads work on it.
+ */
+template<typename BodyT>
+void parallel_for(int begin, int end, const BodyT& body, int grain_size = 1, int max_threads = 0)
+{
+    int count = end - begin;
+    if (count <= 0)
+        return;
+
+    int chunk;
+    if (max_threads > 0 && max_threads < ThreadPool::instance().concurrency())
+        chunk = std::max(grain_size, (count + max_threads - 1) / max_threads);
+    else
+        chunk = std::max(grain_size, count / (4 * ThreadPool::instance().concurrency()));
+    if (chunk >= count)
+    {
+        for (int i = begin; i < end; ++i)
+            body(i);
+        return;
+    }
+
+    std::vector<ParallelForTask<BodyT> > tasks;
+    tasks.reserve((count + chunk - 1) / chunk);
+    for (int b = begin; b < end; b += chunk)
+        tasks.push_back(ParallelForTask<BodyT> (body, b, std::min(b + chunk, end)));
+
+    TaskGroup group;
+    // Keep the first chunk for the calling thread
+    for (size_t t = 1; t < tasks.size(); ++t)
+        group.run(&tasks[t]);
+    tasks[0].execute();
+    group.wait();
+}
+
+} // namespace threads
+} // namespace BASim
+
+#endif
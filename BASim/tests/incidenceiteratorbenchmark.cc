@@ -0,0 +1,116 @@
+/**
+ * \file incidenceiteratorbenchmark.cc
+ *
+ * Times full passes of the adjacency iterators over a triangulated grid of about a
+ * million faces. Each pass visits every vertex, edge or face and walks one of its
+ * adjacency lists, all of which are IncidenceMatrix rows. The handles visited are summed
+ * into a checksum so that passes can be compared across IncidenceMatrix layouts.
+ *
+ * Usage: incidenceiteratorbenchmark [grid size [passes]]
+ */
+
+#include "BASim/src/Core/TopologicalObject/TopologicalObject.hh"
+#include "BASim/src/Core/TopologicalObject/TopObjIterators.hh"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <sys/time.h>
+
+using namespace BASim;
+
+static double now()
+{
+  timeval tp;
+  gettimeofday(&tp, NULL);
+  return (double) tp.tv_sec + 1e-6 * (double) tp.tv_usec;
+}
+
+static void buildGrid(TopologicalObject& obj, int n)
+{
+  std::vector<VertexHandle> verts;
+  for(int i = 0; i < (n+1)*(n+1); ++i)
+    verts.push_back(obj.addVertex());
+
+  for(int j = 0; j < n; ++j) {
+    for(int i = 0; i < n; ++i) {
+      VertexHandle v00 = verts[j*(n+1) + i], v10 = verts[j*(n+1) + i+1];
+      VertexHandle v01 = verts[(j+1)*(n+1) + i], v11 = verts[(j+1)*(n+1) + i+1];
+      obj.addFace(v00, v10, v11);
+      obj.addFace(v00, v11, v01);
+    }
+  }
+}
+
+struct PassResult
+{
+  PassResult() : entries(0), checksum(0), time(0) {}
+
+  long entries;
+  long checksum;
+  double time;
+};
+
+static void report(const char* name, const PassResult& result)
+{
+  std::cout << std::setw(4) << name << ": " << result.entries << " entries in " << result.time << " s, "
+            << 1e9 * result.time / result.entries << " ns per entry (checksum " << result.checksum << ")" << std::endl;
+}
+
+//Walks the adjacency list of every simplex of one kind with the given iterator
+#define ITERATOR_PASS(result, passes, simplices_begin, simplices_end, SimplexIterT, AdjIterT, adj_iter) \
+  {                                                                                             \
+    double start = now();                                                                       \
+    for(int p = 0; p < passes; ++p)                                                             \
+      for(SimplexIterT s_it = obj.simplices_begin(); s_it != obj.simplices_end(); ++s_it)       \
+        for(AdjIterT a_it = obj.adj_iter(*s_it); a_it; ++a_it) {                                \
+          ++result.entries;                                                                     \
+          result.checksum += (*a_it).idx();                                                     \
+        }                                                                                       \
+    result.time = now() - start;                                                                \
+  }
+
+int main(int argc, char** argv)
+{
+  int gridSize = argc > 1 ? std::atoi(argv[1]) : 708;
+  int passes = argc > 2 ? std::atoi(argv[2]) : 5;
+
+  TopologicalObject obj;
+  double start = now();
+  buildGrid(obj, gridSize);
+  double buildTime = now() - start;
+  std::cout << "Grid of " << obj.nv() << " vertices, " << obj.ne() << " edges and " << obj.nf() << " faces built in "
+            << buildTime << " s" << std::endl;
+
+  //the first vertex-face query builds the cache; keep that out of the timings
+  obj.vf_iter(*obj.vertices_begin());
+
+  PassResult ve, vf, vv, ev, ef, fe, fv;
+  ITERATOR_PASS(ve, passes, vertices_begin, vertices_end, VertexIterator, VertexEdgeIterator, ve_iter);
+  ITERATOR_PASS(vf, passes, vertices_begin, vertices_end, VertexIterator, VertexFaceIterator, vf_iter);
+  ITERATOR_PASS(vv, passes, vertices_begin, vertices_end, VertexIterator, VertexVertexIterator, vv_iter);
+  ITERATOR_PASS(ev, passes, edges_begin, edges_end, EdgeIterator, EdgeVertexIterator, ev_iter);
+  ITERATOR_PASS(ef, passes, edges_begin, edges_end, EdgeIterator, EdgeFaceIterator, ef_iter);
+  ITERATOR_PASS(fe, passes, faces_begin, faces_end, FaceIterator, FaceEdgeIterator, fe_iter);
+  ITERATOR_PASS(fv, passes, faces_begin, faces_end, FaceIterator, FaceVertexIterator, fv_iter);
+
+  report("VE", ve);
+  report("VF", vf);
+  report("VV", vv);
+  report("EV", ev);
+  report("EF", ef);
+  report("FE", fe);
+  report("FV", fv);
+
+  PassResult total;
+  PassResult all[] = { ve, vf, vv, ev, ef, fe, fv };
+  for(unsigned int i = 0; i < sizeof(all) / sizeof(all[0]); ++i) {
+    total.entries += all[i].entries;
+    total.checksum += all[i].checksum;
+    total.time += all[i].time;
+  }
+  report("All", total);
+
+  return 0;
+}
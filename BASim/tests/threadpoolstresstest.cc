@@ -0,0 +1,226 @@
+/**
+ * \file threadpoolstresstest.cc
+ *
+ * \section DESCRIPTION
+ *
+ * Stress test for threads::ThreadPool: repeated and nested parallel_for calls with uneven
+ * task costs, TaskGroups submitted from inside tasks, and the max_threads cap of
+ * parallel_for. Run it with BASIM_NUM_THREADS set to vary the pool size, and under
+ * ThreadSanitizer to check the pool's synchronization.
+ *
+ * Returns non-zero if any result is wrong or the cap is exceeded.
+ */
+
+#include "BASim/src/Threads/ThreadPool.hh"
+#include "BASim/src/Threads/Mutex.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+using namespace BASim::threads;
+
+static const int NUM_REPETITIONS = 20;
+static const int NUM_ITEMS = 10000;
+static const int NUM_NESTED_ITEMS = 64;
+static const int NUM_INNER_ITEMS = 200;
+
+// Deliberately uneven amount of work, so that stealing has something to even out
+static long work(int i)
+{
+    long sum = 0;
+    for (int k = 0; k < 1000 * (i % 7 + 1); ++k)
+        sum += k ^ i;
+    return sum + i;
+}
+
+class WorkBody
+{
+    std::vector<long>& m_out;
+
+public:
+    WorkBody(std::vector<long>& out) :
+        m_out(out)
+    {
+    }
+
+    void operator()(int i) const
+    {
+        m_out[i] = work(i);
+    }
+};
+
+// Runs a parallel_for of its own for every index
+class NestedBody
+{
+    std::vector<long>& m_out;
+
+public:
+    NestedBody(std::vector<long>& out) :
+        m_out(out)
+    {
+    }
+
+    void operator()(int i) const
+    {
+        std::vector<long> inner(NUM_INNER_ITEMS);
+        parallel_for(0, NUM_INNER_ITEMS, WorkBody(inner));
+
+        long sum = 0;
+        for (int j = 0; j < NUM_INNER_ITEMS; ++j)
+            sum += inner[j];
+        m_out[i] = sum + i;
+    }
+};
+
+// Tracks how many threads are inside the body at once
+class ConcurrencyBody
+{
+    Mutex& m_mutex;
+    int& m_active;
+    int& m_max_active;
+
+public:
+    ConcurrencyBody(Mutex& mutex, int& active, int& max_active) :
+        m_mutex(mutex), m_active(active), m_max_active(max_active)
+    {
+    }
+
+    void operator()(int i) const
+    {
+        {
+            ScopedLock<Mutex> lock(&m_mutex);
+            m_max_active = std::max(m_max_active, ++m_active);
+        }
+        work(i);
+        {
+            ScopedLock<Mutex> lock(&m_mutex);
+            --m_active;
+        }
+    }
+};
+
+// A task that spawns a group of tasks of its own and waits for them
+class SpawningTask: public Task
+{
+    std::vector<long>* m_out;
+    int m_index;
+
+public:
+    SpawningTask(std::vector<long>* out, int index) :
+        m_out(out), m_index(index)
+    {
+    }
+
+    void execute()
+    {
+        std::vector<long> inner(NUM_INNER_ITEMS);
+        std::vector<ParallelForTask<WorkBody> > tasks;
+        WorkBody body(inner);
+        for (int j = 0; j < NUM_INNER_ITEMS; ++j)
+            tasks.push_back(ParallelForTask<WorkBody> (body, j, j + 1));
+
+        TaskGroup group;
+        for (size_t t = 0; t < tasks.size(); ++t)
+            group.run(&tasks[t]);
+        group.wait();
+
+        long sum = 0;
+        for (int j = 0; j < NUM_INNER_ITEMS; ++j)
+            sum += inner[j];
+        (*m_out)[m_index] = sum + m_index;
+    }
+};
+
+static long innerSum()
+{
+    long sum = 0;
+    for (int j = 0; j < NUM_INNER_ITEMS; ++j)
+        sum += work(j);
+    return sum;
+}
+
+static bool testParallelFor()
+{
+    std::vector<long> out(NUM_ITEMS, 0);
+    parallel_for(0, NUM_ITEMS, WorkBody(out));
+
+    for (int i = 0; i < NUM_ITEMS; ++i)
+        if (out[i] != work(i))
+        {
+            std::cerr << "parallel_for: wrong result at index " << i << std::endl;
+            return false;
+        }
+    return true;
+}
+
+static bool testNestedParallelFor()
+{
+    std::vector<long> out(NUM_NESTED_ITEMS, 0);
+    parallel_for(0, NUM_NESTED_ITEMS, NestedBody(out));
+
+    long expected = innerSum();
+    for (int i = 0; i < NUM_NESTED_ITEMS; ++i)
+        if (out[i] != expected + i)
+        {
+            std::cerr << "nested parallel_for: wrong result at index " << i << std::endl;
+            return false;
+        }
+    return true;
+}
+
+static bool testNestedTaskGroups()
+{
+    std::vector<long> out(NUM_NESTED_ITEMS, 0);
+    std::vector<SpawningTask> tasks;
+    for (int i = 0; i < NUM_NESTED_ITEMS; ++i)
+        tasks.push_back(SpawningTask(&out, i));
+
+    TaskGroup group;
+    for (size_t t = 0; t < tasks.size(); ++t)
+        group.run(&tasks[t]);
+    group.wait();
+
+    long expected = innerSum();
+    for (int i = 0; i < NUM_NESTED_ITEMS; ++i)
+        if (out[i] != expected + i)
+        {
+            std::cerr << "nested task groups: wrong result at index " << i << std::endl;
+            return false;
+        }
+    return true;
+}
+
+static bool testMaxThreads(int max_threads)
+{
+    Mutex mutex;
+    int active = 0;
+    int max_active = 0;
+    parallel_for(0, NUM_ITEMS, ConcurrencyBody(mutex, active, max_active), 1, max_threads);
+
+    if (max_active > max_threads)
+    {
+        std::cerr << "parallel_for capped at " << max_threads << " threads ran on " << max_active << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    int concurrency = ThreadPool::instance().concurrency();
+    std::cout << "Thread pool concurrency: " << concurrency << std::endl;
+
+    for (int rep = 0; rep < NUM_REPETITIONS; ++rep)
+    {
+        if (!testParallelFor() || !testNestedParallelFor() || !testNestedTaskGroups())
+            return 1;
+
+        for (int max_threads = 1; max_threads <= concurrency; ++max_threads)
+            if (!testMaxThreads(max_threads))
+                return 1;
+    }
+
+    std::cout << "All thread pool tests passed" << std::endl;
+    return 0;
+}
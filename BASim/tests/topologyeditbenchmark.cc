@@ -0,0 +1,157 @@
+/**
+ * \file topologyeditbenchmark.cc
+ *
+ * Times random edge splits and collapses on a triangulated grid, each followed by a
+ * vertex-face query around the edited vertex as remeshing does. The edits are run once
+ * with the cached vertex-face adjacency patched in place (addFaceToNbrsVF and
+ * collapseEdge), and once invalidating the cache after every edit so that each query
+ * rebuilds it with compute_nbrsVF, which is what every edit used to cost.
+ *
+ * Usage: topologyeditbenchmark [edits [grid size [rebuilt edits]]]
+ *
+ * Returns non-zero if the patched cache differs from a full recompute at the end.
+ */
+
+#include "BASim/src/Core/TopologicalObject/TopologicalObject.hh"
+#include "BASim/src/Core/TopologicalObject/TopObjIterators.hh"
+#include "BASim/src/Core/TopologicalObject/TopObjUtil.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <vector>
+#include <sys/time.h>
+
+using namespace BASim;
+
+static double now()
+{
+  timeval tp;
+  gettimeofday(&tp, NULL);
+  return (double) tp.tv_sec + 1e-6 * (double) tp.tv_usec;
+}
+
+//Exposes the cache state that the benchmark needs to control
+class BenchmarkObject : public TopologicalObject
+{
+public:
+  void invalidateVF() { m_validVF = false; }
+
+  EdgeHandle randomEdge() const
+  {
+    EdgeHandle eh;
+    do {
+      eh = EdgeHandle(std::rand() % numEdgeSlots());
+    } while(!edgeExists(eh));
+    return eh;
+  }
+};
+
+static void buildGrid(BenchmarkObject& obj, int n)
+{
+  std::vector<VertexHandle> verts;
+  for(int i = 0; i < (n+1)*(n+1); ++i)
+    verts.push_back(obj.addVertex());
+
+  for(int j = 0; j < n; ++j) {
+    for(int i = 0; i < n; ++i) {
+      VertexHandle v00 = verts[j*(n+1) + i], v10 = verts[j*(n+1) + i+1];
+      VertexHandle v01 = verts[(j+1)*(n+1) + i], v11 = verts[(j+1)*(n+1) + i+1];
+      obj.addFace(v00, v10, v11);
+      obj.addFace(v00, v11, v01);
+    }
+  }
+}
+
+//Touch the faces around a vertex, as the remeshing passes do after each edit
+static int countFaces(const BenchmarkObject& obj, const VertexHandle& vh)
+{
+  int count = 0;
+  for(VertexFaceIterator vf_it = obj.vf_iter(vh); vf_it; ++vf_it)
+    ++count;
+  return count;
+}
+
+//Applies the given number of random splits and collapses. A split picks a random edge; a collapse
+//undoes the most recent split that is still standing by merging its midpoint back into
+//one of the split edge's ends, so every collapse is valid and the mesh size stays bounded.
+static double runEdits(BenchmarkObject& obj, int edits, bool rebuild)
+{
+  std::vector< std::pair<VertexHandle, VertexHandle> > splits; //midpoint, end to collapse into
+  std::vector<FaceHandle> newFaces;
+  std::vector<EdgeHandle> deletedEdges;
+
+  double start = now();
+  for(int i = 0; i < edits; ++i) {
+    VertexHandle touched;
+    if(splits.empty() || std::rand() % 2 == 0) {
+      EdgeHandle eh = obj.randomEdge();
+      VertexHandle end = obj.fromVertex(eh);
+      touched = splitEdge(obj, eh, newFaces);
+      splits.push_back(std::make_pair(touched, end));
+    }
+    else {
+      VertexHandle mid = splits.back().first;
+      touched = splits.back().second;
+      splits.pop_back();
+      deletedEdges.clear();
+      obj.collapseEdge(findEdge(obj, mid, touched), mid, deletedEdges);
+    }
+
+    if(rebuild)
+      obj.invalidateVF();
+    countFaces(obj, touched);
+  }
+  return now() - start;
+}
+
+static bool matchesRecompute(BenchmarkObject& obj)
+{
+  std::vector< std::set<int> > cached;
+  for(VertexIterator v_it = obj.vertices_begin(); v_it != obj.vertices_end(); ++v_it) {
+    std::set<int> faces;
+    for(VertexFaceIterator vf_it = obj.vf_iter(*v_it); vf_it; ++vf_it)
+      faces.insert((*vf_it).idx());
+    cached.push_back(faces);
+  }
+
+  obj.invalidateVF();
+  unsigned int v = 0;
+  for(VertexIterator v_it = obj.vertices_begin(); v_it != obj.vertices_end(); ++v_it, ++v) {
+    std::set<int> faces;
+    for(VertexFaceIterator vf_it = obj.vf_iter(*v_it); vf_it; ++vf_it)
+      faces.insert((*vf_it).idx());
+    if(faces != cached[v])
+      return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+  int edits = argc > 1 ? std::atoi(argv[1]) : 100000;
+  int gridSize = argc > 2 ? std::atoi(argv[2]) : 100;
+  int rebuiltEdits = argc > 3 ? std::atoi(argv[3]) : 1000;
+
+  std::srand(1);
+  BenchmarkObject rebuilt;
+  buildGrid(rebuilt, gridSize);
+  double rebuiltTime = runEdits(rebuilt, rebuiltEdits, true);
+
+  std::srand(1);
+  BenchmarkObject patched;
+  buildGrid(patched, gridSize);
+  double patchedTime = runEdits(patched, edits, false);
+
+  std::cout << "Grid of " << patched.nf() << " faces after the edits" << std::endl;
+  std::cout << "Rebuilding the vertex-face cache: " << rebuiltEdits << " edits in " << rebuiltTime << " s, "
+            << 1e6 * rebuiltTime / rebuiltEdits << " us per edit" << std::endl;
+  std::cout << "Patching the vertex-face cache:   " << edits << " edits in " << patchedTime << " s, "
+            << 1e6 * patchedTime / edits << " us per edit" << std::endl;
+
+  if(!matchesRecompute(patched)) {
+    std::cerr << "The patched vertex-face cache differs from a full recompute" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,166 @@
+// ---------------------------------------------------------
+//
+//  blockcompress.cpp
+//
+//  A small, fast LZ77-style compressor for in-memory blocks of bytes.
+//
+//  A block is a sequence of (literal run, back reference) pairs.  Each pair is stored as the varint literal count, the
+//  literal bytes, the varint offset of the reference, and the varint reference length minus the minimum match length.
+//  An offset of zero ends the block.
+//
+// ---------------------------------------------------------
+
+// ---------------------------------------------------------
+// Includes
+// ---------------------------------------------------------
+
+#include <blockcompress.h>
+
+#include <cstring>
+#include <stdint.h>
+
+// ---------------------------------------------------------
+// Local constants, typedefs, macros
+// ---------------------------------------------------------
+
+namespace {
+
+const size_t MIN_MATCH = 4;
+const unsigned int HASH_BITS = 14;
+
+// ---------------------------------------------------------
+// Static function definitions
+// ---------------------------------------------------------
+
+inline uint32_t read32( const unsigned char* p )
+{
+    uint32_t v;
+    std::memcpy( &v, p, sizeof(v) );
+    return v;
+}
+
+inline size_t hash32( uint32_t v )
+{
+    return (size_t)( ( v * 2654435761u ) >> ( 32 - HASH_BITS ) );
+}
+
+inline void put_varint( size_t v, std::vector<unsigned char>& dst )
+{
+    while ( v >= 0x80 )
+    {
+        dst.push_back( (unsigned char)( v | 0x80 ) );
+        v >>= 7;
+    }
+    dst.push_back( (unsigned char)v );
+}
+
+inline bool get_varint( const unsigned char*& p, const unsigned char* end, size_t& v )
+{
+    v = 0;
+    for ( unsigned int shift = 0; shift < 64; shift += 7 )
+    {
+        if ( p == end ) { return false; }
+        unsigned char byte = *p++;
+        v |= (size_t)( byte & 0x7f ) << shift;
+        if ( !( byte & 0x80 ) ) { return true; }
+    }
+    return false;
+}
+
+}
+
+namespace ElTopo {
+
+// ---------------------------------------------------------
+///
+/// Greedy single-pass compression, looking up the last occurrence of each four-byte sequence in a hash table
+///
+// ---------------------------------------------------------
+
+void block_compress( const unsigned char* src, size_t size, std::vector<unsigned char>& dst )
+{
+    // positions are stored plus one, so that zero means empty
+    std::vector<size_t> last_seen( (size_t)1 << HASH_BITS, 0 );
+
+    size_t anchor = 0;
+    size_t i = 0;
+
+    while ( i + MIN_MATCH <= size )
+    {
+        size_t h = hash32( read32( src + i ) );
+        size_t candidate = last_seen[h];
+        last_seen[h] = i + 1;
+
+        if ( candidate == 0 || read32( src + candidate - 1 ) != read32( src + i ) )
+        {
+            ++i;
+            continue;
+        }
+
+        --candidate;
+
+        size_t length = MIN_MATCH;
+        while ( i + length < size && src[candidate + length] == src[i + length] )
+        {
+            ++length;
+        }
+
+        put_varint( i - anchor, dst );
+        dst.insert( dst.end(), src + anchor, src + i );
+        put_varint( i - candidate, dst );
+        put_varint( length - MIN_MATCH, dst );
+
+        i += length;
+        anchor = i;
+    }
+
+    put_varint( size - anchor, dst );
+    dst.insert( dst.end(), src + anchor, src + size );
+    put_varint( 0, dst );
+}
+
+// ---------------------------------------------------------
+///
+/// Replay literal runs and back references, checking every length and offset against the buffer bounds
+///
+// ---------------------------------------------------------
+
+bool block_decompress( const unsigned char* src, size_t size, unsigned char* dst, size_t dst_size )
+{
+    const unsigned char* p = src;
+    const unsigned char* end = src + size;
+    size_t out = 0;
+
+    for ( ;; )
+    {
+        size_t literals;
+        if ( !get_varint( p, end, literals ) ) { return false; }
+        if ( literals > (size_t)( end - p ) || literals > dst_size - out ) { return false; }
+
+        std::memcpy( dst + out, p, literals );
+        p += literals;
+        out += literals;
+
+        size_t offset;
+        if ( !get_varint( p, end, offset ) ) { return false; }
+        if ( offset == 0 )
+        {
+            return out == dst_size && p == end;
+        }
+
+        size_t length;
+        if ( !get_varint( p, end, length ) ) { return false; }
+        if ( offset > out || dst_size - out < MIN_MATCH || length > dst_size - out - MIN_MATCH ) { return false; }
+        length += MIN_MATCH;
+
+        // references may overlap the bytes being written, so copy forwards one byte at a time
+        const unsigned char* from = dst + out - offset;
+        for ( size_t k = 0; k < length; ++k )
+        {
+            dst[out + k] = from[k];
+        }
+        out += length;
+    }
+}
+
+}
@@ -0,0 +1,37 @@
+// ---------------------------------------------------------
+//
+//  blockcompress.h
+//
+//  A small, fast LZ77-style compressor for in-memory blocks of bytes.
+//
+// ---------------------------------------------------------
+
+#ifndef EL_TOPO_BLOCKCOMPRESS_H
+#define EL_TOPO_BLOCKCOMPRESS_H
+
+// ---------------------------------------------------------
+// Nested includes
+// ---------------------------------------------------------
+
+#include <cstddef>
+#include <vector>
+
+// ---------------------------------------------------------
+//  Interface declarations
+// ---------------------------------------------------------
+
+namespace ElTopo {
+
+/// Compress size bytes starting at src, appending the result to dst.  Speed is favoured over compression ratio: there
+/// is no entropy coding, only back references to repeated runs of at least four bytes within the block.
+///
+void block_compress( const unsigned char* src, size_t size, std::vector<unsigned char>& dst );
+
+/// Decompress a block produced by block_compress into exactly dst_size bytes at dst.  Returns false if the block is
+/// malformed or does not decompress to dst_size bytes.
+///
+bool block_decompress( const unsigned char* src, size_t size, unsigned char* dst, size_t dst_size );
+
+}
+
+#endif
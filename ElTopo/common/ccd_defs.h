@@ -10,5 +10,11 @@ namespace ElTopo {
 //#define USE_CUBIC_SOLVER_CCD
 #define USE_ROOT_PARITY_CCD
 
+//
+// Run conservative floating-point filters ahead of the exact root parity test, so that only the
+// candidates they cannot rule out pay for the exact test.
+//
+#define USE_CCD_PREFILTER
+
 }
 #endif
@@ -12,6 +12,8 @@
 #ifndef CCD_WRAPPER_H
 #define CCD_WRAPPER_H
 
+#include <ccd_defs.h>
+#include <string>
 #include <vec.h>
 
 namespace ElTopo {
@@ -85,6 +87,41 @@ bool segment_segment_collision(const Vec3d& x0, const Vec3d& xnew0, size_t index
                                double& relative_normal_displacement );
 
 
+#ifdef USE_CCD_PREFILTER
+
+// Number of 3D continuous collision queries settled by each stage: the swept bounding box test, the
+// coplanarity test, and the exact test for whatever the filters could not rule out.
+struct CCDFilterCounts
+{
+    long rejected_by_bounds;
+    long rejected_by_coplanarity;
+    long exact_tests;
+    // queries rejected by a filter although the exact test finds a collision (verification only)
+    long mismatches;
+};
+
+void get_ccd_filter_counts( CCDFilterCounts& counts );
+void reset_ccd_filter_counts();
+
+// If set, every query rejected by a filter is checked against the exact test, and disagreements are
+// reported and counted as mismatches.  Slow, for debugging.
+extern bool g_verify_ccd_prefilter;
+
+// The floating-point filters on their own, with the argument order of the collision queries: true if they show
+// that there is no collision.  Neither counts nor verifies.
+bool ccd_prefilter_rejects( const Vec3d& x0, const Vec3d& xnew0,
+                            const Vec3d& x1, const Vec3d& xnew1,
+                            const Vec3d& x2, const Vec3d& xnew2,
+                            const Vec3d& x3, const Vec3d& xnew3,
+                            bool is_edge_edge );
+
+// Append every 3D continuous collision query to the given file, for checking the prefilter offline with
+// ccdprefiltertest.  Each record is is_edge_edge as one byte, then x0-x3 and xnew0-xnew3 as doubles.  An empty
+// filename stops dumping.  Returns false if the file could not be opened.
+bool set_ccd_candidate_dump_file( const std::string& filename );
+
+#endif
+
 // --------------------------------------------------------------------------------------------------
 // 3D static intersection detection
 // --------------------------------------------------------------------------------------------------
@@ -14,8 +14,13 @@
 
 #ifdef USE_ROOT_PARITY_CCD
 
+#include <algorithm>
 #include <ccd_wrapper.h>
+#include <cfloat>
+#include <cmath>
 #include <collisionqueries.h>
+#include <fstream>
+#include <iostream>
 //#include <rootparity2d.h>
 #include <rootparitycollisiontest.h>
 #include <tunicate.h>
@@ -189,8 +194,238 @@ namespace
         assert( mag(normal) > 0.0 );        
     }
     
+#ifdef USE_CCD_PREFILTER
+    
+    /// Relative error bound for the Bernstein coefficients computed in never_coplanar(), with respect to
+    /// the sum of the magnitudes of their terms.  Each coefficient is a sum of at most three orient3d-style
+    /// determinants of rounded differences, which are within about 10 ulps of the exact value.
+    ///
+    const double g_coplanarity_error_factor = 8.0 * DBL_EPSILON;
+    
+    /// Coefficients this close to zero, relative to the same sum, are left to the exact test even though their sign
+    /// is certain.  The root parity test reports a collision whenever its ray casts keep grazing the mapped domain
+    /// boundary, which happens when the vertices are coplanar at t=0 or t=1 up to the last few bits, and the
+    /// prefilter must not change those answers.  ccdprefiltertest found such reports up to about 1e-12.
+    ///
+    const double g_coplanarity_degeneracy_margin = 1.0e-10;
+    
+    long g_rejected_by_bounds = 0;
+    long g_rejected_by_coplanarity = 0;
+    long g_exact_tests = 0;
+    long g_mismatches = 0;
+    
+    inline void increment_counter( long& counter )
+    {
+        // queries come in concurrently from the collision pipeline
+#pragma omp atomic
+        ++counter;
+    }
+    
+    ///
+    /// The vertices move linearly, so the points of a primitive stay within the convex hull of its vertices'
+    /// start and end positions.  Returns true if, on some axis, the hull of vertices [0,split) does not
+    /// overlap the hull of vertices [split,4).  Only compares input coordinates, so there is no rounding.
+    ///
+    bool swept_bounds_separated( const Vec3d* const x[4], const Vec3d* const xnew[4], unsigned int split )
+    {
+        for ( unsigned int a = 0; a < 3; ++a )
+        {
+            double lo[2] = {  DBL_MAX,  DBL_MAX };
+            double hi[2] = { -DBL_MAX, -DBL_MAX };
+            for ( unsigned int i = 0; i < 4; ++i )
+            {
+                unsigned int side = ( i < split ) ? 0 : 1;
+                lo[side] = std::min( lo[side], std::min( (*x[i])[a], (*xnew[i])[a] ) );
+                hi[side] = std::max( hi[side], std::max( (*x[i])[a], (*xnew[i])[a] ) );
+            }
+            if ( hi[0] < lo[1] || hi[1] < lo[0] ) { return true; }
+        }
+        return false;
+    }
+    
+    ///
+    /// Determinant of the 3x3 matrix with rows a, b, c.  Adds the magnitudes of its terms to permanent.
+    ///
+    inline double det3( const Vec3d& a, const Vec3d& b, const Vec3d& c, double& permanent )
+    {
+        double b1c2 = b[1]*c[2], b2c1 = b[2]*c[1];
+        double b2c0 = b[2]*c[0], b0c2 = b[0]*c[2];
+        double b0c1 = b[0]*c[1], b1c0 = b[1]*c[0];
+        
+        permanent += std::fabs(a[0]) * ( std::fabs(b1c2) + std::fabs(b2c1) )
+                   + std::fabs(a[1]) * ( std::fabs(b2c0) + std::fabs(b0c2) )
+                   + std::fabs(a[2]) * ( std::fabs(b0c1) + std::fabs(b1c0) );
+        
+        return a[0] * ( b1c2 - b2c1 ) + a[1] * ( b2c0 - b0c2 ) + a[2] * ( b0c1 - b1c0 );
+    }
+    
+    ///
+    /// Both kinds of collision need the four vertices to be coplanar at some time in [0,1].  Their signed
+    /// volume is a cubic in t; returns true if all four of its Bernstein coefficients (scaled by the binomial
+    /// coefficients, which does not change their signs) are safely of one sign, so the cubic has no root.
+    ///
+    bool never_coplanar( const Vec3d* const x[4], const Vec3d* const xnew[4] )
+    {
+        const Vec3d a[2] = { *x[1] - *x[0], *xnew[1] - *xnew[0] };
+        const Vec3d b[2] = { *x[2] - *x[0], *xnew[2] - *xnew[0] };
+        const Vec3d c[2] = { *x[3] - *x[0], *xnew[3] - *xnew[0] };
+        
+        double permanent[4] = { 0.0, 0.0, 0.0, 0.0 };
+        double coefficient[4];
+        coefficient[0] = det3( a[0], b[0], c[0], permanent[0] );
+        coefficient[1] = det3( a[1], b[0], c[0], permanent[1] ) + det3( a[0], b[1], c[0], permanent[1] ) + det3( a[0], b[0], c[1], permanent[1] );
+        coefficient[2] = det3( a[0], b[1], c[1], permanent[2] ) + det3( a[1], b[0], c[1], permanent[2] ) + det3( a[1], b[1], c[0], permanent[2] );
+        coefficient[3] = det3( a[1], b[1], c[1], permanent[3] );
+        
+        // written so that NaNs and infinities are never rejected
+        bool all_positive = true, all_negative = true;
+        for ( unsigned int k = 0; k < 4; ++k )
+        {
+            double error_bound = ( g_coplanarity_error_factor + g_coplanarity_degeneracy_margin ) * permanent[k] + DBL_MIN;
+            all_positive = all_positive && coefficient[k] > error_bound;
+            all_negative = all_negative && coefficient[k] < -error_bound;
+        }
+        return all_positive || all_negative;
+    }
+    
+    /// Which filter, if any, showed that a query has no collision
+    enum PrefilterStage
+    {
+        REJECTED_BY_BOUNDS,
+        REJECTED_BY_COPLANARITY,
+        NOT_REJECTED
+    };
+    
+    PrefilterStage run_prefilter( const Vec3d &x0, const Vec3d &x1, const Vec3d &x2, const Vec3d &x3,
+                                  const Vec3d &xnew0, const Vec3d &xnew1, const Vec3d &xnew2, const Vec3d &xnew3,
+                                  bool is_edge_edge )
+    {
+        const Vec3d* const x[4] = { &x0, &x1, &x2, &x3 };
+        const Vec3d* const xnew[4] = { &xnew0, &xnew1, &xnew2, &xnew3 };
+        
+        if ( swept_bounds_separated( x, xnew, is_edge_edge ? 2 : 1 ) ) { return REJECTED_BY_BOUNDS; }
+        if ( never_coplanar( x, xnew ) ) { return REJECTED_BY_COPLANARITY; }
+        return NOT_REJECTED;
+    }
+    
+    std::ofstream g_candidate_dump;
+    
+    ///
+    /// Appends a query to the candidate dump: is_edge_edge as one byte, then the eight positions as doubles.
+    ///
+    void dump_candidate( const Vec3d &x0, const Vec3d &x1, const Vec3d &x2, const Vec3d &x3,
+                         const Vec3d &xnew0, const Vec3d &xnew1, const Vec3d &xnew2, const Vec3d &xnew3,
+                         bool is_edge_edge )
+    {
+        const Vec3d* const positions[8] = { &x0, &x1, &x2, &x3, &xnew0, &xnew1, &xnew2, &xnew3 };
+        char edge_edge = is_edge_edge ? 1 : 0;
+        
+#pragma omp critical (ccd_candidate_dump)
+        {
+            g_candidate_dump.write( &edge_edge, 1 );
+            for ( unsigned int i = 0; i < 8; ++i )
+            {
+                g_candidate_dump.write( reinterpret_cast<const char*>( positions[i]->v ), 3 * sizeof(double) );
+            }
+        }
+    }
+    
+    ///
+    /// Returns true if the floating-point filters show that there is no collision between point x0 and
+    /// triangle x1-x2-x3, or between edges x0-x1 and x2-x3.  Counts which stage settled the query.
+    ///
+    bool prefilter_rejects( const Vec3d &x0, const Vec3d &x1, const Vec3d &x2, const Vec3d &x3,
+                            const Vec3d &xnew0, const Vec3d &xnew1, const Vec3d &xnew2, const Vec3d &xnew3,
+                            bool is_edge_edge )
+    {
+        if ( g_candidate_dump.is_open() )
+        {
+            dump_candidate( x0, x1, x2, x3, xnew0, xnew1, xnew2, xnew3, is_edge_edge );
+        }
+        
+        bool rejected = true;
+        switch ( run_prefilter( x0, x1, x2, x3, xnew0, xnew1, xnew2, xnew3, is_edge_edge ) )
+        {
+            case REJECTED_BY_BOUNDS:
+                increment_counter( g_rejected_by_bounds );
+                break;
+            case REJECTED_BY_COPLANARITY:
+                increment_counter( g_rejected_by_coplanarity );
+                break;
+            default:
+                increment_counter( g_exact_tests );
+                rejected = false;
+        }
+        
+        if ( rejected && g_verify_ccd_prefilter )
+        {
+            rootparity::RootParityCollisionTest test( x0, x1, x2, x3, xnew0, xnew1, xnew2, xnew3, is_edge_edge );
+            if ( test.run_test() )
+            {
+                std::cerr << "CCD prefilter rejected a colliding " << ( is_edge_edge ? "edge-edge" : "point-triangle" ) 
+                          << " candidate: " << x0 << ", " << x1 << ", " << x2 << ", " << x3 << " -> "
+                          << xnew0 << ", " << xnew1 << ", " << xnew2 << ", " << xnew3 << std::endl;
+                increment_counter( g_mismatches );
+                return false;
+            }
+        }
+        
+        return rejected;
+    }
+    
+#endif
+    
+}
+
+
+#ifdef USE_CCD_PREFILTER
+
+bool g_verify_ccd_prefilter = false;
+
+void get_ccd_filter_counts( CCDFilterCounts& counts )
+{
+    counts.rejected_by_bounds = g_rejected_by_bounds;
+    counts.rejected_by_coplanarity = g_rejected_by_coplanarity;
+    counts.exact_tests = g_exact_tests;
+    counts.mismatches = g_mismatches;
+}
+
+void reset_ccd_filter_counts()
+{
+    g_rejected_by_bounds = 0;
+    g_rejected_by_coplanarity = 0;
+    g_exact_tests = 0;
+    g_mismatches = 0;
+}
+
+bool ccd_prefilter_rejects( const Vec3d& x0, const Vec3d& xnew0,
+                            const Vec3d& x1, const Vec3d& xnew1,
+                            const Vec3d& x2, const Vec3d& xnew2,
+                            const Vec3d& x3, const Vec3d& xnew3,
+                            bool is_edge_edge )
+{
+    return run_prefilter( x0, x1, x2, x3, xnew0, xnew1, xnew2, xnew3, is_edge_edge ) != NOT_REJECTED;
 }
 
+bool set_ccd_candidate_dump_file( const std::string& filename )
+{
+    if ( g_candidate_dump.is_open() )
+    {
+        g_candidate_dump.close();
+    }
+    
+    if ( filename.empty() )
+    {
+        return true;
+    }
+    
+    g_candidate_dump.clear();
+    g_candidate_dump.open( filename.c_str(), std::ios::out | std::ios::binary );
+    return g_candidate_dump.is_open();
+}
+
+#endif
+
 
 //// --------------------------------------------------------------------------------------------------
 //// 2D Continuous collision detection
@@ -260,6 +495,13 @@ bool point_triangle_collision(const Vec3d& x0, const Vec3d& xnew0, size_t /*inde
                               const Vec3d& x2, const Vec3d& xnew2, size_t /*index2*/,
                               const Vec3d& x3, const Vec3d& xnew3, size_t /*index3*/ )
 {   
+#ifdef USE_CCD_PREFILTER
+    if ( prefilter_rejects( x0, x1, x2, x3, xnew0, xnew1, xnew2, xnew3, false ) )
+    {
+        return false;
+    }
+#endif
+    
     rootparity::RootParityCollisionTest test( x0, x1, x2, x3, xnew0, xnew1, xnew2, xnew3, false );
     bool rayhex_result = test.run_test();
     return rayhex_result;
@@ -275,6 +517,13 @@ bool point_triangle_collision(const Vec3d& x0, const Vec3d& xnew0, size_t /*inde
                               double& relative_normal_displacement )
 {
     
+#ifdef USE_CCD_PREFILTER
+    if ( prefilter_rejects( x0, x1, x2, x3, xnew0, xnew1, xnew2, xnew3, false ) )
+    {
+        return false;
+    }
+#endif
+    
     rootparity::RootParityCollisionTest test( x0, x1, x2, x3, xnew0, xnew1, xnew2, xnew3, false );
     bool rayhex_result = test.run_test();
     
@@ -300,6 +549,13 @@ bool segment_segment_collision(const Vec3d& x0, const Vec3d& xnew0, size_t /*ind
                                const Vec3d& x3, const Vec3d& xnew3, size_t /*index3*/)
 {
     
+#ifdef USE_CCD_PREFILTER
+    if ( prefilter_rejects( x0, x1, x2, x3, xnew0, xnew1, xnew2, xnew3, true ) )
+    {
+        return false;
+    }
+#endif
+    
     rootparity::RootParityCollisionTest test( x0, x1, x2, x3, xnew0, xnew1, xnew2, xnew3, true );
     bool rayhex_result = test.run_test();
     return rayhex_result;
@@ -314,6 +570,13 @@ bool segment_segment_collision(const Vec3d& x0, const Vec3d& xnew0, size_t /*ind
                                Vec3d& normal,
                                double& relative_normal_displacement )
 {
+#ifdef USE_CCD_PREFILTER
+    if ( prefilter_rejects( x0, x1, x2, x3, xnew0, xnew1, xnew2, xnew3, true ) )
+    {
+        return false;
+    }
+#endif
+    
     rootparity::RootParityCollisionTest test( x0, x1, x2, x3, xnew0, xnew1, xnew2, xnew3, true );
     bool rayhex_result = test.edge_edge_collision();
     
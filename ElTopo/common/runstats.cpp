@@ -10,6 +10,7 @@
 
 #include <commonoptions.h>
 #include <fstream>
+#include <ostream>
 
 namespace ElTopo {
 
@@ -19,19 +20,15 @@ ElTopo::RunStats g_stats;
 
 void RunStats::set_int( std::string name, int64_t value )
 {
+#pragma omp critical(RunStats)
     int_stats[name] = value;
 }
 
 void RunStats::add_to_int( std::string name, int64_t increment )
 {
-    int64_t value = 0;
-    bool exists = get_int( name, value );
-    if ( !exists )
-    {
-        value = 0;
-    }
-    value += increment;
-    set_int( name, value );
+    // a missing stat starts at zero
+#pragma omp critical(RunStats)
+    int_stats[name] += increment;
 }
 
 int64_t RunStats::get_int( std::string name )
@@ -72,19 +69,15 @@ void RunStats::update_max_int( std::string name, int64_t value )
 
 void RunStats::set_double( std::string name, double value )
 {
+#pragma omp critical(RunStats)
     double_stats[name] = value;
 }
 
 void RunStats::add_to_double( std::string name, double increment )
 {
-    double value = 0;
-    bool exists = get_double( name, value );
-    if ( !exists )
-    {
-        value = 0;
-    }
-    value += increment;
-    set_double( name, value );
+    // a missing stat starts at zero
+#pragma omp critical(RunStats)
+    double_stats[name] += increment;
 }
 
 double RunStats::get_double( std::string name )
@@ -164,7 +157,13 @@ bool RunStats::get_per_frame_doubles( std::string name, std::vector<PerFrameDoub
 void RunStats::write_to_file( const char* filename )
 {
     std::ofstream file( filename );
-    
+    write_to_stream( file );
+}
+
+// ------------------------------------------------------------------
+
+void RunStats::write_to_stream( std::ostream& file )
+{
     // ----------
     if ( !int_stats.empty() )
     {
@@ -11,6 +11,7 @@
 #ifndef RUNSTATS_H
 #define RUNSTATS_H
 
+#include <iosfwd>
 #include <map>
 #include <string>
 #include <stdint.h>
@@ -34,6 +35,8 @@ public:
     typedef std::pair<int, int64_t> PerFrameInt;
     typedef std::pair<int, double> PerFrameDouble;
     
+    // set_* and add_to_* may be called from parallel regions; the other functions may not
+    
     void set_int( std::string name, int64_t value );
     void add_to_int( std::string name, int64_t increment );
     int64_t get_int( std::string name );
@@ -55,6 +58,7 @@ public:
     bool get_per_frame_doubles( std::string name, std::vector<PerFrameDouble>& sequence );
     
     void write_to_file( const char* filename );
+    void write_to_stream( std::ostream& os );
     
     void clear();
     
@@ -9,6 +9,6 @@
 
 #include <interval.h>
 
-int Interval::s_previous_rounding_mode = ~0;
+TUNICATE_THREAD_LOCAL int Interval::s_previous_rounding_mode = ~0;
 
 
@@ -17,6 +17,13 @@
 class Interval;
 typedef Interval IntervalType;
 
+// The rounding mode is per thread, so the saved mode must be too
+#ifdef _MSC_VER
+#define TUNICATE_THREAD_LOCAL __declspec(thread)
+#else
+#define TUNICATE_THREAD_LOCAL __thread
+#endif
+
 #ifndef DEBUG
 #define VERIFY() (void)0;
 #else
@@ -51,7 +58,7 @@ public:
     // Internal representation
     double v[2];
     
-    static int s_previous_rounding_mode;
+    static TUNICATE_THREAD_LOCAL int s_previous_rounding_mode;
     
 public:
     
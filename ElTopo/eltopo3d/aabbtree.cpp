@@ -0,0 +1,579 @@
+// ---------------------------------------------------------
+//
+//  aabbtree.cpp
+//
+//  A refittable bounding volume hierarchy for collision test culling.
+//
+// ---------------------------------------------------------
+
+// ---------------------------------------------------------
+// Includes
+// ---------------------------------------------------------
+
+#include <aabbtree.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+
+// ---------------------------------------------------------
+// Local constants, typedefs, macros
+// ---------------------------------------------------------
+
+namespace ElTopo {
+
+namespace {
+
+/// Marks missing children, parents and leaves
+///
+const size_t NO_NODE = ~(size_t)0;
+
+/// Leaves built from a sorted range hold at most this many elements
+///
+const size_t MAX_LEAF_SIZE = 4;
+
+/// Rebuild when refitting has made the tree this much more costly than when it was built
+///
+const double REBUILD_COST_RATIO = 1.5;
+
+/// Rebuild after this many single insertions, or half as many as the elements in the last build if that is more
+///
+const size_t MIN_INSERTIONS_BEFORE_REBUILD = 256;
+
+/// Below this number of nodes, refitting is not worth starting threads for
+///
+const int MIN_PARALLEL_NODES = 4096;
+
+// ---------------------------------------------------------
+// Static function definitions
+// ---------------------------------------------------------
+
+inline bool aabbs_overlap( const Vec3d& xmin, const Vec3d& xmax, const Vec3d& oxmin, const Vec3d& oxmax )
+{
+    return ( xmin[0] <= oxmax[0] && xmin[1] <= oxmax[1] && xmin[2] <= oxmax[2] ) &&
+           ( xmax[0] >= oxmin[0] && xmax[1] >= oxmin[1] && xmax[2] >= oxmin[2] );
+}
+
+inline double surface_area( const Vec3d& xmin, const Vec3d& xmax )
+{
+    Vec3d d = xmax - xmin;
+    if ( d[0] < 0.0 || d[1] < 0.0 || d[2] < 0.0 ) { return 0.0; }
+    return 2.0 * ( d[0]*d[1] + d[1]*d[2] + d[2]*d[0] );
+}
+
+/// Orders elements by the centre of their AABB along one axis
+///
+struct CentreLess
+{
+    CentreLess( const std::vector<Vec3d>& xmins, const std::vector<Vec3d>& xmaxs, unsigned int axis ) :
+    m_xmins( xmins ), m_xmaxs( xmaxs ), m_axis( axis )
+    {}
+
+    bool operator()( size_t a, size_t b ) const
+    {
+        return m_xmins[a][m_axis] + m_xmaxs[a][m_axis] < m_xmins[b][m_axis] + m_xmaxs[b][m_axis];
+    }
+
+    const std::vector<Vec3d>& m_xmins;
+    const std::vector<Vec3d>& m_xmaxs;
+    unsigned int m_axis;
+};
+
+}
+
+// ---------------------------------------------------------
+// Member function definitions
+// ---------------------------------------------------------
+
+// --------------------------------------------------------
+///
+/// Default constructor: empty tree
+///
+// --------------------------------------------------------
+
+AABBTree::AABBTree() :
+m_elementxmins(0),
+m_elementxmaxs(0),
+m_nodes(0),
+m_leaf_elements(0),
+m_elementleaves(0),
+m_elementcount(0),
+m_built_cost(0.0),
+m_built_elementcount(0),
+m_insertions(0)
+{}
+
+// --------------------------------------------------------
+///
+/// Replace the tree contents with the given elements
+///
+// --------------------------------------------------------
+
+void AABBTree::build( const std::vector<size_t>& indices, const std::vector<Vec3d>& xmins, const std::vector<Vec3d>& xmaxs )
+{
+    assert( xmins.size() == indices.size() );
+    assert( xmaxs.size() == indices.size() );
+
+    clear();
+
+    if ( indices.empty() )
+    {
+        return;
+    }
+
+    size_t num_slots = *std::max_element( indices.begin(), indices.end() ) + 1;
+    m_elementxmins.resize( num_slots );
+    m_elementxmaxs.resize( num_slots );
+    m_elementleaves.resize( num_slots, NO_NODE );
+
+    for ( size_t i = 0; i < indices.size(); ++i )
+    {
+        // don't add inside-out AABBs
+        if ( xmins[i][0] > xmaxs[i][0] )  { continue; }
+
+        size_t idx = indices[i];
+        m_elementxmins[idx] = xmins[i];
+        m_elementxmaxs[idx] = xmaxs[i];
+
+        // any leaf will do until rebuild() assigns the real one
+        m_elementleaves[idx] = 0;
+        ++m_elementcount;
+    }
+
+    rebuild();
+}
+
+// --------------------------------------------------------
+///
+/// Set new AABBs, and refit or rebuild the tree
+///
+// --------------------------------------------------------
+
+void AABBTree::update( const std::vector<size_t>& indices, const std::vector<Vec3d>& xmins, const std::vector<Vec3d>& xmaxs )
+{
+    assert( xmins.size() == indices.size() );
+    assert( xmaxs.size() == indices.size() );
+
+    // indices are distinct, so the same count and all stored means the same set
+    bool same_elements = ( indices.size() == m_elementcount );
+    for ( size_t i = 0; same_elements && i < indices.size(); ++i )
+    {
+        same_elements = ( indices[i] < m_elementleaves.size() && m_elementleaves[indices[i]] != NO_NODE && xmins[i][0] <= xmaxs[i][0] );
+    }
+
+    if ( !same_elements )
+    {
+        build( indices, xmins, xmaxs );
+        return;
+    }
+
+    for ( size_t i = 0; i < indices.size(); ++i )
+    {
+        m_elementxmins[indices[i]] = xmins[i];
+        m_elementxmaxs[indices[i]] = xmaxs[i];
+    }
+
+    refit_all();
+
+    if ( tree_cost() > REBUILD_COST_RATIO * m_built_cost )
+    {
+        rebuild();
+    }
+}
+
+// --------------------------------------------------------
+///
+/// Add an object with the specified index and AABB to the tree
+///
+// --------------------------------------------------------
+
+void AABBTree::add_element( size_t idx, const Vec3d& xmin, const Vec3d& xmax )
+{
+    if ( idx >= m_elementleaves.size() )
+    {
+        m_elementxmins.resize( idx+1 );
+        m_elementxmaxs.resize( idx+1 );
+        m_elementleaves.resize( idx+1, NO_NODE );
+    }
+
+    remove_element( idx );
+
+    m_elementxmins[idx] = xmin;
+    m_elementxmaxs[idx] = xmax;
+    ++m_elementcount;
+    ++m_insertions;
+
+    if ( m_insertions > std::max( MIN_INSERTIONS_BEFORE_REBUILD, m_built_elementcount / 2 ) )
+    {
+        m_elementleaves[idx] = 0;
+        rebuild();
+        return;
+    }
+
+    insert_into_tree( idx );
+}
+
+// --------------------------------------------------------
+///
+/// Remove an object with the specified index from the tree.  Its leaf entry is left in place, and ignored from now on.
+///
+// --------------------------------------------------------
+
+void AABBTree::remove_element( size_t idx )
+{
+    if ( idx >= m_elementleaves.size() || m_elementleaves[idx] == NO_NODE ) { return; }
+
+    size_t leaf = m_elementleaves[idx];
+    m_elementleaves[idx] = NO_NODE;
+    --m_elementcount;
+
+    refit_path( leaf );
+}
+
+// --------------------------------------------------------
+///
+/// Reset the specified object's AABB.  The element stays in its leaf, whose ancestors are refit.
+///
+// --------------------------------------------------------
+
+void AABBTree::update_element( size_t idx, const Vec3d& xmin, const Vec3d& xmax )
+{
+    if ( idx >= m_elementleaves.size() || m_elementleaves[idx] == NO_NODE )
+    {
+        add_element( idx, xmin, xmax );
+        return;
+    }
+
+    m_elementxmins[idx] = xmin;
+    m_elementxmaxs[idx] = xmax;
+
+    refit_path( m_elementleaves[idx] );
+}
+
+// --------------------------------------------------------
+///
+/// Remove all elements from the tree
+///
+// --------------------------------------------------------
+
+void AABBTree::clear()
+{
+    m_nodes.clear();
+    m_leaf_elements.clear();
+    m_elementleaves.clear();
+    m_elementxmins.clear();
+    m_elementxmaxs.clear();
+    m_elementcount = 0;
+    m_built_cost = 0.0;
+    m_built_elementcount = 0;
+    m_insertions = 0;
+}
+
+// --------------------------------------------------------
+///
+/// Return the set of elements which have AABBs overlapping the query AABB.
+///
+// --------------------------------------------------------
+
+void AABBTree::find_overlapping_elements( const Vec3d& xmin, const Vec3d& xmax, std::vector<size_t>& results ) const
+{
+    if ( m_nodes.empty() )
+    {
+        return;
+    }
+
+    std::vector<size_t> stack;
+    stack.reserve( 64 );
+    stack.push_back( 0 );
+
+    while ( !stack.empty() )
+    {
+        const Node& node = m_nodes[ stack.back() ];
+        size_t node_index = stack.back();
+        stack.pop_back();
+
+        if ( !aabbs_overlap( xmin, xmax, node.m_xmin, node.m_xmax ) ) { continue; }
+
+        if ( node.m_children[0] == NO_NODE )
+        {
+            for ( size_t e = node.m_first; e < node.m_first + node.m_count; ++e )
+            {
+                size_t idx = m_leaf_elements[e];
+                if ( m_elementleaves[idx] == node_index &&
+                    aabbs_overlap( xmin, xmax, m_elementxmins[idx], m_elementxmaxs[idx] ) )
+                {
+                    results.push_back( idx );
+                }
+            }
+        }
+        else
+        {
+            stack.push_back( node.m_children[1] );
+            stack.push_back( node.m_children[0] );
+        }
+    }
+}
+
+// --------------------------------------------------------
+///
+/// Build the tree over all stored elements, by recursively splitting them at the median along the axis where their
+/// centres spread the most.
+///
+// --------------------------------------------------------
+
+void AABBTree::rebuild()
+{
+    m_nodes.clear();
+    m_leaf_elements.clear();
+    m_leaf_elements.reserve( m_elementcount );
+
+    for ( size_t idx = 0; idx < m_elementleaves.size(); ++idx )
+    {
+        if ( m_elementleaves[idx] != NO_NODE )
+        {
+            m_leaf_elements.push_back( idx );
+        }
+    }
+
+    if ( !m_leaf_elements.empty() )
+    {
+        m_nodes.reserve( 2 * ( m_leaf_elements.size() / MAX_LEAF_SIZE + 1 ) );
+        build_subtree( NO_NODE, 0, m_leaf_elements.size() );
+    }
+
+    m_built_cost = tree_cost();
+    m_built_elementcount = m_elementcount;
+    m_insertions = 0;
+}
+
+// --------------------------------------------------------
+///
+/// Build the subtree over a range of m_leaf_elements
+///
+// --------------------------------------------------------
+
+size_t AABBTree::build_subtree( size_t parent, size_t first, size_t count )
+{
+    size_t node = m_nodes.size();
+    m_nodes.push_back( Node() );
+    m_nodes[node].m_parent = parent;
+    m_nodes[node].m_children[0] = NO_NODE;
+    m_nodes[node].m_children[1] = NO_NODE;
+    m_nodes[node].m_first = first;
+    m_nodes[node].m_count = 0;
+
+    if ( count <= MAX_LEAF_SIZE )
+    {
+        m_nodes[node].m_count = count;
+        for ( size_t e = first; e < first + count; ++e )
+        {
+            m_elementleaves[ m_leaf_elements[e] ] = node;
+        }
+        refit_node( node );
+        return node;
+    }
+
+    Vec3d centre_min( DBL_MAX, DBL_MAX, DBL_MAX ), centre_max( -DBL_MAX, -DBL_MAX, -DBL_MAX );
+    for ( size_t e = first; e < first + count; ++e )
+    {
+        size_t idx = m_leaf_elements[e];
+        update_minmax( m_elementxmins[idx] + m_elementxmaxs[idx], centre_min, centre_max );
+    }
+
+    unsigned int axis = 0;
+    Vec3d spread = centre_max - centre_min;
+    if ( spread[1] > spread[axis] ) { axis = 1; }
+    if ( spread[2] > spread[axis] ) { axis = 2; }
+
+    size_t half = count / 2;
+    std::nth_element( m_leaf_elements.begin() + first,
+                     m_leaf_elements.begin() + first + half,
+                     m_leaf_elements.begin() + first + count,
+                     CentreLess( m_elementxmins, m_elementxmaxs, axis ) );
+
+    size_t left = build_subtree( node, first, half );
+    size_t right = build_subtree( node, first + half, count - half );
+
+    m_nodes[node].m_children[0] = left;
+    m_nodes[node].m_children[1] = right;
+    refit_node( node );
+
+    return node;
+}
+
+// --------------------------------------------------------
+///
+/// Insert a stored element into the tree: descend towards the child whose surface area grows the least, then split the
+/// leaf reached into the old leaf and a new leaf holding the element.
+///
+// --------------------------------------------------------
+
+void AABBTree::insert_into_tree( size_t idx )
+{
+    const Vec3d& xmin = m_elementxmins[idx];
+    const Vec3d& xmax = m_elementxmaxs[idx];
+
+    m_leaf_elements.push_back( idx );
+
+    Node new_leaf;
+    new_leaf.m_children[0] = NO_NODE;
+    new_leaf.m_children[1] = NO_NODE;
+    new_leaf.m_first = m_leaf_elements.size() - 1;
+    new_leaf.m_count = 1;
+
+    if ( m_nodes.empty() )
+    {
+        new_leaf.m_parent = NO_NODE;
+        m_nodes.push_back( new_leaf );
+        m_elementleaves[idx] = 0;
+        refit_node( 0 );
+        return;
+    }
+
+    size_t node = 0;
+    while ( m_nodes[node].m_children[0] != NO_NODE )
+    {
+        double best_growth = DBL_MAX;
+        size_t best_child = m_nodes[node].m_children[0];
+        for ( unsigned int c = 0; c < 2; ++c )
+        {
+            const Node& child = m_nodes[ m_nodes[node].m_children[c] ];
+            Vec3d union_min = min_union( child.m_xmin, xmin );
+            Vec3d union_max = max_union( child.m_xmax, xmax );
+            double growth = surface_area( union_min, union_max ) - surface_area( child.m_xmin, child.m_xmax );
+            if ( growth < best_growth )
+            {
+                best_growth = growth;
+                best_child = m_nodes[node].m_children[c];
+            }
+        }
+        node = best_child;
+    }
+
+    // the leaf becomes the parent of a copy of itself and of the new leaf
+
+    Node moved_leaf = m_nodes[node];
+    moved_leaf.m_parent = node;
+    size_t moved = m_nodes.size();
+    m_nodes.push_back( moved_leaf );
+
+    for ( size_t e = moved_leaf.m_first; e < moved_leaf.m_first + moved_leaf.m_count; ++e )
+    {
+        if ( m_elementleaves[ m_leaf_elements[e] ] == node )
+        {
+            m_elementleaves[ m_leaf_elements[e] ] = moved;
+        }
+    }
+
+    new_leaf.m_parent = node;
+    size_t added = m_nodes.size();
+    m_nodes.push_back( new_leaf );
+    m_elementleaves[idx] = added;
+    refit_node( added );
+
+    m_nodes[node].m_children[0] = moved;
+    m_nodes[node].m_children[1] = added;
+    m_nodes[node].m_count = 0;
+
+    refit_path( node );
+}
+
+// --------------------------------------------------------
+///
+/// Recompute the box of a node.  A leaf whose elements have all gone gets an empty, inside-out box.
+///
+// --------------------------------------------------------
+
+void AABBTree::refit_node( size_t node_index )
+{
+    Node& node = m_nodes[node_index];
+    node.m_xmin = Vec3d( DBL_MAX, DBL_MAX, DBL_MAX );
+    node.m_xmax = Vec3d( -DBL_MAX, -DBL_MAX, -DBL_MAX );
+
+    if ( node.m_children[0] == NO_NODE )
+    {
+        for ( size_t e = node.m_first; e < node.m_first + node.m_count; ++e )
+        {
+            size_t idx = m_leaf_elements[e];
+            if ( m_elementleaves[idx] == node_index )
+            {
+                node.m_xmin = min_union( node.m_xmin, m_elementxmins[idx] );
+                node.m_xmax = max_union( node.m_xmax, m_elementxmaxs[idx] );
+            }
+        }
+    }
+    else
+    {
+        for ( unsigned int c = 0; c < 2; ++c )
+        {
+            const Node& child = m_nodes[ node.m_children[c] ];
+            node.m_xmin = min_union( node.m_xmin, child.m_xmin );
+            node.m_xmax = max_union( node.m_xmax, child.m_xmax );
+        }
+    }
+}
+
+// --------------------------------------------------------
+///
+/// Refit a node and all of its ancestors
+///
+// --------------------------------------------------------
+
+void AABBTree::refit_path( size_t node )
+{
+    while ( node != NO_NODE )
+    {
+        refit_node( node );
+        node = m_nodes[node].m_parent;
+    }
+}
+
+// --------------------------------------------------------
+///
+/// Refit every node.  Leaves are independent and refit in parallel; since children come after their parents, a reverse
+/// sweep then refits each internal node after its children.
+///
+// --------------------------------------------------------
+
+void AABBTree::refit_all()
+{
+    int num_nodes = (int) m_nodes.size();
+
+#pragma omp parallel for schedule(static) if(num_nodes > MIN_PARALLEL_NODES)
+    for ( int n = 0; n < num_nodes; ++n )
+    {
+        if ( m_nodes[n].m_children[0] == NO_NODE )
+        {
+            refit_node( n );
+        }
+    }
+
+    for ( int n = num_nodes - 1; n >= 0; --n )
+    {
+        if ( m_nodes[n].m_children[0] != NO_NODE )
+        {
+            refit_node( n );
+        }
+    }
+}
+
+// --------------------------------------------------------
+///
+/// Sum of the surface areas of all internal nodes
+///
+// --------------------------------------------------------
+
+double AABBTree::tree_cost() const
+{
+    double cost = 0.0;
+    for ( size_t n = 0; n < m_nodes.size(); ++n )
+    {
+        if ( m_nodes[n].m_children[0] != NO_NODE )
+        {
+            cost += surface_area( m_nodes[n].m_xmin, m_nodes[n].m_xmax );
+        }
+    }
+    return cost;
+}
+
+}
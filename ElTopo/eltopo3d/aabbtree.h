@@ -0,0 +1,144 @@
+// ---------------------------------------------------------
+//
+//  aabbtree.h
+//
+//  A refittable bounding volume hierarchy for collision test culling.
+//
+// ---------------------------------------------------------
+
+#ifndef EL_TOPO_AABBTREE_H
+#define EL_TOPO_AABBTREE_H
+
+// ---------------------------------------------------------
+// Nested includes
+// ---------------------------------------------------------
+
+#include <vec.h>
+#include <vector>
+
+// ---------------------------------------------------------
+//  Class definitions
+// ---------------------------------------------------------
+
+namespace ElTopo {
+
+// --------------------------------------------------------
+///
+/// Binary tree of axis-aligned bounding boxes, with a few elements per leaf.  It adapts to the element sizes, so there is
+/// no cell size to pick.
+///
+/// Nodes are stored in one array, parents before children, and leaves refer to ranges of one element array.  When the
+/// elements move, the node boxes are refit without changing the tree, and the tree is rebuilt only once refitting has
+/// degraded it noticeably.  Single elements are inserted by splitting the leaf they fit best, and removed by
+/// forgetting their leaf.
+///
+// --------------------------------------------------------
+
+class AABBTree
+{
+
+public:
+
+    AABBTree();
+
+    /// Replace the tree contents with the given elements
+    ///
+    void build( const std::vector<size_t>& indices, const std::vector<Vec3d>& xmins, const std::vector<Vec3d>& xmaxs );
+
+    /// Set new AABBs for the given elements.  If they are the elements currently stored, refit the tree and rebuild it
+    /// only if its quality has degraded; otherwise build a new tree.
+    ///
+    void update( const std::vector<size_t>& indices, const std::vector<Vec3d>& xmins, const std::vector<Vec3d>& xmaxs );
+
+    /// Add an object with the specified index and AABB to the tree
+    ///
+    void add_element( size_t idx, const Vec3d& xmin, const Vec3d& xmax );
+
+    /// Remove an object with the specified index from the tree
+    ///
+    void remove_element( size_t idx );
+
+    /// Reset the specified object's AABB
+    ///
+    void update_element( size_t idx, const Vec3d& xmin, const Vec3d& xmax );
+
+    /// Remove all elements from the tree
+    ///
+    void clear();
+
+    /// Return the set of elements which have AABBs overlapping the query AABB.
+    ///
+    void find_overlapping_elements( const Vec3d& xmin, const Vec3d& xmax, std::vector<size_t>& results ) const;
+
+    /// Element AABBs
+    ///
+    std::vector<Vec3d> m_elementxmins, m_elementxmaxs;
+
+private:
+
+    struct Node
+    {
+        Vec3d m_xmin, m_xmax;
+        size_t m_parent;
+        /// Both NO_NODE for leaves
+        size_t m_children[2];
+        /// Leaf elements: m_leaf_elements[m_first] to m_leaf_elements[m_first+m_count-1]
+        size_t m_first, m_count;
+    };
+
+    /// Build the tree over all stored elements
+    ///
+    void rebuild();
+
+    /// Build the subtree over m_leaf_elements[first] to m_leaf_elements[first+count-1], returning its root
+    ///
+    size_t build_subtree( size_t parent, size_t first, size_t count );
+
+    /// Insert a stored element into the tree
+    ///
+    void insert_into_tree( size_t idx );
+
+    /// Recompute the box of a node from its elements or children
+    ///
+    void refit_node( size_t node );
+
+    /// Refit a node and all of its ancestors
+    ///
+    void refit_path( size_t node );
+
+    /// Refit every node
+    ///
+    void refit_all();
+
+    /// Sum of the surface areas of all internal nodes, which is proportional to the expected cost of a query
+    ///
+    double tree_cost() const;
+
+    /// Tree nodes, root first
+    ///
+    std::vector<Node> m_nodes;
+
+    /// Elements referred to by the leaves.  May also hold stale entries of elements which have since been removed or moved
+    /// to other leaves.
+    ///
+    std::vector<size_t> m_leaf_elements;
+
+    /// Leaf holding each element (NO_NODE if the element is not stored)
+    ///
+    std::vector<size_t> m_elementleaves;
+
+    /// Number of elements being stored.
+    ///
+    size_t m_elementcount;
+
+    /// Tree cost and element count right after the last rebuild, and the number of insertions since
+    ///
+    double m_built_cost;
+    size_t m_built_elementcount;
+    size_t m_insertions;
+
+};
+
+}
+
+#endif
@@ -13,6 +13,7 @@
 
 #include <accelerationgrid.h>
 
+#include <algorithm>
 #include <array3.h>
 #include <limits>
 #include <util.h>
@@ -20,6 +21,10 @@
 #include <vector>
 #include <wallclocktime.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 // ---------------------------------------------------------
 // Global externs
 // ---------------------------------------------------------
@@ -478,6 +483,16 @@ void AccelerationGrid::clear()
 
 void AccelerationGrid::find_overlapping_elements( const Vec3d& xmin, const Vec3d& xmax, std::vector<size_t>& results ) 
 {
+#ifdef _OPENMP
+    if ( omp_in_parallel() )
+    {
+        Vec3i xmini, xmaxi;
+        boundstoindices(xmin, xmax, xmini, xmaxi);
+        find_overlapping_elements_unmarked( xmini, xmaxi, xmin, xmax, results );
+        return;
+    }
+#endif
+    
     if(m_lastquery == std::numeric_limits<unsigned int>::max())
     {
         std::vector<unsigned int>::iterator iter = m_elementquery.begin();
@@ -535,5 +550,48 @@ void AccelerationGrid::find_overlapping_elements( const Vec3d& xmin, const Vec3d
     }
 }
 
+// --------------------------------------------------------
+///
+/// Return the set of elements which have AABBs overlapping the query AABB, without modifying the grid.
+///
+// --------------------------------------------------------
+
+void AccelerationGrid::find_overlapping_elements_unmarked( const Vec3i& xmini, const Vec3i& xmaxi, const Vec3d& xmin, const Vec3d& xmax, 
+                                                           std::vector<size_t>& results ) const
+{
+    size_t first_result = results.size();
+    
+    for(int k = xmini[2]; k <= xmaxi[2]; ++k)
+    {
+        for(int j = xmini[1]; j <= xmaxi[1]; ++j)
+        {
+            for(int i = xmini[0]; i <= xmaxi[0]; ++i)
+            {
+                const std::vector<size_t>* cell = m_cells(i, j, k);
+                
+                if(cell)
+                {
+                    for( std::vector<size_t>::const_iterator citer = cell->begin(); citer != cell->end(); ++citer)
+                    {
+                        size_t oidx = *citer;
+                        
+                        const Vec3d& oxmin = m_elementxmins[oidx];
+                        const Vec3d& oxmax = m_elementxmaxs[oidx];
+                        
+                        if( (xmin[0] <= oxmax[0] && xmin[1] <= oxmax[1] && xmin[2] <= oxmax[2]) &&
+                           (xmax[0] >= oxmin[0] && xmax[1] >= oxmin[1] && xmax[2] >= oxmin[2]) )
+                        {
+                            results.push_back(oidx);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    // an element overlapping several cells was found once per cell
+    std::sort( results.begin() + first_result, results.end() );
+    results.erase( std::unique( results.begin() + first_result, results.end() ), results.end() );
 }
 
+}
@@ -64,7 +64,8 @@ public:
     ///
     void clear();
     
-    /// Return the set of elements which have AABBs overlapping the query AABB.
+    /// Return the set of elements which have AABBs overlapping the query AABB.  Queries made from inside a parallel region
+    /// do not use the query timestamps, so several threads may query the grid at once.
     ///
     void find_overlapping_elements( const Vec3d& xmin, const Vec3d& xmax, std::vector<size_t>& results );
     
@@ -89,6 +90,11 @@ public:
     ///
     unsigned int m_lastquery;
     
+    /// Query without timestamps: collect candidates from all cells, then remove duplicates
+    ///
+    void find_overlapping_elements_unmarked( const Vec3i& xmini, const Vec3i& xmaxi, const Vec3d& xmin, const Vec3d& xmax, 
+                                             std::vector<size_t>& results ) const;
+    
     /// Lower/upper corners of the entire grid
     ///
     Vec3d m_gridxmin, m_gridxmax;
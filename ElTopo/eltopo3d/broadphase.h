@@ -4,8 +4,8 @@
 //  Tyson Brochu 2008
 //  
 //  Interface for abstract broad phase collision detector class.  The main function of a broad phase is to avoid performing 
-//  collision detection between all primitives. Abstract so we can try different strategies, however only BroadPhaseGrid is 
-//  currently implemented.
+//  collision detection between all primitives. Abstract so we can try different strategies: BroadPhaseGrid uses regular 
+//  grids, BroadPhaseHash uses spatial hashing and BroadPhaseBVH uses bounding volume hierarchies.
 //
 // ---------------------------------------------------------
 
@@ -26,6 +26,15 @@ namespace ElTopo {
 
 class DynamicSurface;
 
+/// Available broad phase implementations
+///
+enum BroadPhaseType
+{
+    BROAD_PHASE_GRID,
+    BROAD_PHASE_HASH,
+    BROAD_PHASE_BVH
+};
+
 // ---------------------------------------------------------
 //  Class definitions
 // ---------------------------------------------------------
@@ -0,0 +1,156 @@
+// ---------------------------------------------------------
+//
+//  broadphasebvh.cpp
+//  
+//  Broad phase collision detection culling using bounding volume hierarchies.
+//
+// ---------------------------------------------------------
+
+// ---------------------------------------------------------
+// Includes
+// ---------------------------------------------------------
+
+#include <broadphasebvh.h>
+#include <dynamicsurface.h>
+
+// ---------------------------------------------------------
+// Member function definitions
+// ---------------------------------------------------------
+
+namespace ElTopo {
+
+// --------------------------------------------------------
+///
+/// Split the elements of one type into solid and dynamic, and refit or rebuild both trees
+///
+// --------------------------------------------------------
+
+void BroadPhaseBVH::update_trees( AABBTree& solid_tree,
+                                 AABBTree& dynamic_tree,
+                                 const std::vector<Vec3d>& xmins, 
+                                 const std::vector<Vec3d>& xmaxs,
+                                 const std::vector<char>& is_solid )
+{
+    std::vector<Vec3d> solid_xmins, solid_xmaxs;
+    std::vector<size_t> solid_indices;
+    std::vector<Vec3d> dynamic_xmins, dynamic_xmaxs;
+    std::vector<size_t> dynamic_indices;
+    
+    for ( size_t i = 0; i < xmins.size(); ++i )
+    {
+        // don't add inside-out AABBs
+        if ( xmins[i][0] > xmaxs[i][0] )  { continue; }
+        
+        if ( is_solid[i] )
+        {
+            solid_xmins.push_back( xmins[i] );
+            solid_xmaxs.push_back( xmaxs[i] );
+            solid_indices.push_back( i );
+        }
+        else
+        {
+            dynamic_xmins.push_back( xmins[i] );
+            dynamic_xmaxs.push_back( xmaxs[i] );
+            dynamic_indices.push_back( i );
+        }
+    }
+    
+    solid_tree.update( solid_indices, solid_xmins, solid_xmaxs );
+    dynamic_tree.update( dynamic_indices, dynamic_xmins, dynamic_xmaxs );
+}
+
+
+// --------------------------------------------------------
+///
+/// Refit or rebuild the trees according to the given triangle mesh.  Bounding boxes are computed in parallel.
+///
+// --------------------------------------------------------
+
+void BroadPhaseBVH::update_broad_phase( const DynamicSurface& surface, bool continuous )
+{
+    
+    // 
+    // vertices
+    // 
+    {
+        int num_vertices = (int) surface.get_num_vertices();
+        
+        std::vector<Vec3d> xmins( num_vertices ), xmaxs( num_vertices );
+        std::vector<char> is_solid( num_vertices );
+        
+#pragma omp parallel for schedule(static)
+        for ( int i = 0; i < num_vertices; ++i )
+        {
+            if ( continuous )
+            {
+                surface.vertex_continuous_bounds( i, xmins[i], xmaxs[i] );
+            }
+            else
+            {
+                surface.vertex_static_bounds( i, xmins[i], xmaxs[i] );
+            }
+            
+            is_solid[i] = surface.vertex_is_all_solid( i );
+        }
+        
+        update_trees( m_solid_vertex_tree, m_dynamic_vertex_tree, xmins, xmaxs, is_solid );
+    }
+    
+    //
+    // edges
+    //
+    {
+        int num_edges = (int) surface.m_mesh.m_edges.size();
+        
+        std::vector<Vec3d> xmins( num_edges ), xmaxs( num_edges );
+        std::vector<char> is_solid( num_edges );
+        
+#pragma omp parallel for schedule(static)
+        for ( int i = 0; i < num_edges; ++i )
+        {
+            if ( continuous )
+            {
+                surface.edge_continuous_bounds( i, xmins[i], xmaxs[i] );
+            }
+            else
+            {
+                surface.edge_static_bounds( i, xmins[i], xmaxs[i] );
+            }
+            
+            // if either vertex is solid, it has to go into the solid broad phase
+            is_solid[i] = surface.edge_is_all_solid( i );
+        }
+        
+        update_trees( m_solid_edge_tree, m_dynamic_edge_tree, xmins, xmaxs, is_solid );
+    }
+    
+    //
+    // triangles
+    //
+    {
+        int num_triangles = (int) surface.m_mesh.num_triangles();
+        
+        std::vector<Vec3d> xmins( num_triangles ), xmaxs( num_triangles );
+        std::vector<char> is_solid( num_triangles );
+        
+#pragma omp parallel for schedule(static)
+        for ( int i = 0; i < num_triangles; ++i )
+        {
+            if ( continuous )
+            {
+                surface.triangle_continuous_bounds( i, xmins[i], xmaxs[i] );
+            }
+            else
+            {
+                surface.triangle_static_bounds( i, xmins[i], xmaxs[i] );
+            }
+            
+            is_solid[i] = surface.triangle_is_all_solid( i );
+        }
+        
+        update_trees( m_solid_triangle_tree, m_dynamic_triangle_tree, xmins, xmaxs, is_solid );
+    }
+    
+}
+
+}
@@ -0,0 +1,461 @@
+// ---------------------------------------------------------
+//
+//  broadphasebvh.h
+//  
+//  Broad phase collision detection culling using bounding volume hierarchies.
+//
+// ---------------------------------------------------------
+
+#ifndef EL_TOPO_BROADPHASEBVH_H
+#define EL_TOPO_BROADPHASEBVH_H
+
+// ---------------------------------------------------------
+// Nested includes
+// ---------------------------------------------------------
+
+#include <broadphase.h>
+#include <aabbtree.h>
+
+// ---------------------------------------------------------
+//  Forwards and typedefs
+// ---------------------------------------------------------
+
+namespace ElTopo {
+
+class DynamicSurface;
+
+// ---------------------------------------------------------
+//  Class definitions
+// ---------------------------------------------------------
+
+// --------------------------------------------------------
+///
+/// Broad phase collision detector using AABB trees: one tree each for vertices, edges and triangles.  Unlike the grids,
+/// the trees need no cell size, so they cope with element sizes varying widely across the mesh.  Rebuilding the broad
+/// phase refits the existing trees when the mesh elements are unchanged.
+///
+// --------------------------------------------------------
+
+class BroadPhaseBVH : public BroadPhase
+{
+public:
+    
+    /// Default constructor, just initialize empty trees
+    ///
+    BroadPhaseBVH() :
+    m_solid_vertex_tree(),
+    m_solid_edge_tree(),
+    m_solid_triangle_tree(),
+    m_dynamic_vertex_tree(),
+    m_dynamic_edge_tree(),
+    m_dynamic_triangle_tree()
+    {}
+    
+    
+    /// Do-nothing destructor
+    ///
+    ~BroadPhaseBVH() 
+    {}
+    
+    /// Rebuild the broad phase
+    ///
+    void update_broad_phase( const DynamicSurface& surface, bool continuous );
+    
+    /// Add a vertex with the specified bounding box to the broad phase
+    ///
+    inline void add_vertex( size_t index,
+                           const Vec3d& aabb_low,
+                           const Vec3d& aabb_high,
+                           bool is_solid );
+    
+    /// Add an edge with the specified bounding box to the broad phase
+    ///
+    inline void add_edge( size_t index,
+                         const Vec3d& aabb_low,
+                         const Vec3d& aabb_high,
+                         bool is_solid );
+
+    /// Add a triangle with the specified bounding box to the broad phase
+    ///
+    inline void add_triangle( size_t index,
+                             const Vec3d& aabb_low,
+                             const Vec3d& aabb_high,
+                             bool is_solid );
+
+    /// Update a vertex's broad phase entry
+    ///
+    inline void update_vertex( size_t index,
+                              const Vec3d& aabb_low,
+                              const Vec3d& aabb_high,
+                              bool is_solid );
+    
+    /// Update an edge's broad phase entry
+    ///
+    inline void update_edge( size_t index,
+                            const Vec3d& aabb_low,
+                            const Vec3d& aabb_high,
+                            bool is_solid );
+
+    /// Update a triangle's broad phase entry
+    ///
+    inline void update_triangle( size_t index,
+                                const Vec3d& aabb_low,
+                                const Vec3d& aabb_high,
+                                bool is_solid );
+
+    /// Remove a vertex from the broad phase
+    ///
+    inline void remove_vertex( size_t index );
+    
+    /// Remove an edge from the broad phase
+    ///    
+    inline void remove_edge( size_t index );
+    
+    /// Remove a triangle from the broad phase
+    ///        
+    inline void remove_triangle( size_t index ); 
+    
+    /// Get the stored axis-aligned bounding box of a vertex
+    ///
+    virtual void get_vertex_aabb( size_t index, bool is_solid, Vec3d& aabb_low, Vec3d& aabb_high );
+    
+    /// Get the stored axis-aligned bounding box of an edge
+    ///
+    virtual void get_edge_aabb( size_t index, bool is_solid, Vec3d& aabb_low, Vec3d& aabb_high );
+    
+    /// Get the stored axis-aligned bounding box of a triangle
+    ///
+    virtual void get_triangle_aabb( size_t index, bool is_solid, Vec3d& aabb_low, Vec3d& aabb_high );
+    
+    /// Get the set of vertices whose bounding volumes overlap the specified bounding volume
+    ///
+    inline void get_potential_vertex_collisions( const Vec3d& aabb_low, 
+                                                const Vec3d& aabb_high,
+                                                bool return_solid,
+                                                bool return_dynamic,
+                                                std::vector<size_t>& overlapping_vertices );
+    
+    /// Get the set of edges whose bounding volumes overlap the specified bounding volume
+    ///
+    inline void get_potential_edge_collisions( const Vec3d& aabb_low, 
+                                              const Vec3d& aabb_high, 
+                                              bool return_solid,
+                                              bool return_dynamic,
+                                              std::vector<size_t>& overlapping_edges );
+    
+    /// Get the set of triangles whose bounding volumes overlap the specified bounding volume
+    ///
+    inline void get_potential_triangle_collisions( const Vec3d& aabb_low, 
+                                                  const Vec3d& aabb_high,
+                                                  bool return_solid,
+                                                  bool return_dynamic,
+                                                  std::vector<size_t>& overlapping_triangles );
+    
+    /// Refit or rebuild the solid and dynamic trees of one element type, given the AABB and solidity of every element
+    ///
+    void update_trees( AABBTree& solid_tree,
+                      AABBTree& dynamic_tree,
+                      const std::vector<Vec3d>& xmins, 
+                      const std::vector<Vec3d>& xmaxs,
+                      const std::vector<char>& is_solid );
+    
+    /// Trees for solid mesh elements
+    ///
+    AABBTree m_solid_vertex_tree;
+    AABBTree m_solid_edge_tree;
+    AABBTree m_solid_triangle_tree;
+
+    /// Trees for dynamic mesh elements
+    ///
+    AABBTree m_dynamic_vertex_tree;
+    AABBTree m_dynamic_edge_tree;
+    AABBTree m_dynamic_triangle_tree;
+    
+};
+
+// ---------------------------------------------------------
+//  Inline functions
+// ---------------------------------------------------------
+
+// --------------------------------------------------------
+///
+/// Add a vertex to the broad phase
+///
+// --------------------------------------------------------
+
+inline void BroadPhaseBVH::add_vertex( size_t index, const Vec3d& aabb_low, const Vec3d& aabb_high, bool is_solid )
+{
+    if ( is_solid )
+    {
+        m_solid_vertex_tree.add_element( index, aabb_low, aabb_high );
+    }
+    else
+    {
+        m_dynamic_vertex_tree.add_element( index, aabb_low, aabb_high );
+    }
+}
+
+// --------------------------------------------------------
+///
+/// Add an edge to the broad phase
+///
+// --------------------------------------------------------
+
+inline void BroadPhaseBVH::add_edge( size_t index, const Vec3d& aabb_low, const Vec3d& aabb_high, bool is_solid )
+{
+    if ( is_solid )
+    {
+        m_solid_edge_tree.add_element( index, aabb_low, aabb_high );
+    }
+    else
+    {
+        m_dynamic_edge_tree.add_element( index, aabb_low, aabb_high );
+    }
+}
+
+// --------------------------------------------------------
+///
+/// Add a triangle to the broad phase
+///
+// --------------------------------------------------------
+
+inline void BroadPhaseBVH::add_triangle( size_t index, const Vec3d& aabb_low, const Vec3d& aabb_high, bool is_solid )
+{
+    if ( is_solid )
+    {
+        m_solid_triangle_tree.add_element( index, aabb_low, aabb_high );
+    }
+    else
+    {
+        m_dynamic_triangle_tree.add_element( index, aabb_low, aabb_high );
+    }
+}
+
+
+// ---------------------------------------------------------
+///
+/// Update a vertex's broad phase entry
+///
+// ---------------------------------------------------------
+
+inline void BroadPhaseBVH::update_vertex( size_t index, const Vec3d& aabb_low, const Vec3d& aabb_high, bool is_solid )
+{
+    if ( is_solid )
+    {
+        m_solid_vertex_tree.update_element( index, aabb_low, aabb_high );
+    }
+    else
+    {
+        m_dynamic_vertex_tree.update_element( index, aabb_low, aabb_high );
+    }
+}
+
+// ---------------------------------------------------------
+///
+/// Update an edge's broad phase entry
+///
+// ---------------------------------------------------------
+
+inline void BroadPhaseBVH::update_edge( size_t index, const Vec3d& aabb_low, const Vec3d& aabb_high, bool is_solid )
+{
+    if ( is_solid )
+    {
+        m_solid_edge_tree.update_element( index, aabb_low, aabb_high );
+    }
+    else
+    {
+        m_dynamic_edge_tree.update_element( index, aabb_low, aabb_high );
+    }
+}
+
+// ---------------------------------------------------------
+///
+/// Update a triangle's broad phase entry
+///
+// ---------------------------------------------------------
+
+inline void BroadPhaseBVH::update_triangle( size_t index, const Vec3d& aabb_low, const Vec3d& aabb_high, bool is_solid )
+{
+    if ( is_solid )
+    {
+        m_solid_triangle_tree.update_element( index, aabb_low, aabb_high );
+    }
+    else
+    {
+        m_dynamic_triangle_tree.update_element( index, aabb_low, aabb_high );
+    }
+}
+
+
+// --------------------------------------------------------
+///
+/// Remove a vertex from the broad phase
+///
+// --------------------------------------------------------
+
+inline void BroadPhaseBVH::remove_vertex( size_t index )
+{
+    m_solid_vertex_tree.remove_element( index );
+    m_dynamic_vertex_tree.remove_element( index );
+}
+
+// --------------------------------------------------------
+///
+/// Remove an edge from the broad phase
+///
+// --------------------------------------------------------
+
+inline void BroadPhaseBVH::remove_edge( size_t index )
+{
+    m_solid_edge_tree.remove_element( index );
+    m_dynamic_edge_tree.remove_element( index );
+}
+
+// --------------------------------------------------------
+///
+/// Remove a triangle from the broad phase
+///
+// --------------------------------------------------------
+
+inline void BroadPhaseBVH::remove_triangle( size_t index )
+{
+    m_solid_triangle_tree.remove_element( index );
+    m_dynamic_triangle_tree.remove_element( index );
+}
+
+// --------------------------------------------------------
+///
+/// Query the broad phase to get the set of all vertices overlapping the given AABB
+///
+// --------------------------------------------------------
+
+inline void BroadPhaseBVH::get_potential_vertex_collisions( const Vec3d& aabb_low,
+                                                            const Vec3d& aabb_high,
+                                                            bool return_solid,
+                                                            bool return_dynamic,
+                                                            std::vector<size_t>& overlapping_vertices )
+{
+    if ( return_solid )
+    {
+        m_solid_vertex_tree.find_overlapping_elements( aabb_low, aabb_high, overlapping_vertices );
+    }
+    
+    if ( return_dynamic )
+    {
+        m_dynamic_vertex_tree.find_overlapping_elements( aabb_low, aabb_high, overlapping_vertices );
+    }
+}
+
+// --------------------------------------------------------
+///
+/// Query the broad phase to get the set of all edges overlapping the given AABB
+///
+// --------------------------------------------------------
+
+inline void BroadPhaseBVH::get_potential_edge_collisions( const Vec3d& aabb_low,
+                                                          const Vec3d& aabb_high,
+                                                          bool return_solid,
+                                                          bool return_dynamic,
+                                                          std::vector<size_t>& overlapping_edges )
+{
+    if ( return_solid )
+    {
+        m_solid_edge_tree.find_overlapping_elements( aabb_low, aabb_high, overlapping_edges );
+    }
+    
+    if ( return_dynamic )
+    {
+        m_dynamic_edge_tree.find_overlapping_elements( aabb_low, aabb_high, overlapping_edges );
+    }
+}
+
+// --------------------------------------------------------
+///
+/// Query the broad phase to get the set of all triangles overlapping the given AABB
+///
+// --------------------------------------------------------
+
+inline void BroadPhaseBVH::get_potential_triangle_collisions( const Vec3d& aabb_low,
+                                                              const Vec3d& aabb_high,
+                                                              bool return_solid,
+                                                              bool return_dynamic,
+                                                              std::vector<size_t>& overlapping_triangles )
+{
+    if ( return_solid )
+    {
+        m_solid_triangle_tree.find_overlapping_elements( aabb_low, aabb_high, overlapping_triangles );
+    }
+
+    if ( return_dynamic )
+    {
+        m_dynamic_triangle_tree.find_overlapping_elements( aabb_low, aabb_high, overlapping_triangles );
+    }
+}
+
+
+// ---------------------------------------------------------
+///
+/// Get the stored axis-aligned bounding box of a vertex
+///
+// ---------------------------------------------------------
+
+inline void BroadPhaseBVH::get_vertex_aabb( size_t index, bool is_solid, Vec3d& aabb_low, Vec3d& aabb_high )
+{
+    if ( is_solid )
+    {
+        aabb_low = m_solid_vertex_tree.m_elementxmins[index];
+        aabb_high = m_solid_vertex_tree.m_elementxmaxs[index];
+    }
+    else
+    {
+        aabb_low = m_dynamic_vertex_tree.m_elementxmins[index];
+        aabb_high = m_dynamic_vertex_tree.m_elementxmaxs[index];      
+    }
+}
+
+// ---------------------------------------------------------
+///
+/// Get the stored axis-aligned bounding box of an edge
+///
+// ---------------------------------------------------------
+
+inline void BroadPhaseBVH::get_edge_aabb( size_t index, bool is_solid, Vec3d& aabb_low, Vec3d& aabb_high )
+{
+    if ( is_solid )
+    {
+        aabb_low = m_solid_edge_tree.m_elementxmins[index];
+        aabb_high = m_solid_edge_tree.m_elementxmaxs[index];
+    }
+    else
+    {
+        aabb_low = m_dynamic_edge_tree.m_elementxmins[index];
+        aabb_high = m_dynamic_edge_tree.m_elementxmaxs[index];      
+    }
+}
+
+// ---------------------------------------------------------
+///
+/// Get the stored axis-aligned bounding box of a triangle
+///
+// ---------------------------------------------------------
+
+inline void BroadPhaseBVH::get_triangle_aabb( size_t index, bool is_solid, Vec3d& aabb_low, Vec3d& aabb_high )
+{
+    if ( is_solid )
+    {
+        aabb_low = m_solid_triangle_tree.m_elementxmins[index];
+        aabb_high = m_solid_triangle_tree.m_elementxmaxs[index];
+    }
+    else
+    {
+        aabb_low = m_dynamic_triangle_tree.m_elementxmins[index];
+        aabb_high = m_dynamic_triangle_tree.m_elementxmaxs[index];      
+    }   
+}
+
+}
+
+#endif
+
+
+
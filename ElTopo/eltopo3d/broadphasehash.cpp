@@ -0,0 +1,205 @@
+// ---------------------------------------------------------
+//
+//  broadphasehash.cpp
+//  
+//  Broad phase collision detection culling using spatial hash grids.
+//
+// ---------------------------------------------------------
+
+// ---------------------------------------------------------
+// Includes
+// ---------------------------------------------------------
+
+#include <broadphasehash.h>
+#include <dynamicsurface.h>
+
+// ---------------------------------------------------------
+// Member function definitions
+// ---------------------------------------------------------
+
+namespace ElTopo {
+
+// --------------------------------------------------------
+///
+/// Construct one grid from the given set of AABBs, using the given length scale as the cell size
+///
+// --------------------------------------------------------
+
+void BroadPhaseHash::build_hash_grid( SpatialHashGrid& grid, 
+                                     const std::vector<Vec3d>& xmins, 
+                                     const std::vector<Vec3d>& xmaxs, 
+                                     const std::vector<size_t>& indices,
+                                     double length_scale )
+{
+    
+    assert( xmaxs.size() == xmins.size() );
+    assert( xmins.size() == indices.size() );
+    
+    if ( indices.empty() )
+    {
+        grid.clear();
+        return;
+    }
+    
+    Vec3d xmax = xmaxs[0];
+    Vec3d xmin = xmins[0];
+    
+    size_t n = xmins.size();
+    for(size_t i = 0; i < n; i++)
+    {
+        update_minmax(xmins[i], xmin, xmax);
+        update_minmax(xmaxs[i], xmin, xmax);
+    }
+    
+    // on huge domains, grow the cells rather than let the grid clamp cell coordinates
+    double cell_size = length_scale;
+    for(unsigned int i = 0; i < 3; i++)
+    {
+        cell_size = std::max( cell_size, (xmax[i] - xmin[i]) / (1 << 19) );
+    }
+    
+    if ( !(cell_size > 0.0) )
+    {
+        cell_size = 1.0;
+    }
+    
+    grid.set( cell_size, xmin );
+    grid.build( indices, xmins, xmaxs );
+}
+
+
+// --------------------------------------------------------
+///
+/// Split the elements of one type into solid and dynamic, and rebuild both grids
+///
+// --------------------------------------------------------
+
+void BroadPhaseHash::build_hash_grids( SpatialHashGrid& solid_grid,
+                                      SpatialHashGrid& dynamic_grid,
+                                      const std::vector<Vec3d>& xmins, 
+                                      const std::vector<Vec3d>& xmaxs,
+                                      const std::vector<char>& is_solid,
+                                      double length_scale )
+{
+    std::vector<Vec3d> solid_xmins, solid_xmaxs;
+    std::vector<size_t> solid_indices;
+    std::vector<Vec3d> dynamic_xmins, dynamic_xmaxs;
+    std::vector<size_t> dynamic_indices;
+    
+    for ( size_t i = 0; i < xmins.size(); ++i )
+    {
+        if ( is_solid[i] )
+        {
+            solid_xmins.push_back( xmins[i] );
+            solid_xmaxs.push_back( xmaxs[i] );
+            solid_indices.push_back( i );
+        }
+        else
+        {
+            dynamic_xmins.push_back( xmins[i] );
+            dynamic_xmaxs.push_back( xmaxs[i] );
+            dynamic_indices.push_back( i );
+        }
+    }
+    
+    build_hash_grid( solid_grid, solid_xmins, solid_xmaxs, solid_indices, length_scale );
+    build_hash_grid( dynamic_grid, dynamic_xmins, dynamic_xmaxs, dynamic_indices, length_scale );
+}
+
+
+// --------------------------------------------------------
+///
+/// Rebuild the hash grids according to the given triangle mesh.  Bounding boxes are computed in parallel.
+///
+// --------------------------------------------------------
+
+void BroadPhaseHash::update_broad_phase( const DynamicSurface& surface, bool continuous )
+{
+    
+    double grid_scale = surface.get_average_edge_length();
+    
+    // 
+    // vertices
+    // 
+    {
+        int num_vertices = (int) surface.get_num_vertices();
+        
+        std::vector<Vec3d> xmins( num_vertices ), xmaxs( num_vertices );
+        std::vector<char> is_solid( num_vertices );
+        
+#pragma omp parallel for schedule(static)
+        for ( int i = 0; i < num_vertices; ++i )
+        {
+            if ( continuous )
+            {
+                surface.vertex_continuous_bounds( i, xmins[i], xmaxs[i] );
+            }
+            else
+            {
+                surface.vertex_static_bounds( i, xmins[i], xmaxs[i] );
+            }
+            
+            is_solid[i] = surface.vertex_is_all_solid( i );
+        }
+        
+        build_hash_grids( m_solid_vertex_grid, m_dynamic_vertex_grid, xmins, xmaxs, is_solid, grid_scale );
+    }
+    
+    //
+    // edges
+    //
+    {
+        int num_edges = (int) surface.m_mesh.m_edges.size();
+        
+        std::vector<Vec3d> xmins( num_edges ), xmaxs( num_edges );
+        std::vector<char> is_solid( num_edges );
+        
+#pragma omp parallel for schedule(static)
+        for ( int i = 0; i < num_edges; ++i )
+        {
+            if ( continuous )
+            {
+                surface.edge_continuous_bounds( i, xmins[i], xmaxs[i] );
+            }
+            else
+            {
+                surface.edge_static_bounds( i, xmins[i], xmaxs[i] );
+            }
+            
+            // if either vertex is solid, it has to go into the solid broad phase
+            is_solid[i] = surface.edge_is_all_solid( i );
+        }
+        
+        build_hash_grids( m_solid_edge_grid, m_dynamic_edge_grid, xmins, xmaxs, is_solid, grid_scale );
+    }
+    
+    //
+    // triangles
+    //
+    {
+        int num_triangles = (int) surface.m_mesh.num_triangles();
+        
+        std::vector<Vec3d> xmins( num_triangles ), xmaxs( num_triangles );
+        std::vector<char> is_solid( num_triangles );
+        
+#pragma omp parallel for schedule(static)
+        for ( int i = 0; i < num_triangles; ++i )
+        {
+            if ( continuous )
+            {
+                surface.triangle_continuous_bounds( i, xmins[i], xmaxs[i] );
+            }
+            else
+            {
+                surface.triangle_static_bounds( i, xmins[i], xmaxs[i] );
+            }
+            
+            is_solid[i] = surface.triangle_is_all_solid( i );
+        }
+        
+        build_hash_grids( m_solid_triangle_grid, m_dynamic_triangle_grid, xmins, xmaxs, is_solid, grid_scale );
+    }
+    
+}
+
+}
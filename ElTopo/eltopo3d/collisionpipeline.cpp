@@ -16,6 +16,10 @@
 #include <runstats.h>
 #include <wallclocktime.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 // ---------------------------------------------------------
 // Global externs
 // ---------------------------------------------------------
@@ -889,51 +893,38 @@ void CollisionPipeline::test_collision_candidates( CollisionCandidateSet& candid
     
     const size_t MAX_COLLISIONS = 5000;
     
+    // Candidates are consumed from the back.  Each batch is tested in parallel, then its hits are appended in the order the 
+    // one-at-a-time loop would have found them, so that an overflow leaves the same collisions and remaining candidates.
+    const size_t BATCH_SIZE = 16384;
+    std::vector< std::vector< std::pair<size_t, Collision> > > chunk_hits;
+    
     while ( false == candidates.empty() )
     {
-
-       Vec3st candidate = candidates.back();
-       candidates.pop_back();
+        size_t batch_end = candidates.size();
+        size_t batch_begin = ( batch_end > BATCH_SIZE ) ? batch_end - BATCH_SIZE : 0;
         
-        if ( candidate[2] == 1 )
+        detect_candidate_collisions( candidates, batch_begin, batch_end, chunk_hits );
+        
+        for ( size_t c = 0; c < chunk_hits.size(); ++c )
         {
-            // edge-edge
-            Collision collision;
-            if ( detect_segment_segment_collision( candidate, collision ) )
+            for ( size_t h = 0; h < chunk_hits[c].size(); ++h )
             {
                 status.collision_found = true;
                 
-                collisions.push_back( collision );
+                collisions.push_back( chunk_hits[c][h].second );
                 
                 if ( collisions.size() > MAX_COLLISIONS ) 
                 {
+                    // everything down to and including this candidate has been consumed
+                    candidates.resize( chunk_hits[c][h].first );
                     status.overflow = true;
                     status.all_candidates_processed = false;
                     return; 
-                }                 
-            }
-            
-        }
-        else
-        {
-            // point-triangle
-            
-            Collision collision;
-            if ( detect_point_triangle_collision( candidate, collision ) )
-            {               
-                status.collision_found = true;
-                
-                collisions.push_back( collision );
-                
-                if ( collisions.size() > MAX_COLLISIONS ) 
-                {
-                    status.overflow = true;
-                    status.all_candidates_processed = false;                  
-                    return; 
-                }               
+                }
             }
-            
         }
+        
+        candidates.resize( batch_begin );
     }
     
     
@@ -945,35 +936,83 @@ void CollisionPipeline::test_collision_candidates( CollisionCandidateSet& candid
 
 // ---------------------------------------------------------
 ///
-/// Check if any collision exists in the set of candidates.  Stop when the first collision is found.
+/// Run the narrow phase on one candidate: an edge pair if candidate[2] is 1, otherwise a triangle and a vertex
 ///
 // ---------------------------------------------------------
 
-bool CollisionPipeline::any_collision( CollisionCandidateSet& candidates, Collision& collision )
+bool CollisionPipeline::detect_candidate_collision( const Vec3st& candidate, Collision& collision )
 {
+    if ( candidate[2] == 1 )
+    {
+        // edge-edge
+        return detect_segment_segment_collision( candidate, collision );
+    }
     
-    CollisionCandidateSet::iterator iter = candidates.begin();
+    // point-triangle
+    return detect_point_triangle_collision( candidate, collision );
+}
+
+// ---------------------------------------------------------
+///
+/// Run the narrow phase on a range of candidates in parallel, collecting the hits of each chunk separately
+///
+// ---------------------------------------------------------
+
+void CollisionPipeline::detect_candidate_collisions( const CollisionCandidateSet& candidates,
+                                                    size_t begin, 
+                                                    size_t end,
+                                                    std::vector< std::vector< std::pair<size_t, Collision> > >& chunk_hits )
+{
+    // a few chunks per thread, so that threads getting cheap candidates can pick up more chunks
+    const size_t MIN_CHUNK_SIZE = 64;
+    size_t num_threads = 1;
+#ifdef _OPENMP
+    num_threads = (size_t) omp_get_max_threads();
+#endif
     
-    for ( ; iter != candidates.end(); ++iter )
+    size_t count = end - begin;
+    size_t num_chunks = std::max( (size_t) 1, std::min( 4 * num_threads, count / MIN_CHUNK_SIZE ) );
+    
+    chunk_hits.resize( num_chunks );
+    
+#pragma omp parallel for schedule(dynamic) if(num_chunks > 1)
+    for ( int c = 0; c < (int) num_chunks; ++c )
     {
+        std::vector< std::pair<size_t, Collision> >& hits = chunk_hits[c];
+        hits.clear();
         
-        Vec3st candidate = *iter;
+        // chunk 0 is the back of the range
+        size_t chunk_end = end - count * c / num_chunks;
+        size_t chunk_begin = end - count * (c + 1) / num_chunks;
         
-        if ( candidate[2] == 1 )
+        for ( size_t i = chunk_end; i > chunk_begin; --i )
         {
-            // edge-edge
-            if ( detect_segment_segment_collision( candidate, collision ) )
+            Collision collision;
+            if ( detect_candidate_collision( candidates[i-1], collision ) )
             {
-                return true;
-            }         
+                hits.push_back( std::make_pair( i-1, collision ) );
+            }
         }
-        else
+    }
+}
+
+// ---------------------------------------------------------
+///
+/// Check if any collision exists in the set of candidates.  Stop when the first collision is found.
+///
+// ---------------------------------------------------------
+
+bool CollisionPipeline::any_collision( CollisionCandidateSet& candidates, Collision& collision )
+{
+    
+    CollisionCandidateSet::iterator iter = candidates.begin();
+    
+    for ( ; iter != candidates.end(); ++iter )
+    {
+        
+        if ( detect_candidate_collision( *iter, collision ) )
         {
-            // point-triangle
-            if ( detect_point_triangle_collision( candidate, collision ) )
-            {
-                return true;
-            }
+            return true;
         }
     }
     
@@ -253,6 +253,19 @@ private:
                                    std::vector<Collision>& collisions,
                                    ProcessCollisionStatus& status );
     
+    /// Run the narrow phase on one candidate of either type
+    ///
+    bool detect_candidate_collision( const Vec3st& candidate, Collision& collision );
+    
+    /// Run the narrow phase on candidates [begin, end) in parallel.  The range is cut into chunks, each filling its own list 
+    /// of (candidate index, collision) pairs.  Chunks run from the back of the range and each lists its hits by decreasing 
+    /// index, so concatenating the lists gives the order in which popping candidates one at a time would find them.
+    ///
+    void detect_candidate_collisions( const CollisionCandidateSet& candidates,
+                                     size_t begin, 
+                                     size_t end,
+                                     std::vector< std::vector< std::pair<size_t, Collision> > >& chunk_hits );
+    
     /// Check if any collision exists in the set of candidates.  Stop when the first collision is found.
     /// 
     bool any_collision( CollisionCandidateSet& candidates, Collision& collision );
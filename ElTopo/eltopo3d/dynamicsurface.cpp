@@ -12,8 +12,11 @@
 // ---------------------------------------------------------
 
 #include <dynamicsurface.h>
+#include <algorithm>
 
+#include <broadphasebvh.h>
 #include <broadphasegrid.h>
+#include <broadphasehash.h>
 #include <cassert>
 #include <ccd_wrapper.h>
 #include <collisionpipeline.h>
@@ -75,7 +78,15 @@ m_aabb_padding( max( in_proximity_epsilon, 1e-4 ) ),
 pm_positions(vertex_positions), 
 pm_newpositions(vertex_positions),
 m_velocities(0),
-m_feature_edge_angle_threshold(M_PI/6)
+m_feature_edge_angle_threshold(M_PI/6),
+m_localized_intersection_checks( true ),
+m_intersection_check_epsilon( 0.0 ),
+m_full_intersection_check_interval( 0 ),
+m_vertex_needs_intersection_check(),
+m_full_intersection_check_pending( true ),
+m_vertex_change_log(),
+m_vertex_change_log_epoch( 0 ),
+m_intersection_check_count( 0 )
 {
     
     if ( m_verbose )
@@ -680,7 +691,7 @@ void DynamicSurface::integrate( double desired_dt, double& actual_dt )
     if ( m_collision_safety )
     {
       std::cout << "Checking collisions before integration.\n";
-      assert_mesh_is_intersection_free( false );
+      assert_mesh_changes_are_intersection_free( false );
       
     }
     std::cout << "Integrating\n";
@@ -702,6 +713,9 @@ void DynamicSurface::integrate( double desired_dt, double& actual_dt )
     while ( !success )
     {
         
+        // predicted positions before collision response, to find the vertices it moves
+        const std::vector<Vec3d> step_predicted_positions = get_newpositions();
+        
         m_velocities.resize( get_num_vertices() );
         for(size_t i = 0; i < get_num_vertices(); i++)
         {
@@ -760,9 +774,19 @@ void DynamicSurface::integrate( double desired_dt, double& actual_dt )
             }
             
             
-            // verify intersection-free predicted mesh
+            // verify intersection-free predicted mesh.  The current mesh is known to be intersection-free, so only elements 
+            // incident on a moving vertex can have become intersecting.
             std::vector<Intersection> intersections;
-            get_intersections( DEGEN_DOES_NOT_COUNT, USE_NEW_POSITIONS, intersections );
+            if ( full_intersection_check_due() )
+            {
+                get_intersections( DEGEN_DOES_NOT_COUNT, USE_NEW_POSITIONS, intersections );
+            }
+            else
+            {
+                std::vector<size_t> moved_vertices;
+                get_vertices_needing_predicted_check( step_predicted_positions, moved_vertices );
+                get_intersections_near_vertices( moved_vertices, DEGEN_DOES_NOT_COUNT, USE_NEW_POSITIONS, intersections );
+            }
             
             if ( !intersections.empty() )
             {
@@ -798,7 +822,15 @@ void DynamicSurface::integrate( double desired_dt, double& actual_dt )
         
         if ( m_collision_safety )
         {
-            assert_mesh_is_intersection_free( DEGEN_DOES_NOT_COUNT );
+            if ( m_localized_intersection_checks )
+            {
+                // the new positions were verified above
+                m_vertex_needs_intersection_check.assign( m_vertex_needs_intersection_check.size(), 0 );
+            }
+            else
+            {
+                assert_mesh_is_intersection_free( DEGEN_DOES_NOT_COUNT );
+            }
         }
         
         actual_dt = curr_dt;
@@ -812,10 +844,48 @@ void DynamicSurface::integrate( double desired_dt, double& actual_dt )
     static unsigned int step = 0;
     g_stats.add_per_frame_double( "DynamicSurface:integration_time_per_timestep", step, end_time - start_time );
     ++step;
+    
+#ifdef USE_CCD_PREFILTER
+    CCDFilterCounts ccd_filter_counts;
+    get_ccd_filter_counts( ccd_filter_counts );
+    g_stats.set_int( "DynamicSurface:ccd_rejected_by_bounds", ccd_filter_counts.rejected_by_bounds );
+    g_stats.set_int( "DynamicSurface:ccd_rejected_by_coplanarity", ccd_filter_counts.rejected_by_coplanarity );
+    g_stats.set_int( "DynamicSurface:ccd_exact_tests", ccd_filter_counts.exact_tests );
+    g_stats.set_int( "DynamicSurface:ccd_prefilter_mismatches", ccd_filter_counts.mismatches );
+#endif
     std::cout << "Done integrating\n";
     
 }
 
+// ---------------------------------------------------------
+///
+/// Replace the broad phase object.  The collision pipeline holds on to the broad phase, so it is recreated too.
+///
+// ---------------------------------------------------------
+
+void DynamicSurface::set_broad_phase_type( BroadPhaseType type )
+{
+    double friction_coefficient = m_collision_pipeline->m_friction_coefficient;
+    
+    delete m_collision_pipeline;
+    delete m_broad_phase;
+    
+    switch ( type )
+    {
+        case BROAD_PHASE_HASH:
+            m_broad_phase = new BroadPhaseHash();
+            break;
+        case BROAD_PHASE_BVH:
+            m_broad_phase = new BroadPhaseBVH();
+            break;
+        default:
+            m_broad_phase = new BroadPhaseGrid();
+            break;
+    }
+    
+    m_collision_pipeline = new CollisionPipeline( *this, *m_broad_phase, friction_coefficient );
+}
+
 // ---------------------------------------------------------
 ///
 /// Construct static acceleration structure
@@ -827,7 +897,9 @@ void DynamicSurface::rebuild_static_broad_phase()
     assert( m_collision_safety );
     if(m_verbose)
       std::cout << "Rebuilding broad phase\n";
+    double start_time = get_time_in_seconds();
     m_broad_phase->update_broad_phase( *this, false );
+    g_stats.add_to_double( "DynamicSurface:total_broad_phase_update_time", get_time_in_seconds() - start_time );
     
     if(m_verbose)
       std::cout << "Done rebuilding broad phase\n";
@@ -842,7 +914,9 @@ void DynamicSurface::rebuild_static_broad_phase()
 void DynamicSurface::rebuild_continuous_broad_phase()
 {
     assert( m_collision_safety );
+    double start_time = get_time_in_seconds();
     m_broad_phase->update_broad_phase( *this, true );
+    g_stats.add_to_double( "DynamicSurface:total_broad_phase_update_time", get_time_in_seconds() - start_time );
 }
 
 
@@ -1478,13 +1552,16 @@ void DynamicSurface::check_continuous_broad_phase_is_up_to_date() const
                 std::cout << "query_overlaps_broadphase_aabb: " << query_overlaps_broadphase_aabb << std::endl;
                 
                 
-                BroadPhaseGrid* grid_bf = static_cast<BroadPhaseGrid*>(m_broad_phase);
+                BroadPhaseGrid* grid_bf = dynamic_cast<BroadPhaseGrid*>(m_broad_phase);
                 
-                const std::vector<Vec3st>& cells = grid_bf->m_dynamic_vertex_grid.m_elementidxs[ brute_force_overlapping_vertices[k] ];
-                std::cout << "cells: " << std::endl;
-                for ( size_t m = 0; m < cells.size(); ++m )
+                if ( grid_bf )
                 {
-                    std::cout << cells[m] << std::endl;
+                    const std::vector<Vec3st>& cells = grid_bf->m_dynamic_vertex_grid.m_elementidxs[ brute_force_overlapping_vertices[k] ];
+                    std::cout << "cells: " << std::endl;
+                    for ( size_t m = 0; m < cells.size(); ++m )
+                    {
+                        std::cout << cells[m] << std::endl;
+                    }
                 }
                 
             }
@@ -1683,8 +1760,6 @@ void DynamicSurface::get_intersections( bool degeneracy_counts_as_intersection,
         triangle_static_bounds( i, low, high );       
         m_broad_phase->get_potential_edge_collisions( low, high, get_solid_edges, true, edge_candidates );
         
-        const Vec3st& triangle = m_mesh.get_triangle(i);
-        
         //skip deleted triangles
         if(m_mesh.triangle_is_deleted(i)) continue;
         
@@ -1696,37 +1771,8 @@ void DynamicSurface::get_intersections( bool degeneracy_counts_as_intersection,
         for ( size_t j = 0; j < edge_candidates.size(); ++j )
         {
           
-            const Vec2st& edge = m_mesh.m_edges[ edge_candidates[j] ];
-            
-            if(m_mesh.edge_is_deleted( edge_candidates[j] ) ) continue;
-
-            if (    edge[0] == triangle[0] || edge[0] == triangle[1] || edge[0] == triangle[2] 
-                || edge[1] == triangle[0] || edge[1] == triangle[1] || edge[1] == triangle[2] )
-            {
-                continue;
-            }
-
-            assert( !triangle_is_all_solid( i ) || !edge_is_all_solid( edge_candidates[j] ) );
-            
-            const Vec3d& e0 = use_new_positions ? get_newposition(edge[0]) : get_position(edge[0]);
-            const Vec3d& e1 = use_new_positions ? get_newposition(edge[1]) : get_position(edge[1]);
-            const Vec3d& t0 = use_new_positions ? get_newposition(triangle[0]) : get_position(triangle[0]);
-            const Vec3d& t1 = use_new_positions ? get_newposition(triangle[1]) : get_position(triangle[1]);
-            const Vec3d& t2 = use_new_positions ? get_newposition(triangle[2]) : get_position(triangle[2]);
-            
-            if ( segment_triangle_intersection( e0, edge[0], 
-                                               e1, edge[1],
-                                               t0, triangle[0], 
-                                               t1, triangle[1], 
-                                               t2, triangle[2], 
-                                               degeneracy_counts_as_intersection, m_verbose ) )
+            if ( edge_triangle_intersection( edge_candidates[j], i, degeneracy_counts_as_intersection, use_new_positions ) )
             {
-                std::cout << "intersection: " << edge << " vs " << triangle << std::endl;
-                std::cout << "e0: " << e0 << std::endl;
-                std::cout << "e1: " << e1 << std::endl;
-                std::cout << "t0: " << t0 << std::endl;
-                std::cout << "t1: " << t1 << std::endl;
-                std::cout << "t2: " << t2 << std::endl;            
                 //#pragma omp critical 
                 {
                   intersections.push_back( Intersection( edge_candidates[j], i ) );
@@ -1739,6 +1785,216 @@ void DynamicSurface::get_intersections( bool degeneracy_counts_as_intersection,
     
 }
 
+// ---------------------------------------------------------
+///
+/// Test one edge against one triangle, skipping pairs that share a vertex.
+///
+// ---------------------------------------------------------
+
+bool DynamicSurface::edge_triangle_intersection( size_t edge_index, 
+                                                size_t triangle_index, 
+                                                bool degeneracy_counts_as_intersection, 
+                                                bool use_new_positions )
+{
+    if ( m_mesh.edge_is_deleted( edge_index ) || m_mesh.triangle_is_deleted( triangle_index ) ) { return false; }
+    
+    const Vec2st& edge = m_mesh.m_edges[ edge_index ];
+    const Vec3st& triangle = m_mesh.get_triangle( triangle_index );
+    
+    if (    edge[0] == triangle[0] || edge[0] == triangle[1] || edge[0] == triangle[2] 
+        || edge[1] == triangle[0] || edge[1] == triangle[1] || edge[1] == triangle[2] )
+    {
+        return false;
+    }
+    
+    assert( !triangle_is_all_solid( triangle_index ) || !edge_is_all_solid( edge_index ) );
+    
+    const Vec3d& e0 = use_new_positions ? get_newposition(edge[0]) : get_position(edge[0]);
+    const Vec3d& e1 = use_new_positions ? get_newposition(edge[1]) : get_position(edge[1]);
+    const Vec3d& t0 = use_new_positions ? get_newposition(triangle[0]) : get_position(triangle[0]);
+    const Vec3d& t1 = use_new_positions ? get_newposition(triangle[1]) : get_position(triangle[1]);
+    const Vec3d& t2 = use_new_positions ? get_newposition(triangle[2]) : get_position(triangle[2]);
+    
+    if ( segment_triangle_intersection( e0, edge[0], 
+                                       e1, edge[1],
+                                       t0, triangle[0], 
+                                       t1, triangle[1], 
+                                       t2, triangle[2], 
+                                       degeneracy_counts_as_intersection, m_verbose ) )
+    {
+        std::cout << "intersection: " << edge << " vs " << triangle << std::endl;
+        std::cout << "e0: " << e0 << std::endl;
+        std::cout << "e1: " << e1 << std::endl;
+        std::cout << "t0: " << t0 << std::endl;
+        std::cout << "t1: " << t1 << std::endl;
+        std::cout << "t2: " << t2 << std::endl;            
+        return true;
+    }
+    
+    return false;
+}
+
+// ---------------------------------------------------------
+///
+/// Detect the edge-triangle intersections involving a triangle or an edge incident on one of the given vertices.  Each 
+/// incident triangle is tested against the edges overlapping it in the broad phase, and each incident edge against the 
+/// overlapping triangles.
+///
+// ---------------------------------------------------------
+
+void DynamicSurface::get_intersections_near_vertices( const std::vector<size_t>& vertices,
+                                                     bool degeneracy_counts_as_intersection, 
+                                                     bool use_new_positions, 
+                                                     std::vector<Intersection>& intersections )
+{
+    
+    std::vector<size_t> triangles, edges;
+    for ( size_t i = 0; i < vertices.size(); ++i )
+    {
+        if ( vertices[i] >= m_mesh.m_vertex_to_triangle_map.size() ) { continue; }
+        const std::vector<size_t>& inc_tris = m_mesh.m_vertex_to_triangle_map[ vertices[i] ];
+        const std::vector<size_t>& inc_edges = m_mesh.m_vertex_to_edge_map[ vertices[i] ];
+        triangles.insert( triangles.end(), inc_tris.begin(), inc_tris.end() );
+        edges.insert( edges.end(), inc_edges.begin(), inc_edges.end() );
+    }
+    
+    std::sort( triangles.begin(), triangles.end() );
+    triangles.erase( std::unique( triangles.begin(), triangles.end() ), triangles.end() );
+    std::sort( edges.begin(), edges.end() );
+    edges.erase( std::unique( edges.begin(), edges.end() ), edges.end() );
+    
+    // a pair with both elements incident on the vertices is found from both sides; collect as (edge, triangle) and dedupe
+    std::vector< std::pair<size_t, size_t> > found;
+    std::vector<size_t> candidates;
+    
+    for ( size_t i = 0; i < triangles.size(); ++i )
+    {
+        size_t t = triangles[i];
+        if ( m_mesh.triangle_is_deleted(t) ) { continue; }
+        
+        Vec3d low, high;
+        if ( use_new_positions ) { triangle_continuous_bounds( t, low, high ); }
+        else { triangle_static_bounds( t, low, high ); }
+        
+        candidates.clear();
+        m_broad_phase->get_potential_edge_collisions( low, high, !triangle_is_all_solid(t), true, candidates );
+        
+        for ( size_t j = 0; j < candidates.size(); ++j )
+        {
+            if ( edge_triangle_intersection( candidates[j], t, degeneracy_counts_as_intersection, use_new_positions ) )
+            {
+                found.push_back( std::make_pair( candidates[j], t ) );
+            }
+        }
+    }
+    
+    for ( size_t i = 0; i < edges.size(); ++i )
+    {
+        size_t e = edges[i];
+        if ( m_mesh.edge_is_deleted(e) ) { continue; }
+        
+        Vec3d low, high;
+        if ( use_new_positions ) { edge_continuous_bounds( e, low, high ); }
+        else { edge_static_bounds( e, low, high ); }
+        
+        candidates.clear();
+        m_broad_phase->get_potential_triangle_collisions( low, high, !edge_is_all_solid(e), true, candidates );
+        
+        for ( size_t j = 0; j < candidates.size(); ++j )
+        {
+            if ( edge_triangle_intersection( e, candidates[j], degeneracy_counts_as_intersection, use_new_positions ) )
+            {
+                found.push_back( std::make_pair( e, candidates[j] ) );
+            }
+        }
+    }
+    
+    std::sort( found.begin(), found.end() );
+    found.erase( std::unique( found.begin(), found.end() ), found.end() );
+    
+    for ( size_t i = 0; i < found.size(); ++i )
+    {
+        intersections.push_back( Intersection( found[i].first, found[i].second ) );
+    }
+    
+}
+
+// ---------------------------------------------------------
+///
+/// Get the vertices whose neighbourhood must be verified in the predicted mesh: those moving by more than the 
+/// verification epsilon, and those moved by collision response.
+///
+// ---------------------------------------------------------
+
+void DynamicSurface::get_vertices_needing_predicted_check( const std::vector<Vec3d>& reference_newpositions, 
+                                                          std::vector<size_t>& vertices ) const
+{
+    const double epsilon_squared = m_intersection_check_epsilon * m_intersection_check_epsilon;
+    
+    for ( size_t i = 0; i < get_num_vertices(); ++i )
+    {
+        if ( m_mesh.vertex_is_deleted(i) ) { continue; }
+        
+        const Vec3d& x = get_newposition(i);
+        bool moved = ( m_intersection_check_epsilon > 0.0 ) ? ( mag2( x - get_position(i) ) > epsilon_squared ) 
+                                                            : ( x != get_position(i) );
+        bool touched = i >= reference_newpositions.size() || x != reference_newpositions[i];
+        bool marked = i < m_vertex_needs_intersection_check.size() && m_vertex_needs_intersection_check[i];
+        
+        if ( moved || touched || marked )
+        {
+            vertices.push_back( i );
+        }
+    }
+}
+
+// ---------------------------------------------------------
+///
+/// Get the vertices marked changed since the cursor was last advanced, and advance it.  Returns false if the caller must 
+/// treat every vertex as changed.
+///
+// ---------------------------------------------------------
+
+bool DynamicSurface::get_vertices_changed_since( VertexChangeCursor& cursor, std::vector<size_t>& vertices ) const
+{
+    bool up_to_date = cursor.m_valid && cursor.m_epoch == m_vertex_change_log_epoch;
+    
+    if ( up_to_date )
+    {
+        assert( cursor.m_position <= m_vertex_change_log.size() );
+        vertices.assign( m_vertex_change_log.begin() + cursor.m_position, m_vertex_change_log.end() );
+        std::sort( vertices.begin(), vertices.end() );
+        vertices.erase( std::unique( vertices.begin(), vertices.end() ), vertices.end() );
+        
+        // entries for vertices removed by a defrag are out of range
+        while ( !vertices.empty() && vertices.back() >= get_num_vertices() )
+        {
+            vertices.pop_back();
+        }
+    }
+    
+    cursor.m_epoch = m_vertex_change_log_epoch;
+    cursor.m_position = m_vertex_change_log.size();
+    cursor.m_valid = true;
+    
+    return up_to_date;
+}
+
+// ---------------------------------------------------------
+///
+/// Count a verification, and decide whether it must cover the whole mesh.
+///
+// ---------------------------------------------------------
+
+bool DynamicSurface::full_intersection_check_due()
+{
+    ++m_intersection_check_count;
+    
+    return !m_localized_intersection_checks 
+        || m_full_intersection_check_pending
+        || ( m_full_intersection_check_interval > 0 && m_intersection_check_count % m_full_intersection_check_interval == 0 );
+}
+
 // ---------------------------------------------------------
 ///
 /// Fire an assert if any edge is intersecting any triangles
@@ -1751,6 +2007,51 @@ void DynamicSurface::assert_mesh_is_intersection_free( bool degeneracy_counts_as
     std::vector<Intersection> intersections;
     get_intersections( degeneracy_counts_as_intersection, false, intersections );
     
+    report_intersections( intersections );
+    
+}
+
+// ---------------------------------------------------------
+///
+/// Fire an assert if any edge is intersecting any triangles, checking only near the vertices marked since the last 
+/// verification unless a full sweep is due.
+///
+// ---------------------------------------------------------
+
+void DynamicSurface::assert_mesh_changes_are_intersection_free( bool degeneracy_counts_as_intersection )
+{
+    
+    if ( full_intersection_check_due() )
+    {
+        assert_mesh_is_intersection_free( degeneracy_counts_as_intersection );
+    }
+    else
+    {
+        std::vector<size_t> vertices;
+        for ( size_t i = 0; i < m_vertex_needs_intersection_check.size(); ++i )
+        {
+            if ( m_vertex_needs_intersection_check[i] ) { vertices.push_back( i ); }
+        }
+        
+        std::vector<Intersection> intersections;
+        get_intersections_near_vertices( vertices, degeneracy_counts_as_intersection, false, intersections );
+        report_intersections( intersections );
+    }
+    
+    m_vertex_needs_intersection_check.assign( m_vertex_needs_intersection_check.size(), 0 );
+    m_full_intersection_check_pending = false;
+    
+}
+
+// ---------------------------------------------------------
+///
+/// Print the given intersections of the current mesh, and fire an assert if there are any.
+///
+// ---------------------------------------------------------
+
+void DynamicSurface::report_intersections( const std::vector<Intersection>& intersections )
+{
+    
     for ( size_t i = 0; i < intersections.size(); ++i )
     {
         
@@ -17,6 +17,7 @@
 // Nested includes
 // ---------------------------------------------------------
 
+#include <broadphase.h>
 #include <ccd_wrapper.h>
 #include <nondestructivetrimesh.h>
 #include <limits>
@@ -27,9 +28,6 @@
 
 namespace ElTopo {
 
-// Broad-phase collision detector.  Avoids performing collision detection between far-away primitives.
-class BroadPhase;
-
 // Class for encapsulating all collision detection and resolution functionality.
 class CollisionPipeline;
 
@@ -65,6 +63,43 @@ struct Intersection
 };
 
 
+// --------------------------------------------------------
+///
+/// Read position in DynamicSurface's log of changed vertices.  Each consumer of the log (e.g. an incremental mesh 
+/// improvement pass) keeps its own cursor.
+///
+// --------------------------------------------------------
+
+struct VertexChangeCursor
+{
+    
+    /// Constructor.  A fresh cursor reports the whole mesh as changed on first use.
+    ///
+    VertexChangeCursor() :
+    m_epoch( 0 ),
+    m_position( 0 ),
+    m_valid( false )
+    {}
+    
+    /// Report the whole mesh as changed on next use, e.g. because the criteria applied by the consumer changed
+    ///
+    void invalidate() { m_valid = false; }
+    
+    /// Log epoch at the time the cursor was last advanced
+    ///
+    unsigned int m_epoch;
+    
+    /// Number of log entries already read
+    ///
+    size_t m_position;
+    
+    /// Whether m_epoch and m_position refer to the current log
+    ///
+    bool m_valid;
+    
+};
+
+
 // --------------------------------------------------------
 ///
 /// A surface mesh.  Essentially consists of a NonDestructiveTriMesh object coupled with a set of vertex locations in 3D space.
@@ -250,6 +285,11 @@ public:
     // Broad phase collision detector
     //
     
+    /// Replace the broad phase object with one of the given type (BROAD_PHASE_GRID by default).  The new broad phase is 
+    /// empty until it is next rebuilt.
+    ///
+    void set_broad_phase_type( BroadPhaseType type );
+    
     /// Delete and rebuild the broad phase object, using AABBs defined from m_positions.
     ///
     void rebuild_static_broad_phase( );
@@ -353,6 +393,41 @@ public:
     ///
     void assert_predicted_mesh_is_intersection_free( bool degeneracy_counts_as_intersection ); 
 
+    /// Get the self-intersections involving a triangle or edge incident on one of the given vertices.  Intersections between
+    /// elements that touch none of these vertices are not reported.
+    ///
+    void get_intersections_near_vertices( const std::vector<size_t>& vertices,
+                                         bool degeneracy_counts_as_intersection, 
+                                         bool use_new_positions, 
+                                         std::vector<Intersection>& intersections );
+    
+    /// Fire an assert if the mesh contains a self-intersection, using m_positions.  In localized mode only the neighbourhoods 
+    /// of the vertices marked since the last verification are checked; otherwise, or when a periodic full sweep is due, the 
+    /// whole mesh is checked.  Clears the marks.
+    ///
+    void assert_mesh_changes_are_intersection_free( bool degeneracy_counts_as_intersection );
+    
+    /// Record that a vertex moved or that its incident triangles changed, so that the next intersection verification and 
+    /// incremental mesh improvement revisit its neighbourhood.
+    ///
+    inline void mark_vertex_changed( size_t index );
+    
+    /// Get the vertices marked changed since the cursor was last advanced, sorted and without duplicates, and advance it.  
+    /// Returns false if the cursor is fresh or the change log was discarded since, in which case the caller must treat every 
+    /// vertex as changed.
+    ///
+    bool get_vertices_changed_since( VertexChangeCursor& cursor, std::vector<size_t>& vertices ) const;
+    
+    /// Discard the change log: every cursor will report the whole mesh as changed.
+    ///
+    inline void discard_vertex_change_log();
+    
+    /// Get the vertices that moved by more than m_intersection_check_epsilon between m_positions and m_newpositions, or whose 
+    /// predicted position no longer matches reference_newpositions (i.e. was changed by collision response).
+    ///
+    void get_vertices_needing_predicted_check( const std::vector<Vec3d>& reference_newpositions, 
+                                              std::vector<size_t>& vertices ) const;
+
     /// Returns the number of vertices in the mesh, including any vertices marked as deleted
     ///
     inline size_t get_num_vertices() const;
@@ -477,6 +552,54 @@ public:
     ///
     std::vector<Vec3d> m_velocities;
     
+    /// Whether intersection verification only re-checks the neighbourhoods of vertices that moved, or were touched by 
+    /// collision response or mesh improvement, since the last verification
+    ///
+    bool m_localized_intersection_checks;
+    
+    /// Vertices moving less than this during a time step are not re-checked by localized verification
+    ///
+    double m_intersection_check_epsilon;
+    
+    /// Check the whole mesh on every n-th verification, as a debugging sweep (0 = never)
+    ///
+    unsigned int m_full_intersection_check_interval;
+    
+    /// Vertices flagged for the next localized verification
+    ///
+    std::vector<char> m_vertex_needs_intersection_check;
+    
+    /// Set when positions were replaced wholesale, so that the next verification checks the whole mesh
+    ///
+    bool m_full_intersection_check_pending;
+    
+    /// Vertices passed to mark_vertex_changed, in order, read incrementally through VertexChangeCursors
+    ///
+    std::vector<size_t> m_vertex_change_log;
+    
+    /// Incremented every time m_vertex_change_log is discarded
+    ///
+    unsigned int m_vertex_change_log_epoch;
+    
+private:
+    
+    /// Test one edge against one triangle, skipping pairs that share a vertex
+    ///
+    bool edge_triangle_intersection( size_t edge_index, 
+                                    size_t triangle_index, 
+                                    bool degeneracy_counts_as_intersection, 
+                                    bool use_new_positions );
+    
+    /// Print the given intersections of the current mesh, and fire an assert if there are any
+    ///
+    void report_intersections( const std::vector<Intersection>& intersections );
+    
+    /// Count a verification, and decide whether it must cover the whole mesh
+    ///
+    bool full_intersection_check_due();
+    
+    unsigned int m_intersection_check_count;
+    
 };
 
 
@@ -1031,6 +1154,7 @@ inline void DynamicSurface::set_position( size_t index, const Vec3d& x )
 {
     assert( index < pm_positions.size() );
     pm_positions[index] = x;
+    mark_vertex_changed( index );
     
     // update broad phase
     if ( m_collision_safety )
@@ -1049,6 +1173,8 @@ inline void DynamicSurface::set_all_positions( const std::vector<Vec3d>& xs )
 {
     pm_positions = xs;
     pm_newpositions = xs;
+    m_full_intersection_check_pending = true;
+    discard_vertex_change_log();
     
     // update broad phase
     if ( m_collision_safety )
@@ -1074,6 +1200,8 @@ inline void DynamicSurface::set_all_positions( size_t n, const double* xs )
     }
     
     pm_newpositions = pm_positions;
+    m_full_intersection_check_pending = true;
+    discard_vertex_change_log();
     
     // update broad phase
     if ( m_collision_safety )
@@ -1090,6 +1218,14 @@ inline void DynamicSurface::set_all_positions( size_t n, const double* xs )
 
 inline void DynamicSurface::set_positions_to_newpositions()
 {
+    for ( size_t i = 0; i < pm_positions.size(); ++i )
+    {
+        if ( pm_positions[i] != pm_newpositions[i] )
+        {
+            mark_vertex_changed( i );
+        }
+    }
+    
     pm_positions = pm_newpositions;
     
     if ( m_collision_safety )
@@ -1098,6 +1234,40 @@ inline void DynamicSurface::set_positions_to_newpositions()
     }
 }
 
+// ---------------------------------------------------------
+///
+/// Flag a vertex whose neighbourhood must be checked by the next intersection verification.
+///
+// ---------------------------------------------------------
+
+inline void DynamicSurface::mark_vertex_changed( size_t index )
+{
+    if ( index >= m_vertex_needs_intersection_check.size() )
+    {
+        m_vertex_needs_intersection_check.resize( index + 1, 0 );
+    }
+    m_vertex_needs_intersection_check[index] = 1;
+    
+    // nobody is reading the log fast enough; a full rescan is cheaper than letting it grow
+    if ( m_vertex_change_log.size() > 4 * pm_positions.size() + 1024 )
+    {
+        discard_vertex_change_log();
+    }
+    m_vertex_change_log.push_back( index );
+}
+
+// ---------------------------------------------------------
+///
+/// Discard the change log: every cursor will report the whole mesh as changed.
+///
+// ---------------------------------------------------------
+
+inline void DynamicSurface::discard_vertex_change_log()
+{
+    m_vertex_change_log.clear();
+    ++m_vertex_change_log_epoch;
+}
+
 // ---------------------------------------------------------
 ///
 /// Returns the predicted position of a vertex.
@@ -1072,6 +1072,8 @@ bool EdgeCollapser::edge_is_collapsible( size_t edge_index, double& current_leng
   
   ///////////////////////////////////////////////////////////////////////
   
+  current_length = m_surf.get_edge_length(edge_index);
+
   //try to collapse based on small angles
   size_t vertex_a = m_surf.m_mesh.m_edges[edge_index][0];
   size_t vertex_b = m_surf.m_mesh.m_edges[edge_index][1];
@@ -1089,7 +1091,6 @@ bool EdgeCollapser::edge_is_collapsible( size_t edge_index, double& current_leng
         return true;
   }
 
-  current_length = m_surf.get_edge_length(edge_index);
   if ( m_use_curvature )
   {
 
@@ -1137,6 +1138,19 @@ bool EdgeCollapser::edge_is_collapsible( size_t edge_index, double& current_leng
 }
 
 
+// --------------------------------------------------------
+///
+/// Make the next passes consider every edge
+///
+// --------------------------------------------------------
+
+void EdgeCollapser::invalidate_candidates()
+{
+    m_collapse_cursors[0].invalidate();
+    m_collapse_cursors[1].invalidate();
+}
+
+
 // --------------------------------------------------------
 ///
 /// Collapse all short edges
@@ -1163,11 +1177,15 @@ bool EdgeCollapser::collapse_pass()
     
     
     //
-    // get set of edges to collapse
+    // get set of edges to collapse, among those near vertices changed since the last pass
     //
     
-    for( size_t i = 0; i < m_surf.m_mesh.m_edges.size(); i++ )
+    std::vector<size_t> candidate_edges;
+    m_surf.get_remesh_candidate_edges( m_collapse_cursors[m_surf.m_aggressive_mode ? 1 : 0], candidate_edges );
+    
+    for( size_t ci = 0; ci < candidate_edges.size(); ci++ )
     {    
+        size_t i = candidate_edges[ci];
         double current_length;
         if(edge_is_collapsible(i, current_length)) 
           sortable_edges_to_try.push_back( SortableEdge( i, current_length ) );
@@ -1181,7 +1199,7 @@ bool EdgeCollapser::collapse_pass()
     
     if ( m_surf.m_verbose )
     {
-        std::cout << sortable_edges_to_try.size() << " candidate edges sorted" << std::endl;
+        std::cout << sortable_edges_to_try.size() << " candidate edges sorted, out of " << candidate_edges.size() << " examined" << std::endl;
         std::cout << "total edges: " << m_surf.m_mesh.m_edges.size() << std::endl;
     }
     
@@ -1204,6 +1222,12 @@ bool EdgeCollapser::collapse_pass()
             // clean up degenerate triangles and tets
             m_surf.trim_degeneracies( m_surf.m_dirty_triangles );                        
           }
+          else
+          {
+            // try again next pass
+            m_surf.mark_vertex_changed( m_surf.m_mesh.m_edges[e][0] );
+            m_surf.mark_vertex_changed( m_surf.m_mesh.m_edges[e][1] );
+          }
 
           collapse_occurred |= result;
         }
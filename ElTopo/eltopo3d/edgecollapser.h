@@ -15,6 +15,7 @@
 // ---------------------------------------------------------
 
 #include <cstddef>
+#include <dynamicsurface.h>
 #include <vector>
 #include <vec.h>
 
@@ -79,6 +80,15 @@ public:
   
     /// t1 pull apart distance
     double m_t1_pull_apart_distance;
+    
+    /// Make the next passes consider every edge, e.g. after the collapse criteria changed
+    ///
+    void invalidate_candidates();
+    
+    /// Where the pass stopped reading the surface's vertex change log, in regular (0) and aggressive (1) mode.  Each pass 
+    /// only re-examines edges near vertices changed since then, plus edges it failed to collapse.
+    ///
+    VertexChangeCursor m_collapse_cursors[2];
 
 private:
     
@@ -11,6 +11,7 @@
 
 #include <broadphase.h>
 #include <collisionqueries.h>
+#include <independentedgeset.h>
 #include <nondestructivetrimesh.h>
 #include <runstats.h>
 #include <surftrack.h>
@@ -154,23 +155,25 @@ bool EdgeFlipper::flip_introduces_collision( size_t edge_index,
 
 // --------------------------------------------------------
 ///
-/// Flip an edge: remove the edge and its incident triangles, then add a new edge and two new triangles
+/// Check whether flipping an edge is safe and improves the mesh, without changing the mesh.  If so, return the two 
+/// triangles which would replace the edge's triangles.
 ///
 // --------------------------------------------------------
 
-bool EdgeFlipper::flip_edge( size_t edge, 
-                            size_t tri0, 
-                            size_t tri1, 
-                            size_t third_vertex_0, 
-                            size_t third_vertex_1 )
-{  
-    
-    g_stats.add_to_int( "EdgeFlipper:edge_flip_attempt", 1 );
+bool EdgeFlipper::flip_edge_is_acceptable( size_t edge, 
+                                          size_t tri0, 
+                                          size_t tri1, 
+                                          size_t third_vertex_0, 
+                                          size_t third_vertex_1,
+                                          Vec3st& new_triangle0,
+                                          Vec3st& new_triangle1 )
+{
+  
     
-    NonDestructiveTriMesh& m_mesh = m_surf.m_mesh;
+    const NonDestructiveTriMesh& m_mesh = m_surf.m_mesh;
     const std::vector<Vec3d>& xs = m_surf.get_positions();
     
-    Vec2st& edge_vertices = m_mesh.m_edges[edge];
+    const Vec2st& edge_vertices = m_mesh.m_edges[edge];
     
     // Find the vertices which will form the new edge
     Vec2st new_edge( third_vertex_0, third_vertex_1);
@@ -247,8 +250,8 @@ bool EdgeFlipper::flip_edge( size_t edge,
  
     
     //the new patch has orientations that match each other, for simplicity.
-    Vec3st new_triangle0( new_edge[0], new_edge[1], new_triangle_third_vertex_0 );
-    Vec3st new_triangle1( new_edge[1], new_edge[0], new_triangle_third_vertex_1 );
+    new_triangle0 = Vec3st( new_edge[0], new_edge[1], new_triangle_third_vertex_0 );
+    new_triangle1 = Vec3st( new_edge[1], new_edge[0], new_triangle_third_vertex_1 );
     
     if ( m_surf.m_verbose )
     {
@@ -459,9 +462,25 @@ bool EdgeFlipper::flip_edge( size_t edge,
         return false;
     }
     
-    // --------------
+    return true;
+    
+}
+
+// --------------------------------------------------------
+///
+/// Replace an edge and its two triangles by the dual edge and the given triangles
+///
+// --------------------------------------------------------
+
+void EdgeFlipper::commit_flip( size_t edge, size_t tri0, size_t tri1, const Vec3st& new_triangle0, const Vec3st& new_triangle1 )
+{
     
-    // Okay, now do the actual operation
+    NonDestructiveTriMesh& m_mesh = m_surf.m_mesh;
+    
+    Vec2st& edge_vertices = m_mesh.m_edges[edge];
+    Vec2st new_edge( new_triangle0[0], new_triangle0[1] );
+    Vec3st old_tri0 = m_mesh.get_triangle(tri0);
+    Vec3st old_tri1 = m_mesh.get_triangle(tri1);
     
     // Start history log
     MeshUpdateEvent flip(MeshUpdateEvent::EDGE_FLIP);
@@ -534,7 +553,32 @@ bool EdgeFlipper::flip_edge( size_t edge,
 
     if (m_surf.m_mesheventcallback)
         m_surf.m_mesheventcallback->flip(m_surf, edge);
-  
+    
+}
+
+// --------------------------------------------------------
+///
+/// Flip an edge: remove the edge and its incident triangles, then add a new edge and two new triangles
+///
+// --------------------------------------------------------
+
+bool EdgeFlipper::flip_edge( size_t edge, 
+                            size_t tri0, 
+                            size_t tri1, 
+                            size_t third_vertex_0, 
+                            size_t third_vertex_1 )
+{  
+    
+    g_stats.add_to_int( "EdgeFlipper:edge_flip_attempt", 1 );
+    
+    Vec3st new_triangle0, new_triangle1;
+    if ( !flip_edge_is_acceptable( edge, tri0, tri1, third_vertex_0, third_vertex_1, new_triangle0, new_triangle1 ) )
+    {
+        return false;
+    }
+    
+    commit_flip( edge, tri0, tri1, new_triangle0, new_triangle1 );
+    
     return true;
     
 }
@@ -645,6 +689,308 @@ bool EdgeFlipper::is_Delaunay_anisotropic( size_t edge, size_t tri0, size_t tri1
 }
 
 
+// --------------------------------------------------------
+///
+/// Check whether an edge should be flipped, by the Delaunay or the valence criterion.  If so, return its two incident
+/// triangles and the vertices opposite the edge.
+///
+// --------------------------------------------------------
+
+bool EdgeFlipper::flip_is_required( size_t edge, size_t& triangle_a, size_t& triangle_b, size_t& third_vertex_0, size_t& third_vertex_1 ) const
+{
+    
+    const NonDestructiveTriMesh& m_mesh = m_surf.m_mesh;
+    const std::vector<Vec3d>& xs = m_surf.get_positions();
+    
+    if ( m_mesh.m_edges[edge][0] == m_mesh.m_edges[edge][1] )   { return false; }
+    if ( m_mesh.m_edge_to_triangle_map[edge].size() > 4 || m_mesh.m_edge_to_triangle_map[edge].size() < 2 )   { return false; }
+    
+    if ( m_mesh.m_edge_to_triangle_map[edge].size() == 3) return false; //don't try flipping Y-junction non-manifold edges.
+
+    //if ( m_mesh.m_is_boundary_vertex[ m_mesh.m_edges[edge][0] ] || m_mesh.m_is_boundary_vertex[ m_mesh.m_edges[edge][1] ] )  { return false; }  // skip boundary vertices
+    //NOTE: This check disables flipping on edges where either endpoint is on the boundary.
+    //For cloth/shell-like scenarios this is a problem
+
+    triangle_a = (size_t)~0;
+    triangle_b = (size_t)~0;
+    
+    if ( m_mesh.m_edge_to_triangle_map[edge].size() == 2 )
+    {    
+        triangle_a = m_mesh.m_edge_to_triangle_map[edge][0];
+        triangle_b = m_mesh.m_edge_to_triangle_map[edge][1];         
+        
+        ////////////////////////////////////////////////////////////
+        // FD 20121126
+        // 
+        //  need to consider the case where triangle_a and triangle_b have opposite orientation
+        
+//                assert (    m_mesh.oriented( m_mesh.m_edges[edge][0], m_mesh.m_edges[edge][1], m_mesh.get_triangle(triangle_a) ) 
+//                        != m_mesh.oriented( m_mesh.m_edges[edge][0], m_mesh.m_edges[edge][1], m_mesh.get_triangle(triangle_b) ) );
+        
+        ////////////////////////////////////////////////////////////
+    }
+    else if ( m_mesh.m_edge_to_triangle_map[edge].size() == 4 )  // FD 20121126: Why is flipping allowed in this case?
+    {
+        ////////////////////////////////////////////////////////////
+        // FD 20121126
+        //
+        // non manifold edge: disable flipping
+        // 
+        //
+        return false;
+        
+        ////////////////////////////////////////////////////////////
+
+        triangle_a = m_mesh.m_edge_to_triangle_map[edge][0];
+        
+        // Find first triangle with orientation opposite triangle_a's orientation
+        unsigned int j = 1;
+        for ( ; j < 4; ++j )
+        {
+            triangle_b = m_mesh.m_edge_to_triangle_map[edge][j];
+            if (    m_mesh.oriented( m_mesh.m_edges[edge][0], m_mesh.m_edges[edge][1], m_mesh.get_triangle(triangle_a) ) 
+                != m_mesh.oriented( m_mesh.m_edges[edge][0], m_mesh.m_edges[edge][1], m_mesh.get_triangle(triangle_b) ) )
+            {
+                break;
+            }
+        }
+        assert ( j < 4 );
+    }
+    else
+    {
+        std::cout << m_mesh.m_edge_to_triangle_map[edge].size() << " triangles incident to an edge" << std::endl;
+        assert(0);
+    }
+    
+    //don't flip if one of the faces is all solid
+    if(m_surf.triangle_is_all_solid(triangle_a) || m_surf.triangle_is_all_solid(triangle_b)) {
+      return false;
+    }
+
+    // Don't flip edge on a degenerate/deleted triangles
+    if ( m_mesh.triangle_is_deleted(triangle_a) || m_mesh.triangle_is_deleted(triangle_b) )
+        return false;
+
+    const Vec3st& tri_a = m_mesh.get_triangle( triangle_a );
+    const Vec3st& tri_b = m_mesh.get_triangle( triangle_b );
+
+    third_vertex_0 = m_mesh.get_third_vertex( m_mesh.m_edges[edge][0], m_mesh.m_edges[edge][1], tri_a );
+    third_vertex_1 = m_mesh.get_third_vertex( m_mesh.m_edges[edge][0], m_mesh.m_edges[edge][1], tri_b );
+    
+    if ( third_vertex_0 == third_vertex_1 ) {
+        return false;
+    }
+    
+    size_t vert_0 = m_mesh.m_edges[edge][0];
+    size_t vert_1 = m_mesh.m_edges[edge][1];
+
+    bool flip_required = false;
+
+    if(m_use_Delaunay_criterion) {
+
+       //compute the angles that oppose the edge
+       Vec3d pos_3rd_0 = m_surf.get_position(third_vertex_0);
+       Vec3d pos_3rd_1 = m_surf.get_position(third_vertex_1);
+       Vec3d pos_vert_0 = m_surf.get_position(vert_0);
+       Vec3d pos_vert_1 = m_surf.get_position(vert_1);
+
+       Vec3d off0 = pos_vert_0 - pos_3rd_0;
+       Vec3d off1 = pos_vert_1 - pos_3rd_0;
+       double m0 = mag(off0), m1 = mag(off1);
+       if(m0 == 0 || m1 == 0) return false;
+       double angle0 = acos( dot(off0,off1) / (m0*m1) );
+
+       Vec3d off2 = pos_vert_0 - pos_3rd_1;
+       Vec3d off3 = pos_vert_1 - pos_3rd_1;
+       double m2 = mag(off2), m3 = mag(off3);
+       if(m2 == 0 || m3 == 0) return false;
+       double angle1 = acos( dot(off2, off3) / (m2*m3) );
+
+       if(m_surf.m_aggressive_mode) {
+          //skip any triangles that don't have fairly bad angles.
+          double min_angle = min_triangle_angle(pos_vert_0, pos_vert_1, pos_3rd_0);
+          min_angle = min(min_angle, min_triangle_angle(pos_vert_0, pos_vert_1, pos_3rd_1));
+          if(min_angle > m_surf.m_min_triangle_angle)
+             return false;
+
+          double max_angle = max_triangle_angle(pos_vert_0, pos_vert_1, pos_3rd_0);
+          max_angle = min(max_angle, max_triangle_angle(pos_vert_0, pos_vert_1, pos_3rd_1));
+          if(max_angle < m_surf.m_max_triangle_angle)
+             return false;
+       }
+
+       //if the sum of the opposing angles exceeds 180, then we should flip (according to the Delaunay criterion)
+       //Delaunay apparently maximizes the minimum angle in the triangulation
+       flip_required = angle0 + angle1 > M_PI;
+    }
+    else {
+       //Flip based on valences instead.
+       //per e.g. "A Remeshing Approach to Multiresolution Modeling"
+
+       //Here we treat non-manifold vertices as being on boundaries, and boundaries as boundaries.
+       //so their optimal valence is 4 instead of 6.
+       //See e.g. https://code.google.com/p/stacker/source/browse/trunk/GraphicsLibrary/Remeshing/LaplacianRemesher.h
+
+    
+       int opt_val_a = m_mesh.is_vertex_nonmanifold(third_vertex_0)?4:(m_mesh.m_is_boundary_vertex[third_vertex_0]?4:6), 
+          opt_val_b = m_mesh.is_vertex_nonmanifold(third_vertex_1)?4:(m_mesh.m_is_boundary_vertex[third_vertex_1]?4:6),
+          opt_val_0 = m_mesh.is_vertex_nonmanifold(vert_0)?4:(m_mesh.m_is_boundary_vertex[vert_0]?4:6), 
+          opt_val_1 = m_mesh.is_vertex_nonmanifold(vert_1)?4:(m_mesh.m_is_boundary_vertex[vert_1]?4:6);
+
+       int val_a, val_b, val_0, val_1;
+       Vec2i region_pair = m_mesh.get_triangle_label(triangle_a); //doesn't matter which triangle we consider.
+       val_0 = edge_count_bordering_region_pair(vert_0, region_pair);
+       val_1 = edge_count_bordering_region_pair(vert_1, region_pair);
+       val_a = edge_count_bordering_region_pair(third_vertex_0, region_pair);
+       val_b = edge_count_bordering_region_pair(third_vertex_1, region_pair);
+
+       int score_before = sqr(val_a-opt_val_a) + sqr(val_b-opt_val_b)  + sqr(val_0-opt_val_0) + sqr(val_1-opt_val_1);
+
+       //now work out the valences after
+       val_a++; val_b++;
+       val_0--; val_1--;
+
+       int score_after = sqr(val_a-opt_val_a) + sqr(val_b-opt_val_b)  + sqr(val_0-opt_val_0) + sqr(val_1-opt_val_1);
+       
+       flip_required = score_before > score_after;
+    
+       double current_length = mag( xs[m_mesh.m_edges[edge][1]] - xs[m_mesh.m_edges[edge][0]] );        
+       double potential_length = mag( xs[third_vertex_1] - xs[third_vertex_0] );     
+    }
+    
+    return flip_required;
+    
+}
+
+// --------------------------------------------------------
+///
+/// Flip edges over batches of edges with disjoint stencils.  The flips of a batch are evaluated concurrently, then 
+/// applied in order.  A flip near a region changed earlier in the batch is evaluated again before being applied, since
+/// its collision check may be out of date.
+///
+// --------------------------------------------------------
+
+bool EdgeFlipper::flip_independent_sets( size_t number_of_edges )
+{
+    
+    bool flip_occurred = false;
+    
+    IndependentEdgeSet independent_set( m_surf );
+    
+    std::vector<size_t> pending( number_of_edges );
+    for ( size_t i = 0; i < number_of_edges; ++i )
+    {
+        pending[i] = i;
+    }
+    
+    std::vector<FlipCandidate> candidates;
+    std::vector<char> required;
+    std::vector<size_t> wanted, wanted_edges, batch, deferred;
+    
+    while ( !pending.empty() )
+    {
+        // find the edges which should be flipped
+        
+        int num_pending = (int) pending.size();
+        candidates.resize( num_pending );
+        required.assign( num_pending, 0 );
+        
+#pragma omp parallel for schedule(dynamic, 256)
+        for ( int k = 0; k < num_pending; ++k )
+        {
+            FlipCandidate& c = candidates[k];
+            c.m_edge = pending[k];
+            required[k] = flip_is_required( c.m_edge, c.m_triangle_a, c.m_triangle_b, c.m_third_vertex_0, c.m_third_vertex_1 );
+        }
+        
+        wanted.clear();
+        wanted_edges.clear();
+        for ( int k = 0; k < num_pending; ++k )
+        {
+            if ( required[k] )
+            {
+                wanted.push_back( k );
+                wanted_edges.push_back( candidates[k].m_edge );
+            }
+        }
+        
+        if ( wanted.empty() )
+        {
+            break;
+        }
+        
+        independent_set.select( wanted_edges, batch, deferred );
+        
+        g_stats.add_to_int( "EdgeFlipper:independent_set_batches", 1 );
+        
+        // evaluate the batch
+        
+        int batch_size = (int) batch.size();
+        
+#pragma omp parallel for schedule(dynamic, 16)
+        for ( int b = 0; b < batch_size; ++b )
+        {
+            FlipCandidate& c = candidates[ wanted[ batch[b] ] ];
+            
+            independent_set.get_stencil_bounds( c.m_edge, c.m_low, c.m_high );
+            
+            // feature tests on solid edges call back into the application, so evaluate those when applying the batch
+            c.m_evaluate_serially = m_surf.edge_is_any_solid( c.m_edge );
+            c.m_acceptable = false;
+            
+            if ( !c.m_evaluate_serially )
+            {
+                g_stats.add_to_int( "EdgeFlipper:edge_flip_attempt", 1 );
+                c.m_acceptable = flip_edge_is_acceptable( c.m_edge, c.m_triangle_a, c.m_triangle_b, c.m_third_vertex_0, c.m_third_vertex_1,
+                                                          c.m_new_triangle0, c.m_new_triangle1 );
+            }
+        }
+        
+        // apply it
+        
+        independent_set.clear_changed_regions();
+        
+        for ( int b = 0; b < batch_size; ++b )
+        {
+            const FlipCandidate& c = candidates[ wanted[ batch[b] ] ];
+            
+            bool flipped = false;
+            
+            if ( c.m_evaluate_serially || ( c.m_acceptable && independent_set.overlaps_changed_region( c.m_low, c.m_high ) ) )
+            {
+                if ( !c.m_evaluate_serially )
+                {
+                    g_stats.add_to_int( "EdgeFlipper:independent_set_reevaluations", 1 );
+                }
+                flipped = flip_edge( c.m_edge, c.m_triangle_a, c.m_triangle_b, c.m_third_vertex_0, c.m_third_vertex_1 );
+            }
+            else if ( c.m_acceptable )
+            {
+                commit_flip( c.m_edge, c.m_triangle_a, c.m_triangle_b, c.m_new_triangle0, c.m_new_triangle1 );
+                flipped = true;
+            }
+            
+            if ( flipped )
+            {
+                independent_set.add_changed_region( c.m_low, c.m_high );
+                flip_occurred = true;
+            }
+        }
+        
+        // the deferred edges are looked at again, as the flips may have changed whether they need flipping
+        
+        pending.clear();
+        for ( size_t d = 0; d < deferred.size(); ++d )
+        {
+            pending.push_back( wanted_edges[ deferred[d] ] );
+        }
+    }
+    
+    return flip_occurred;
+    
+}
+
+
 // --------------------------------------------------------
 ///
 /// Flip all non-delaunay edges
@@ -673,7 +1019,6 @@ bool EdgeFlipper::flip_pass( )
     unsigned int num_flip_passes = 0;
     
     NonDestructiveTriMesh& m_mesh = m_surf.m_mesh;
-    const std::vector<Vec3d>& xs = m_surf.get_positions();
     
     //
     // Each "pass" is once over the entire set of edges (ignoring edges created during the current pass)
@@ -692,171 +1037,20 @@ bool EdgeFlipper::flip_pass( )
         
         size_t number_of_edges = m_mesh.m_edges.size();      // don't work on newly created edges
         
-        for( size_t i = 0; i < number_of_edges; i++ )
+        if ( m_surf.m_parallel_edge_operations )
         {
-            if ( m_mesh.m_edges[i][0] == m_mesh.m_edges[i][1] )   { continue; }
-            if ( m_mesh.m_edge_to_triangle_map[i].size() > 4 || m_mesh.m_edge_to_triangle_map[i].size() < 2 )   { continue; }
-            
-            if ( m_mesh.m_edge_to_triangle_map[i].size() == 3) continue; //don't try flipping Y-junction non-manifold edges.
-
-            //if ( m_mesh.m_is_boundary_vertex[ m_mesh.m_edges[i][0] ] || m_mesh.m_is_boundary_vertex[ m_mesh.m_edges[i][1] ] )  { continue; }  // skip boundary vertices
-            //NOTE: This check disables flipping on edges where either endpoint is on the boundary.
-            //For cloth/shell-like scenarios this is a problem
-
-            size_t triangle_a = (size_t)~0, triangle_b =(size_t)~0;
-            
-            if ( m_mesh.m_edge_to_triangle_map[i].size() == 2 )
-            {    
-                triangle_a = m_mesh.m_edge_to_triangle_map[i][0];
-                triangle_b = m_mesh.m_edge_to_triangle_map[i][1];         
-                
-                ////////////////////////////////////////////////////////////
-                // FD 20121126
-                // 
-                //  need to consider the case where triangle_a and triangle_b have opposite orientation
-                
-//                assert (    m_mesh.oriented( m_mesh.m_edges[i][0], m_mesh.m_edges[i][1], m_mesh.get_triangle(triangle_a) ) 
-//                        != m_mesh.oriented( m_mesh.m_edges[i][0], m_mesh.m_edges[i][1], m_mesh.get_triangle(triangle_b) ) );
-                
-                ////////////////////////////////////////////////////////////
-            }
-            else if ( m_mesh.m_edge_to_triangle_map[i].size() == 4 )  // FD 20121126: Why is flipping allowed in this case?
+            flip_occurred = flip_independent_sets( number_of_edges );
+        }
+        else
+        {
+            for( size_t i = 0; i < number_of_edges; i++ )
             {
-                ////////////////////////////////////////////////////////////
-                // FD 20121126
-                //
-                // non manifold edge: disable flipping
-                // 
-                //
-                continue;
-                
-                ////////////////////////////////////////////////////////////
-
-                triangle_a = m_mesh.m_edge_to_triangle_map[i][0];
-                
-                // Find first triangle with orientation opposite triangle_a's orientation
-                unsigned int j = 1;
-                for ( ; j < 4; ++j )
+                size_t triangle_a, triangle_b, third_vertex_0, third_vertex_1;
+                if ( flip_is_required( i, triangle_a, triangle_b, third_vertex_0, third_vertex_1 ) )
                 {
-                    triangle_b = m_mesh.m_edge_to_triangle_map[i][j];
-                    if (    m_mesh.oriented( m_mesh.m_edges[i][0], m_mesh.m_edges[i][1], m_mesh.get_triangle(triangle_a) ) 
-                        != m_mesh.oriented( m_mesh.m_edges[i][0], m_mesh.m_edges[i][1], m_mesh.get_triangle(triangle_b) ) )
-                    {
-                        break;
-                    }
+                    flip_occurred |= flip_edge( i, triangle_a, triangle_b, third_vertex_0, third_vertex_1 );
                 }
-                assert ( j < 4 );
-            }
-            else
-            {
-                std::cout << m_mesh.m_edge_to_triangle_map[i].size() << " triangles incident to an edge" << std::endl;
-                assert(0);
-            }
-            
-            //don't flip if one of the faces is all solid
-            if(m_surf.triangle_is_all_solid(triangle_a) || m_surf.triangle_is_all_solid(triangle_b)) {
-              continue;
-            }
-
-            // Don't flip edge on a degenerate/deleted triangles
-            if ( m_mesh.triangle_is_deleted(triangle_a) || m_mesh.triangle_is_deleted(triangle_b) )
-                continue;
-
-            const Vec3st& tri_a = m_mesh.get_triangle( triangle_a );
-            const Vec3st& tri_b = m_mesh.get_triangle( triangle_b );
-
-            size_t third_vertex_0 = m_mesh.get_third_vertex( m_mesh.m_edges[i][0], m_mesh.m_edges[i][1], tri_a );
-            size_t third_vertex_1 = m_mesh.get_third_vertex( m_mesh.m_edges[i][0], m_mesh.m_edges[i][1], tri_b );
-            
-            if ( third_vertex_0 == third_vertex_1 ) {
-                continue;
             }
-            
-            size_t vert_0 = m_mesh.m_edges[i][0];
-            size_t vert_1 = m_mesh.m_edges[i][1];
-
-            bool flipped = false;
-           
-            bool flip_required = false;
-
-            if(m_use_Delaunay_criterion) {
-
-               //compute the angles that oppose the edge
-               Vec3d pos_3rd_0 = m_surf.get_position(third_vertex_0);
-               Vec3d pos_3rd_1 = m_surf.get_position(third_vertex_1);
-               Vec3d pos_vert_0 = m_surf.get_position(vert_0);
-               Vec3d pos_vert_1 = m_surf.get_position(vert_1);
-
-               Vec3d off0 = pos_vert_0 - pos_3rd_0;
-               Vec3d off1 = pos_vert_1 - pos_3rd_0;
-               double m0 = mag(off0), m1 = mag(off1);
-               if(m0 == 0 || m1 == 0) continue;
-               double angle0 = acos( dot(off0,off1) / (m0*m1) );
-
-               Vec3d off2 = pos_vert_0 - pos_3rd_1;
-               Vec3d off3 = pos_vert_1 - pos_3rd_1;
-               double m2 = mag(off2), m3 = mag(off3);
-               if(m2 == 0 || m3 == 0) continue;
-               double angle1 = acos( dot(off2, off3) / (m2*m3) );
-
-               if(m_surf.m_aggressive_mode) {
-                  //skip any triangles that don't have fairly bad angles.
-                  double min_angle = min_triangle_angle(pos_vert_0, pos_vert_1, pos_3rd_0);
-                  min_angle = min(min_angle, min_triangle_angle(pos_vert_0, pos_vert_1, pos_3rd_1));
-                  if(min_angle > m_surf.m_min_triangle_angle)
-                     continue;
-
-                  double max_angle = max_triangle_angle(pos_vert_0, pos_vert_1, pos_3rd_0);
-                  max_angle = min(max_angle, max_triangle_angle(pos_vert_0, pos_vert_1, pos_3rd_1));
-                  if(max_angle < m_surf.m_max_triangle_angle)
-                     continue;
-               }
-
-               //if the sum of the opposing angles exceeds 180, then we should flip (according to the Delaunay criterion)
-               //Delaunay apparently maximizes the minimum angle in the triangulation
-               flip_required = angle0 + angle1 > M_PI;
-            }
-            else {
-               //Flip based on valences instead.
-               //per e.g. "A Remeshing Approach to Multiresolution Modeling"
-
-               //Here we treat non-manifold vertices as being on boundaries, and boundaries as boundaries.
-               //so their optimal valence is 4 instead of 6.
-               //See e.g. https://code.google.com/p/stacker/source/browse/trunk/GraphicsLibrary/Remeshing/LaplacianRemesher.h
-
-            
-               int opt_val_a = m_mesh.is_vertex_nonmanifold(third_vertex_0)?4:(m_mesh.m_is_boundary_vertex[third_vertex_0]?4:6), 
-                  opt_val_b = m_mesh.is_vertex_nonmanifold(third_vertex_1)?4:(m_mesh.m_is_boundary_vertex[third_vertex_1]?4:6),
-                  opt_val_0 = m_mesh.is_vertex_nonmanifold(vert_0)?4:(m_mesh.m_is_boundary_vertex[vert_0]?4:6), 
-                  opt_val_1 = m_mesh.is_vertex_nonmanifold(vert_1)?4:(m_mesh.m_is_boundary_vertex[vert_1]?4:6);
-
-               int val_a, val_b, val_0, val_1;
-               Vec2i region_pair = m_mesh.get_triangle_label(triangle_a); //doesn't matter which triangle we consider.
-               val_0 = edge_count_bordering_region_pair(vert_0, region_pair);
-               val_1 = edge_count_bordering_region_pair(vert_1, region_pair);
-               val_a = edge_count_bordering_region_pair(third_vertex_0, region_pair);
-               val_b = edge_count_bordering_region_pair(third_vertex_1, region_pair);
-
-               int score_before = sqr(val_a-opt_val_a) + sqr(val_b-opt_val_b)  + sqr(val_0-opt_val_0) + sqr(val_1-opt_val_1);
-
-               //now work out the valences after
-               val_a++; val_b++;
-               val_0--; val_1--;
-
-               int score_after = sqr(val_a-opt_val_a) + sqr(val_b-opt_val_b)  + sqr(val_0-opt_val_0) + sqr(val_1-opt_val_1);
-               
-               flip_required = score_before > score_after;
-            
-               double current_length = mag( xs[m_mesh.m_edges[i][1]] - xs[m_mesh.m_edges[i][0]] );        
-               double potential_length = mag( xs[third_vertex_1] - xs[third_vertex_0] );     
-            }
-            
-            if ( flip_required )
-            {
-                flipped = flip_edge( i, triangle_a, triangle_b, third_vertex_0, third_vertex_1 );            
-            }
-            
-            flip_occurred |= flipped;            
         }
         
         flip_occurred_ever |= flip_occurred;
@@ -872,7 +1066,7 @@ bool EdgeFlipper::flip_pass( )
     
 }
 
-int EdgeFlipper::edge_count_bordering_region_pair(size_t vertex, Vec2i region_pair) {
+int EdgeFlipper::edge_count_bordering_region_pair(size_t vertex, Vec2i region_pair) const {
    int count = 0;
    
    Vec2i flipped_pair(region_pair[1], region_pair[0]);
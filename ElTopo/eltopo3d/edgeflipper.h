@@ -74,10 +74,41 @@ private:
                                    const Vec3st& new_triangle_a, 
                                    const Vec3st& new_triangle_b );
     
+    /// Check whether an edge should be flipped.  If so, return its incident triangles and the vertices opposite the edge.
+    ///
+    bool flip_is_required( size_t edge, size_t& triangle_a, size_t& triangle_b, size_t& third_vertex_0, size_t& third_vertex_1 ) const;
+    
+    /// Check whether flipping an edge is safe and improves the mesh, without changing the mesh, and build the new triangles
+    ///
+    bool flip_edge_is_acceptable( size_t edge, size_t tri0, size_t tri1, size_t third_vertex_0, size_t third_vertex_1,
+                                  Vec3st& new_triangle0, Vec3st& new_triangle1 );
+    
+    /// Replace an edge and its two triangles by the dual edge and the given triangles
+    ///
+    void commit_flip( size_t edge, size_t tri0, size_t tri1, const Vec3st& new_triangle0, const Vec3st& new_triangle1 );
+    
     /// Flip an edge: remove the edge and its incident triangles, then add a new edge and two new triangles
     ///
     bool flip_edge( size_t edge, size_t tri0, size_t tri1, size_t third_vertex_0, size_t third_vertex_1 );
     
+    /// An edge to flip, and what evaluating the flip found
+    ///
+    struct FlipCandidate
+    {
+        size_t m_edge;
+        size_t m_triangle_a, m_triangle_b;
+        size_t m_third_vertex_0, m_third_vertex_1;
+        Vec3st m_new_triangle0, m_new_triangle1;
+        /// Bounds of the edge's stencil
+        Vec3d m_low, m_high;
+        bool m_evaluate_serially;
+        bool m_acceptable;
+    };
+    
+    /// Flip the edges below number_of_edges which need it, evaluating batches of independent flips concurrently
+    ///
+    bool flip_independent_sets( size_t number_of_edges );
+    
     /// Gather the quadric data for a given vertex
     ///
     void getQuadric(size_t vertex, Mat33d& A);
@@ -86,7 +117,7 @@ private:
     ///
     bool is_Delaunay_anisotropic( size_t edge, size_t tri0, size_t tri1, size_t third_vertex_0, size_t third_vertex_1 );
 
-    int edge_count_bordering_region_pair(size_t vertex, Vec2i region_pair);
+    int edge_count_bordering_region_pair(size_t vertex, Vec2i region_pair) const;
 
 };
 
@@ -10,6 +10,7 @@
 #include <edgesplitter.h>
 #include <broadphase.h>
 #include <collisionqueries.h>
+#include <independentedgeset.h>
 #include <runstats.h>
 #include <subdivisionscheme.h>
 #include <surftrack.h>
@@ -350,18 +351,20 @@ bool EdgeSplitter::split_edge_pseudo_motion_introduces_intersection( const Vec3d
 
 // --------------------------------------------------------
 ///
-/// Split an edge, using subdivision_scheme to determine the new vertex location, if safe to do so.
+/// Decide where to put the new vertex splitting an edge, and check that the split is safe and does not make the mesh 
+/// worse, without changing the mesh.
 ///
 // --------------------------------------------------------
 
-bool EdgeSplitter::split_edge( size_t edge, size_t& result_vert, bool ignore_bad_angles, bool use_specified_point, Vec3d const * pos )
-{   
-
-  g_stats.add_to_int( "EdgeSplitter:edge_split_attempts", 1 );
+bool EdgeSplitter::split_edge_is_acceptable( size_t edge, 
+                                            bool ignore_bad_angles, 
+                                            bool use_specified_point, 
+                                            Vec3d const * pos, 
+                                            Vec3d& new_vertex_proposed_final_position, 
+                                            Vec3c& new_vert_solid_label )
+{
 
-  assert( edge_is_splittable(edge) );
-
-  NonDestructiveTriMesh& mesh = m_surf.m_mesh;
+  const NonDestructiveTriMesh& mesh = m_surf.m_mesh;
 
   // --------------
   // Collect all the triangles around the edge
@@ -402,15 +405,13 @@ bool EdgeSplitter::split_edge( size_t edge, size_t& result_vert, bool ignore_bad
   Vec3d new_vertex_constrained_position;
   Vec3d new_vertex_specified_position = use_specified_point? *pos : Vec3d(0,0,0);
   
-  Vec3d new_vertex_proposed_final_position;
-  
   // Track which one we decide on.
   // Smooth point will fall back to midpoint, whereas specified and constrained points simply fail out.
   bool use_smooth_point;
   bool use_average_point;
   bool use_constrained_point;
 
-  Vec3c new_vert_solid_label = Vec3c(false, false, false);
+  new_vert_solid_label = Vec3c(false, false, false);
 
   // Try to decide what point to use
   if(use_specified_point) { 
@@ -654,9 +655,35 @@ bool EdgeSplitter::split_edge( size_t edge, size_t& result_vert, bool ignore_bad
     }
   }
 
-  // --------------
-  
-  // Do the actual splitting
+  return true;
+
+}
+
+// --------------------------------------------------------
+///
+/// Split an edge at the given position, replacing each incident triangle by two
+///
+// --------------------------------------------------------
+
+void EdgeSplitter::commit_split( size_t edge, 
+                                const Vec3d& new_vertex_proposed_final_position, 
+                                const Vec3c& new_vert_solid_label, 
+                                bool ignore_bad_angles, 
+                                bool use_specified_point, 
+                                size_t& result_vert )
+{
+
+  NonDestructiveTriMesh& mesh = m_surf.m_mesh;
+
+  std::vector<size_t> incident_tris = mesh.m_edge_to_triangle_map[edge];
+
+  size_t vertex_a = mesh.m_edges[edge][0];
+  size_t vertex_b = mesh.m_edges[edge][1];
+
+  std::vector<size_t> other_verts;
+  for(size_t i = 0; i < incident_tris.size(); ++i) {
+    other_verts.push_back(mesh.get_third_vertex(vertex_a, vertex_b, mesh.get_triangle(incident_tris[i])));
+  }
 
   Vec3d new_vertex_mass = 0.5 * ( m_surf.m_masses[ vertex_a ] + m_surf.m_masses[ vertex_b ] );
   for (int i = 0; i < 3; i++)
@@ -749,6 +776,31 @@ bool EdgeSplitter::split_edge( size_t edge, size_t& result_vert, bool ignore_bad
   //store the resulting vertex as output.
   result_vert = vertex_e;
 
+}
+
+
+// --------------------------------------------------------
+///
+/// Split an edge, using subdivision_scheme to determine the new vertex location, if safe to do so.
+///
+// --------------------------------------------------------
+
+bool EdgeSplitter::split_edge( size_t edge, size_t& result_vert, bool ignore_bad_angles, bool use_specified_point, Vec3d const * pos )
+{   
+
+  g_stats.add_to_int( "EdgeSplitter:edge_split_attempts", 1 );
+
+  assert( edge_is_splittable(edge) );
+
+  Vec3d new_vertex_position;
+  Vec3c new_vert_solid_label;
+  if ( !split_edge_is_acceptable( edge, ignore_bad_angles, use_specified_point, pos, new_vertex_position, new_vert_solid_label ) )
+  {
+    return false;
+  }
+
+  commit_split( edge, new_vertex_position, new_vert_solid_label, ignore_bad_angles, use_specified_point, result_vert );
+
   return true;
 
 }
@@ -849,8 +901,12 @@ bool EdgeSplitter::large_angle_split_pass()
 
   bool split_occurred = false;
 
-  for ( size_t e = 0; e < mesh.m_edges.size(); ++e )
+  std::vector<size_t> candidate_edges;
+  m_surf.get_remesh_candidate_edges( m_large_angle_cursors[m_surf.m_aggressive_mode ? 1 : 0], candidate_edges );
+  
+  for ( size_t ci = 0; ci < candidate_edges.size(); ++ci )
   {
+    size_t e = candidate_edges[ci];
 
     if ( !edge_is_splittable(e) ) { continue; }
 
@@ -912,6 +968,10 @@ bool EdgeSplitter::large_angle_split_pass()
         else
         {
           g_stats.add_to_int( "EdgeSplitter:large_angle_split_failed", 1 );
+          
+          // try again next pass
+          m_surf.mark_vertex_changed( edge[0] );
+          m_surf.mark_vertex_changed( edge[1] );
         }
 
         split_occurred |= result;
@@ -925,6 +985,165 @@ bool EdgeSplitter::large_angle_split_pass()
 }
 
 
+// --------------------------------------------------------
+///
+/// Make the next passes consider every edge
+///
+// --------------------------------------------------------
+
+void EdgeSplitter::invalidate_candidates()
+{
+    m_split_cursor.invalidate();
+    m_large_angle_cursors[0].invalidate();
+    m_large_angle_cursors[1].invalidate();
+}
+
+
+// --------------------------------------------------------
+///
+/// Split edges over batches of edges with disjoint stencils, going through the given edges in order.  The splits of a 
+/// batch are evaluated concurrently, then applied in order.  A split near a region changed earlier in the batch is 
+/// evaluated again before being applied, since its collision checks may be out of date.
+///
+// --------------------------------------------------------
+
+bool EdgeSplitter::split_independent_sets( const std::vector<size_t>& edges )
+{
+    
+    NonDestructiveTriMesh& mesh = m_surf.m_mesh;
+    
+    bool split_occurred = false;
+    
+    IndependentEdgeSet independent_set( m_surf );
+    
+    const Vec3d padding = m_surf.m_aabb_padding * Vec3d(1,1,1);
+    
+    std::vector<size_t> pending = edges;
+    std::vector<char> required;
+    std::vector<size_t> wanted_edges, batch, deferred;
+    std::vector<SplitCandidate> candidates;
+    
+    while ( !pending.empty() )
+    {
+        // find the edges which should still be split
+        
+        int num_pending = (int) pending.size();
+        required.assign( num_pending, 0 );
+        
+#pragma omp parallel for schedule(dynamic, 256)
+        for ( int k = 0; k < num_pending; ++k )
+        {
+            required[k] = edge_is_splittable( pending[k] ) && edge_length_needs_split( pending[k] );
+        }
+        
+        wanted_edges.clear();
+        for ( int k = 0; k < num_pending; ++k )
+        {
+            if ( required[k] )
+            {
+                wanted_edges.push_back( pending[k] );
+            }
+        }
+        
+        if ( wanted_edges.empty() )
+        {
+            break;
+        }
+        
+        independent_set.select( wanted_edges, batch, deferred );
+        
+        g_stats.add_to_int( "EdgeSplitter:independent_set_batches", 1 );
+        
+        // evaluate the batch
+        
+        int batch_size = (int) batch.size();
+        candidates.resize( batch_size );
+        
+#pragma omp parallel for schedule(dynamic, 16)
+        for ( int b = 0; b < batch_size; ++b )
+        {
+            SplitCandidate& c = candidates[b];
+            c.m_edge = wanted_edges[ batch[b] ];
+            
+            independent_set.get_stencil_bounds( c.m_edge, c.m_low, c.m_high );
+            
+            // constrained vertices call back into the application, so evaluate those splits when applying the batch
+            c.m_evaluate_serially = m_surf.vertex_is_any_solid( mesh.m_edges[c.m_edge][0] ) || 
+                                    m_surf.vertex_is_any_solid( mesh.m_edges[c.m_edge][1] );
+            c.m_acceptable = false;
+            
+            if ( !c.m_evaluate_serially )
+            {
+                g_stats.add_to_int( "EdgeSplitter:edge_split_attempts", 1 );
+                c.m_acceptable = split_edge_is_acceptable( c.m_edge, false, false, NULL, c.m_new_position, c.m_new_solid_label );
+            }
+            
+            if ( c.m_acceptable )
+            {
+                update_minmax( c.m_new_position - padding, c.m_low, c.m_high );
+                update_minmax( c.m_new_position + padding, c.m_low, c.m_high );
+            }
+        }
+        
+        // apply it
+        
+        independent_set.clear_changed_regions();
+        
+        for ( int b = 0; b < batch_size; ++b )
+        {
+            SplitCandidate& c = candidates[b];
+            
+            bool result = false;
+            size_t result_vert;
+            
+            if ( c.m_evaluate_serially || ( c.m_acceptable && independent_set.overlaps_changed_region( c.m_low, c.m_high ) ) )
+            {
+                if ( !c.m_evaluate_serially )
+                {
+                    g_stats.add_to_int( "EdgeSplitter:independent_set_reevaluations", 1 );
+                }
+                
+                result = split_edge( c.m_edge, result_vert );
+                
+                if ( result )
+                {
+                    update_minmax( m_surf.get_position(result_vert) - padding, c.m_low, c.m_high );
+                    update_minmax( m_surf.get_position(result_vert) + padding, c.m_low, c.m_high );
+                }
+            }
+            else if ( c.m_acceptable )
+            {
+                commit_split( c.m_edge, c.m_new_position, c.m_new_solid_label, false, false, result_vert );
+                result = true;
+            }
+            
+            if ( result )
+            {
+                independent_set.add_changed_region( c.m_low, c.m_high );
+                split_occurred = true;
+            }
+            else
+            {
+                // try again next pass
+                m_surf.mark_vertex_changed( mesh.m_edges[c.m_edge][0] );
+                m_surf.mark_vertex_changed( mesh.m_edges[c.m_edge][1] );
+            }
+        }
+        
+        // the deferred edges are looked at again, as the splits may have made them short enough
+        
+        pending.clear();
+        for ( size_t d = 0; d < deferred.size(); ++d )
+        {
+            pending.push_back( wanted_edges[ deferred[d] ] );
+        }
+    }
+    
+    return split_occurred;
+    
+}
+
+
 // --------------------------------------------------------
 ///
 /// Split all long edges
@@ -949,8 +1168,12 @@ bool EdgeSplitter::split_pass()
     
     //only do length-based splitting in regular mode.
     if(!m_surf.m_aggressive_mode) {
-       for( size_t i = 0; i < mesh.m_edges.size(); i++ )
+       std::vector<size_t> candidate_edges;
+       m_surf.get_remesh_candidate_edges( m_split_cursor, candidate_edges );
+       
+       for( size_t ci = 0; ci < candidate_edges.size(); ci++ )
        {    
+           size_t i = candidate_edges[ci];
            if ( !edge_is_splittable(i) ) { continue; }
         
            bool should_split = edge_length_needs_split(i);
@@ -965,6 +1188,18 @@ bool EdgeSplitter::split_pass()
     
        std::sort( sortable_edges_to_try.begin(), sortable_edges_to_try.end() );
     
+       if ( m_surf.m_parallel_edge_operations )
+       {
+          std::vector<size_t> edges_to_try;
+          for ( size_t i = sortable_edges_to_try.size(); i > 0; --i )
+          {
+             edges_to_try.push_back( sortable_edges_to_try[i-1].m_edge_index );
+          }
+          
+          split_occurred = split_independent_sets( edges_to_try );
+          sortable_edges_to_try.clear();
+       }
+       
        std::vector<SortableEdge>::reverse_iterator iter = sortable_edges_to_try.rbegin();
     
        for ( ; iter != sortable_edges_to_try.rend(); ++iter )
@@ -979,6 +1214,13 @@ bool EdgeSplitter::split_pass()
               size_t result_vert;
               bool result = split_edge(longest_edge, result_vert);
 
+              if ( !result )
+              {
+                 // try again next pass
+                 m_surf.mark_vertex_changed( mesh.m_edges[longest_edge][0] );
+                 m_surf.mark_vertex_changed( mesh.m_edges[longest_edge][1] );
+              }
+
               split_occurred |= result;
            }
 
@@ -15,6 +15,7 @@
 // ---------------------------------------------------------
 
 #include <cstddef>
+#include <dynamicsurface.h>
 #include <vector>
 
 // ---------------------------------------------------------
@@ -78,6 +79,19 @@ public:
     /// Whether to perform remeshing on mesh boundary edges (in the case of open surfaces, e.g. sheets)
     ///
     bool m_remesh_boundaries;
+    
+    /// Make the next passes consider every edge, e.g. after the split criteria changed
+    ///
+    void invalidate_candidates();
+    
+    /// Where the length-based pass stopped reading the surface's vertex change log.  Each pass only re-examines edges near 
+    /// vertices changed since then, plus edges it failed to split.
+    ///
+    VertexChangeCursor m_split_cursor;
+    
+    /// Same for the large angle pass, in regular (0) and aggressive (1) mode, since the two use different thresholds
+    ///
+    VertexChangeCursor m_large_angle_cursors[2];
         
 private:
     
@@ -114,6 +128,33 @@ private:
     ///
     bool edge_length_needs_split(size_t edge_index);
 
+    /// Decide where to put the new vertex, and check that the split is safe and acceptable, without changing the mesh
+    ///
+    bool split_edge_is_acceptable( size_t edge, bool ignore_bad_angles, bool use_specified_point, Vec3d const * pos,
+                                   Vec3d& new_vertex_position, Vec3c& new_vert_solid_label );
+    
+    /// Split an edge at the given position
+    ///
+    void commit_split( size_t edge, const Vec3d& new_vertex_position, const Vec3c& new_vert_solid_label,
+                       bool ignore_bad_angles, bool use_specified_point, size_t& result_vert );
+    
+    /// A long edge to split, and what evaluating the split found
+    ///
+    struct SplitCandidate
+    {
+        size_t m_edge;
+        Vec3d m_new_position;
+        Vec3c m_new_solid_label;
+        /// Bounds of the edge's stencil and the new vertex
+        Vec3d m_low, m_high;
+        bool m_evaluate_serially;
+        bool m_acceptable;
+    };
+    
+    /// Split the given edges, in order, evaluating batches of independent splits concurrently
+    ///
+    bool split_independent_sets( const std::vector<size_t>& edges );
+
 public:
     /// Determine if edge should be allowed to be split
     ///    
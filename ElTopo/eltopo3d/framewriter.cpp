@@ -0,0 +1,430 @@
+// ---------------------------------------------------------
+//
+//  framewriter.cpp
+//
+//  Background output of simulation frames: snapshots of the mesh are queued on the simulation thread, and written to
+//  disk by worker threads while the simulation proceeds.
+//
+//  Without pthreads (i.e. when built with MSVC), outputs are written by push() on the calling thread.
+//
+// ---------------------------------------------------------
+
+// ---------------------------------------------------------
+// Includes
+// ---------------------------------------------------------
+
+#include <framewriter.h>
+
+#include <cassert>
+#include <fstream>
+#include <iomesh.h>
+#include <iostream>
+
+// ---------------------------------------------------------
+// Member function definitions
+// ---------------------------------------------------------
+
+namespace ElTopo {
+
+// --------------------------------------------------------
+///
+/// Keep the file contents
+///
+// --------------------------------------------------------
+
+TextFileOutput::TextFileOutput( const std::string& filename, const std::string& contents ) :
+m_filename( filename ),
+m_contents( contents )
+{}
+
+// --------------------------------------------------------
+///
+/// Write the whole contents at once
+///
+// --------------------------------------------------------
+
+bool TextFileOutput::write()
+{
+    std::ofstream file( m_filename.c_str() );
+    file.write( m_contents.data(), m_contents.size() );
+    file.close();
+    return file.good();
+}
+
+// --------------------------------------------------------
+///
+/// Copy the triangles, labels and positions.  The connectivity is not needed to write files, so it is not built.
+///
+// --------------------------------------------------------
+
+MeshFrameOutput::MeshFrameOutput( const NonDestructiveTriMesh& mesh, const std::vector<Vec3d>& positions ) :
+m_mesh(),
+m_positions( positions ),
+m_masses(),
+m_curr_t( 0.0 ),
+m_files()
+{
+    m_mesh.m_tris = mesh.get_triangles();
+    m_mesh.m_triangle_labels = mesh.get_triangle_labels();
+}
+
+// --------------------------------------------------------
+///
+/// Queue a binary file
+///
+// --------------------------------------------------------
+
+void MeshFrameOutput::add_binary_file( const std::vector<double>& masses, double curr_t, const std::string& filename )
+{
+    assert( masses.size() == m_positions.size() );
+
+    m_masses = masses;
+    m_curr_t = curr_t;
+
+    MeshFile file;
+    file.m_kind = MeshFile::BINARY;
+    file.m_filenames.push_back( filename );
+    m_files.push_back( file );
+}
+
+// --------------------------------------------------------
+///
+/// Queue an OBJ file of the whole mesh
+///
+// --------------------------------------------------------
+
+void MeshFrameOutput::add_objfile( const std::string& filename )
+{
+    MeshFile file;
+    file.m_kind = MeshFile::OBJ;
+    file.m_filenames.push_back( filename );
+    m_files.push_back( file );
+}
+
+// --------------------------------------------------------
+///
+/// Queue an OBJ file of one region
+///
+// --------------------------------------------------------
+
+void MeshFrameOutput::add_objfile_per_region( int label, const std::set<int>& excluding_regions, const std::string& filename )
+{
+    MeshFile file;
+    file.m_kind = MeshFile::OBJ_PER_REGION;
+    file.m_filenames.push_back( filename );
+    file.m_label = label;
+    file.m_regions = excluding_regions;
+    m_files.push_back( file );
+}
+
+// --------------------------------------------------------
+///
+/// Queue an OBJ file of the mesh minus some regions
+///
+// --------------------------------------------------------
+
+void MeshFrameOutput::add_objfile_excluding_regions( const std::set<int>& regions, const std::string& filename )
+{
+    MeshFile file;
+    file.m_kind = MeshFile::OBJ_EXCLUDING_REGIONS;
+    file.m_filenames.push_back( filename );
+    file.m_regions = regions;
+    m_files.push_back( file );
+}
+
+// --------------------------------------------------------
+///
+/// Queue one OBJ file per label pair
+///
+// --------------------------------------------------------
+
+void MeshFrameOutput::add_objfiles_per_region_pair( const std::vector<Vec2i>& labels, const std::vector<std::string>& filenames )
+{
+    assert( labels.size() == filenames.size() );
+
+    MeshFile file;
+    file.m_kind = MeshFile::OBJ_PER_REGION_PAIR;
+    file.m_filenames = filenames;
+    file.m_label_pairs = labels;
+    m_files.push_back( file );
+}
+
+// --------------------------------------------------------
+///
+/// Write every queued file from the snapshot.  Filenames are passed as arguments rather than formats, so that they are
+/// used verbatim.
+///
+// --------------------------------------------------------
+
+bool MeshFrameOutput::write()
+{
+    bool all_good = true;
+
+    for ( size_t i = 0; i < m_files.size(); ++i )
+    {
+        const MeshFile& file = m_files[i];
+        bool good = true;
+
+        switch ( file.m_kind )
+        {
+            case MeshFile::BINARY:
+                good = write_binary_file( m_mesh, m_positions, m_masses, m_curr_t, "%s", file.m_filenames[0].c_str() );
+                break;
+            case MeshFile::OBJ:
+                good = write_objfile( m_mesh, m_positions, "%s", file.m_filenames[0].c_str() );
+                break;
+            case MeshFile::OBJ_PER_REGION:
+                good = write_objfile_per_region( m_mesh, m_positions, file.m_label, file.m_regions, "%s", file.m_filenames[0].c_str() );
+                break;
+            case MeshFile::OBJ_EXCLUDING_REGIONS:
+                good = write_objfile_excluding_regions( m_mesh, m_positions, file.m_regions, "%s", file.m_filenames[0].c_str() );
+                break;
+            case MeshFile::OBJ_PER_REGION_PAIR:
+                good = write_objfiles_per_region_pair( m_mesh, m_positions, file.m_label_pairs, file.m_filenames );
+                break;
+        }
+
+        all_good = all_good && good;
+    }
+
+    return all_good;
+}
+
+// --------------------------------------------------------
+///
+/// Set up the queue.  No thread is started until there is something to write.
+///
+// --------------------------------------------------------
+
+AsyncFrameWriter::AsyncFrameWriter( unsigned int num_threads, unsigned int capacity ) :
+m_num_threads( num_threads > 0 ? num_threads : 1 ),
+m_capacity( capacity > 0 ? capacity : 1 ),
+m_num_failed( 0 )
+#ifndef _MSC_VER
+,
+m_queue(),
+m_num_writing( 0 ),
+m_stopping( false ),
+m_threads()
+#endif
+{
+#ifndef _MSC_VER
+    pthread_mutex_init( &m_mutex, NULL );
+    pthread_cond_init( &m_not_empty, NULL );
+    pthread_cond_init( &m_not_full, NULL );
+    pthread_cond_init( &m_idle, NULL );
+#endif
+}
+
+// --------------------------------------------------------
+///
+/// Write everything queued, then stop the workers
+///
+// --------------------------------------------------------
+
+AsyncFrameWriter::~AsyncFrameWriter()
+{
+#ifndef _MSC_VER
+    flush();
+
+    pthread_mutex_lock( &m_mutex );
+    m_stopping = true;
+    pthread_cond_broadcast( &m_not_empty );
+    pthread_mutex_unlock( &m_mutex );
+
+    for ( size_t i = 0; i < m_threads.size(); ++i )
+    {
+        pthread_join( m_threads[i], NULL );
+    }
+
+    pthread_cond_destroy( &m_idle );
+    pthread_cond_destroy( &m_not_full );
+    pthread_cond_destroy( &m_not_empty );
+    pthread_mutex_destroy( &m_mutex );
+#endif
+}
+
+#ifndef _MSC_VER
+
+// --------------------------------------------------------
+///
+/// Wait for room in the queue, then hand the output over to the workers.  If no worker could be started, write it
+/// here instead.
+///
+// --------------------------------------------------------
+
+void AsyncFrameWriter::push( FrameOutput* output )
+{
+    pthread_mutex_lock( &m_mutex );
+
+    start_workers();
+
+    if ( m_threads.empty() )
+    {
+        pthread_mutex_unlock( &m_mutex );
+
+        bool good = output->write();
+        delete output;
+
+        pthread_mutex_lock( &m_mutex );
+        if ( !good ) { ++m_num_failed; }
+        pthread_mutex_unlock( &m_mutex );
+        return;
+    }
+
+    while ( m_queue.size() >= m_capacity )
+    {
+        pthread_cond_wait( &m_not_full, &m_mutex );
+    }
+
+    m_queue.push_back( output );
+    pthread_cond_signal( &m_not_empty );
+
+    pthread_mutex_unlock( &m_mutex );
+}
+
+// --------------------------------------------------------
+///
+/// Wait until the queue is empty and no worker is writing
+///
+// --------------------------------------------------------
+
+void AsyncFrameWriter::flush()
+{
+    pthread_mutex_lock( &m_mutex );
+    while ( !m_queue.empty() || m_num_writing > 0 )
+    {
+        pthread_cond_wait( &m_idle, &m_mutex );
+    }
+    pthread_mutex_unlock( &m_mutex );
+}
+
+// --------------------------------------------------------
+///
+/// Number of failed outputs
+///
+// --------------------------------------------------------
+
+unsigned int AsyncFrameWriter::get_num_failed()
+{
+    pthread_mutex_lock( &m_mutex );
+    unsigned int num_failed = m_num_failed;
+    pthread_mutex_unlock( &m_mutex );
+    return num_failed;
+}
+
+// --------------------------------------------------------
+///
+/// Thread entry point
+///
+// --------------------------------------------------------
+
+void* AsyncFrameWriter::worker_entry( void* writer )
+{
+    static_cast<AsyncFrameWriter*>( writer )->run_worker();
+    return NULL;
+}
+
+// --------------------------------------------------------
+///
+/// Take outputs from the front of the queue and write them, without holding the lock while writing.  Exit once stopped
+/// and the queue is empty.
+///
+// --------------------------------------------------------
+
+void AsyncFrameWriter::run_worker()
+{
+    pthread_mutex_lock( &m_mutex );
+
+    for ( ;; )
+    {
+        while ( m_queue.empty() && !m_stopping )
+        {
+            pthread_cond_wait( &m_not_empty, &m_mutex );
+        }
+
+        if ( m_queue.empty() )
+        {
+            break;
+        }
+
+        FrameOutput* output = m_queue.front();
+        m_queue.pop_front();
+        ++m_num_writing;
+        pthread_cond_signal( &m_not_full );
+
+        pthread_mutex_unlock( &m_mutex );
+
+        bool good = output->write();
+        delete output;
+
+        pthread_mutex_lock( &m_mutex );
+
+        --m_num_writing;
+        if ( !good )
+        {
+            ++m_num_failed;
+            std::cerr << "AsyncFrameWriter: failed to write an output" << std::endl;
+        }
+
+        if ( m_queue.empty() && m_num_writing == 0 )
+        {
+            pthread_cond_broadcast( &m_idle );
+        }
+    }
+
+    pthread_mutex_unlock( &m_mutex );
+}
+
+// --------------------------------------------------------
+///
+/// Start the workers on first use
+///
+// --------------------------------------------------------
+
+void AsyncFrameWriter::start_workers()
+{
+    if ( !m_threads.empty() )
+    {
+        return;
+    }
+
+    for ( unsigned int i = 0; i < m_num_threads; ++i )
+    {
+        pthread_t thread;
+        if ( pthread_create( &thread, NULL, worker_entry, this ) != 0 )
+        {
+            break;
+        }
+        m_threads.push_back( thread );
+    }
+}
+
+#else
+
+// --------------------------------------------------------
+///
+/// Write the output immediately
+///
+// --------------------------------------------------------
+
+void AsyncFrameWriter::push( FrameOutput* output )
+{
+    if ( !output->write() )
+    {
+        ++m_num_failed;
+    }
+    delete output;
+}
+
+void AsyncFrameWriter::flush()
+{}
+
+unsigned int AsyncFrameWriter::get_num_failed()
+{
+    return m_num_failed;
+}
+
+#endif
+
+}
@@ -0,0 +1,230 @@
+// ---------------------------------------------------------
+//
+//  framewriter.h
+//
+//  Background output of simulation frames: snapshots of the mesh are queued on the simulation thread, and written to
+//  disk by worker threads while the simulation proceeds.
+//
+// ---------------------------------------------------------
+
+#ifndef EL_TOPO_FRAMEWRITER_H
+#define EL_TOPO_FRAMEWRITER_H
+
+// ---------------------------------------------------------
+// Nested includes
+// ---------------------------------------------------------
+
+#include <deque>
+#include <nondestructivetrimesh.h>
+#include <set>
+#include <string>
+#include <vec.h>
+#include <vector>
+
+#ifndef _MSC_VER
+#include <pthread.h>
+#endif
+
+// ---------------------------------------------------------
+//  Forwards and typedefs
+// ---------------------------------------------------------
+
+namespace ElTopo {
+
+// ---------------------------------------------------------
+//  Class definitions
+// ---------------------------------------------------------
+
+// --------------------------------------------------------
+///
+/// Output queued on an AsyncFrameWriter.  An output holds copies of all the data it needs, since the simulation moves
+/// on as soon as it is queued.
+///
+// --------------------------------------------------------
+
+class FrameOutput
+{
+
+public:
+
+    virtual ~FrameOutput() {}
+
+    /// Write the output.  Returns false if some file could not be written.
+    ///
+    virtual bool write() = 0;
+
+};
+
+// --------------------------------------------------------
+///
+/// A text file whose contents were generated when it was queued
+///
+// --------------------------------------------------------
+
+class TextFileOutput : public FrameOutput
+{
+
+public:
+
+    TextFileOutput( const std::string& filename, const std::string& contents );
+
+    virtual bool write();
+
+private:
+
+    std::string m_filename;
+    std::string m_contents;
+
+};
+
+// --------------------------------------------------------
+///
+/// Files generated from one state of a triangle mesh.  The triangles, labels and positions are copied on construction;
+/// the files to generate from them are then added, and all written by write(), in the order they were added.
+///
+// --------------------------------------------------------
+
+class MeshFrameOutput : public FrameOutput
+{
+
+public:
+
+    MeshFrameOutput( const NonDestructiveTriMesh& mesh, const std::vector<Vec3d>& positions );
+
+    /// Binary file, as written by write_binary_file
+    ///
+    void add_binary_file( const std::vector<double>& masses, double curr_t, const std::string& filename );
+
+    /// OBJ file of the whole mesh, as written by write_objfile
+    ///
+    void add_objfile( const std::string& filename );
+
+    /// OBJ file of one region, as written by write_objfile_per_region
+    ///
+    void add_objfile_per_region( int label, const std::set<int>& excluding_regions, const std::string& filename );
+
+    /// OBJ file of the mesh minus some regions, as written by write_objfile_excluding_regions
+    ///
+    void add_objfile_excluding_regions( const std::set<int>& regions, const std::string& filename );
+
+    /// One OBJ file per label pair, as written by write_objfiles_per_region_pair
+    ///
+    void add_objfiles_per_region_pair( const std::vector<Vec2i>& labels, const std::vector<std::string>& filenames );
+
+    virtual bool write();
+
+    /// The snapshot.  Only the triangles and labels of the mesh are set: it has no connectivity.
+    ///
+    const NonDestructiveTriMesh& get_mesh() const { return m_mesh; }
+    const std::vector<Vec3d>& get_positions() const { return m_positions; }
+
+private:
+
+    struct MeshFile
+    {
+        enum Kind { BINARY, OBJ, OBJ_PER_REGION, OBJ_EXCLUDING_REGIONS, OBJ_PER_REGION_PAIR };
+
+        Kind m_kind;
+        std::vector<std::string> m_filenames;
+
+        /// Region, or regions to exclude, for the per-region OBJ kinds
+        ///
+        int m_label;
+        std::set<int> m_regions;
+
+        /// Label pairs, for OBJ_PER_REGION_PAIR
+        ///
+        std::vector<Vec2i> m_label_pairs;
+    };
+
+    NonDestructiveTriMesh m_mesh;
+    std::vector<Vec3d> m_positions;
+
+    /// Per-vertex masses and time, for the binary file
+    ///
+    std::vector<double> m_masses;
+    double m_curr_t;
+
+    std::vector<MeshFile> m_files;
+
+};
+
+// --------------------------------------------------------
+///
+/// A bounded queue of outputs, written by a fixed number of worker threads.
+///
+/// push() takes ownership of an output and returns as soon as it is queued.  If the queue is full, push() blocks until
+/// a worker takes an output from it, so a simulation that produces output faster than the disk can take it is slowed
+/// down, rather than accumulating snapshots without bound.  With a single worker, outputs are written in the order they
+/// were queued; with more, outputs may be written concurrently and finish in any order.
+///
+/// Workers are started by the first push().  The destructor writes everything still queued before returning.
+///
+// --------------------------------------------------------
+
+class AsyncFrameWriter
+{
+
+public:
+
+    /// num_threads workers, and at most capacity outputs waiting for a worker
+    ///
+    explicit AsyncFrameWriter( unsigned int num_threads = 1, unsigned int capacity = 2 );
+    ~AsyncFrameWriter();
+
+    /// Queue an output, blocking while the queue is full.  The writer deletes the output once written.
+    ///
+    void push( FrameOutput* output );
+
+    /// Block until every queued output has been written.  Must not be called from an output's write().
+    ///
+    void flush();
+
+    /// Number of outputs whose write() has failed so far
+    ///
+    unsigned int get_num_failed();
+
+private:
+
+    // not copyable
+    AsyncFrameWriter( const AsyncFrameWriter& );
+    AsyncFrameWriter& operator=( const AsyncFrameWriter& );
+
+    unsigned int m_num_threads;
+    unsigned int m_capacity;
+    unsigned int m_num_failed;
+
+#ifndef _MSC_VER
+
+    static void* worker_entry( void* writer );
+
+    /// Write queued outputs until stopped
+    ///
+    void run_worker();
+
+    /// Start the worker threads, if not started yet.  Called with m_mutex held.
+    ///
+    void start_workers();
+
+    std::deque<FrameOutput*> m_queue;
+
+    /// Number of outputs taken from the queue and not yet written
+    ///
+    unsigned int m_num_writing;
+
+    bool m_stopping;
+
+    std::vector<pthread_t> m_threads;
+
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_not_empty;
+    pthread_cond_t m_not_full;
+    pthread_cond_t m_idle;
+
+#endif
+
+};
+
+}
+
+#endif
@@ -14,6 +14,7 @@
 #include <mat.h>
 #include <sparse_matrix.h>
 #include <runstats.h>
+#include <algorithm>
 
 namespace ElTopo {
 
@@ -160,13 +161,72 @@ m_rigid_zone_infinite_mass( 1000.0 )
 {}
 
 
+// ---------------------------------------------------------
+///
+/// Gather the zone vertices, starting from the given velocities and the current predicted positions
+///
+// ---------------------------------------------------------
+
+void ImpactZoneState::init( const ImpactZone& iz, const DynamicSurface& surface, const std::vector<Vec3d>& velocities )
+{
+    iz.get_all_vertices( m_vertices );
+    
+    const size_t n = m_vertices.size();
+    m_sorted_vertices.resize( n );
+    m_velocities.resize( n );
+    m_newpositions.resize( n );
+    
+    for ( size_t i = 0; i < n; ++i )
+    {
+        m_sorted_vertices[i] = std::make_pair( m_vertices[i], i );
+        m_velocities[i] = velocities[m_vertices[i]];
+        m_newpositions[i] = surface.get_newposition( m_vertices[i] );
+    }
+    
+    std::sort( m_sorted_vertices.begin(), m_sorted_vertices.end() );
+}
+
+
+// ---------------------------------------------------------
+///
+/// Position of a mesh vertex in m_vertices
+///
+// ---------------------------------------------------------
+
+size_t ImpactZoneState::local_index( size_t vertex ) const
+{
+    std::vector< std::pair<size_t, size_t> >::const_iterator it = 
+        std::lower_bound( m_sorted_vertices.begin(), m_sorted_vertices.end(), std::make_pair( vertex, (size_t) 0 ) );
+    
+    assert( it != m_sorted_vertices.end() && it->first == vertex );
+    
+    return it->second;
+}
+
+
+// ---------------------------------------------------------
+///
+/// Write the velocities and predicted positions of a solved zone back to the mesh
+///
+// ---------------------------------------------------------
+
+void ImpactZoneSolver::apply_zone_state( const ImpactZoneState& state )
+{
+    for ( size_t i = 0; i < state.m_vertices.size(); ++i )
+    {
+        m_surface.m_velocities[state.m_vertices[i]] = state.m_velocities[i];
+        m_surface.set_newposition( state.m_vertices[i], state.m_newpositions[i] );
+    }
+}
+
+
 // ---------------------------------------------------------
 ///
 /// Iteratively project out relative normal velocities for a set of collisions in an impact zone until all collisions are solved.
 ///
 // ---------------------------------------------------------
 
-bool ImpactZoneSolver::iterated_inelastic_projection( ImpactZone& iz, double dt )
+bool ImpactZoneSolver::iterated_inelastic_projection( ImpactZone& iz, ImpactZoneState& state, double dt )
 {
     assert( m_surface.m_masses.size() == m_surface.get_num_vertices() );
     
@@ -174,7 +234,7 @@ bool ImpactZoneSolver::iterated_inelastic_projection( ImpactZone& iz, double dt
     
     for ( unsigned int i = 0; i < MAX_PROJECTION_ITERATIONS; ++i )
     {
-        bool success = inelastic_projection( iz );
+        bool success = inelastic_projection( iz, state );
         
         if ( !success )
         {
@@ -192,10 +252,13 @@ bool ImpactZoneSolver::iterated_inelastic_projection( ImpactZone& iz, double dt
             Collision& collision = iz.m_collisions[c];
             const Vec4st& vs = collision.m_vertex_indices;
             
-            m_surface.set_newposition( vs[0], m_surface.get_position(vs[0]) + dt * m_surface.m_velocities[vs[0]]);
-            m_surface.set_newposition( vs[1], m_surface.get_position(vs[1]) + dt * m_surface.m_velocities[vs[1]]);
-            m_surface.set_newposition( vs[2], m_surface.get_position(vs[2]) + dt * m_surface.m_velocities[vs[2]]);
-            m_surface.set_newposition( vs[3], m_surface.get_position(vs[3]) + dt * m_surface.m_velocities[vs[3]]);         
+            Vec3d newpositions[4];
+            for ( unsigned int v = 0; v < 4; ++v )
+            {
+                size_t local = state.local_index( vs[v] );
+                state.m_newpositions[local] = m_surface.get_position(vs[v]) + dt * state.m_velocities[local];
+                newpositions[v] = state.m_newpositions[local];
+            }
             
             if ( m_surface.m_verbose ) { std::cout << "checking collision " << vs << std::endl; }
             
@@ -207,10 +270,10 @@ bool ImpactZoneSolver::iterated_inelastic_projection( ImpactZone& iz, double dt
                 
                 assert( vs[0] < vs[1] && vs[2] < vs[3] );       // should have been sorted by original collision detection
                 
-                if ( segment_segment_collision( m_surface.get_position(vs[0]), m_surface.get_newposition(vs[0]), vs[0],
-                                               m_surface.get_position(vs[1]), m_surface.get_newposition(vs[1]), vs[1],
-                                               m_surface.get_position(vs[2]), m_surface.get_newposition(vs[2]), vs[2],
-                                               m_surface.get_position(vs[3]), m_surface.get_newposition(vs[3]), vs[3],
+                if ( segment_segment_collision( m_surface.get_position(vs[0]), newpositions[0], vs[0],
+                                               m_surface.get_position(vs[1]), newpositions[1], vs[1],
+                                               m_surface.get_position(vs[2]), newpositions[2], vs[2],
+                                               m_surface.get_position(vs[3]), newpositions[3], vs[3],
                                                s0, s2,
                                                normal,
                                                rel_disp ) )               
@@ -230,10 +293,10 @@ bool ImpactZoneSolver::iterated_inelastic_projection( ImpactZone& iz, double dt
                 
                 assert( vs[1] < vs[2] && vs[2] < vs[3] && vs[1] < vs[3] );    // should have been sorted by original collision detection
                 
-                if ( point_triangle_collision( m_surface.get_position(vs[0]), m_surface.get_newposition(vs[0]), vs[0],
-                                              m_surface.get_position(vs[1]), m_surface.get_newposition(vs[1]), vs[1],
-                                              m_surface.get_position(vs[2]), m_surface.get_newposition(vs[2]), vs[2],
-                                              m_surface.get_position(vs[3]), m_surface.get_newposition(vs[3]), vs[3],
+                if ( point_triangle_collision( m_surface.get_position(vs[0]), newpositions[0], vs[0],
+                                              m_surface.get_position(vs[1]), newpositions[1], vs[1],
+                                              m_surface.get_position(vs[2]), newpositions[2], vs[2],
+                                              m_surface.get_position(vs[3]), newpositions[3], vs[3],
                                               s1, s2, s3,
                                               normal,
                                               rel_disp ) )                                 
@@ -271,7 +334,7 @@ bool ImpactZoneSolver::iterated_inelastic_projection( ImpactZone& iz, double dt
 ///
 // ---------------------------------------------------------
 
-bool ImpactZoneSolver::inelastic_projection( const ImpactZone& iz )
+bool ImpactZoneSolver::inelastic_projection( const ImpactZone& iz, ImpactZoneState& state )
 {
     
     if ( m_surface.m_verbose )
@@ -281,8 +344,7 @@ bool ImpactZoneSolver::inelastic_projection( const ImpactZone& iz )
     
     const size_t k = iz.m_collisions.size();    // notation from [Harmon et al 2008]: k == number of collisions
     
-    std::vector<size_t> zone_vertices;
-    iz.get_all_vertices( zone_vertices );
+    const std::vector<size_t>& zone_vertices = state.m_vertices;
     
     const size_t n = zone_vertices.size();       // n == number of distinct colliding vertices
     
@@ -302,11 +364,7 @@ bool ImpactZoneSolver::inelastic_projection( const ImpactZone& iz )
             // block row j ( == block column j of grad C )
             size_t j = coll.m_vertex_indices[v];
             
-            std::vector<size_t>::iterator zone_vertex_iter = find( zone_vertices.begin(), zone_vertices.end(), j );
-            
-            assert( zone_vertex_iter != zone_vertices.end() );
-            
-            int mat_j = to_int( zone_vertex_iter - zone_vertices.begin() );
+            int mat_j = to_int( state.local_index( j ) );
             
             GCT(mat_j*3, i) = coll.m_alphas[v] * coll.m_normal[0];
             GCT(mat_j*3+1, i) = coll.m_alphas[v] * coll.m_normal[1];
@@ -327,9 +385,9 @@ bool ImpactZoneSolver::inelastic_projection( const ImpactZone& iz )
         inv_masses.push_back( 1.0 / m_surface.m_masses[zone_vertices[i]][1] );
         inv_masses.push_back( 1.0 / m_surface.m_masses[zone_vertices[i]][2] );
         
-        column_velocities.push_back( m_surface.m_velocities[zone_vertices[i]][0] );
-        column_velocities.push_back( m_surface.m_velocities[zone_vertices[i]][1] );
-        column_velocities.push_back( m_surface.m_velocities[zone_vertices[i]][2] );
+        column_velocities.push_back( state.m_velocities[i][0] );
+        column_velocities.push_back( state.m_velocities[i][1] );
+        column_velocities.push_back( state.m_velocities[i][2] );
     }
     
     //
@@ -393,9 +451,9 @@ bool ImpactZoneSolver::inelastic_projection( const ImpactZone& iz )
     
     for ( size_t i = 0; i < n; ++i )
     {
-        m_surface.m_velocities[zone_vertices[i]][0] = column_velocities[3*i];
-        m_surface.m_velocities[zone_vertices[i]][1] = column_velocities[3*i + 1];
-        m_surface.m_velocities[zone_vertices[i]][2] = column_velocities[3*i + 2];      
+        state.m_velocities[i][0] = column_velocities[3*i];
+        state.m_velocities[i][1] = column_velocities[3*i + 1];
+        state.m_velocities[i][2] = column_velocities[3*i + 2];      
     }
     
     
@@ -455,39 +513,34 @@ bool ImpactZoneSolver::inelastic_impact_zones(double dt)
             assert( false == impact_zones[i].m_all_solved );
         }            
         
-        bool all_zones_solved_ok = true;
+        // solve each impact zone on its own, starting from the pre-response velocities
+        std::vector<ImpactZoneState> zone_states( impact_zones.size() );
+        std::vector<char> zone_solved_ok( impact_zones.size() );
         
-        // for each impact zone
-        for ( size_t i = 0; i < impact_zones.size(); ++i )
+#pragma omp parallel for schedule(dynamic)
+        for ( int i = 0; i < (int) impact_zones.size(); ++i )
         {
-            
-            // reset impact zone to pre-response m_velocities
-            for ( size_t j = 0; j < impact_zones[i].m_collisions.size(); ++j )
-            {
-                const Vec4st& vs = impact_zones[i].m_collisions[j].m_vertex_indices;            
-                m_surface.m_velocities[vs[0]] = old_velocities[vs[0]];
-                m_surface.m_velocities[vs[1]] = old_velocities[vs[1]];
-                m_surface.m_velocities[vs[2]] = old_velocities[vs[2]];
-                m_surface.m_velocities[vs[3]] = old_velocities[vs[3]]; 
-            }
+            ImpactZoneState& state = zone_states[i];
+            state.init( impact_zones[i], m_surface, old_velocities );
             
             // apply inelastic projection
             
-            all_zones_solved_ok &= iterated_inelastic_projection( impact_zones[i], dt );
+            zone_solved_ok[i] = iterated_inelastic_projection( impact_zones[i], state, dt );
             
             // reset predicted positions
-            for ( size_t j = 0; j < impact_zones[i].m_collisions.size(); ++j )
+            for ( size_t j = 0; j < state.m_vertices.size(); ++j )
             {
-                const Vec4st& vs = impact_zones[i].m_collisions[j].m_vertex_indices;            
-                
-                m_surface.set_newposition( vs[0], m_surface.get_position(vs[0]) + dt * m_surface.m_velocities[vs[0]] );
-                m_surface.set_newposition( vs[1], m_surface.get_position(vs[1]) + dt * m_surface.m_velocities[vs[1]] );
-                m_surface.set_newposition( vs[2], m_surface.get_position(vs[2]) + dt * m_surface.m_velocities[vs[2]] );
-                m_surface.set_newposition( vs[3], m_surface.get_position(vs[3]) + dt * m_surface.m_velocities[vs[3]] );
-                
-            } 
-            
-        }  // for IZs
+                state.m_newpositions[j] = m_surface.get_position(state.m_vertices[j]) + dt * state.m_velocities[j];
+            }
+        }
+        
+        // merge in zone order, updating the broad phase on this thread only
+        bool all_zones_solved_ok = true;
+        for ( size_t i = 0; i < impact_zones.size(); ++i )
+        {
+            apply_zone_state( zone_states[i] );
+            all_zones_solved_ok &= ( zone_solved_ok[i] != 0 );
+        }
         
         
         if ( false == all_zones_solved_ok )
@@ -580,15 +633,23 @@ bool ImpactZoneSolver::rigid_impact_zones(double dt)
             assert( false == impact_zones[i].m_all_solved );
         }            
         
-        // for each impact zone
+        // compute the rigid motion of each impact zone on its own
+        std::vector<ImpactZoneState> zone_states( impact_zones.size() );
+        std::vector<char> zone_motion_ok( impact_zones.size() );
+        
+#pragma omp parallel for schedule(dynamic)
+        for ( int i = 0; i < (int) impact_zones.size(); ++i )
+        {
+            zone_states[i].init( impact_zones[i], m_surface, m_surface.m_velocities );
+            zone_motion_ok[i] = calculate_rigid_motion( dt, zone_states[i] );
+        }
+        
+        // merge in zone order, stopping at the first failure like a serial sweep would
         for ( size_t i = 0; i < impact_zones.size(); ++i )
         {
+            apply_zone_state( zone_states[i] );
             
-            std::vector<size_t> zone_vertices;
-            impact_zones[i].get_all_vertices( zone_vertices );
-            bool rigid_motion_ok = calculate_rigid_motion(dt, zone_vertices);
-            
-            if ( !rigid_motion_ok )
+            if ( !zone_motion_ok[i] )
             {
                 std::cout << "rigid impact zone fails" << std::endl;
                 return false;
@@ -627,8 +688,10 @@ bool ImpactZoneSolver::rigid_impact_zones(double dt)
 ///
 // ---------------------------------------------------------
 
-bool ImpactZoneSolver::calculate_rigid_motion(double dt, std::vector<size_t>& vs)
+bool ImpactZoneSolver::calculate_rigid_motion(double dt, ImpactZoneState& state)
 {
+    const std::vector<size_t>& vs = state.m_vertices;
+    
     Vec3d xcm(0,0,0);
     Vec3d vcm(0,0,0);
     double mass = 0;
@@ -648,10 +711,10 @@ bool ImpactZoneSolver::calculate_rigid_motion(double dt, std::vector<size_t>& vs
         
         mass += m;
         
-        m_surface.m_velocities[idx] = ( m_surface.get_newposition(idx) - m_surface.get_position(idx) ) / dt;
+        state.m_velocities[i] = ( state.m_newpositions[i] - m_surface.get_position(idx) ) / dt;
         
         xcm += m * m_surface.get_position(idx);
-        vcm += m * m_surface.m_velocities[idx];
+        vcm += m * state.m_velocities[i];
     }
     
     
@@ -662,7 +725,7 @@ bool ImpactZoneSolver::calculate_rigid_motion(double dt, std::vector<size_t>& vs
         for(size_t j = i+1; j < vs.size(); j++)
         {
             min_dist_t0 = min( min_dist_t0, dist( m_surface.get_position(vs[i]), m_surface.get_position(vs[j]) ) );
-            min_dist_t1 = min( min_dist_t1, dist( m_surface.get_newposition(vs[i]), m_surface.get_newposition(vs[j]) ) );
+            min_dist_t1 = min( min_dist_t1, dist( state.m_newpositions[i], state.m_newpositions[j] ) );
         }
     }
     
@@ -687,7 +750,7 @@ bool ImpactZoneSolver::calculate_rigid_motion(double dt, std::vector<size_t>& vs
         assert( m != std::numeric_limits<double>::infinity() );
         
         Vec3d xdiff = m_surface.get_position(idx) - xcm;
-        Vec3d vdiff = m_surface.m_velocities[idx] - vcm;
+        Vec3d vdiff = state.m_velocities[i] - vcm;
         
         L += m * cross(xdiff, vdiff);
     }
@@ -746,11 +809,11 @@ bool ImpactZoneSolver::calculate_rigid_motion(double dt, std::vector<size_t>& vs
         Vec3d xf = dot(xdiff, wnorm) * wnorm;
         Vec3d xr = xdiff - xf;
         
-        m_surface.set_newposition( idx, xrigid + xf + cosdtw * xr + cross(sindtww, xr) );
+        state.m_newpositions[i] = xrigid + xf + cosdtw * xr + cross(sindtww, xr);
         
-        m_surface.m_velocities[idx] = ( m_surface.get_newposition(idx) - m_surface.get_position(idx) ) / dt;
+        state.m_velocities[i] = ( state.m_newpositions[i] - m_surface.get_position(idx) ) / dt;
         
-        max_velocity_mag = max( max_velocity_mag, mag( m_surface.m_velocities[idx] ) );
+        max_velocity_mag = max( max_velocity_mag, mag( state.m_velocities[i] ) );
         
     }
     
@@ -759,7 +822,7 @@ bool ImpactZoneSolver::calculate_rigid_motion(double dt, std::vector<size_t>& vs
     {
         for(size_t j = i+1; j < vs.size(); j++)
         {
-            min_dist_t1 = min( min_dist_t1, dist( m_surface.get_newposition(vs[i]), m_surface.get_newposition(vs[j]) ) );
+            min_dist_t1 = min( min_dist_t1, dist( state.m_newpositions[i], state.m_newpositions[j] ) );
         }
     }
     
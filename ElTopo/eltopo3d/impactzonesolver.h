@@ -16,6 +16,7 @@
 // ---------------------------------------------------------
 
 #include <collisionpipeline.h>
+#include <utility>
 #include <vector>
 
 // ---------------------------------------------------------
@@ -64,6 +65,36 @@ struct ImpactZone
 };
 
 
+// --------------------------------------------------------
+///
+/// Velocities and predicted positions of the vertices of one impact zone.  Impact zones are vertex-disjoint, so each 
+/// zone is solved into its own state, and the states are written back to the mesh afterwards in zone order.
+///
+// --------------------------------------------------------
+
+struct ImpactZoneState
+{
+    /// Gather the zone vertices, starting from the given velocities and the current predicted positions
+    ///
+    void init( const ImpactZone& iz, const DynamicSurface& surface, const std::vector<Vec3d>& velocities );
+    
+    /// Position of a mesh vertex in m_vertices
+    ///
+    size_t local_index( size_t vertex ) const;
+    
+    /// Zone vertices, in ImpactZone::get_all_vertices order
+    ///
+    std::vector<size_t> m_vertices;
+    
+    /// (vertex, local index) pairs sorted by vertex, for local_index
+    ///
+    std::vector< std::pair<size_t, size_t> > m_sorted_vertices;
+    
+    std::vector<Vec3d> m_velocities;
+    std::vector<Vec3d> m_newpositions;
+};
+
+
 // ---------------------------------------------------------
 ///
 /// Impact zone solver.  Handles inelastic impact zones (Harmon et al. 2008) and rigid impact zones (Bridson et al. 2002).
@@ -90,16 +121,21 @@ public:
 protected:
     
     /// Iteratively project out relative normal velocities for a set of collisions in an impact zone until all collisions are solved.
+    /// Only touches the zone state, so distinct zones can be solved concurrently.
     ///
-    bool iterated_inelastic_projection( ImpactZone& iz, double dt );
+    bool iterated_inelastic_projection( ImpactZone& iz, ImpactZoneState& state, double dt );
     
     /// Project out relative normal velocities for a set of collisions in an impact zone.
     ///
-    bool inelastic_projection( const ImpactZone& iz );
+    bool inelastic_projection( const ImpactZone& iz, ImpactZoneState& state );
+    
+    /// Compute the best-fit rigid motion for the set of moving vertices in the zone state
+    ///
+    bool calculate_rigid_motion(double dt, ImpactZoneState& state);
     
-    /// Compute the best-fit rigid motion for the set of moving vertices
+    /// Write the velocities and predicted positions of a solved zone back to the mesh
     ///
-    bool calculate_rigid_motion(double dt, std::vector<size_t>& vs);
+    void apply_zone_state( const ImpactZoneState& state );
     
     /// The mesh this object operates on
     /// 
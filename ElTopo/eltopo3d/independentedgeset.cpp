@@ -0,0 +1,183 @@
+// ---------------------------------------------------------
+//
+//  independentedgeset.cpp
+//
+//  Selection of edges whose mesh operations do not interact, so that they can be evaluated concurrently.
+//
+// ---------------------------------------------------------
+
+// ---------------------------------------------------------
+// Includes
+// ---------------------------------------------------------
+
+#include <independentedgeset.h>
+
+#include <surftrack.h>
+
+// ---------------------------------------------------------
+// Member function definitions
+// ---------------------------------------------------------
+
+namespace ElTopo {
+
+// --------------------------------------------------------
+///
+/// Create an empty set of batches for the given surface.  Changed regions are hashed on cells of a few edge lengths.
+///
+// --------------------------------------------------------
+
+IndependentEdgeSet::IndependentEdgeSet( const SurfTrack& surf ) :
+m_surf( surf ),
+m_vertex_batch(),
+m_batch( 0 ),
+m_changed_regions(),
+m_num_changed_regions( 0 )
+{
+    double cell_size = 2.0 * surf.get_average_edge_length();
+    if ( !( cell_size > 0.0 ) )
+    {
+        cell_size = 1.0;
+    }
+    m_changed_regions.set( cell_size, Vec3d(0,0,0) );
+}
+
+// --------------------------------------------------------
+///
+/// Collect the vertices of all triangles incident on either edge vertex
+///
+// --------------------------------------------------------
+
+void IndependentEdgeSet::get_stencil( size_t edge, std::vector<size_t>& vertices ) const
+{
+    const NonDestructiveTriMesh& mesh = m_surf.m_mesh;
+
+    vertices.clear();
+
+    for ( unsigned int e = 0; e < 2; ++e )
+    {
+        size_t v = mesh.m_edges[edge][e];
+        vertices.push_back( v );
+
+        const std::vector<size_t>& incident_triangles = mesh.m_vertex_to_triangle_map[v];
+        for ( size_t i = 0; i < incident_triangles.size(); ++i )
+        {
+            const Vec3st& tri = mesh.get_triangle( incident_triangles[i] );
+            vertices.push_back( tri[0] );
+            vertices.push_back( tri[1] );
+            vertices.push_back( tri[2] );
+        }
+    }
+}
+
+// --------------------------------------------------------
+///
+/// Greedily pick, in order, the candidates whose stencils are disjoint from those already picked
+///
+// --------------------------------------------------------
+
+void IndependentEdgeSet::select( const std::vector<size_t>& candidates, std::vector<size_t>& batch, std::vector<size_t>& deferred )
+{
+    batch.clear();
+    deferred.clear();
+
+    // vertices may have been added since the last batch
+    m_vertex_batch.resize( m_surf.get_num_vertices(), 0 );
+    ++m_batch;
+
+    std::vector<size_t> stencil;
+
+    for ( size_t i = 0; i < candidates.size(); ++i )
+    {
+        get_stencil( candidates[i], stencil );
+
+        bool independent = true;
+        for ( size_t j = 0; j < stencil.size(); ++j )
+        {
+            if ( m_vertex_batch[stencil[j]] == m_batch )
+            {
+                independent = false;
+                break;
+            }
+        }
+
+        if ( !independent )
+        {
+            deferred.push_back( i );
+            continue;
+        }
+
+        for ( size_t j = 0; j < stencil.size(); ++j )
+        {
+            m_vertex_batch[stencil[j]] = m_batch;
+        }
+
+        batch.push_back( i );
+    }
+}
+
+// --------------------------------------------------------
+///
+/// Bounding box of an edge's stencil, padded by the surface's AABB padding
+///
+// --------------------------------------------------------
+
+void IndependentEdgeSet::get_stencil_bounds( size_t edge, Vec3d& low, Vec3d& high ) const
+{
+    std::vector<size_t> stencil;
+    get_stencil( edge, stencil );
+
+    low = high = m_surf.get_position( stencil[0] );
+    for ( size_t i = 1; i < stencil.size(); ++i )
+    {
+        update_minmax( m_surf.get_position( stencil[i] ), low, high );
+    }
+
+    low -= m_surf.m_aabb_padding * Vec3d(1,1,1);
+    high += m_surf.m_aabb_padding * Vec3d(1,1,1);
+}
+
+// --------------------------------------------------------
+///
+/// Forget all recorded regions
+///
+// --------------------------------------------------------
+
+void IndependentEdgeSet::clear_changed_regions()
+{
+    if ( m_num_changed_regions > 0 )
+    {
+        m_changed_regions.clear();
+        m_num_changed_regions = 0;
+    }
+}
+
+// --------------------------------------------------------
+///
+/// Record a region changed by an applied operation
+///
+// --------------------------------------------------------
+
+void IndependentEdgeSet::add_changed_region( const Vec3d& low, const Vec3d& high )
+{
+    m_changed_regions.add_element( m_num_changed_regions++, low, high );
+}
+
+// --------------------------------------------------------
+///
+/// Whether the given box overlaps a recorded region
+///
+// --------------------------------------------------------
+
+bool IndependentEdgeSet::overlaps_changed_region( const Vec3d& low, const Vec3d& high ) const
+{
+    if ( m_num_changed_regions == 0 )
+    {
+        return false;
+    }
+
+    std::vector<size_t> overlapping;
+    m_changed_regions.find_overlapping_elements( low, high, overlapping );
+    return !overlapping.empty();
+}
+
+}
@@ -0,0 +1,99 @@
+// ---------------------------------------------------------
+//
+//  independentedgeset.h
+//
+//  Selection of edges whose mesh operations do not interact, so that they can be evaluated concurrently.
+//
+// ---------------------------------------------------------
+
+#ifndef EL_TOPO_INDEPENDENTEDGESET_H
+#define EL_TOPO_INDEPENDENTEDGESET_H
+
+// ---------------------------------------------------------
+// Nested includes
+// ---------------------------------------------------------
+
+#include <spatialhashgrid.h>
+#include <vec.h>
+#include <vector>
+
+// ---------------------------------------------------------
+//  Forwards and typedefs
+// ---------------------------------------------------------
+
+namespace ElTopo {
+
+class SurfTrack;
+
+// ---------------------------------------------------------
+//  Class definitions
+// ---------------------------------------------------------
+
+// --------------------------------------------------------
+///
+/// Batches of edge operations which can be evaluated in parallel and then applied one at a time.
+///
+/// The stencil of an edge is the set of vertices of all triangles incident on either edge vertex.  An operation on the
+/// edge only reads and changes mesh connectivity within its stencil, so the operations in a batch of edges with disjoint
+/// stencils cannot change each other's outcome through connectivity.  They can still interact geometrically, through
+/// the collision-safety checks.  The regions of space changed by applied operations are therefore recorded, and an
+/// operation whose region overlaps one of them has to be evaluated again before being applied.
+///
+// --------------------------------------------------------
+
+class IndependentEdgeSet
+{
+
+public:
+
+    IndependentEdgeSet( const SurfTrack& surf );
+
+    /// Go through the candidate edges in order, and put each edge whose stencil is disjoint from the stencils of the edges
+    /// already in the batch into the batch.  The others are deferred.  Both lists hold positions in candidates, in order.
+    ///
+    void select( const std::vector<size_t>& candidates, std::vector<size_t>& batch, std::vector<size_t>& deferred );
+
+    /// Bounding box of an edge's stencil, padded by the surface's AABB padding
+    ///
+    void get_stencil_bounds( size_t edge, Vec3d& low, Vec3d& high ) const;
+
+    /// Forget all recorded regions
+    ///
+    void clear_changed_regions();
+
+    /// Record a region changed by an applied operation
+    ///
+    void add_changed_region( const Vec3d& low, const Vec3d& high );
+
+    /// Whether the given box overlaps a region recorded since the last call to clear_changed_regions
+    ///
+    bool overlaps_changed_region( const Vec3d& low, const Vec3d& high ) const;
+
+private:
+
+    /// Collect the stencil vertices of an edge (possibly with duplicates)
+    ///
+    void get_stencil( size_t edge, std::vector<size_t>& vertices ) const;
+
+    /// The mesh being operated on
+    ///
+    const SurfTrack& m_surf;
+
+    /// For each vertex, the number of the batch which claimed it last
+    ///
+    std::vector<unsigned int> m_vertex_batch;
+
+    /// Number of the current batch
+    ///
+    unsigned int m_batch;
+
+    /// Regions changed by applied operations
+    ///
+    SpatialHashGrid m_changed_regions;
+    size_t m_num_changed_regions;
+
+};
+
+}
+
+#endif
@@ -10,6 +10,8 @@
 #include <gluvi.h>
 #include <bfstream.h>
 #include <map>
+#include <sstream>
+#include <algorithm>
 
 #define LINESIZE 1024 // maximum line size when reading .OBJ files
 
@@ -695,6 +697,104 @@ bool write_objfile_per_region_pair(const NonDestructiveTriMesh &mesh, const std:
     return output.good();
 }
 
+// ---------------------------------------------------------
+///
+/// Write one OBJ file for each of the given label pairs, containing the triangles between the two regions.  The
+/// triangles are bucketed by label pair in a single pass over the mesh, and the files are then assembled in memory and
+/// written concurrently.  The contents of each file are the same as write_objfile_per_region_pair would produce.
+///
+// ---------------------------------------------------------
+
+bool write_objfiles_per_region_pair(const NonDestructiveTriMesh &mesh, const std::vector<Vec3d> &x, const std::vector<Vec2i> &labels, const std::vector<std::string> &filenames)
+{
+    assert( labels.size() == filenames.size() );
+    
+    // bucket triangles by unordered label pair
+    
+    std::map< std::pair<int,int>, size_t > bucket_of_pair;
+    for(size_t b = 0; b < labels.size(); ++b) {
+        bucket_of_pair[std::make_pair(min(labels[b][0], labels[b][1]), max(labels[b][0], labels[b][1]))] = b;
+    }
+    
+    std::vector< std::vector<size_t> > bucket_tris(labels.size());
+    
+    for(size_t i = 0; i < mesh.m_tris.size(); ++i) {
+        const Vec2i& cur_label = mesh.get_triangle_label(i);
+        std::map< std::pair<int,int>, size_t >::const_iterator it = bucket_of_pair.find(std::make_pair(min(cur_label[0], cur_label[1]), max(cur_label[0], cur_label[1])));
+        if(it != bucket_of_pair.end()) {
+            bucket_tris[it->second].push_back(i);
+        }
+    }
+    
+    bool all_good = true;
+    int num_buckets = (int)labels.size();
+    
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(int b = 0; b < num_buckets; ++b) {
+        const Vec2i& label = labels[b];
+        const std::vector<size_t>& tris = bucket_tris[b];
+        
+        // needed vertices, in increasing order of their index in the whole mesh
+        
+        std::vector<size_t> old_indices;
+        old_indices.reserve(3 * tris.size());
+        for(size_t i = 0; i < tris.size(); ++i) {
+            const Vec3st& tri = mesh.m_tris[tris[i]];
+            for(int j = 0; j < 3; ++j) {
+                old_indices.push_back(tri[j]);
+            }
+        }
+        std::sort(old_indices.begin(), old_indices.end());
+        old_indices.erase(std::unique(old_indices.begin(), old_indices.end()), old_indices.end());
+        
+        std::vector<ElTopo::Vec3d> new_points(old_indices.size());
+        for(size_t i = 0; i < old_indices.size(); ++i) {
+            new_points[i] = x[old_indices[i]];
+        }
+        
+        std::vector<ElTopo::Vec3st> new_tris(tris.size());
+        for(size_t i = 0; i < tris.size(); ++i) {
+            const Vec3st& old_tri = mesh.m_tris[tris[i]];
+            Vec3st new_tri;
+            for(int j = 0; j < 3; ++j) {
+                new_tri[j] = std::lower_bound(old_indices.begin(), old_indices.end(), old_tri[j]) - old_indices.begin();
+            }
+            //swap the orientation depending on which label is on the "front", for good measure.
+            if(mesh.get_triangle_label(tris[i])[1] == label[0])
+                std::swap(new_tri[1], new_tri[2]);
+            new_tris[i] = new_tri;
+        }
+        
+        std::vector<Vec3d> normals;
+        std::vector<Vec3st> normal_indices;
+        generate_normals(new_points, new_tris, normals, normal_indices);
+        
+        std::ostringstream buffer;
+        buffer<<"# generated by VoronoiFluid3D - meeting all your wacky fluid sim needs since 2010"<<'\n';
+        for(unsigned int i=0; i<new_points.size(); ++i)
+            buffer<<"v "<<new_points[i]<<'\n';
+        for(unsigned int i=0; i<normals.size(); ++i)
+            buffer<<"vn "<<normals[i]<<'\n';
+        for(unsigned int t=0; t<new_tris.size(); ++t)
+            buffer<<"f "<<new_tris[t][0]+1<<"//"<<normal_indices[t][0]+1<<" "<<new_tris[t][1]+1<<"//"<<normal_indices[t][1]+1<<" "<<new_tris[t][2]+1<<"//"<<normal_indices[t][2]+1<<'\n'; // correct for 1-based indexing in OBJ files
+        
+        #pragma omp critical(write_objfiles_per_region_pair)
+        std::cout << "Writing " << filenames[b] << std::endl;
+        
+        std::ofstream output(filenames[b].c_str());
+        const std::string& contents = buffer.str();
+        output.write(contents.data(), contents.size());
+        output.close();
+        
+        if(!output.good()) {
+            #pragma omp critical(write_objfiles_per_region_pair)
+            all_good = false;
+        }
+    }
+    
+    return all_good;
+}
+
 bool write_objfile_excluding_regions(const NonDestructiveTriMesh &mesh, const std::vector<Vec3d> &x, const std::set<int> & labels, const char *filename_format, ...)
 {
     va_list ap;
@@ -17,6 +17,7 @@
 #include <vec.h>
 #include <fstream>
 #include <set>
+#include <string>
 
 // ---------------------------------------------------------
 //  Forwards and typedefs
@@ -59,6 +60,7 @@ bool read_objfile(ElTopo::NonDestructiveTriMesh &mesh, std::vector<ElTopo::Vec3d
 bool read_objfile(std::vector<ElTopo::Vec3st> &tris, std::vector<ElTopo::Vec3d> &x, const char *filename_format, ...);
 bool write_objfile_per_region(const ElTopo::NonDestructiveTriMesh &mesh, const std::vector<ElTopo::Vec3d> &x, int label, const std::set<int> & excluding_regions, const char *filename_format, ...);
 bool write_objfile_per_region_pair(const ElTopo::NonDestructiveTriMesh &mesh, const std::vector<ElTopo::Vec3d> &x, ElTopo::Vec2i label, const char *filename_format, ...);
+bool write_objfiles_per_region_pair(const ElTopo::NonDestructiveTriMesh &mesh, const std::vector<ElTopo::Vec3d> &x, const std::vector<ElTopo::Vec2i> &labels, const std::vector<std::string> &filenames);
 bool write_objfile_excluding_regions(const ElTopo::NonDestructiveTriMesh &mesh, const std::vector<ElTopo::Vec3d> &x, const std::set<int> & labels, const char *filename_format, ...);
 // ---------------------------------------------------------
 //
@@ -475,7 +475,7 @@ bool MeshCutter::perform_pull_apart(const std::vector<size_t>& boundary_verts, c
 
   if ( m_surf.m_collision_safety )
   {
-    m_surf.assert_mesh_is_intersection_free(false);
+    m_surf.assert_mesh_changes_are_intersection_free(false);
   }
 
   if ( m_surf.m_verbose ) { std::cout << "pulled apart a vertex" << std::endl; }
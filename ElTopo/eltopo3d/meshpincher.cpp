@@ -236,7 +236,7 @@ bool MeshPincher::pull_apart_vertex( size_t vertex_index, const std::vector< Tri
     
     if ( m_surf.m_collision_safety )
     {
-        m_surf.assert_mesh_is_intersection_free(false);
+        m_surf.assert_mesh_changes_are_intersection_free(false);
     }
     
     if ( m_surf.m_verbose ) { std::cout << "pulled apart a vertex" << std::endl; }
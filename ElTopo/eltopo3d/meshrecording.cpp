@@ -0,0 +1,927 @@
+// ---------------------------------------------------------
+//
+//  meshrecording.cpp
+//
+//  Compact recording of a sequence of triangle mesh states, stored as periodic keyframes and per-step deltas.
+//
+//  All values are stored in native byte order, like the other binary formats written by El Topo.  A stream is laid out
+//  as follows:
+//
+//      stream header:   "ETMR", uint32 version, double position quantum
+//      record header:   char kind ('K' or 'D'), char compressed, int32 step number,
+//                       uint64 log size, uint64 payload size, uint64 stored payload size
+//      record:          record header, log text, stored payload (compressed with block_compress if flagged)
+//      index:           char 'I', uint64 step count, (uint64 offset, uint64 size, int32 step number, char keyframe)
+//                       for each step, then the trailer: uint64 offset of the index, "ETMI"
+//
+//  The index is written when the stream is ended.  Streams without one (e.g. from a crashed run) are indexed by walking
+//  the record headers instead.
+//
+//  Counts and indices in payloads are varints, and signed values are zigzag-encoded varints.
+//
+//      keyframe payload: vertex count, raw positions, triangle count, (vertex indices, labels) for each triangle
+//      delta payload:    vertex count,
+//                        for each vertex of the previous step: the quantized change of each coordinate, or the XOR of
+//                        the old and new coordinate bits if the quantum is zero,
+//                        for each new vertex: the raw position,
+//                        triangle count, number of triangle edits,
+//                        for each edit: index gap since the previous edit, vertex indices, labels
+//
+// ---------------------------------------------------------
+
+// ---------------------------------------------------------
+// Includes
+// ---------------------------------------------------------
+
+#include <meshrecording.h>
+
+#include <algorithm>
+#include <blockcompress.h>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ---------------------------------------------------------
+// Local constants, typedefs, macros
+// ---------------------------------------------------------
+
+namespace {
+
+const char STREAM_MAGIC[4] = { 'E', 'T', 'M', 'R' };
+const uint32_t STREAM_VERSION = 1;
+const size_t STREAM_HEADER_SIZE = 4 + sizeof(uint32_t) + sizeof(double);
+
+const char KEYFRAME = 'K';
+const char DELTA = 'D';
+const size_t RECORD_HEADER_SIZE = 2 + sizeof(int32_t) + 3 * sizeof(uint64_t);
+
+const char INDEX = 'I';
+const char INDEX_MAGIC[4] = { 'E', 'T', 'M', 'I' };
+const size_t INDEX_ENTRY_SIZE = 2 * sizeof(uint64_t) + sizeof(int32_t) + 1;
+const size_t INDEX_TRAILER_SIZE = sizeof(uint64_t) + 4;
+
+/// Quantized changes larger than this (in quanta) are not encoded; a keyframe is written instead
+const double MAX_QUANTIZED_CHANGE = 4.0e18;
+
+// ---------------------------------------------------------
+// Static function definitions
+// ---------------------------------------------------------
+
+inline void put_bytes( const void* data, size_t size, std::vector<unsigned char>& dst )
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>( data );
+    dst.insert( dst.end(), bytes, bytes + size );
+}
+
+inline void put_varint( uint64_t v, std::vector<unsigned char>& dst )
+{
+    while ( v >= 0x80 )
+    {
+        dst.push_back( (unsigned char)( v | 0x80 ) );
+        v >>= 7;
+    }
+    dst.push_back( (unsigned char)v );
+}
+
+inline void put_zigzag( int64_t v, std::vector<unsigned char>& dst )
+{
+    put_varint( ( (uint64_t)v << 1 ) ^ (uint64_t)( v >> 63 ), dst );
+}
+
+inline bool get_bytes( const unsigned char*& p, const unsigned char* end, void* data, size_t size )
+{
+    if ( size > (size_t)( end - p ) ) { return false; }
+    std::memcpy( data, p, size );
+    p += size;
+    return true;
+}
+
+inline bool get_varint( const unsigned char*& p, const unsigned char* end, uint64_t& v )
+{
+    v = 0;
+    for ( unsigned int shift = 0; shift < 64; shift += 7 )
+    {
+        if ( p == end ) { return false; }
+        unsigned char byte = *p++;
+        v |= (uint64_t)( byte & 0x7f ) << shift;
+        if ( !( byte & 0x80 ) ) { return true; }
+    }
+    return false;
+}
+
+inline bool get_zigzag( const unsigned char*& p, const unsigned char* end, int64_t& v )
+{
+    uint64_t u;
+    if ( !get_varint( p, end, u ) ) { return false; }
+    v = (int64_t)( u >> 1 ) ^ -(int64_t)( u & 1 );
+    return true;
+}
+
+inline uint64_t double_bits( double x )
+{
+    uint64_t bits;
+    std::memcpy( &bits, &x, sizeof(bits) );
+    return bits;
+}
+
+inline double bits_double( uint64_t bits )
+{
+    double x;
+    std::memcpy( &x, &bits, sizeof(x) );
+    return x;
+}
+
+/// Reconstruct a coordinate from its previous value and quantized change.  The writer and the reader both go through
+/// this function, so they reconstruct identical values.
+///
+inline double dequantize( double previous, int64_t change, double quantum )
+{
+    return previous + (double)change * quantum;
+}
+
+inline void put_triangle( const ElTopo::Vec3st& tri, const ElTopo::Vec2i& label, std::vector<unsigned char>& dst )
+{
+    put_varint( tri[0], dst );
+    put_varint( tri[1], dst );
+    put_varint( tri[2], dst );
+    put_zigzag( label[0], dst );
+    put_zigzag( label[1], dst );
+}
+
+inline bool get_triangle( const unsigned char*& p, const unsigned char* end, ElTopo::Vec3st& tri, ElTopo::Vec2i& label )
+{
+    uint64_t v[3];
+    int64_t l[2];
+    if ( !get_varint( p, end, v[0] ) || !get_varint( p, end, v[1] ) || !get_varint( p, end, v[2] ) ) { return false; }
+    if ( !get_zigzag( p, end, l[0] ) || !get_zigzag( p, end, l[1] ) ) { return false; }
+    tri = ElTopo::Vec3st( (size_t)v[0], (size_t)v[1], (size_t)v[2] );
+    label = ElTopo::Vec2i( (int)l[0], (int)l[1] );
+    return true;
+}
+
+struct RecordHeader
+{
+    char m_kind;
+    bool m_compressed;
+    int32_t m_step;
+    uint64_t m_log_size;
+    uint64_t m_payload_size;
+    uint64_t m_stored_size;
+};
+
+void write_record_header( const RecordHeader& header, unsigned char* dst )
+{
+    dst[0] = (unsigned char)header.m_kind;
+    dst[1] = header.m_compressed ? 1 : 0;
+    dst += 2;
+    std::memcpy( dst, &header.m_step, sizeof(header.m_step) );
+    dst += sizeof(header.m_step);
+    std::memcpy( dst, &header.m_log_size, sizeof(header.m_log_size) );
+    dst += sizeof(header.m_log_size);
+    std::memcpy( dst, &header.m_payload_size, sizeof(header.m_payload_size) );
+    dst += sizeof(header.m_payload_size);
+    std::memcpy( dst, &header.m_stored_size, sizeof(header.m_stored_size) );
+}
+
+bool read_record_header( const unsigned char* src, RecordHeader& header )
+{
+    header.m_kind = (char)src[0];
+    if ( header.m_kind != KEYFRAME && header.m_kind != DELTA ) { return false; }
+    if ( src[1] > 1 ) { return false; }
+    header.m_compressed = ( src[1] != 0 );
+    src += 2;
+    std::memcpy( &header.m_step, src, sizeof(header.m_step) );
+    src += sizeof(header.m_step);
+    std::memcpy( &header.m_log_size, src, sizeof(header.m_log_size) );
+    src += sizeof(header.m_log_size);
+    std::memcpy( &header.m_payload_size, src, sizeof(header.m_payload_size) );
+    src += sizeof(header.m_payload_size);
+    std::memcpy( &header.m_stored_size, src, sizeof(header.m_stored_size) );
+    if ( !header.m_compressed && header.m_stored_size != header.m_payload_size ) { return false; }
+    return true;
+}
+
+}
+
+// ---------------------------------------------------------
+// Member function definitions
+// ---------------------------------------------------------
+
+namespace ElTopo {
+
+// --------------------------------------------------------
+///
+/// Writer constructor: keyframes every 32 steps, positions recorded exactly, compression on
+///
+// --------------------------------------------------------
+
+MeshRecordingWriter::MeshRecordingWriter() :
+m_keyframe_interval( 32 ),
+m_position_quantum( 0.0 ),
+m_compress( true ),
+m_stream_quantum( 0.0 ),
+m_steps_since_keyframe( 32 ),
+m_stream_size( 0 ),
+m_index(),
+m_previous(),
+m_reconstructed(),
+m_payload(),
+m_record()
+{
+    assert( sizeof(Vec3d) == 3 * sizeof(double) );
+}
+
+// --------------------------------------------------------
+///
+/// Write the stream header.  The next step will be a keyframe.
+///
+// --------------------------------------------------------
+
+void MeshRecordingWriter::begin_stream( std::ostream& os )
+{
+    m_stream_quantum = m_position_quantum;
+    m_steps_since_keyframe = m_keyframe_interval;
+    m_index.clear();
+
+    m_record.clear();
+    put_bytes( STREAM_MAGIC, sizeof(STREAM_MAGIC), m_record );
+    put_bytes( &STREAM_VERSION, sizeof(STREAM_VERSION), m_record );
+    put_bytes( &m_stream_quantum, sizeof(m_stream_quantum), m_record );
+    os.write( (const char*)&m_record[0], m_record.size() );
+
+    m_stream_size = m_record.size();
+}
+
+// --------------------------------------------------------
+///
+/// Write the index of all steps written since begin_stream, and its trailer
+///
+// --------------------------------------------------------
+
+void MeshRecordingWriter::end_stream( std::ostream& os )
+{
+    uint64_t index_offset = m_stream_size;
+    uint64_t num_steps = m_index.size();
+
+    m_record.clear();
+    m_record.push_back( (unsigned char)INDEX );
+    put_bytes( &num_steps, sizeof(num_steps), m_record );
+
+    for ( size_t i = 0; i < m_index.size(); ++i )
+    {
+        const MeshRecordingStep& step = m_index[i];
+        int32_t step_number = step.m_step;
+        put_bytes( &step.m_offset, sizeof(step.m_offset), m_record );
+        put_bytes( &step.m_size, sizeof(step.m_size), m_record );
+        put_bytes( &step_number, sizeof(step_number), m_record );
+        m_record.push_back( step.m_keyframe ? 1 : 0 );
+    }
+
+    put_bytes( &index_offset, sizeof(index_offset), m_record );
+    put_bytes( INDEX_MAGIC, sizeof(INDEX_MAGIC), m_record );
+
+    os.write( (const char*)&m_record[0], m_record.size() );
+
+    m_index.clear();
+    m_stream_size += m_record.size();
+}
+
+// --------------------------------------------------------
+///
+/// Encode the full mesh
+///
+// --------------------------------------------------------
+
+void MeshRecordingWriter::encode_keyframe( const std::vector<Vec3d>& positions, const std::vector<Vec3st>& triangles, const std::vector<Vec2i>& labels )
+{
+    m_payload.clear();
+
+    put_varint( positions.size(), m_payload );
+    if ( !positions.empty() )
+    {
+        put_bytes( &positions[0], positions.size() * sizeof(Vec3d), m_payload );
+    }
+
+    put_varint( triangles.size(), m_payload );
+    for ( size_t i = 0; i < triangles.size(); ++i )
+    {
+        put_triangle( triangles[i], labels[i], m_payload );
+    }
+}
+
+// --------------------------------------------------------
+///
+/// Encode the changes since the previous step
+///
+// --------------------------------------------------------
+
+bool MeshRecordingWriter::encode_delta( const std::vector<Vec3d>& positions, const std::vector<Vec3st>& triangles, const std::vector<Vec2i>& labels )
+{
+    m_payload.clear();
+
+    const std::vector<Vec3d>& previous_positions = m_previous.m_positions;
+    size_t num_shared = std::min( positions.size(), previous_positions.size() );
+
+    m_reconstructed.resize( positions.size() );
+
+    put_varint( positions.size(), m_payload );
+
+    for ( size_t i = 0; i < num_shared; ++i )
+    {
+        for ( unsigned int k = 0; k < 3; ++k )
+        {
+            double previous = previous_positions[i][k];
+            double current = positions[i][k];
+
+            if ( m_stream_quantum > 0.0 )
+            {
+                double change = ( current - previous ) / m_stream_quantum;
+                if ( !( std::fabs( change ) < MAX_QUANTIZED_CHANGE ) )
+                {
+                    return false;
+                }
+                int64_t quantized = (int64_t)std::floor( change + 0.5 );
+                put_zigzag( quantized, m_payload );
+                m_reconstructed[i][k] = dequantize( previous, quantized, m_stream_quantum );
+            }
+            else
+            {
+                put_varint( double_bits( previous ) ^ double_bits( current ), m_payload );
+                m_reconstructed[i][k] = current;
+            }
+        }
+    }
+
+    for ( size_t i = num_shared; i < positions.size(); ++i )
+    {
+        put_bytes( &positions[i], sizeof(Vec3d), m_payload );
+        m_reconstructed[i] = positions[i];
+    }
+
+    const std::vector<Vec3st>& previous_triangles = m_previous.m_triangles;
+    const std::vector<Vec2i>& previous_labels = m_previous.m_labels;
+
+    size_t num_edits = 0;
+    for ( size_t i = 0; i < triangles.size(); ++i )
+    {
+        if ( i >= previous_triangles.size() || triangles[i] != previous_triangles[i] || labels[i] != previous_labels[i] )
+        {
+            ++num_edits;
+        }
+    }
+
+    put_varint( triangles.size(), m_payload );
+    put_varint( num_edits, m_payload );
+
+    size_t next_index = 0;
+    for ( size_t i = 0; i < triangles.size(); ++i )
+    {
+        if ( i >= previous_triangles.size() || triangles[i] != previous_triangles[i] || labels[i] != previous_labels[i] )
+        {
+            put_varint( i - next_index, m_payload );
+            put_triangle( triangles[i], labels[i], m_payload );
+            next_index = i + 1;
+        }
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------
+///
+/// Encode one step as a keyframe or a delta, and write it as a single block
+///
+// --------------------------------------------------------
+
+void MeshRecordingWriter::write_step( std::ostream& os,
+                                      int step,
+                                      const std::string& log,
+                                      const std::vector<Vec3d>& positions,
+                                      const std::vector<Vec3st>& triangles,
+                                      const std::vector<Vec2i>& labels )
+{
+    assert( triangles.size() == labels.size() );
+
+    bool keyframe = ( m_steps_since_keyframe >= m_keyframe_interval );
+
+    if ( !keyframe )
+    {
+        // a delta is worth writing only if it is smaller than the keyframe would be
+        size_t keyframe_size = positions.size() * sizeof(Vec3d) + 5 * triangles.size();
+        keyframe = !encode_delta( positions, triangles, labels ) || m_payload.size() >= keyframe_size;
+    }
+
+    if ( keyframe )
+    {
+        encode_keyframe( positions, triangles, labels );
+        m_previous.m_positions = positions;
+        m_steps_since_keyframe = 1;
+    }
+    else
+    {
+        m_previous.m_positions.swap( m_reconstructed );
+        ++m_steps_since_keyframe;
+    }
+
+    m_previous.m_triangles = triangles;
+    m_previous.m_labels = labels;
+
+    RecordHeader header;
+    header.m_kind = keyframe ? KEYFRAME : DELTA;
+    header.m_compressed = false;
+    header.m_step = step;
+    header.m_log_size = log.size();
+    header.m_payload_size = m_payload.size();
+
+    m_record.resize( RECORD_HEADER_SIZE );
+    m_record.insert( m_record.end(), log.begin(), log.end() );
+
+    size_t payload_start = m_record.size();
+
+    if ( m_compress )
+    {
+        block_compress( &m_payload[0], m_payload.size(), m_record );
+        header.m_compressed = ( m_record.size() - payload_start < m_payload.size() );
+    }
+
+    if ( !header.m_compressed )
+    {
+        m_record.resize( payload_start );
+        m_record.insert( m_record.end(), m_payload.begin(), m_payload.end() );
+    }
+
+    header.m_stored_size = m_record.size() - payload_start;
+    write_record_header( header, &m_record[0] );
+
+    os.write( (const char*)&m_record[0], m_record.size() );
+
+    MeshRecordingStep entry;
+    entry.m_offset = m_stream_size;
+    entry.m_size = m_record.size();
+    entry.m_step = step;
+    entry.m_keyframe = keyframe;
+    m_index.push_back( entry );
+
+    m_stream_size += m_record.size();
+}
+
+// --------------------------------------------------------
+///
+/// Reader constructor
+///
+// --------------------------------------------------------
+
+MeshRecordingReader::MeshRecordingReader() :
+m_stream_quantum( 0.0 ),
+m_current(),
+m_current_index( -1 ),
+m_payload()
+{}
+
+// --------------------------------------------------------
+///
+/// Check the stream header, then load the index if the stream has a valid one, or else walk the record headers to
+/// locate every complete step
+///
+// --------------------------------------------------------
+
+bool MeshRecordingReader::open( const unsigned char* data, size_t size, std::vector<MeshRecordingStep>& steps )
+{
+    steps.clear();
+    m_current_index = -1;
+
+    if ( size < STREAM_HEADER_SIZE )
+    {
+        return false;
+    }
+
+    uint32_t version;
+    std::memcpy( &version, data + 4, sizeof(version) );
+    if ( std::memcmp( data, STREAM_MAGIC, sizeof(STREAM_MAGIC) ) != 0 || version != STREAM_VERSION )
+    {
+        return false;
+    }
+    std::memcpy( &m_stream_quantum, data + 4 + sizeof(version), sizeof(m_stream_quantum) );
+
+    if ( read_index( data, size, steps ) )
+    {
+        return true;
+    }
+
+    steps.clear();
+
+    // a partly written last record (e.g. from a crashed run) is ignored
+    uint64_t offset = STREAM_HEADER_SIZE;
+    while ( size - offset >= RECORD_HEADER_SIZE )
+    {
+        RecordHeader header;
+        if ( !read_record_header( data + offset, header ) )
+        {
+            break;
+        }
+
+        uint64_t record_size = RECORD_HEADER_SIZE + header.m_log_size + header.m_stored_size;
+        if ( header.m_log_size > size || header.m_stored_size > size || record_size > size - offset )
+        {
+            break;
+        }
+
+        MeshRecordingStep step;
+        step.m_offset = offset;
+        step.m_size = record_size;
+        step.m_step = header.m_step;
+        step.m_keyframe = ( header.m_kind == KEYFRAME );
+        steps.push_back( step );
+
+        offset += record_size;
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------
+///
+/// Load the step index from the end of the stream.  Returns false if there is no consistent index.
+///
+// --------------------------------------------------------
+
+bool MeshRecordingReader::read_index( const unsigned char* data, size_t size, std::vector<MeshRecordingStep>& steps ) const
+{
+    if ( size < STREAM_HEADER_SIZE + 1 + sizeof(uint64_t) + INDEX_TRAILER_SIZE )
+    {
+        return false;
+    }
+
+    const unsigned char* trailer = data + size - INDEX_TRAILER_SIZE;
+    if ( std::memcmp( trailer + sizeof(uint64_t), INDEX_MAGIC, sizeof(INDEX_MAGIC) ) != 0 )
+    {
+        return false;
+    }
+
+    uint64_t index_offset;
+    std::memcpy( &index_offset, trailer, sizeof(index_offset) );
+    if ( index_offset < STREAM_HEADER_SIZE || index_offset > size - INDEX_TRAILER_SIZE - 1 - sizeof(uint64_t) )
+    {
+        return false;
+    }
+
+    const unsigned char* p = data + index_offset;
+    uint64_t num_steps;
+    std::memcpy( &num_steps, p + 1, sizeof(num_steps) );
+    uint64_t entries_size = size - INDEX_TRAILER_SIZE - index_offset - 1 - sizeof(uint64_t);
+    if ( *p != (unsigned char)INDEX || num_steps > entries_size / INDEX_ENTRY_SIZE || num_steps * INDEX_ENTRY_SIZE != entries_size )
+    {
+        return false;
+    }
+    p += 1 + sizeof(uint64_t);
+
+    steps.resize( (size_t)num_steps );
+
+    uint64_t expected_offset = STREAM_HEADER_SIZE;
+    for ( size_t i = 0; i < steps.size(); ++i )
+    {
+        MeshRecordingStep& step = steps[i];
+        int32_t step_number;
+        std::memcpy( &step.m_offset, p, sizeof(step.m_offset) );
+        p += sizeof(step.m_offset);
+        std::memcpy( &step.m_size, p, sizeof(step.m_size) );
+        p += sizeof(step.m_size);
+        std::memcpy( &step_number, p, sizeof(step_number) );
+        p += sizeof(step_number);
+        step.m_step = step_number;
+        step.m_keyframe = ( *p++ != 0 );
+
+        // records are contiguous and end where the index begins
+        if ( step.m_offset != expected_offset || step.m_size < RECORD_HEADER_SIZE || step.m_size > index_offset - expected_offset )
+        {
+            return false;
+        }
+        expected_offset += step.m_size;
+    }
+
+    return expected_offset == index_offset;
+}
+
+// --------------------------------------------------------
+///
+/// Decode from the current step if it lies between the target and the keyframe preceding it, otherwise from that
+/// keyframe
+///
+// --------------------------------------------------------
+
+size_t MeshRecordingReader::first_step_to_decode( const std::vector<MeshRecordingStep>& steps, size_t index ) const
+{
+    size_t keyframe = index;
+    while ( keyframe > 0 && !steps[keyframe].m_keyframe )
+    {
+        --keyframe;
+    }
+
+    if ( m_current_index >= (long)keyframe && m_current_index < (long)index )
+    {
+        return (size_t)m_current_index + 1;
+    }
+
+    return keyframe;
+}
+
+// --------------------------------------------------------
+///
+/// Decode steps[index], straight from the stream bytes
+///
+// --------------------------------------------------------
+
+bool MeshRecordingReader::read_step( const unsigned char* data, const std::vector<MeshRecordingStep>& steps, size_t index, std::string& log )
+{
+    if ( index >= steps.size() )
+    {
+        return false;
+    }
+
+    for ( size_t i = first_step_to_decode( steps, index ); i <= index; ++i )
+    {
+        const MeshRecordingStep& step = steps[i];
+
+        if ( !decode_record( data + step.m_offset, (size_t)step.m_size, log ) )
+        {
+            m_current_index = -1;
+            return false;
+        }
+
+        m_current_index = (long)i;
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------
+///
+/// Apply one record to the current mesh
+///
+// --------------------------------------------------------
+
+bool MeshRecordingReader::decode_record( const unsigned char* record, size_t size, std::string& log )
+{
+    RecordHeader header;
+    if ( size < RECORD_HEADER_SIZE || !read_record_header( record, header ) )
+    {
+        return false;
+    }
+
+    if ( header.m_log_size > size - RECORD_HEADER_SIZE || header.m_stored_size != size - RECORD_HEADER_SIZE - header.m_log_size )
+    {
+        return false;
+    }
+
+    const unsigned char* p = record + RECORD_HEADER_SIZE;
+    log.assign( (const char*)p, (size_t)header.m_log_size );
+    p += header.m_log_size;
+
+    if ( header.m_compressed )
+    {
+        m_payload.resize( (size_t)header.m_payload_size );
+        if ( m_payload.empty() || !block_decompress( p, (size_t)header.m_stored_size, &m_payload[0], m_payload.size() ) )
+        {
+            return false;
+        }
+        p = &m_payload[0];
+    }
+
+    const unsigned char* end = p + header.m_payload_size;
+
+    std::vector<Vec3d>& positions = m_current.m_positions;
+    std::vector<Vec3st>& triangles = m_current.m_triangles;
+    std::vector<Vec2i>& labels = m_current.m_labels;
+
+    uint64_t num_vertices;
+    if ( !get_varint( p, end, num_vertices ) )
+    {
+        return false;
+    }
+
+    if ( header.m_kind == KEYFRAME )
+    {
+        if ( num_vertices > (uint64_t)( end - p ) / sizeof(Vec3d) )
+        {
+            return false;
+        }
+
+        positions.resize( (size_t)num_vertices );
+        if ( num_vertices > 0 && !get_bytes( p, end, &positions[0], positions.size() * sizeof(Vec3d) ) )
+        {
+            return false;
+        }
+
+        uint64_t num_triangles;
+        if ( !get_varint( p, end, num_triangles ) || num_triangles > (uint64_t)( end - p ) / 5 )
+        {
+            return false;
+        }
+
+        triangles.resize( (size_t)num_triangles );
+        labels.resize( (size_t)num_triangles );
+        for ( size_t i = 0; i < triangles.size(); ++i )
+        {
+            if ( !get_triangle( p, end, triangles[i], labels[i] ) )
+            {
+                return false;
+            }
+        }
+    }
+    else
+    {
+        if ( m_current_index < 0 )
+        {
+            return false;
+        }
+
+        size_t num_shared = std::min( (size_t)num_vertices, positions.size() );
+        if ( num_vertices - num_shared > (uint64_t)( end - p ) / sizeof(Vec3d) )
+        {
+            return false;
+        }
+
+        positions.resize( (size_t)num_vertices );
+
+        for ( size_t i = 0; i < num_shared; ++i )
+        {
+            for ( unsigned int k = 0; k < 3; ++k )
+            {
+                if ( m_stream_quantum > 0.0 )
+                {
+                    int64_t quantized;
+                    if ( !get_zigzag( p, end, quantized ) ) { return false; }
+                    positions[i][k] = dequantize( positions[i][k], quantized, m_stream_quantum );
+                }
+                else
+                {
+                    uint64_t bits;
+                    if ( !get_varint( p, end, bits ) ) { return false; }
+                    positions[i][k] = bits_double( double_bits( positions[i][k] ) ^ bits );
+                }
+            }
+        }
+
+        for ( size_t i = num_shared; i < positions.size(); ++i )
+        {
+            if ( !get_bytes( p, end, &positions[i], sizeof(Vec3d) ) )
+            {
+                return false;
+            }
+        }
+
+        uint64_t num_triangles, num_edits;
+        if ( !get_varint( p, end, num_triangles ) || !get_varint( p, end, num_edits ) || num_edits > (uint64_t)( end - p ) / 5 )
+        {
+            return false;
+        }
+
+        // every triangle beyond the previous count comes with an edit
+        if ( num_triangles > triangles.size() && num_triangles - triangles.size() > num_edits )
+        {
+            return false;
+        }
+
+        triangles.resize( (size_t)num_triangles );
+        labels.resize( (size_t)num_triangles );
+
+        uint64_t next_index = 0;
+        for ( uint64_t e = 0; e < num_edits; ++e )
+        {
+            uint64_t gap;
+            if ( !get_varint( p, end, gap ) || gap >= num_triangles - next_index )
+            {
+                return false;
+            }
+            size_t i = (size_t)( next_index + gap );
+            if ( !get_triangle( p, end, triangles[i], labels[i] ) )
+            {
+                return false;
+            }
+            next_index = i + 1;
+        }
+    }
+
+    return p == end;
+}
+
+// --------------------------------------------------------
+///
+/// Recording file constructor
+///
+// --------------------------------------------------------
+
+MeshRecordingFile::MeshRecordingFile() :
+m_data( NULL ),
+m_size( 0 ),
+m_buffer(),
+m_steps(),
+m_reader()
+{}
+
+MeshRecordingFile::~MeshRecordingFile()
+{
+    close();
+}
+
+// --------------------------------------------------------
+///
+/// Map the file read-only (or read it whole where mmap is not available), and locate its steps
+///
+// --------------------------------------------------------
+
+bool MeshRecordingFile::open( const std::string& filename )
+{
+    close();
+
+#ifdef _MSC_VER
+
+    std::ifstream file( filename.c_str(), std::ios::binary );
+    if ( !file.is_open() )
+    {
+        return false;
+    }
+
+    file.seekg( 0, std::ios_base::end );
+    m_buffer.resize( (size_t)file.tellg() );
+    file.seekg( 0 );
+
+    if ( m_buffer.empty() || !file.read( (char*)&m_buffer[0], m_buffer.size() ) )
+    {
+        m_buffer.clear();
+        return false;
+    }
+
+    m_data = &m_buffer[0];
+    m_size = m_buffer.size();
+
+#else
+
+    int fd = ::open( filename.c_str(), O_RDONLY );
+    if ( fd < 0 )
+    {
+        return false;
+    }
+
+    struct stat file_stat;
+    if ( fstat( fd, &file_stat ) != 0 || file_stat.st_size <= 0 )
+    {
+        ::close( fd );
+        return false;
+    }
+
+    void* mapped = mmap( NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    ::close( fd );
+
+    if ( mapped == MAP_FAILED )
+    {
+        return false;
+    }
+
+    m_data = static_cast<const unsigned char*>( mapped );
+    m_size = (size_t)file_stat.st_size;
+
+#endif
+
+    if ( !m_reader.open( m_data, m_size, m_steps ) )
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------
+///
+/// Unmap the file
+///
+// --------------------------------------------------------
+
+void MeshRecordingFile::close()
+{
+    if ( m_data == NULL )
+    {
+        return;
+    }
+
+#ifdef _MSC_VER
+    m_buffer.clear();
+#else
+    munmap( const_cast<unsigned char*>( m_data ), m_size );
+#endif
+
+    m_data = NULL;
+    m_size = 0;
+    m_steps.clear();
+}
+
+}
@@ -0,0 +1,279 @@
+// ---------------------------------------------------------
+//
+//  meshrecording.h
+//
+//  Compact recording of a sequence of triangle mesh states, stored as periodic keyframes and per-step deltas.
+//
+// ---------------------------------------------------------
+
+#ifndef EL_TOPO_MESHRECORDING_H
+#define EL_TOPO_MESHRECORDING_H
+
+// ---------------------------------------------------------
+// Nested includes
+// ---------------------------------------------------------
+
+#include <cstddef>
+#include <iosfwd>
+#include <stdint.h>
+#include <string>
+#include <vec.h>
+#include <vector>
+
+// ---------------------------------------------------------
+//  Forwards and typedefs
+// ---------------------------------------------------------
+
+namespace ElTopo {
+
+// ---------------------------------------------------------
+//  Class definitions
+// ---------------------------------------------------------
+
+// --------------------------------------------------------
+///
+/// One recorded mesh state
+///
+// --------------------------------------------------------
+
+struct RecordedMesh
+{
+    std::vector<Vec3d> m_positions;
+    std::vector<Vec3st> m_triangles;
+    std::vector<Vec2i> m_labels;
+};
+
+// --------------------------------------------------------
+///
+/// Location of one step record in a recording stream
+///
+// --------------------------------------------------------
+
+struct MeshRecordingStep
+{
+    /// Offset of the record from the start of the stream header
+    uint64_t m_offset;
+
+    /// Size of the whole record, including its header
+    uint64_t m_size;
+
+    /// Step number given by the writer
+    int m_step;
+
+    /// Whether the record holds the full mesh, rather than changes to the previous step
+    bool m_keyframe;
+};
+
+// --------------------------------------------------------
+///
+/// Writes a recording stream.
+///
+/// A stream is a header followed by one record per step, and an index of the steps once the stream is ended.  A keyframe record holds the full mesh.  A delta record holds
+/// the position changes since the previous step, quantized to a multiple of the position quantum if it is not zero,
+/// and the triangles that changed, as a list of (index, triangle, label) edits.  A keyframe is written every few steps,
+/// and whenever a delta would not be smaller.  Each record is assembled in memory, optionally compressed, and written
+/// with a single call.
+///
+/// The writer keeps the positions as a reader will reconstruct them, so quantization errors do not accumulate: every
+/// reconstructed coordinate is within half a quantum of the recorded one.  A quantum of zero, the default, records
+/// positions exactly, so that a replay reproduces the bits the exact predicates saw.
+///
+// --------------------------------------------------------
+
+class MeshRecordingWriter
+{
+
+public:
+
+    MeshRecordingWriter();
+
+    /// Maximum number of steps between keyframes
+    ///
+    void set_keyframe_interval( unsigned int interval ) { m_keyframe_interval = interval > 0 ? interval : 1; }
+
+    /// Position quantum for streams started after this call.  Zero, the default, records positions exactly.
+    ///
+    void set_position_quantum( double quantum ) { m_position_quantum = quantum > 0.0 ? quantum : 0.0; }
+
+    /// Whether to compress records
+    ///
+    void set_compression( bool compress ) { m_compress = compress; }
+
+    /// Write the stream header.  The next step will be a keyframe.
+    ///
+    void begin_stream( std::ostream& os );
+
+    /// Write the index of the steps recorded since begin_stream.  Nothing should be written to the stream after this.
+    ///
+    void end_stream( std::ostream& os );
+
+    /// Record one step, with a free-form log text
+    ///
+    void write_step( std::ostream& os,
+                     int step,
+                     const std::string& log,
+                     const std::vector<Vec3d>& positions,
+                     const std::vector<Vec3st>& triangles,
+                     const std::vector<Vec2i>& labels );
+
+private:
+
+    /// Encode the full mesh into m_payload
+    ///
+    void encode_keyframe( const std::vector<Vec3d>& positions, const std::vector<Vec3st>& triangles, const std::vector<Vec2i>& labels );
+
+    /// Encode the changes since m_previous into m_payload, and the reconstructed positions into m_reconstructed.  Returns
+    /// false if some position change can't be quantized.
+    ///
+    bool encode_delta( const std::vector<Vec3d>& positions, const std::vector<Vec3st>& triangles, const std::vector<Vec2i>& labels );
+
+    unsigned int m_keyframe_interval;
+    double m_position_quantum;
+    bool m_compress;
+
+    /// Position quantum of the current stream
+    ///
+    double m_stream_quantum;
+
+    /// Number of steps written since the last keyframe, or the keyframe interval if the next step must be a keyframe
+    ///
+    unsigned int m_steps_since_keyframe;
+
+    /// Number of bytes written since begin_stream, and the steps written
+    ///
+    uint64_t m_stream_size;
+    std::vector<MeshRecordingStep> m_index;
+
+    /// The last step, as a reader will reconstruct it
+    ///
+    RecordedMesh m_previous;
+
+    /// Scratch space
+    ///
+    std::vector<Vec3d> m_reconstructed;
+    std::vector<unsigned char> m_payload;
+    std::vector<unsigned char> m_record;
+
+};
+
+// --------------------------------------------------------
+///
+/// Decodes a recording stream written by MeshRecordingWriter, held in memory.
+///
+/// Steps can be read in any order.  Reading the step after the current one applies a single delta; other steps are
+/// decoded forward from the closest keyframe at or before them, so the cost of a step is bounded by the keyframe
+/// interval.
+///
+// --------------------------------------------------------
+
+class MeshRecordingReader
+{
+
+public:
+
+    MeshRecordingReader();
+
+    /// Check the stream header at data and locate every step record.  Returns false if the bytes don't hold a recording.
+    ///
+    bool open( const unsigned char* data, size_t size, std::vector<MeshRecordingStep>& steps );
+
+    /// Decode steps[index] of the stream opened last, which must still be held at data
+    ///
+    bool read_step( const unsigned char* data, const std::vector<MeshRecordingStep>& steps, size_t index, std::string& log );
+
+    /// The mesh as of the last step decoded
+    ///
+    const RecordedMesh& current() const { return m_current; }
+
+private:
+
+    /// Load the index written by MeshRecordingWriter::end_stream.  Returns false if the stream has no valid index.
+    ///
+    bool read_index( const unsigned char* data, size_t size, std::vector<MeshRecordingStep>& steps ) const;
+
+    /// Apply one record held in memory to m_current
+    ///
+    bool decode_record( const unsigned char* record, size_t size, std::string& log );
+
+    /// Index of the first step which must be decoded to reach steps[index]
+    ///
+    size_t first_step_to_decode( const std::vector<MeshRecordingStep>& steps, size_t index ) const;
+
+    /// Position quantum of the stream
+    ///
+    double m_stream_quantum;
+
+    /// The mesh as of step m_current_index
+    ///
+    RecordedMesh m_current;
+
+    /// Index of the decoded step, or -1 if none
+    ///
+    long m_current_index;
+
+    /// Decompressed payload
+    ///
+    std::vector<unsigned char> m_payload;
+
+};
+
+// --------------------------------------------------------
+///
+/// A recording file, memory-mapped for reading.  Opening a file that was ended properly only reads its index, and
+/// loading a step only touches the records it is decoded from.
+///
+// --------------------------------------------------------
+
+class MeshRecordingFile
+{
+
+public:
+
+    MeshRecordingFile();
+    ~MeshRecordingFile();
+
+    /// Map the named file and locate its steps.  Returns false if the file can't be read or is not a recording.
+    ///
+    bool open( const std::string& filename );
+
+    /// Unmap the file
+    ///
+    void close();
+
+    bool is_open() const { return m_data != NULL; }
+
+    /// Located steps, in recording order
+    ///
+    const std::vector<MeshRecordingStep>& steps() const { return m_steps; }
+
+    /// Decode the step at the given position in steps()
+    ///
+    bool read_step( size_t index, std::string& log ) { return m_reader.read_step( m_data, m_steps, index, log ); }
+
+    /// The mesh as of the last step decoded
+    ///
+    const RecordedMesh& current() const { return m_reader.current(); }
+
+private:
+
+    // not copyable
+    MeshRecordingFile( const MeshRecordingFile& );
+    MeshRecordingFile& operator=( const MeshRecordingFile& );
+
+    /// Mapped file contents
+    ///
+    const unsigned char* m_data;
+    size_t m_size;
+
+    /// File contents, on platforms where the file is read rather than mapped
+    ///
+    std::vector<unsigned char> m_buffer;
+
+    std::vector<MeshRecordingStep> m_steps;
+    MeshRecordingReader m_reader;
+
+};
+
+}
+
+#endif
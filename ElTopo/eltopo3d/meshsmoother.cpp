@@ -668,52 +668,52 @@ bool MeshSmoother::null_space_smoothing_pass( double dt )
         std::cout << "---------------------- El Topo: vertex redistribution ----------------------" << std::endl;
     }
     
-    std::vector<double> triangle_areas;
-    triangle_areas.reserve( m_surf.m_mesh.num_triangles());
-    std::vector<Vec3d> triangle_normals;
-    triangle_normals.reserve( m_surf.m_mesh.num_triangles());
-    std::vector<Vec3d> triangle_centroids;
-    triangle_centroids.reserve( m_surf.m_mesh.num_triangles());
+    int num_triangles = (int) m_surf.m_mesh.num_triangles();
+    int num_vertices = (int) m_surf.get_num_vertices();
     
-    for ( size_t i = 0; i < m_surf.m_mesh.num_triangles(); ++i )
+    std::vector<double> triangle_areas( num_triangles );
+    std::vector<Vec3d> triangle_normals( num_triangles );
+    std::vector<Vec3d> triangle_centroids( num_triangles );
+    
+#pragma omp parallel for schedule(static)
+    for ( int i = 0; i < num_triangles; ++i )
     {
         const Vec3st& tri = m_surf.m_mesh.get_triangle(i);
         if ( tri[0] == tri[1] )
         {
-            triangle_areas.push_back( 0 );
-            triangle_normals.push_back( Vec3d(0,0,0) );
-            triangle_centroids.push_back( Vec3d(0,0,0) );
+            triangle_areas[i] = 0;
+            triangle_normals[i] = Vec3d(0,0,0);
+            triangle_centroids[i] = Vec3d(0,0,0);
         }
         else
         {
-            triangle_areas.push_back( m_surf.get_triangle_area( i ) );
-            triangle_normals.push_back( m_surf.get_triangle_normal( i ) );
-            triangle_centroids.push_back( (m_surf.get_position(tri[0]) + m_surf.get_position(tri[1]) + m_surf.get_position(tri[2])) / 3 );
+            triangle_areas[i] = m_surf.get_triangle_area( i );
+            triangle_normals[i] = m_surf.get_triangle_normal( i );
+            triangle_centroids[i] = (m_surf.get_position(tri[0]) + m_surf.get_position(tri[1]) + m_surf.get_position(tri[2])) / 3;
         }
     }
     
-    std::vector<Vec3d> displacements;
-    displacements.resize( m_surf.get_num_vertices(), Vec3d(0) );
+    // vertices to smooth
+    std::vector<size_t> smoothed_vertices;
     
-    double max_displacement = 1e-30;
     if(!m_surf.m_aggressive_mode)  {
        
        //in standard mode, smooth all vertices with null space smoothing
-       //#pragma omp parallel for 
-       for ( int i = 0; i < m_surf.get_num_vertices(); ++i )
+       for ( int i = 0; i < num_vertices; ++i )
        {
           if ( !m_surf.vertex_is_all_solid(i) )
           {
-             null_space_smooth_vertex( i, triangle_areas, triangle_normals, triangle_centroids, displacements[i] );
-             max_displacement = max( max_displacement, mag( displacements[i] ) );
+             smoothed_vertices.push_back( i );
           }
        }
     }
     else {
        
        //in aggressive mode, identify only the triangles with bad angles, and smooth all of their vertices (with naive Laplacian smoothing)
-       std::vector<bool> smoothed_already(m_surf.get_num_vertices(), false);
-       for(size_t i = 0; i < m_surf.m_mesh.num_triangles(); ++i) {
+       std::vector<char> bad_triangle( num_triangles, 0 );
+       
+#pragma omp parallel for schedule(static)
+       for(int i = 0; i < num_triangles; ++i) {
           
           Vec3st tri = m_surf.m_mesh.m_tris[i];
           Vec3d v0 = m_surf.get_position(tri[0]);
@@ -725,46 +725,81 @@ bool MeshSmoother::null_space_smoothing_pass( double dt )
           //switch angle modes
           angles[0] = rad2deg(angles[0]); angles[1] = rad2deg(angles[1]); angles[2] = rad2deg(angles[2]);
 
-          if(angles[0] < m_surf.m_min_triangle_angle || angles[0] > m_surf.m_max_triangle_angle ||
-             angles[1] < m_surf.m_min_triangle_angle || angles[1] > m_surf.m_max_triangle_angle ||
-             angles[2] < m_surf.m_min_triangle_angle || angles[2] > m_surf.m_max_triangle_angle) 
-          {
-             //std::cout << "Bad triangle angles: " << angles << std::endl;
-             for(int j = 0; j < 3; ++j) {
-                size_t v = tri[j];
-                if ( !m_surf.vertex_is_all_solid(v) && !smoothed_already[v])
-                {
-                   null_space_smooth_vertex(v, triangle_areas, triangle_normals, triangle_centroids, displacements[v]);
-                   max_displacement = max( max_displacement, mag( displacements[v] ) );
-                   smoothed_already[v] = true;
-                }
+          bad_triangle[i] = ( angles[0] < m_surf.m_min_triangle_angle || angles[0] > m_surf.m_max_triangle_angle ||
+                              angles[1] < m_surf.m_min_triangle_angle || angles[1] > m_surf.m_max_triangle_angle ||
+                              angles[2] < m_surf.m_min_triangle_angle || angles[2] > m_surf.m_max_triangle_angle );
+       }
+       
+       std::vector<bool> smoothed_already(num_vertices, false);
+       for(int i = 0; i < num_triangles; ++i) {
+          if ( !bad_triangle[i] ) { continue; }
+          
+          const Vec3st& tri = m_surf.m_mesh.m_tris[i];
+          for(int j = 0; j < 3; ++j) {
+             size_t v = tri[j];
+             if ( !m_surf.vertex_is_all_solid(v) && !smoothed_already[v])
+             {
+                smoothed_vertices.push_back( v );
+                smoothed_already[v] = true;
              }
           }
        }
     }
     
+    // each vertex only reads the current positions and writes its own displacement
+    
+    std::vector<Vec3d> displacements;
+    displacements.resize( num_vertices, Vec3d(0) );
+    
+    int num_smoothed = (int) smoothed_vertices.size();
+    double max_displacement = 1e-30;
+    
+#pragma omp parallel
+    {
+        double thread_max_displacement = 1e-30;
+        
+#pragma omp for schedule(dynamic, 64)
+        for ( int k = 0; k < num_smoothed; ++k )
+        {
+            size_t v = smoothed_vertices[k];
+            null_space_smooth_vertex( v, triangle_areas, triangle_normals, triangle_centroids, displacements[v] );
+            thread_max_displacement = max( thread_max_displacement, mag( displacements[v] ) );
+        }
+        
+#pragma omp critical
+        max_displacement = max( max_displacement, thread_max_displacement );
+    }
+    
     // compute maximum dt
     double max_beta = 1.0; //compute_max_timestep_quadratic_solve( m_surf.m_mesh.get_triangles(), m_surf.m_positions, displacements, m_surf.m_verbose );
     
-    if ( m_surf.m_verbose ) { std::cout << "max beta: " << max_beta << std::endl; }
+    if ( m_surf.m_verbose ) { std::cout << "max displacement: " << max_displacement << ", max beta: " << max_beta << std::endl; }
+    
+    m_surf.m_velocities.resize( num_vertices );
     
-    m_surf.m_velocities.resize( m_surf.get_num_vertices() );
+    // set all predicted positions at once, so the broad phase is updated once rather than per vertex
+    std::vector<Vec3d> new_positions( num_vertices );
     
-    for ( size_t i = 0; i < m_surf.get_num_vertices(); ++i )
+#pragma omp parallel for schedule(static)
+    for ( int i = 0; i < num_vertices; ++i )
     {
         Vec3d displacement = (max_beta) * displacements[i];
         Vec3c solid = m_surf.vertex_is_solid_3(i);
         if (solid[0]) displacement[0] = 0;
-        if (solid[1]) displacement[1] = 1;
-        if (solid[2]) displacement[2] = 2;
-        m_surf.set_newposition( i, m_surf.get_position(i) + displacement );
-        m_surf.m_velocities[i] = (m_surf.get_newposition(i) - m_surf.get_position(i)) / dt;
+        if (solid[1]) displacement[1] = 0;
+        if (solid[2]) displacement[2] = 0;
+        new_positions[i] = m_surf.get_position(i) + displacement;
+        m_surf.m_velocities[i] = displacement / dt;
     }
     
+    m_surf.set_all_newpositions( new_positions );
+    
     // repositioned locations stored in m_newpositions, but needs to be collision safe
     if ( m_surf.m_collision_safety )
     {
         
+        const std::vector<Vec3d> smoothed_positions = m_surf.get_newpositions();
+        
         bool all_collisions_handled = m_surf.m_collision_pipeline->handle_collisions(dt);
         
         if ( !all_collisions_handled )
@@ -792,7 +827,16 @@ bool MeshSmoother::null_space_smoothing_pass( double dt )
         // Actually, a call to DynamicSurface::integrate(dt) would be even better
         
         std::vector<Intersection> intersections;
-        m_surf.get_intersections( false, true, intersections );
+        if ( m_surf.full_intersection_check_due() )
+        {
+            m_surf.get_intersections( false, true, intersections );
+        }
+        else
+        {
+            std::vector<size_t> moved_vertices;
+            m_surf.get_vertices_needing_predicted_check( smoothed_positions, moved_vertices );
+            m_surf.get_intersections_near_vertices( moved_vertices, false, true, intersections );
+        }
         
         if ( intersections.size() != 0 )
         {
@@ -807,10 +851,19 @@ bool MeshSmoother::null_space_smoothing_pass( double dt )
     double max_position_change = 0.0;
     
     // Set positions
-    for(size_t i = 0; i < m_surf.get_num_vertices(); i++)
+#pragma omp parallel
     {
-        max_position_change = max( max_position_change, mag( m_surf.get_newposition(i) - m_surf.get_position(i) ) );
-    } 
+        double thread_max_position_change = 0.0;
+        
+#pragma omp for schedule(static)
+        for ( int i = 0; i < num_vertices; ++i )
+        {
+            thread_max_position_change = max( thread_max_position_change, mag( m_surf.get_newposition(i) - m_surf.get_position(i) ) );
+        }
+        
+#pragma omp critical
+        max_position_change = max( max_position_change, thread_max_position_change );
+    }
     
     m_surf.set_positions_to_newpositions();
     
@@ -0,0 +1,571 @@
+// ---------------------------------------------------------
+//
+//  spatialhashgrid.cpp
+//
+//  A hashed, flat-array grid for collision test culling.
+//
+// ---------------------------------------------------------
+
+// ---------------------------------------------------------
+// Includes
+// ---------------------------------------------------------
+
+#include <spatialhashgrid.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+// ---------------------------------------------------------
+// Local constants, typedefs, macros
+// ---------------------------------------------------------
+
+namespace ElTopo {
+
+namespace {
+
+/// Cell coordinates are clamped to [-MAX_CELL, MAX_CELL), so that they pack into 21 bits each
+///
+const int MAX_CELL = 1 << 20;
+
+/// Fibonacci hashing multiplier (2^64 / golden ratio)
+///
+const uint64_t HASH_MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+
+/// The table always has at least 2^MIN_BUCKET_BITS buckets
+///
+const unsigned int MIN_BUCKET_BITS = 10;
+
+/// Elements covering more cells than this go to the large element list
+///
+const size_t MAX_ELEMENT_CELLS = 512;
+
+/// The table is rebuilt when the delta list has more than this many entries, and more than half as many as the table
+///
+const size_t MIN_DELTA_ENTRIES = 4096;
+
+/// End of a delta chain
+///
+const size_t NO_ENTRY = ~(size_t)0;
+
+/// Below this number of elements, rebuilding the table is not worth starting threads for
+///
+const int MIN_PARALLEL_ELEMENTS = 4096;
+
+// ---------------------------------------------------------
+// Static function definitions
+// ---------------------------------------------------------
+
+inline int clamp_cell( double x )
+{
+    double c = std::floor( x );
+    // also sends NaNs to the lowest cell
+    if ( !( c >= -MAX_CELL ) ) { return -MAX_CELL; }
+    if ( c > MAX_CELL - 1 ) { return MAX_CELL - 1; }
+    return (int) c;
+}
+
+inline double count_cells( const Vec3i& low, const Vec3i& high )
+{
+    double count = 1.0;
+    for ( unsigned int a = 0; a < 3; ++a )
+    {
+        if ( high[a] < low[a] ) { return 0.0; }
+        count *= (double) ( high[a] - low[a] + 1 );
+    }
+    return count;
+}
+
+inline bool aabbs_overlap( const Vec3d& xmin, const Vec3d& xmax, const Vec3d& oxmin, const Vec3d& oxmax )
+{
+    return ( xmin[0] <= oxmax[0] && xmin[1] <= oxmax[1] && xmin[2] <= oxmax[2] ) &&
+           ( xmax[0] >= oxmin[0] && xmax[1] >= oxmin[1] && xmax[2] >= oxmin[2] );
+}
+
+}
+
+// ---------------------------------------------------------
+// Member function definitions
+// ---------------------------------------------------------
+
+// --------------------------------------------------------
+///
+/// Default constructor: unit cells, no elements
+///
+// --------------------------------------------------------
+
+SpatialHashGrid::SpatialHashGrid() :
+m_elementxmins(0),
+m_elementxmaxs(0),
+m_cellsize(1.0),
+m_invcellsize(1.0),
+m_origin(0,0,0),
+m_bucket_bits(MIN_BUCKET_BITS),
+m_bucket_starts(0),
+m_table_entries(0),
+m_delta_entries(0),
+m_delta_heads(0),
+m_large_elements(0),
+m_elementlocations(0),
+m_elementversions(0),
+m_occupied_low(0,0,0),
+m_occupied_high(0,0,0),
+m_elementcount(0)
+{
+    clear();
+}
+
+// --------------------------------------------------------
+///
+/// Define the cells, removing all elements
+///
+// --------------------------------------------------------
+
+void SpatialHashGrid::set( double cell_size, const Vec3d& origin )
+{
+    assert( cell_size > 0.0 );
+
+    clear();
+
+    m_cellsize = cell_size;
+    m_invcellsize = 1.0 / cell_size;
+    m_origin = origin;
+}
+
+// --------------------------------------------------------
+///
+/// Replace the grid contents with the given elements
+///
+// --------------------------------------------------------
+
+void SpatialHashGrid::build( const std::vector<size_t>& indices, const std::vector<Vec3d>& xmins, const std::vector<Vec3d>& xmaxs )
+{
+    assert( xmins.size() == indices.size() );
+    assert( xmaxs.size() == indices.size() );
+
+    clear();
+
+    if ( indices.empty() )
+    {
+        return;
+    }
+
+    size_t num_slots = *std::max_element( indices.begin(), indices.end() ) + 1;
+    m_elementxmins.resize( num_slots );
+    m_elementxmaxs.resize( num_slots );
+    m_elementlocations.resize( num_slots, ELEMENT_ABSENT );
+    m_elementversions.resize( num_slots, 0 );
+
+    for ( size_t i = 0; i < indices.size(); ++i )
+    {
+        // don't add inside-out AABBs
+        if ( xmins[i][0] > xmaxs[i][0] )  { continue; }
+
+        size_t idx = indices[i];
+        m_elementxmins[idx] = xmins[i];
+        m_elementxmaxs[idx] = xmaxs[i];
+
+        // picked up by rebuild_table
+        m_elementlocations[idx] = ELEMENT_IN_DELTA;
+        ++m_elementcount;
+    }
+
+    rebuild_table();
+}
+
+// --------------------------------------------------------
+///
+/// Add an object with the specified index and AABB to the grid
+///
+// --------------------------------------------------------
+
+void SpatialHashGrid::add_element( size_t idx, const Vec3d& xmin, const Vec3d& xmax )
+{
+    if ( idx >= m_elementlocations.size() )
+    {
+        m_elementxmins.resize( idx+1 );
+        m_elementxmaxs.resize( idx+1 );
+        m_elementlocations.resize( idx+1, ELEMENT_ABSENT );
+        m_elementversions.resize( idx+1, 0 );
+    }
+
+    remove_element( idx );
+
+    m_elementxmins[idx] = xmin;
+    m_elementxmaxs[idx] = xmax;
+
+    insert_loose( idx );
+}
+
+// --------------------------------------------------------
+///
+/// Remove an object with the specified index from the grid.  Its table or delta entries are left in place, and
+/// ignored by queries from now on.
+///
+// --------------------------------------------------------
+
+void SpatialHashGrid::remove_element( size_t idx )
+{
+    if ( idx >= m_elementlocations.size() || m_elementlocations[idx] == ELEMENT_ABSENT ) { return; }
+
+    if ( m_elementlocations[idx] == ELEMENT_IN_LARGE_LIST )
+    {
+        m_large_elements.erase( std::find( m_large_elements.begin(), m_large_elements.end(), idx ) );
+    }
+
+    ++m_elementversions[idx];
+    m_elementlocations[idx] = ELEMENT_ABSENT;
+    --m_elementcount;
+}
+
+// --------------------------------------------------------
+///
+/// Reset the specified object's AABB.  The element moves to the delta list, so this is as cheap as an insertion.
+///
+// --------------------------------------------------------
+
+void SpatialHashGrid::update_element( size_t idx, const Vec3d& xmin, const Vec3d& xmax )
+{
+    add_element( idx, xmin, xmax );
+}
+
+// --------------------------------------------------------
+///
+/// Remove all elements from the grid
+///
+// --------------------------------------------------------
+
+void SpatialHashGrid::clear()
+{
+    m_bucket_bits = MIN_BUCKET_BITS;
+    size_t num_buckets = (size_t) 1 << m_bucket_bits;
+
+    m_bucket_starts.assign( num_buckets + 1, 0 );
+    m_table_entries.clear();
+    m_delta_entries.clear();
+    m_delta_heads.assign( num_buckets, NO_ENTRY );
+    m_large_elements.clear();
+
+    m_elementxmins.clear();
+    m_elementxmaxs.clear();
+    m_elementlocations.clear();
+    m_elementversions.clear();
+
+    m_occupied_low = Vec3i( MAX_CELL, MAX_CELL, MAX_CELL );
+    m_occupied_high = Vec3i( -MAX_CELL, -MAX_CELL, -MAX_CELL );
+
+    m_elementcount = 0;
+}
+
+// --------------------------------------------------------
+///
+/// Return the set of elements which have AABBs overlapping the query AABB.
+///
+/// Each element is reported from a single cell: the lowest cell, along each axis, that it shares with the query.  This
+/// makes marking elements as visited unnecessary.
+///
+// --------------------------------------------------------
+
+void SpatialHashGrid::find_overlapping_elements( const Vec3d& xmin, const Vec3d& xmax, std::vector<size_t>& results ) const
+{
+    for ( size_t l = 0; l < m_large_elements.size(); ++l )
+    {
+        size_t idx = m_large_elements[l];
+        if ( aabbs_overlap( xmin, xmax, m_elementxmins[idx], m_elementxmaxs[idx] ) )
+        {
+            results.push_back( idx );
+        }
+    }
+
+    Vec3i low, high;
+    cell_range( xmin, xmax, low, high );
+    for ( unsigned int a = 0; a < 3; ++a )
+    {
+        low[a] = std::max( low[a], m_occupied_low[a] );
+        high[a] = std::min( high[a], m_occupied_high[a] );
+    }
+
+    double num_cells = count_cells( low, high );
+    if ( num_cells == 0.0 )
+    {
+        return;
+    }
+
+    if ( num_cells > (double) ( m_table_entries.size() + m_delta_entries.size() ) )
+    {
+        // cheaper to test every element than to visit every cell
+        for ( size_t idx = 0; idx < m_elementlocations.size(); ++idx )
+        {
+            if ( ( m_elementlocations[idx] == ELEMENT_IN_TABLE || m_elementlocations[idx] == ELEMENT_IN_DELTA ) &&
+                aabbs_overlap( xmin, xmax, m_elementxmins[idx], m_elementxmaxs[idx] ) )
+            {
+                results.push_back( idx );
+            }
+        }
+        return;
+    }
+
+    for ( int k = low[2]; k <= high[2]; ++k )
+    {
+        for ( int j = low[1]; j <= high[1]; ++j )
+        {
+            for ( int i = low[0]; i <= high[0]; ++i )
+            {
+                uint64_t key = cell_key( i, j, k );
+                size_t b = bucket( key );
+
+                for ( size_t e = m_bucket_starts[b]; e < m_bucket_starts[b+1]; ++e )
+                {
+                    const TableEntry& entry = m_table_entries[e];
+                    if ( entry.m_key != key || m_elementlocations[entry.m_element] != ELEMENT_IN_TABLE ) { continue; }
+
+                    if ( aabbs_overlap( xmin, xmax, m_elementxmins[entry.m_element], m_elementxmaxs[entry.m_element] ) &&
+                        is_reporting_cell( entry.m_element, low, i, j, k ) )
+                    {
+                        results.push_back( entry.m_element );
+                    }
+                }
+
+                for ( size_t d = m_delta_heads[b]; d != NO_ENTRY; d = m_delta_entries[d].m_next )
+                {
+                    const DeltaEntry& entry = m_delta_entries[d];
+                    if ( entry.m_key != key ||
+                        m_elementlocations[entry.m_element] != ELEMENT_IN_DELTA ||
+                        m_elementversions[entry.m_element] != entry.m_version )
+                    {
+                        continue;
+                    }
+
+                    if ( aabbs_overlap( xmin, xmax, m_elementxmins[entry.m_element], m_elementxmaxs[entry.m_element] ) &&
+                        is_reporting_cell( entry.m_element, low, i, j, k ) )
+                    {
+                        results.push_back( entry.m_element );
+                    }
+                }
+            }
+        }
+    }
+}
+
+// --------------------------------------------------------
+///
+/// Compute the range of cells covered by an AABB
+///
+// --------------------------------------------------------
+
+void SpatialHashGrid::cell_range( const Vec3d& xmin, const Vec3d& xmax, Vec3i& low, Vec3i& high ) const
+{
+    for ( unsigned int a = 0; a < 3; ++a )
+    {
+        low[a] = clamp_cell( ( xmin[a] - m_origin[a] ) * m_invcellsize );
+        high[a] = clamp_cell( ( xmax[a] - m_origin[a] ) * m_invcellsize );
+    }
+}
+
+// --------------------------------------------------------
+///
+/// Pack integer cell coordinates into a key
+///
+// --------------------------------------------------------
+
+uint64_t SpatialHashGrid::cell_key( int i, int j, int k )
+{
+    return ( (uint64_t) ( i + MAX_CELL ) << 42 ) | ( (uint64_t) ( j + MAX_CELL ) << 21 ) | (uint64_t) ( k + MAX_CELL );
+}
+
+// --------------------------------------------------------
+///
+/// Bucket of a cell key
+///
+// --------------------------------------------------------
+
+size_t SpatialHashGrid::bucket( uint64_t key ) const
+{
+    return (size_t) ( ( key * HASH_MULTIPLIER ) >> ( 64 - m_bucket_bits ) );
+}
+
+// --------------------------------------------------------
+///
+/// Store an element whose AABB is set in the delta list, or in the list of large elements
+///
+// --------------------------------------------------------
+
+void SpatialHashGrid::insert_loose( size_t idx )
+{
+    Vec3i low, high;
+    cell_range( m_elementxmins[idx], m_elementxmaxs[idx], low, high );
+
+    ++m_elementcount;
+
+    double num_cells = count_cells( low, high );
+    if ( num_cells > (double) MAX_ELEMENT_CELLS )
+    {
+        m_elementlocations[idx] = ELEMENT_IN_LARGE_LIST;
+        m_large_elements.push_back( idx );
+        return;
+    }
+
+    m_elementlocations[idx] = ELEMENT_IN_DELTA;
+
+    if ( num_cells == 0.0 )
+    {
+        return;
+    }
+
+    for ( int k = low[2]; k <= high[2]; ++k )
+    {
+        for ( int j = low[1]; j <= high[1]; ++j )
+        {
+            for ( int i = low[0]; i <= high[0]; ++i )
+            {
+                DeltaEntry entry;
+                entry.m_key = cell_key( i, j, k );
+                entry.m_element = idx;
+                entry.m_version = m_elementversions[idx];
+
+                size_t b = bucket( entry.m_key );
+                entry.m_next = m_delta_heads[b];
+                m_delta_heads[b] = m_delta_entries.size();
+                m_delta_entries.push_back( entry );
+            }
+        }
+    }
+
+    m_occupied_low = min_union( m_occupied_low, low );
+    m_occupied_high = max_union( m_occupied_high, high );
+
+    if ( m_delta_entries.size() > std::max( MIN_DELTA_ENTRIES, m_table_entries.size() / 2 ) )
+    {
+        rebuild_table();
+    }
+}
+
+// --------------------------------------------------------
+///
+/// Whether the query covering cells from query_low should report the element when visiting cell (i,j,k): the cell
+/// must be the lowest cell the element shares with the query.
+///
+// --------------------------------------------------------
+
+bool SpatialHashGrid::is_reporting_cell( size_t idx, const Vec3i& query_low, int i, int j, int k ) const
+{
+    const Vec3d& xmin = m_elementxmins[idx];
+    return i == std::max( query_low[0], clamp_cell( ( xmin[0] - m_origin[0] ) * m_invcellsize ) ) &&
+           j == std::max( query_low[1], clamp_cell( ( xmin[1] - m_origin[1] ) * m_invcellsize ) ) &&
+           k == std::max( query_low[2], clamp_cell( ( xmin[2] - m_origin[2] ) * m_invcellsize ) );
+}
+
+// --------------------------------------------------------
+///
+/// Build a new table holding every element of the table and of the delta list.  The cells of each element are
+/// enumerated in parallel, then a counting sort groups the entries by bucket.  Within a bucket, entries are ordered
+/// by element index, so query results do not depend on the number of threads.
+///
+// --------------------------------------------------------
+
+void SpatialHashGrid::rebuild_table()
+{
+    std::vector<size_t> elements;
+    elements.reserve( m_elementcount );
+    for ( size_t idx = 0; idx < m_elementlocations.size(); ++idx )
+    {
+        if ( m_elementlocations[idx] == ELEMENT_IN_TABLE || m_elementlocations[idx] == ELEMENT_IN_DELTA )
+        {
+            elements.push_back( idx );
+        }
+    }
+
+    int num_elements = (int) elements.size();
+    std::vector<Vec3i> lows( num_elements ), highs( num_elements );
+    std::vector<size_t> offsets( num_elements + 1, 0 );
+
+#pragma omp parallel for schedule(static) if(num_elements > MIN_PARALLEL_ELEMENTS)
+    for ( int e = 0; e < num_elements; ++e )
+    {
+        size_t idx = elements[e];
+        cell_range( m_elementxmins[idx], m_elementxmaxs[idx], lows[e], highs[e] );
+        double num_cells = count_cells( lows[e], highs[e] );
+        offsets[e+1] = ( num_cells > (double) MAX_ELEMENT_CELLS ) ? MAX_ELEMENT_CELLS + 1 : (size_t) num_cells;
+    }
+
+    m_occupied_low = Vec3i( MAX_CELL, MAX_CELL, MAX_CELL );
+    m_occupied_high = Vec3i( -MAX_CELL, -MAX_CELL, -MAX_CELL );
+
+    for ( int e = 0; e < num_elements; ++e )
+    {
+        size_t idx = elements[e];
+        if ( offsets[e+1] > MAX_ELEMENT_CELLS )
+        {
+            m_elementlocations[idx] = ELEMENT_IN_LARGE_LIST;
+            m_large_elements.push_back( idx );
+            offsets[e+1] = 0;
+        }
+        else
+        {
+            m_elementlocations[idx] = ELEMENT_IN_TABLE;
+            if ( offsets[e+1] > 0 )
+            {
+                m_occupied_low = min_union( m_occupied_low, lows[e] );
+                m_occupied_high = max_union( m_occupied_high, highs[e] );
+            }
+        }
+        offsets[e+1] += offsets[e];
+    }
+
+    size_t num_entries = offsets[num_elements];
+
+    m_bucket_bits = MIN_BUCKET_BITS;
+    while ( ( (size_t) 1 << m_bucket_bits ) < 2 * num_entries )
+    {
+        ++m_bucket_bits;
+    }
+    size_t num_buckets = (size_t) 1 << m_bucket_bits;
+
+    std::vector<TableEntry> unsorted_entries( num_entries );
+    std::vector<size_t> entry_buckets( num_entries );
+
+#pragma omp parallel for schedule(static) if(num_elements > MIN_PARALLEL_ELEMENTS)
+    for ( int e = 0; e < num_elements; ++e )
+    {
+        size_t n = offsets[e];
+        if ( n == offsets[e+1] ) { continue; }
+
+        for ( int k = lows[e][2]; k <= highs[e][2]; ++k )
+        {
+            for ( int j = lows[e][1]; j <= highs[e][1]; ++j )
+            {
+                for ( int i = lows[e][0]; i <= highs[e][0]; ++i )
+                {
+                    unsorted_entries[n].m_key = cell_key( i, j, k );
+                    unsorted_entries[n].m_element = elements[e];
+                    entry_buckets[n] = bucket( unsorted_entries[n].m_key );
+                    ++n;
+                }
+            }
+        }
+    }
+
+    // counting sort by bucket
+
+    m_bucket_starts.assign( num_buckets + 1, 0 );
+    for ( size_t n = 0; n < num_entries; ++n )
+    {
+        ++m_bucket_starts[ entry_buckets[n] + 1 ];
+    }
+    for ( size_t b = 0; b < num_buckets; ++b )
+    {
+        m_bucket_starts[b+1] += m_bucket_starts[b];
+    }
+
+    std::vector<size_t> cursors( m_bucket_starts.begin(), m_bucket_starts.end() - 1 );
+    m_table_entries.resize( num_entries );
+    for ( size_t n = 0; n < num_entries; ++n )
+    {
+        m_table_entries[ cursors[ entry_buckets[n] ]++ ] = unsorted_entries[n];
+    }
+
+    m_delta_entries.clear();
+    m_delta_heads.assign( num_buckets, NO_ENTRY );
+}
+
+}
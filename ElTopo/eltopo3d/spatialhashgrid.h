@@ -0,0 +1,176 @@
+// ---------------------------------------------------------
+//
+//  spatialhashgrid.h
+//
+//  A hashed, flat-array grid for collision test culling.  Only occupied cells take up memory, so it suits large,
+//  mostly empty domains.
+//
+// ---------------------------------------------------------
+
+#ifndef EL_TOPO_SPATIALHASHGRID_H
+#define EL_TOPO_SPATIALHASHGRID_H
+
+// ---------------------------------------------------------
+// Nested includes
+// ---------------------------------------------------------
+
+#include <stdint.h>
+#include <vec.h>
+#include <vector>
+
+// ---------------------------------------------------------
+//  Class definitions
+// ---------------------------------------------------------
+
+namespace ElTopo {
+
+// --------------------------------------------------------
+///
+/// Spatial hash collision culling structure.
+///
+/// Cells are cubes identified by their integer coordinates, hashed into a power-of-two number of buckets.  The bulk
+/// of the (cell, element) entries live in a table sorted by bucket, with one array of entries and one array of bucket
+/// offsets.  Elements added or updated afterwards go into a delta list, chained per bucket through array indices, until
+/// the delta grows large enough to be merged by rebuilding the table.  Elements covering very many cells are kept in a
+/// separate list and tested against every query.
+///
+/// Queries report each overlapping element exactly once without marking elements, so they do not modify the grid and
+/// can run concurrently.
+///
+// --------------------------------------------------------
+
+class SpatialHashGrid
+{
+
+public:
+
+    SpatialHashGrid();
+
+    /// Remove all elements and define the cells: cubes of the given size, with one corner at the given origin
+    ///
+    void set( double cell_size, const Vec3d& origin );
+
+    /// Replace the grid contents with the given elements, and build the table in parallel
+    ///
+    void build( const std::vector<size_t>& indices, const std::vector<Vec3d>& xmins, const std::vector<Vec3d>& xmaxs );
+
+    /// Add an object with the specified index and AABB to the grid
+    ///
+    void add_element( size_t idx, const Vec3d& xmin, const Vec3d& xmax );
+
+    /// Remove an object with the specified index from the grid
+    ///
+    void remove_element( size_t idx );
+
+    /// Reset the specified object's AABB
+    ///
+    void update_element( size_t idx, const Vec3d& xmin, const Vec3d& xmax );
+
+    /// Remove all elements from the grid
+    ///
+    void clear();
+
+    /// Return the set of elements which have AABBs overlapping the query AABB.
+    ///
+    void find_overlapping_elements( const Vec3d& xmin, const Vec3d& xmax, std::vector<size_t>& results ) const;
+
+    /// Element AABBs
+    ///
+    std::vector<Vec3d> m_elementxmins, m_elementxmaxs;
+
+private:
+
+    /// Where an element's entries are stored
+    ///
+    enum ElementLocation
+    {
+        ELEMENT_ABSENT,
+        ELEMENT_IN_TABLE,
+        ELEMENT_IN_DELTA,
+        ELEMENT_IN_LARGE_LIST
+    };
+
+    /// A (cell, element) pair in the table
+    ///
+    struct TableEntry
+    {
+        uint64_t m_key;
+        size_t m_element;
+    };
+
+    /// A (cell, element) pair in the delta list.  Entries made before the element was last removed or updated are stale,
+    /// which is detected by comparing versions.
+    ///
+    struct DeltaEntry
+    {
+        uint64_t m_key;
+        size_t m_element;
+        unsigned int m_version;
+        size_t m_next;
+    };
+
+    /// Compute the (clamped) range of cells covered by an AABB
+    ///
+    void cell_range( const Vec3d& xmin, const Vec3d& xmax, Vec3i& low, Vec3i& high ) const;
+
+    /// Pack integer cell coordinates into a key
+    ///
+    static uint64_t cell_key( int i, int j, int k );
+
+    /// Bucket of a cell key
+    ///
+    size_t bucket( uint64_t key ) const;
+
+    /// Store an element in the delta list, or in the list of large elements
+    ///
+    void insert_loose( size_t idx );
+
+    /// Whether the query with cell range starting at query_low should report the element while visiting cell (i,j,k)
+    ///
+    bool is_reporting_cell( size_t idx, const Vec3i& query_low, int i, int j, int k ) const;
+
+    /// Move all elements from the delta list into a newly built table
+    ///
+    void rebuild_table();
+
+    /// Cell dimensions and grid origin
+    ///
+    double m_cellsize, m_invcellsize;
+    Vec3d m_origin;
+
+    /// log2 of the number of buckets
+    ///
+    unsigned int m_bucket_bits;
+
+    /// Table entries, grouped by bucket.  The entries of bucket b are [m_bucket_starts[b], m_bucket_starts[b+1]).
+    ///
+    std::vector<size_t> m_bucket_starts;
+    std::vector<TableEntry> m_table_entries;
+
+    /// Delta entries, and the index of the most recent delta entry of each bucket
+    ///
+    std::vector<DeltaEntry> m_delta_entries;
+    std::vector<size_t> m_delta_heads;
+
+    /// Elements covering too many cells to be hashed
+    ///
+    std::vector<size_t> m_large_elements;
+
+    /// Per-element storage location and version
+    ///
+    std::vector<unsigned char> m_elementlocations;
+    std::vector<unsigned int> m_elementversions;
+
+    /// Bounds of the cells that may hold table or delta entries
+    ///
+    Vec3i m_occupied_low, m_occupied_high;
+
+    /// Number of elements being stored.
+    ///
+    size_t m_elementcount;
+
+};
+
+}
+
+#endif
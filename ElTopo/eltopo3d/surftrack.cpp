@@ -82,7 +82,12 @@ m_allow_non_manifold(true),
 m_perform_improvement(true),
 m_remesh_boundaries(true),
 m_verbose(false),
-m_pull_apart_distance(0.1)
+m_pull_apart_distance(0.1),
+m_localized_intersection_checks(true),
+m_intersection_check_epsilon(0.0),
+m_full_intersection_check_interval(0),
+m_broad_phase_type(BROAD_PHASE_GRID),
+m_parallel_edge_operations(false)
 {}
 
 
@@ -139,6 +144,7 @@ m_perform_improvement( initial_parameters.m_perform_improvement ),
 m_remesh_boundaries( initial_parameters.m_remesh_boundaries),
 m_allow_vertex_movement_during_collapse( initial_parameters.m_allow_vertex_movement_during_collapse ),
 m_perform_smoothing( initial_parameters.m_perform_smoothing),
+m_parallel_edge_operations( initial_parameters.m_parallel_edge_operations ),
 m_vertex_change_history(),
 m_triangle_change_history(),
 m_defragged_triangle_map(),
@@ -159,6 +165,15 @@ m_hard_max_edge_len(10.0*initial_parameters.m_max_edge_length)
         std::cout << "initial_parameters.m_use_fraction: " << initial_parameters.m_use_fraction << std::endl;
     }
     
+    m_localized_intersection_checks = initial_parameters.m_localized_intersection_checks;
+    m_intersection_check_epsilon = initial_parameters.m_intersection_check_epsilon;
+    m_full_intersection_check_interval = initial_parameters.m_full_intersection_check_interval;
+    
+    if ( initial_parameters.m_broad_phase_type != BROAD_PHASE_GRID )
+    {
+        set_broad_phase_type( initial_parameters.m_broad_phase_type );
+    }
+    
     if ( m_collision_safety )
     {
         rebuild_static_broad_phase();
@@ -258,6 +273,10 @@ size_t SurfTrack::add_triangle( const Vec3st& t, const Vec2i& label )
     assert( t[1] < get_num_vertices() );
     assert( t[2] < get_num_vertices() );
     
+    mark_vertex_changed( t[0] );
+    mark_vertex_changed( t[1] );
+    mark_vertex_changed( t[2] );
+    
     if ( m_collision_safety )
     {
         // Add to the triangle grid
@@ -354,6 +373,8 @@ size_t SurfTrack::add_vertex( const Vec3d& new_vertex_position, const Vec3d& new
   
     pm_velocities[new_vertex_index] = Vec3d(0);
   
+    mark_vertex_changed( new_vertex_index );
+    
     ////////////////////////////////////////////////////////////
     
     if ( m_collision_safety )
@@ -436,6 +457,9 @@ void SurfTrack::defrag_mesh( )
         
         std::vector<Vec3st> new_tris = m_mesh.get_triangles();
         
+        static const size_t REMOVED = (size_t)~0;
+        std::vector<size_t> new_vertex_index( get_num_vertices(), REMOVED );
+        
         for ( size_t i = 0; i < get_num_vertices(); ++i )
         {      
             if ( !m_mesh.vertex_is_deleted(i) )
@@ -443,8 +467,14 @@ void SurfTrack::defrag_mesh( )
                 pm_positions[j] = pm_positions[i];
                 pm_newpositions[j] = pm_newpositions[i];
                 m_masses[j] = m_masses[i];
+                if ( j < m_vertex_needs_intersection_check.size() )
+                {
+                    m_vertex_needs_intersection_check[j] = ( i < m_vertex_needs_intersection_check.size() ) ? 
+                                                           m_vertex_needs_intersection_check[i] : 0;
+                }
                 
                 m_defragged_vertex_map[i] = Vec2st(i,j);
+                new_vertex_index[i] = j;
                 
                 // Now rewire the triangles containing vertex i
                 
@@ -473,6 +503,18 @@ void SurfTrack::defrag_mesh( )
         pm_positions.resize(j);
         pm_newpositions.resize(j);
         m_masses.resize(j);
+        if ( m_vertex_needs_intersection_check.size() > j )
+        {
+            m_vertex_needs_intersection_check.resize(j);
+        }
+        
+        // renumber the change log in place, so that cursor positions stay valid; removed vertices become out-of-range 
+        // entries, which readers skip
+        for ( size_t i = 0; i < m_vertex_change_log.size(); ++i )
+        {
+            size_t v = m_vertex_change_log[i];
+            m_vertex_change_log[i] = ( v < new_vertex_index.size() ) ? new_vertex_index[v] : REMOVED;
+        }
     }
     
     double end_time = get_time_in_seconds();
@@ -590,6 +632,118 @@ bool SurfTrack::any_triangles_with_bad_angles( )
    return false;
 }
    
+// --------------------------------------------------------
+///
+/// Get the edges whose split or collapse criteria may have changed since the cursor was last advanced.  Moving a vertex 
+/// changes the lengths of its edges and the angles and curvature estimates of its one-ring, so every edge incident on the 
+/// vertex or on one of its neighbours is a candidate.
+///
+// --------------------------------------------------------
+
+bool SurfTrack::get_remesh_candidate_edges( VertexChangeCursor& cursor, std::vector<size_t>& edges ) const
+{
+    edges.clear();
+    
+    std::vector<size_t> changed_vertices;
+    if ( !get_vertices_changed_since( cursor, changed_vertices ) )
+    {
+        edges.reserve( m_mesh.m_edges.size() );
+        for ( size_t e = 0; e < m_mesh.m_edges.size(); ++e )
+        {
+            if ( !m_mesh.edge_is_deleted(e) ) { edges.push_back(e); }
+        }
+        return false;
+    }
+    
+    std::vector<size_t> ring = changed_vertices;
+    for ( size_t i = 0; i < changed_vertices.size(); ++i )
+    {
+        size_t v = changed_vertices[i];
+        if ( v >= m_mesh.m_vertex_to_edge_map.size() ) { continue; }
+        const std::vector<size_t>& inc_edges = m_mesh.m_vertex_to_edge_map[v];
+        for ( size_t j = 0; j < inc_edges.size(); ++j )
+        {
+            const Vec2st& edge = m_mesh.m_edges[ inc_edges[j] ];
+            ring.push_back( edge[0] == v ? edge[1] : edge[0] );
+        }
+    }
+    std::sort( ring.begin(), ring.end() );
+    ring.erase( std::unique( ring.begin(), ring.end() ), ring.end() );
+    
+    for ( size_t i = 0; i < ring.size(); ++i )
+    {
+        if ( ring[i] >= m_mesh.m_vertex_to_edge_map.size() ) { continue; }
+        const std::vector<size_t>& inc_edges = m_mesh.m_vertex_to_edge_map[ ring[i] ];
+        edges.insert( edges.end(), inc_edges.begin(), inc_edges.end() );
+    }
+    std::sort( edges.begin(), edges.end() );
+    edges.erase( std::unique( edges.begin(), edges.end() ), edges.end() );
+    
+    return true;
+}
+
+// --------------------------------------------------------
+///
+/// Whether any threshold used to pick split and collapse candidates changed since the last improvement.  Edges that were 
+/// passed over under the old thresholds then have to be looked at again.
+///
+// --------------------------------------------------------
+
+bool SurfTrack::remesh_criteria_changed()
+{
+    std::vector<double> criteria;
+    criteria.push_back( m_splitter.m_max_edge_length );
+    criteria.push_back( m_splitter.m_min_edge_length );
+    criteria.push_back( m_collapser.m_max_edge_length );
+    criteria.push_back( m_collapser.m_min_edge_length );
+    criteria.push_back( m_min_edge_length );
+    criteria.push_back( m_hard_min_edge_len );
+    criteria.push_back( m_min_triangle_angle );
+    criteria.push_back( m_max_triangle_angle );
+    criteria.push_back( m_large_triangle_angle_to_split );
+    criteria.push_back( m_remesh_boundaries ? 1.0 : 0.0 );
+    
+    bool changed = ( criteria != m_remesh_criteria );
+    m_remesh_criteria.swap( criteria );
+    return changed;
+}
+
+// --------------------------------------------------------
+///
+/// Drop the part of the vertex change log that every improvement pass has already read.
+///
+// --------------------------------------------------------
+
+void SurfTrack::trim_vertex_change_log()
+{
+    std::vector<VertexChangeCursor*> cursors;
+    cursors.push_back( &m_splitter.m_split_cursor );
+    cursors.push_back( &m_splitter.m_large_angle_cursors[0] );
+    cursors.push_back( &m_splitter.m_large_angle_cursors[1] );
+    cursors.push_back( &m_collapser.m_collapse_cursors[0] );
+    cursors.push_back( &m_collapser.m_collapse_cursors[1] );
+    
+    size_t read = m_vertex_change_log.size();
+    for ( size_t i = 0; i < cursors.size(); ++i )
+    {
+        if ( cursors[i]->m_valid && cursors[i]->m_epoch == m_vertex_change_log_epoch )
+        {
+            read = min( read, cursors[i]->m_position );
+        }
+    }
+    
+    if ( read == 0 ) { return; }
+    
+    m_vertex_change_log.erase( m_vertex_change_log.begin(), m_vertex_change_log.begin() + read );
+    for ( size_t i = 0; i < cursors.size(); ++i )
+    {
+        if ( cursors[i]->m_valid && cursors[i]->m_epoch == m_vertex_change_log_epoch )
+        {
+            cursors[i]->m_position -= read;
+        }
+    }
+}
+
 bool SurfTrack::triangle_with_bad_angle(size_t i)
 {
    Vec3st tri = m_mesh.m_tris[i];
@@ -835,6 +989,13 @@ void SurfTrack::improve_mesh( )
   
     if ( m_perform_improvement ) {
       
+      // the passes only revisit edges near vertices changed since they last ran, unless the thresholds moved
+      if ( remesh_criteria_changed() )
+      {
+        m_splitter.invalidate_candidates();
+        m_collapser.invalidate_candidates();
+      }
+      
       ////////////////////////////////////////////////////////////
       
       //standard mesh improvement pass is gentle, seeks to preserve volume, prevent flips, preserve features, avoid popping.
@@ -940,10 +1101,12 @@ void SurfTrack::improve_mesh( )
 
       assert_no_bad_labels();
       
+      trim_vertex_change_log();
+      
       std::cout << "Done improvement\n" << std::endl;
       if ( m_collision_safety )
       {
-        assert_mesh_is_intersection_free( false );
+        assert_mesh_changes_are_intersection_free( false );
       }      
     }
     
@@ -966,7 +1129,7 @@ void SurfTrack::cut_mesh( const std::vector< std::pair<size_t,size_t> >& edges)
   if ( m_collision_safety )
   {
     //std::cout << "Checking collisions after cutting.\n";
-    assert_mesh_is_intersection_free( false );
+    assert_mesh_changes_are_intersection_free( false );
   }      
   
 }
@@ -1004,7 +1167,7 @@ void SurfTrack::topology_changes( )
 
    if ( m_collision_safety )
    {
-      assert_mesh_is_intersection_free( false );
+      assert_mesh_changes_are_intersection_free( false );
    }
 
   if (m_mesheventcallback)
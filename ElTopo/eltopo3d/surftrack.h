@@ -159,6 +159,28 @@ struct SurfTrackInitializationParameters
   
     /// Pull apart distance, in terms of absolute length
     double m_pull_apart_distance;
+    
+    /// Whether collision-safety intersection checks only re-test the neighbourhoods of vertices that moved or were touched 
+    /// by collision response or mesh operations
+    ///
+    bool m_localized_intersection_checks;
+    
+    /// Vertices moving less than this during a time step are skipped by localized intersection checks
+    ///
+    double m_intersection_check_epsilon;
+    
+    /// Check the whole mesh for intersections on every n-th check, as a debugging sweep (0 = never)
+    ///
+    unsigned int m_full_intersection_check_interval;
+    
+    /// Broad phase implementation.  The spatial hash suits surfaces occupying a small part of a large domain, the BVH
+    /// suits meshes whose edge lengths vary widely.
+    ///
+    BroadPhaseType m_broad_phase_type;
+    
+    /// Whether edge flips and length-based splits are evaluated concurrently, over sets of edges with disjoint stencils
+    ///
+    bool m_parallel_edge_operations;
 
     /// Whether to be verbose in outputting data
     ///
@@ -546,6 +568,12 @@ public:
     /// Detect any bad angle, i.e. out of range [m_min_triangle_angle, m_max_triangle_angle)
     bool triangle_with_bad_angle(size_t triangle);
     bool any_triangles_with_bad_angles();
+    
+    /// Get the edges whose split or collapse criteria may have changed since the cursor was last advanced, i.e. the edges 
+    /// incident on a changed vertex or one of its neighbours.  Returns false, with every edge in the mesh, when the whole 
+    /// mesh has to be considered.
+    ///
+    bool get_remesh_candidate_edges( VertexChangeCursor& cursor, std::vector<size_t>& edges ) const;
 
     //
     // Member variables
@@ -671,6 +699,12 @@ public:
     /// boolean, whether to do null space smoothing on vertex positions
     int m_perform_smoothing;
     
+    /// Whether edge flips and length-based splits are evaluated concurrently, over sets of edges with disjoint stencils.
+    /// Operations are still applied one at a time; an edge whose stencil overlaps that of a higher priority edge waits for
+    /// a later batch.
+    ///
+    bool m_parallel_edge_operations;
+    
     
     //Return whether the given edge is a feature as determined by dihedral angles.
     bool edge_is_feature(size_t edge) const;
@@ -747,6 +781,19 @@ public:
     ///    
     std::vector<MeshUpdateEvent> m_mesh_change_history;
 
+private:
+    
+    /// Whether any threshold used to pick split and collapse candidates changed since the last improvement
+    ///
+    bool remesh_criteria_changed();
+    
+    /// Drop the part of the vertex change log that every improvement pass has already read
+    ///
+    void trim_vertex_change_log();
+    
+    /// Thresholds in effect during the last improvement
+    ///
+    std::vector<double> m_remesh_criteria;
     
 };
 
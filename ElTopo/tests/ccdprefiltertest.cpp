@@ -0,0 +1,274 @@
+// ---------------------------------------------------------
+//
+//  ccdprefiltertest.cpp
+//
+//  Checks that the floating-point CCD prefilter never rejects a candidate that the exact root parity test reports as
+//  colliding.
+//
+//  Usage: ccdprefiltertest [candidate dump files]
+//
+//  Candidate dumps are written by talpa when its script sets "ccd_candidate_dump <filename>" (see
+//  set_ccd_candidate_dump_file() in ccd_wrapper.h).  Without arguments, random and near-coplanar candidates are
+//  generated instead.
+//
+// ---------------------------------------------------------
+
+#include <ccd_defs.h>
+#include <ccd_wrapper.h>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <rootparitycollisiontest.h>
+#include <vec.h>
+#include <vector>
+
+using namespace ElTopo;
+
+#ifdef USE_CCD_PREFILTER
+
+static const unsigned int nRandomCandidates = 200000;
+static const unsigned int nCoplanarCandidates = 200000;
+static const double maxDisplacement = 0.3;
+
+// ---------------------------------------------------------
+
+struct Candidate
+{
+    Vec3d x[4];
+    Vec3d xnew[4];
+    bool is_edge_edge;
+};
+
+struct CandidateCounts
+{
+    CandidateCounts() : candidates(0), rejected(0), colliding(0), mismatches(0) {}
+
+    long candidates;
+    long rejected;
+    long colliding;
+    long mismatches;
+};
+
+// ---------------------------------------------------------
+///
+/// Run the prefilter and the exact test on a candidate, and report it if the prefilter wrongly rejects it.
+///
+// ---------------------------------------------------------
+
+static void check_candidate( const Candidate& c, CandidateCounts& counts )
+{
+    bool rejected = ccd_prefilter_rejects( c.x[0], c.xnew[0], c.x[1], c.xnew[1], c.x[2], c.xnew[2], c.x[3], c.xnew[3],
+                                           c.is_edge_edge );
+
+    rootparity::RootParityCollisionTest test( c.x[0], c.x[1], c.x[2], c.x[3], c.xnew[0], c.xnew[1], c.xnew[2], c.xnew[3],
+                                              c.is_edge_edge );
+    bool colliding = test.run_test();
+
+    ++counts.candidates;
+    if ( rejected ) { ++counts.rejected; }
+    if ( colliding ) { ++counts.colliding; }
+
+    if ( rejected && colliding )
+    {
+        ++counts.mismatches;
+        std::cerr.precision( 17 );
+        std::cerr << "Prefilter rejected a colliding " << ( c.is_edge_edge ? "edge-edge" : "point-triangle" )
+                  << " candidate: " << c.x[0] << ", " << c.x[1] << ", " << c.x[2] << ", " << c.x[3] << " -> "
+                  << c.xnew[0] << ", " << c.xnew[1] << ", " << c.xnew[2] << ", " << c.xnew[3] << std::endl;
+    }
+}
+
+// ---------------------------------------------------------
+
+static void report( const char* name, const CandidateCounts& counts )
+{
+    std::cout << name << ": " << counts.candidates << " candidates, " << counts.rejected << " rejected by the prefilter, "
+              << counts.colliding << " colliding, " << counts.mismatches << " mismatches" << std::endl;
+}
+
+// ---------------------------------------------------------
+
+static double random_double( double lo, double hi )
+{
+    return lo + ( hi - lo ) * ( std::rand() / (double) RAND_MAX );
+}
+
+static Vec3d random_vec( double lo, double hi )
+{
+    return Vec3d( random_double( lo, hi ), random_double( lo, hi ), random_double( lo, hi ) );
+}
+
+// ---------------------------------------------------------
+///
+/// Candidates in the unit cube with random displacements.  Most are easy rejections.
+///
+// ---------------------------------------------------------
+
+static CandidateCounts test_random_candidates()
+{
+    CandidateCounts counts;
+
+    for ( unsigned int n = 0; n < nRandomCandidates; ++n )
+    {
+        Candidate c;
+        c.is_edge_edge = ( n % 2 == 1 );
+        for ( unsigned int i = 0; i < 4; ++i )
+        {
+            c.x[i] = random_vec( 0.0, 1.0 );
+            c.xnew[i] = c.x[i] + random_vec( -maxDisplacement, maxDisplacement );
+        }
+        check_candidate( c, counts );
+    }
+
+    return counts;
+}
+
+// ---------------------------------------------------------
+///
+/// Candidates whose vertices are coplanar, or very nearly so, at t=0 or t=1, which is where the coplanarity filter's
+/// error bound matters: a point ending on its triangle's plane, edges that end up crossing or touching, and primitives
+/// that stay in one plane throughout.
+///
+// ---------------------------------------------------------
+
+static CandidateCounts test_coplanar_candidates()
+{
+    CandidateCounts counts;
+
+    for ( unsigned int n = 0; n < nCoplanarCandidates; ++n )
+    {
+        Candidate c;
+        c.is_edge_edge = ( n % 2 == 1 );
+
+        // a plane through the origin spanned by u and v, with a random scale so that exponents vary
+        double scale = std::ldexp( 1.0, (int) ( n % 21 ) - 10 );
+        Vec3d origin = scale * random_vec( -1.0, 1.0 );
+        Vec3d u = scale * random_vec( -1.0, 1.0 );
+        Vec3d v = scale * random_vec( -1.0, 1.0 );
+        Vec3d w = cross( u, v ) / scale;
+
+        for ( unsigned int i = 0; i < 4; ++i )
+        {
+            Vec3d in_plane = origin + random_double( -1.0, 1.0 ) * u + random_double( -1.0, 1.0 ) * v;
+            c.x[i] = in_plane;
+            c.xnew[i] = in_plane;
+        }
+
+        switch ( n % 5 )
+        {
+            case 0:
+                // coplanar at t=1 only
+                for ( unsigned int i = 0; i < 4; ++i ) { c.x[i] += random_double( -1.0, 1.0 ) * w; }
+                break;
+            case 4:
+                // as above, but off the plane at t=1 by a small amount, down to the last few bits
+                for ( unsigned int i = 0; i < 4; ++i ) { c.x[i] += random_double( -1.0, 1.0 ) * w; }
+                c.xnew[0] += std::ldexp( random_double( -1.0, 1.0 ), -(int) ( n % 48 ) - 4 ) * w;
+                break;
+            case 1:
+                // coplanar at t=0 only
+                for ( unsigned int i = 0; i < 4; ++i ) { c.xnew[i] += random_double( -1.0, 1.0 ) * w; }
+                break;
+            case 2:
+                // coplanar throughout, with motion in the plane
+                for ( unsigned int i = 0; i < 4; ++i )
+                {
+                    c.xnew[i] += random_double( -0.5, 0.5 ) * u + random_double( -0.5, 0.5 ) * v;
+                }
+                break;
+            default:
+                // crossing the plane from one side to the other, offset by a tiny amount from the exact configuration
+                c.x[0] += w;
+                c.xnew[0] -= w;
+                if ( c.is_edge_edge )
+                {
+                    c.x[1] += w;
+                    c.xnew[1] -= w;
+                }
+                c.xnew[0] += 1e-14 * random_vec( -scale, scale );
+                break;
+        }
+
+        check_candidate( c, counts );
+    }
+
+    return counts;
+}
+
+// ---------------------------------------------------------
+///
+/// Candidates read from a dump written by set_ccd_candidate_dump_file().
+///
+// ---------------------------------------------------------
+
+static CandidateCounts test_candidate_dump( const char* filename )
+{
+    CandidateCounts counts;
+
+    std::ifstream dump( filename, std::ios::in | std::ios::binary );
+    if ( !dump.good() )
+    {
+        std::cerr << "Could not open " << filename << std::endl;
+        exit( 1 );
+    }
+
+    while ( true )
+    {
+        Candidate c;
+        char edge_edge;
+        dump.read( &edge_edge, 1 );
+        for ( unsigned int i = 0; i < 4; ++i ) { dump.read( reinterpret_cast<char*>( c.x[i].v ), 3 * sizeof(double) ); }
+        for ( unsigned int i = 0; i < 4; ++i ) { dump.read( reinterpret_cast<char*>( c.xnew[i].v ), 3 * sizeof(double) ); }
+        if ( !dump.good() ) { break; }
+
+        c.is_edge_edge = ( edge_edge != 0 );
+        check_candidate( c, counts );
+    }
+
+    return counts;
+}
+
+// ---------------------------------------------------------
+
+int main( int argc, char** argv )
+{
+    long mismatches = 0;
+
+    if ( argc > 1 )
+    {
+        for ( int i = 1; i < argc; ++i )
+        {
+            CandidateCounts counts = test_candidate_dump( argv[i] );
+            report( argv[i], counts );
+            mismatches += counts.mismatches;
+        }
+    }
+    else
+    {
+        std::srand( 1 );
+
+        CandidateCounts random_counts = test_random_candidates();
+        report( "Random candidates", random_counts );
+
+        CandidateCounts coplanar_counts = test_coplanar_candidates();
+        report( "Near-coplanar candidates", coplanar_counts );
+
+        mismatches = random_counts.mismatches + coplanar_counts.mismatches;
+    }
+
+    assert( mismatches == 0 );
+
+    return mismatches == 0 ? 0 : 1;
+}
+
+#else
+
+int main()
+{
+    std::cout << "USE_CCD_PREFILTER is not defined in ccd_defs.h, nothing to test" << std::endl;
+    return 0;
+}
+
+#endif
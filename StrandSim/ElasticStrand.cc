@@ -18,7 +18,9 @@ using namespace BASim;
 
 ElasticStrand::ElasticStrand( const VecXd& dofs, const ParametersType& parameters ) :
     m_parameters( parameters ), m_currentGeometry( new StrandGeometry( dofs ) ),
-            m_futureGeometry( new StrandGeometry( dofs ) ), m_readyForSolving( false )
+            m_futureGeometry( new StrandGeometry( dofs ) ), m_readyForSolving( false ),
+            m_currentBuiltInForcesComputed( false ), m_futureBuiltInForcesComputed( false ), m_asleep( false ),
+            m_quietSteps( 0 ), m_forcesInvalidated( false ), m_movingAtClumpingSnapshot( true )
 {
     // Allocate the Jacobian matrix and store it in a shared pointer.
     m_currentGeometry->m_totalJacobian = m_futureGeometry->m_totalJacobian = boost::shared_ptr<
@@ -86,6 +88,8 @@ void ElasticStrand::freezeRestShape()
         m_currentGeometry->computeKappa( m_restBends[vtx], vtx );
         m_restTwists[vtx] = 0; // TODO: check that this is correct
     }
+
+    wakeUp();
 }
 
 Mat2d ElasticStrand::computeBendingMatrix( const IndexType vtx ) const
@@ -158,24 +162,54 @@ void ElasticStrand::accumulateEFJ( StrandGeometry* geometry ) const
     }
 }
 
-// Compute energy, force and Jacobian, based on current geometry
-void ElasticStrand::prepareForSolving()
+void ElasticStrand::computeBuiltInEFJ()
 {
-    if ( m_readyForSolving )
-        return;
-
     m_currentGeometry->m_totalEnergy = 0.0;
     m_currentGeometry->m_totalForce.setZero();
     m_currentGeometry->m_totalJacobian->setZero();
 
-    m_currentGeometry->updateFrames();
-    // for ( IndexType vtx = 1; vtx < m_numVertices - 1; ++vtx )
-    //     m_bendingMatrices[vtx] = computeBendingMatrix( vtx );
-
     accumulateEFJ<StretchingForce> ( m_currentGeometry );
     accumulateEFJ<TwistingForce> ( m_currentGeometry );
     accumulateEFJ<BendingForce> ( m_currentGeometry );
     accumulateEFJ<GravitationForce> ( m_currentGeometry );
+}
+
+void ElasticStrand::computeBuiltInEF()
+{
+    m_futureGeometry->m_totalEnergy = 0.0;
+    m_futureGeometry->m_totalForce.setZero();
+
+    accumulateEF<StretchingForce> ( m_futureGeometry );
+    accumulateEF<TwistingForce> ( m_futureGeometry );
+    accumulateEF<BendingForce> ( m_futureGeometry );
+    accumulateEF<GravitationForce> ( m_futureGeometry );
+}
+
+void ElasticStrand::updateFutureFrames()
+{
+    m_futureGeometry->m_referenceFrames1 = m_currentGeometry->m_referenceFrames1; // We need the old ones to compute the new ones
+    m_futureGeometry->m_previousTangents = m_currentGeometry->m_previousTangents; // Can we avoid the copis?
+    m_futureGeometry->m_referenceTwists = m_currentGeometry->m_referenceTwists;
+
+    m_futureGeometry->updateFrames();
+}
+
+// Compute energy, force and Jacobian, based on current geometry
+void ElasticStrand::prepareForSolving()
+{
+    if ( m_readyForSolving )
+        return;
+
+    if ( m_currentBuiltInForcesComputed )
+        m_currentBuiltInForcesComputed = false;
+    else
+    {
+        m_currentGeometry->updateFrames();
+        // for ( IndexType vtx = 1; vtx < m_numVertices - 1; ++vtx )
+        //     m_bendingMatrices[vtx] = computeBendingMatrix( vtx );
+
+        computeBuiltInEFJ();
+    }
 
     for ( std::list<ForceBase*>::const_iterator force = m_externalForces.begin(); force
             != m_externalForces.end(); ++force )
@@ -193,21 +227,16 @@ void ElasticStrand::prepareForExamining()
     if ( m_readyForExamining )
         return;
 
-    m_futureGeometry->m_referenceFrames1 = m_currentGeometry->m_referenceFrames1; // We need the old ones to compute the new ones
-    m_futureGeometry->m_previousTangents = m_currentGeometry->m_previousTangents; // Can we avoid the copis?
-    m_futureGeometry->m_referenceTwists = m_currentGeometry->m_referenceTwists;
-
-    m_futureGeometry->updateFrames();
-    //  for ( IndexType vtx = 1; vtx < m_numVertices - 1; ++vtx )
-    //      m_bendingMatrices[vtx] = computeBendingMatrix( vtx );
-
-    m_futureGeometry->m_totalEnergy = 0.0;
-    m_futureGeometry->m_totalForce.setZero();
+    if ( m_futureBuiltInForcesComputed )
+        m_futureBuiltInForcesComputed = false;
+    else
+    {
+        updateFutureFrames();
+        //  for ( IndexType vtx = 1; vtx < m_numVertices - 1; ++vtx )
+        //      m_bendingMatrices[vtx] = computeBendingMatrix( vtx );
 
-    accumulateEF<StretchingForce> ( m_futureGeometry );
-    accumulateEF<TwistingForce> ( m_futureGeometry );
-    accumulateEF<BendingForce> ( m_futureGeometry );
-    accumulateEF<GravitationForce> ( m_futureGeometry );
+        computeBuiltInEF();
+    }
 
     for ( std::list<ForceBase*>::const_iterator force = m_externalForces.begin(); force
             != m_externalForces.end(); ++force )
@@ -222,6 +251,7 @@ void ElasticStrand::acceptNewPositions()
     assert( m_readyForExamining );
 
     std::swap( m_currentGeometry, m_futureGeometry );
+    m_currentBuiltInForcesComputed = m_futureBuiltInForcesComputed = false;
 
     // Compute the Jacobian
     m_currentGeometry->m_totalJacobian->setZero();
@@ -243,10 +273,51 @@ void ElasticStrand::acceptNewPositions()
     m_readyForSolving = true;
 }
 
+void ElasticStrand::invalidateForces()
+{
+    m_asleep = false;
+    m_quietSteps = 0;
+    m_forcesInvalidated = true;
+
+    m_readyForSolving = false;
+    m_readyForExamining = false;
+    prepareForSolving();
+}
+
+void ElasticStrand::wakeUp()
+{
+    if ( m_asleep )
+        invalidateForces();
+    else
+        m_quietSteps = 0;
+}
+
+void ElasticStrand::updateSleepState( const Scalar threshold, const int numSteps )
+{
+    if ( m_currentGeometry->m_totalForce.norm() < threshold )
+    {
+        if ( ++m_quietSteps >= numSteps )
+            m_asleep = true;
+    }
+    else
+        m_quietSteps = 0;
+}
+
+bool ElasticStrand::hasMovingClumpingAttractor() const
+{
+    for ( std::vector<const ElasticStrand*>::const_iterator attractor = m_clumpingAttractors.begin(); attractor
+            != m_clumpingAttractors.end(); ++attractor )
+        if ( ( *attractor )->m_movingAtClumpingSnapshot )
+            return true;
+
+    return false;
+}
+
 void ElasticStrand::filterNewGeometryLength()
 {
     m_futureGeometry->m_framesUpToDate = false; // Because we are changing stuff below
     m_readyForExamining = false;
+    m_futureBuiltInForcesComputed = false;
 
     Vec3d xaP = m_currentGeometry->getVertex( 1 );
     Vec3d xaN = m_futureGeometry->getVertex( 1 );
@@ -272,12 +343,18 @@ void ElasticStrand::filterNewGeometryLength()
 
 Vec3d ElasticStrand::closestPoint( const Vec3d& x ) const
 {
+    // Called by other strands' clumping forces, so read the snapshot if there is one: this strand may be being stepped.
+    if ( m_clumpingSnapshot.size() > 0 )
+        return m_clumpingTree.closestPoint( m_clumpingSnapshot, x );
+
+    const VecXd& dofs = m_currentGeometry->m_degreesOfFreedom;
+
     Scalar mindist = std::numeric_limits<Scalar>::max();
     Vec3d winner;
 
     for ( int vtx = 0; vtx < m_numVertices - 1; ++vtx )
     {
-        Vec3d y = ClosestPtPointSegment( x, getVertex( vtx ), getVertex( vtx + 1 ) );
+        Vec3d y = ClosestPtPointSegment( x, dofs.segment<3> ( 4 * vtx ), dofs.segment<3> ( 4 * vtx + 4 ) );
         Scalar dist = ( y - x ).squaredNorm();
         if ( dist < mindist )
         {
@@ -9,6 +9,7 @@
 #define ELASTICSTRAND_HH_
 
 #include <list>
+#include <vector>
 
 #include "StrandBase.hh"
 #include "StrandGeometry.hh"
@@ -17,6 +18,7 @@
 #include "ElasticStrandParameters.hh"
 #include "Typelist.hh"
 #include "Forces/ForceBase.hh"
+#include "SegmentIndex.hh"
 
 namespace strandsim
 {
@@ -48,6 +50,7 @@ public:
     {
         m_futureGeometry->m_framesUpToDate = false;
         m_readyForExamining = false;
+        m_futureBuiltInForcesComputed = false;
 
         return m_futureGeometry->m_degreesOfFreedom;
     }
@@ -113,17 +116,96 @@ public:
     void prepareForExamining();
     void acceptNewPositions();
 
+    // Reset the energy, force and Jacobian of the current geometry to those of the built-in forces alone. Frames must
+    // be up to date. StrandForceBatch does the same for many strands at once; the next prepareForSolving() then only
+    // adds the external forces.
+    void computeBuiltInEFJ();
+
+    // Reset the energy and force of the future geometry to those of the built-in forces alone
+    void computeBuiltInEF();
+
+    // Bring the frames of the future geometry up to date, as prepareForExamining() does before computing its forces
+    void updateFutureFrames();
+
+    // Copy the current vertices to where the clumping forces of other strands read them, and refit the segment
+    // hierarchy used to find closest points on them. Once a snapshot is stored, this strand can be stepped while
+    // others are attracted to it.
+    void storeClumpingSnapshot()
+    {
+        m_clumpingSnapshot = m_currentGeometry->m_degreesOfFreedom;
+        m_clumpingTree.refit( m_clumpingSnapshot );
+        m_movingAtClumpingSnapshot = !m_asleep && m_quietSteps == 0;
+    }
+
+    // Drop the snapshot, so that closestPoint() reads the current vertices again. Strands stepped outside of a
+    // StrandStepManager would otherwise be attracted to where others were when the snapshots were last stored.
+    void clearClumpingSnapshot()
+    {
+        m_clumpingSnapshot.resize( 0 );
+    }
+
+    const VecXd& getClumpingSnapshot() const
+    {
+        return m_clumpingSnapshot;
+    }
+
+    // Strands this one is attracted to by its clumping forces. Changing them invalidates the forces.
+    void setClumpingAttractors( const std::vector<const ElasticStrand*>& attractors )
+    {
+        if ( attractors != m_clumpingAttractors )
+        {
+            m_clumpingAttractors = attractors;
+            invalidateForces();
+        }
+    }
+
+    const std::vector<const ElasticStrand*>& getClumpingAttractors() const
+    {
+        return m_clumpingAttractors;
+    }
+
+    // Whether one of the attractors was moving, that is awake and not yet at rest, when the snapshots were last stored
+    bool hasMovingClumpingAttractor() const;
+
     void addExternalForce( ForceBase* force )
     {
         m_externalForces.push_back( force );
+        invalidateForces();
     }
 
-private:
-    const std::list<ElasticStrand*>& getClumpingAttractors() const
+    // To be called when the forces on the strand change, or its fixed degrees of freedom move: recomputes the energy,
+    // force and Jacobian of the current geometry, without any regularisation a stepper may have added, and wakes the
+    // strand up.
+    void invalidateForces();
+
+    // Whether invalidateForces() was called since the last clearForcesInvalidated(). A stepper keeping state across
+    // steps of this strand, such as a trust region, should start over when it is set.
+    bool forcesInvalidated() const
     {
-        return m_clumpingAttractors;
+        return m_forcesInvalidated;
     }
 
+    void clearForcesInvalidated()
+    {
+        m_forcesInvalidated = false;
+    }
+
+    // A strand at rest falls asleep, and is not stepped until woken up. Anything changing the forces on a strand, or
+    // its fixed degrees of freedom, must invalidate them, which wakes it up.
+    bool isAsleep() const
+    {
+        return m_asleep;
+    }
+
+    // Invalidates the forces if the strand was asleep, as they may have changed since
+    void wakeUp();
+
+    // To be called after each step: the strand falls asleep once the norm of its total force has stayed below
+    // threshold for numSteps consecutive steps. The forces on fixed degrees of freedom must have been zeroed.
+    void updateSleepState( const Scalar threshold, const int numSteps );
+
+private:
+
     // For testing only, otherwise private:
     void resizeInternals();
     void freezeRestShape();
@@ -168,11 +250,23 @@ private:
     // Flags
     bool m_readyForExamining;
     bool m_readyForSolving;
+    bool m_currentBuiltInForcesComputed; // by StrandForceBatch, for the next prepareForSolving() to complete
+    bool m_futureBuiltInForcesComputed; // by StrandForceBatch, for the next prepareForExamining() to complete
+
+    // Sleeping
+    bool m_asleep;
+    int m_quietSteps; // consecutive steps with a force below the sleep threshold
+    bool m_forcesInvalidated;
 
     // Forces that are not built-in
     std::list<ForceBase*> m_externalForces;
 
-    std::list<ElasticStrand*> m_clumpingAttractors;
+    std::vector<const ElasticStrand*> m_clumpingAttractors;
+
+    // Degrees of freedom as of the last storeClumpingSnapshot(), read by closestPoint(). Empty if none is stored.
+    VecXd m_clumpingSnapshot;
+    SegmentBVH m_clumpingTree;
+    bool m_movingAtClumpingSnapshot;
 
 public:
     friend class StretchingForce;
@@ -180,6 +274,7 @@ public:
     friend class TwistingForce;
     friend class GravitationForce;
     friend class ClumpingForce;
+    friend class StrandForceBatch;
     friend std::ostream& operator<<( std::ostream& os, const ElasticStrand& strand );
 };
 
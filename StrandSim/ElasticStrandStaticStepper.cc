@@ -19,6 +19,25 @@ ElasticStrandStaticStepper::~ElasticStrandStaticStepper()
 {
 }
 
+ElasticStrandStaticStepper::StateType ElasticStrandStaticStepper::getState() const
+{
+    StateType state;
+    state.m_successcount = m_successcount;
+    state.m_failurecount = m_failurecount;
+    state.m_lambda = m_lambda;
+    state.m_previousLambda = m_previousLambda;
+
+    return state;
+}
+
+void ElasticStrandStaticStepper::setState( const StateType& state )
+{
+    m_successcount = state.m_successcount;
+    m_failurecount = state.m_failurecount;
+    m_lambda = state.m_lambda;
+    m_previousLambda = state.m_previousLambda;
+}
+
 inline Scalar clipValue( Scalar minvalue, Scalar variable, Scalar maxvalue )
 {
     // funny wrap-around behavior ensures we don't get "stuck" at lambda=maxvalue
@@ -28,14 +47,27 @@ inline Scalar clipValue( Scalar minvalue, Scalar variable, Scalar maxvalue )
     return fmin( fmax( variable, minvalue ), maxvalue );
 }
 
+static const int numberOfFixedDOFs = 7;
+
 void ElasticStrandStaticStepper::execute( ElasticStrand& strand )
 {
-    assert( strand.readyForSolving() );
+    if ( solve( strand ) )
+        examine( strand );
+}
 
-    static const int numberOfFixedDOFs = 7;
+bool ElasticStrandStaticStepper::solve( ElasticStrand& strand )
+{
+    if ( strand.isAsleep() )
+        return false;
 
-    const Scalar E = strand.getTotalEnergy();
-    //  std::cout << "Energy before = " << E << '\n';
+    // The Jacobian was recomputed without the regularisation added by previous steps
+    if ( strand.forcesInvalidated() )
+    {
+        setState( StateType() );
+        strand.clearForcesInvalidated();
+    }
+
+    assert( strand.readyForSolving() );
 
     VecXd& F = strand.getTotalForces();
     F.segment<numberOfFixedDOFs> ( 0 ).setZero(); // Enforce fixed DOFs
@@ -53,11 +85,19 @@ void ElasticStrandStaticStepper::execute( ElasticStrand& strand )
 
     VecXd& newDOFs = strand.getNewDegreesOfFreedom();
 
-    linearSolver.solve( newDOFs, J, F ); // X = J^{-1} F
+    linearSolver.solveSymmetric( newDOFs, J, F ); // X = J^{-1} F; J is symmetric
     newDOFs += strand.getDegreesOfFreedom(); // X = X_0 + J^{-1} F
     // std::cout << "Proposed new DOFS = " << newDOFs << '\n';
 
-    // Update the new position's frames and forces
+    return true;
+}
+
+void ElasticStrandStaticStepper::examine( ElasticStrand& strand )
+{
+    const Scalar E = strand.getTotalEnergy();
+    //  std::cout << "Energy before = " << E << '\n';
+
+    // Update the new position's frames and forces, unless the built-in ones were already computed by a batch
     strand.prepareForExamining();
 
     const Scalar newE = strand.getNewTotalEnergy();
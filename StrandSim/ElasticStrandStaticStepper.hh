@@ -21,8 +21,33 @@ public:
     ElasticStrandStaticStepper();
     virtual ~ElasticStrandStaticStepper();
 
+    // Trust region, which a strand should keep from one step to the next: after a rejected step, the regularisation is
+    // left in the strand's Jacobian and only its increment is added on the next try.
+    struct StateType
+    {
+        StateType() :
+            m_successcount( 1 ), m_failurecount( 0 ), m_lambda( 1.0e-3 ), m_previousLambda( 0.0 )
+        {
+        }
+
+        int m_successcount;
+        int m_failurecount;
+        Scalar m_lambda;
+        Scalar m_previousLambda;
+    };
+
+    // Take one step towards equilibrium. Sleeping strands are left as they are.
     void execute( ElasticStrand& strand );
 
+    // The two halves of execute(), for callers that compute the forces at the new position in between (see
+    // StrandStepManager::setBatchedForces()): solve() proposes new degrees of freedom and returns false if the strand
+    // is asleep; examine() then accepts or rejects them, and must be called with the state solve() left.
+    bool solve( ElasticStrand& strand );
+    void examine( ElasticStrand& strand );
+
+    StateType getState() const;
+    void setState( const StateType& state );
+
 private:
     static const int m_maxlsit = 5;
     static const Scalar m_lambdamin = 1.0e-8;
@@ -25,18 +25,18 @@ ClumpingForce::~ClumpingForce()
 
 void ClumpingForce::accumulateEF( StrandGeometry& geometry, const ElasticStrand& strand ) const
 {
-    const std::list<ElasticStrand*>& attractors = strand.getClumpingAttractors();
+    const std::vector<const ElasticStrand*>& attractors = strand.getClumpingAttractors();
 
-    for ( std::list<ElasticStrand*>::const_iterator attractor = attractors.begin(); attractor
+    for ( std::vector<const ElasticStrand*>::const_iterator attractor = attractors.begin(); attractor
             != attractors.end(); ++attractor )
         accumulateMutualEF( geometry.m_totalEnergy, geometry.m_totalForce, strand, *( *attractor ) );
 }
 
 void ClumpingForce::accumulateEFJ( StrandGeometry& geometry, const ElasticStrand& strand ) const
 {
-    const std::list<ElasticStrand*>& attractors = strand.getClumpingAttractors();
+    const std::vector<const ElasticStrand*>& attractors = strand.getClumpingAttractors();
 
-    for ( std::list<ElasticStrand*>::const_iterator attractor = attractors.begin(); attractor
+    for ( std::vector<const ElasticStrand*>::const_iterator attractor = attractors.begin(); attractor
             != attractors.end(); ++attractor )
         accumulateMutualEFJ( geometry.m_totalEnergy, geometry.m_totalForce,
                 *( geometry.m_totalJacobian ), strand, *( *attractor ) );
@@ -44,9 +44,9 @@ void ClumpingForce::accumulateEFJ( StrandGeometry& geometry, const ElasticStrand
 
 void ClumpingForce::accumulateJ( StrandGeometry& geometry, const ElasticStrand& strand ) const
 {
-    const std::list<ElasticStrand*>& attractors = strand.getClumpingAttractors();
+    const std::vector<const ElasticStrand*>& attractors = strand.getClumpingAttractors();
 
-    for ( std::list<ElasticStrand*>::const_iterator attractor = attractors.begin(); attractor
+    for ( std::vector<const ElasticStrand*>::const_iterator attractor = attractors.begin(); attractor
             != attractors.end(); ++attractor )
         accumulateMutualJ( *( geometry.m_totalJacobian ), strand, *( *attractor ) );
 }
@@ -51,6 +51,11 @@ public:
         s_gravity = gravity;
     }
 
+    static const Vec3d& getGravity()
+    {
+        return s_gravity;
+    }
+
 private:
     static Vec3d s_gravity;
 };
@@ -8,6 +8,8 @@
 #include "LinearSolver.hh"
 #include "BandMatrix.hh"
 #include <mkl.h>
+#include <algorithm>
+#include <cmath>
 
 namespace strandsim
 {
@@ -61,6 +63,82 @@ int BandMatrixLinearSolver<kl, ku>::solve( VecXd& x, const BandMatrix<double, kl
     return info;
 }
 
+template<int kl, int ku>
+bool BandMatrixLinearSolver<kl, ku>::choleskyFactor( const BandMatrix<double, kl, ku>& A )
+{
+    static const int w = kl + 1; // Stored entries per row of L
+    const int n = A.cols();
+    const std::vector<Scalar>& data = A.getData();
+
+    m_l.resize( w * n );
+
+    // Row by row: each entry of L is the corresponding entry of A, minus the dot product of two contiguous row
+    // segments of L computed already.
+    for ( int i = 0; i < n; ++i )
+    {
+        const int first = std::max( 0, i - kl );
+        Scalar* Li = &m_l[i * w + kl - i]; // Li[j] = L(i, j)
+
+        for ( int j = first; j <= i; ++j )
+        {
+            const Scalar* Lj = &m_l[j * w + kl - j];
+
+            Scalar s = data[( ku + i - j ) * n + j]; // A(i, j)
+            for ( int k = first; k < j; ++k )
+                s -= Li[k] * Lj[k];
+
+            if ( j < i )
+                Li[j] = s / Lj[j];
+            else if ( s > 0.0 )
+                Li[i] = sqrt( s );
+            else
+                return false;
+        }
+    }
+
+    return true;
+}
+
+template<int kl, int ku>
+int BandMatrixLinearSolver<kl, ku>::solveSymmetric( VecXd& x, const BandMatrix<double, kl, ku>& A,
+        const VecXd& b )
+{
+    assert( A.rows() == A.cols() );
+    assert( b.rows() == A.cols() );
+    assert( x.rows() == A.cols() );
+
+    static const int w = kl + 1;
+    const int n = A.cols();
+
+    // Indefinite, e.g. far from equilibrium with a small regularisation: use the pivoted LU instead
+    if ( !choleskyFactor( A ) )
+        return solve( x, A, b );
+
+    x = b;
+
+    // Forward substitution: L y = b
+    for ( int i = 0; i < n; ++i )
+    {
+        const Scalar* Li = &m_l[i * w + kl - i];
+        Scalar s = x[i];
+        for ( int k = std::max( 0, i - kl ); k < i; ++k )
+            s -= Li[k] * x[k];
+        x[i] = s / Li[i];
+    }
+
+    // Back substitution: L^T x = y, subtracting each solved unknown from the rows above it
+    for ( int i = n - 1; i >= 0; --i )
+    {
+        const Scalar* Li = &m_l[i * w + kl - i];
+        x[i] /= Li[i];
+        const Scalar xi = x[i];
+        for ( int k = std::max( 0, i - kl ); k < i; ++k )
+            x[k] -= Li[k] * xi;
+    }
+
+    return 0;
+}
+
 template class BandMatrixLinearSolver<10, 10> ;
 
 }
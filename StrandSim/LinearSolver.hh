@@ -23,9 +23,19 @@ public:
 
     int solve( VecXd& x, const BandMatrix<Scalar, kl, ku>& A, const VecXd& b );
 
+    // Solve for a symmetric A, of which only the lower band is read. A banded Cholesky factorization is tried first,
+    // at about half the cost of solve(); if A turns out not to be positive definite, this falls back to solve().
+    int solveSymmetric( VecXd& x, const BandMatrix<Scalar, kl, ku>& A, const VecXd& b );
+
 private:
+    // Factor A = L L^T into m_l, reading A's band storage directly. Returns false if A is not positive definite.
+    bool choleskyFactor( const BandMatrix<Scalar, kl, ku>& A );
+
     std::vector<Scalar> m_ab;
     std::vector<int> m_ipiv;
+
+    // Rows of the Cholesky factor: L(i, j) for j = i - kl .. i is stored at m_l[i * (kl + 1) + kl + j - i]
+    std::vector<Scalar> m_l;
 };
 
 }
@@ -0,0 +1,265 @@
+/*
+ * SegmentIndex.cc
+ *
+ *  Spatial indices over the segments of strands, for the clumping forces.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "SegmentIndex.hh"
+#include "ElasticStrandUtils.hh"
+
+namespace strandsim
+{
+
+// Number of segments below which a node is not split
+static const int s_leafSize = 2;
+
+static inline void segmentBox( Vec3d& lo, Vec3d& hi, const VecXd& dofs, const int segment )
+{
+    for ( int k = 0; k < 3; ++k )
+    {
+        const Scalar a = dofs[4 * segment + k];
+        const Scalar b = dofs[4 * segment + 4 + k];
+        lo[k] = std::min( a, b );
+        hi[k] = std::max( a, b );
+    }
+}
+
+static inline void growBox( Vec3d& lo, Vec3d& hi, const Vec3d& otherLo, const Vec3d& otherHi )
+{
+    for ( int k = 0; k < 3; ++k )
+    {
+        lo[k] = std::min( lo[k], otherLo[k] );
+        hi[k] = std::max( hi[k], otherHi[k] );
+    }
+}
+
+static inline Scalar squaredBoxDistance( const Vec3d& lo, const Vec3d& hi, const Vec3d& x )
+{
+    Scalar d2 = 0.0;
+    for ( int k = 0; k < 3; ++k )
+    {
+        const Scalar d = std::max( std::max( lo[k] - x[k], x[k] - hi[k] ), 0.0 );
+        d2 += d * d;
+    }
+    return d2;
+}
+
+static inline bool boxesWithin( const Vec3d& lo1, const Vec3d& hi1, const Vec3d& lo2, const Vec3d& hi2,
+        const Scalar radius )
+{
+    Scalar d2 = 0.0;
+    for ( int k = 0; k < 3; ++k )
+    {
+        const Scalar d = std::max( std::max( lo1[k] - hi2[k], lo2[k] - hi1[k] ), 0.0 );
+        d2 += d * d;
+    }
+    return d2 <= radius * radius;
+}
+
+SegmentBVH::SegmentBVH() :
+    m_numVertices( 0 )
+{
+}
+
+int SegmentBVH::build( int begin, int end )
+{
+    const int index = static_cast<int> ( m_nodes.size() );
+    m_nodes.push_back( Node() );
+    m_nodes[index].m_begin = begin;
+    m_nodes[index].m_end = end;
+    m_nodes[index].m_right = -1;
+
+    if ( end - begin > s_leafSize )
+    {
+        const int middle = ( begin + end ) / 2;
+        build( begin, middle );
+        const int right = build( middle, end );
+        m_nodes[index].m_right = right;
+    }
+
+    return index;
+}
+
+void SegmentBVH::refit( const VecXd& dofs )
+{
+    const int numVertices = static_cast<int> ( ( dofs.size() + 1 ) / 4 );
+
+    if ( numVertices != m_numVertices )
+    {
+        m_nodes.clear();
+        m_numVertices = numVertices;
+        if ( numVertices >= 2 )
+            build( 0, numVertices - 1 );
+    }
+
+    // Children come after their parent, so going backwards refits them first
+    for ( int i = static_cast<int> ( m_nodes.size() ) - 1; i >= 0; --i )
+    {
+        Node& node = m_nodes[i];
+
+        if ( node.m_right < 0 )
+        {
+            segmentBox( node.m_min, node.m_max, dofs, node.m_begin );
+            for ( int seg = node.m_begin + 1; seg < node.m_end; ++seg )
+            {
+                Vec3d lo, hi;
+                segmentBox( lo, hi, dofs, seg );
+                growBox( node.m_min, node.m_max, lo, hi );
+            }
+        }
+        else
+        {
+            const Node& left = m_nodes[i + 1];
+            const Node& right = m_nodes[node.m_right];
+            node.m_min = left.m_min;
+            node.m_max = left.m_max;
+            growBox( node.m_min, node.m_max, right.m_min, right.m_max );
+        }
+    }
+}
+
+Vec3d SegmentBVH::closestPoint( const VecXd& dofs, const Vec3d& x ) const
+{
+    Scalar mindist = std::numeric_limits<Scalar>::max();
+    Vec3d winner;
+
+    if ( m_nodes.empty() )
+        return winner;
+
+    // Depth first, nearer child first, skipping nodes whose box is farther than the best point found so far. The
+    // hierarchy is balanced, so its depth is at most log2 of the maximum number of vertices.
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while ( top > 0 )
+    {
+        const Node& node = m_nodes[stack[--top]];
+        if ( squaredBoxDistance( node.m_min, node.m_max, x ) >= mindist )
+            continue;
+
+        if ( node.m_right < 0 )
+        {
+            for ( int seg = node.m_begin; seg < node.m_end; ++seg )
+            {
+                Vec3d y = ClosestPtPointSegment( x, dofs.segment<3> ( 4 * seg ), dofs.segment<3> ( 4 * seg + 4 ) );
+                Scalar dist = ( y - x ).squaredNorm();
+                if ( dist < mindist )
+                {
+                    mindist = dist;
+                    winner = y;
+                }
+            }
+        }
+        else
+        {
+            const int left = static_cast<int> ( &node - &m_nodes[0] ) + 1;
+            const int right = node.m_right;
+            const Scalar leftDist = squaredBoxDistance( m_nodes[left].m_min, m_nodes[left].m_max, x );
+            const Scalar rightDist = squaredBoxDistance( m_nodes[right].m_min, m_nodes[right].m_max, x );
+
+            if ( leftDist < rightDist )
+            {
+                stack[top++] = right;
+                stack[top++] = left;
+            }
+            else
+            {
+                stack[top++] = left;
+                stack[top++] = right;
+            }
+        }
+    }
+
+    return winner;
+}
+
+SegmentGrid::SegmentGrid( const Scalar cellSize ) :
+    m_cellSize( cellSize )
+{
+}
+
+int SegmentGrid::cellCoordinate( const Scalar x ) const
+{
+    return static_cast<int> ( std::floor( x / m_cellSize ) );
+}
+
+void SegmentGrid::insert( const int strand, const VecXd& dofs )
+{
+    if ( strand >= static_cast<int> ( m_dofs.size() ) )
+        m_dofs.resize( strand + 1, NULL );
+    m_dofs[strand] = &dofs;
+
+    const int numSegments = static_cast<int> ( ( dofs.size() + 1 ) / 4 ) - 1;
+
+    Entry entry;
+    entry.m_strand = strand;
+
+    for ( int seg = 0; seg < numSegments; ++seg )
+    {
+        Vec3d lo, hi;
+        segmentBox( lo, hi, dofs, seg );
+        entry.m_segment = seg;
+
+        const int i0 = cellCoordinate( lo[0] ), i1 = cellCoordinate( hi[0] );
+        const int j0 = cellCoordinate( lo[1] ), j1 = cellCoordinate( hi[1] );
+        const int k0 = cellCoordinate( lo[2] ), k1 = cellCoordinate( hi[2] );
+
+        for ( entry.m_cell[0] = i0; entry.m_cell[0] <= i1; ++entry.m_cell[0] )
+            for ( entry.m_cell[1] = j0; entry.m_cell[1] <= j1; ++entry.m_cell[1] )
+                for ( entry.m_cell[2] = k0; entry.m_cell[2] <= k1; ++entry.m_cell[2] )
+                    m_entries.push_back( entry );
+    }
+}
+
+void SegmentGrid::finalize()
+{
+    std::sort( m_entries.begin(), m_entries.end() );
+}
+
+void SegmentGrid::strandsNear( std::vector<int>& result, const int strand, const VecXd& dofs,
+        const Scalar radius ) const
+{
+    result.clear();
+
+    const int numSegments = static_cast<int> ( ( dofs.size() + 1 ) / 4 ) - 1;
+
+    Entry key;
+
+    for ( int seg = 0; seg < numSegments; ++seg )
+    {
+        Vec3d lo, hi;
+        segmentBox( lo, hi, dofs, seg );
+
+        const int i0 = cellCoordinate( lo[0] - radius ), i1 = cellCoordinate( hi[0] + radius );
+        const int j0 = cellCoordinate( lo[1] - radius ), j1 = cellCoordinate( hi[1] + radius );
+        const int k0 = cellCoordinate( lo[2] - radius ), k1 = cellCoordinate( hi[2] + radius );
+
+        for ( key.m_cell[0] = i0; key.m_cell[0] <= i1; ++key.m_cell[0] )
+            for ( key.m_cell[1] = j0; key.m_cell[1] <= j1; ++key.m_cell[1] )
+                for ( key.m_cell[2] = k0; key.m_cell[2] <= k1; ++key.m_cell[2] )
+                {
+                    std::pair<std::vector<Entry>::const_iterator, std::vector<Entry>::const_iterator> cell =
+                            std::equal_range( m_entries.begin(), m_entries.end(), key );
+
+                    for ( std::vector<Entry>::const_iterator entry = cell.first; entry != cell.second; ++entry )
+                    {
+                        if ( entry->m_strand == strand )
+                            continue;
+
+                        Vec3d otherLo, otherHi;
+                        segmentBox( otherLo, otherHi, *m_dofs[entry->m_strand], entry->m_segment );
+                        if ( boxesWithin( lo, hi, otherLo, otherHi, radius ) )
+                            result.push_back( entry->m_strand );
+                    }
+                }
+    }
+
+    std::sort( result.begin(), result.end() );
+    result.erase( std::unique( result.begin(), result.end() ), result.end() );
+}
+
+}
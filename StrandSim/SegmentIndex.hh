@@ -0,0 +1,125 @@
+/*
+ * SegmentIndex.hh
+ *
+ *  Spatial indices over the segments of strands, for the clumping forces.
+ */
+
+#ifndef SEGMENTINDEX_HH_
+#define SEGMENTINDEX_HH_
+
+#include <vector>
+#include "Definitions.hh"
+
+namespace strandsim
+{
+
+// Bounding volume hierarchy over the segments of one strand, whose vertices are dofs.segment<3>( 4 * vtx ). Segments
+// are contiguous along a strand, so each node covers a range of consecutive segments and the hierarchy depends only on
+// the number of vertices: it is built once, and only its boxes are recomputed when the strand moves.
+class SegmentBVH
+{
+public:
+    SegmentBVH();
+
+    // Recompute the boxes for the given degrees of freedom, rebuilding the hierarchy if the number of vertices changed
+    void refit( const VecXd& dofs );
+
+    void clear()
+    {
+        m_nodes.clear();
+    }
+
+    bool empty() const
+    {
+        return m_nodes.empty();
+    }
+
+    // Closest point to x on the polyline. dofs must be those of the last refit().
+    Vec3d closestPoint( const VecXd& dofs, const Vec3d& x ) const;
+
+    // Bounding box of the whole strand
+    const Vec3d& getMin() const
+    {
+        return m_nodes.front().m_min;
+    }
+
+    const Vec3d& getMax() const
+    {
+        return m_nodes.front().m_max;
+    }
+
+private:
+    // Nodes are stored depth first: the left child of a node follows it, and children always come after their parent.
+    struct Node
+    {
+        Vec3d m_min;
+        Vec3d m_max;
+        int m_begin; // first segment
+        int m_end; // one past the last segment
+        int m_right; // right child, or -1 for a leaf
+    };
+
+    int build( int begin, int end );
+
+    std::vector<Node> m_nodes;
+    int m_numVertices;
+};
+
+// Uniform grid over the segments of many strands, for finding the strands near a given one. Strands are inserted with
+// an index chosen by the caller; the grid must be finalized before it is queried, and can then be queried concurrently.
+class SegmentGrid
+{
+public:
+    explicit SegmentGrid( const Scalar cellSize = 1.0 );
+
+    void setCellSize( const Scalar cellSize )
+    {
+        m_cellSize = cellSize;
+    }
+
+    Scalar getCellSize() const
+    {
+        return m_cellSize;
+    }
+
+    void clear()
+    {
+        m_entries.clear();
+        m_dofs.clear();
+    }
+
+    // Insert the segments of a strand. dofs must stay valid, and unchanged, until the grid is cleared.
+    void insert( const int strand, const VecXd& dofs );
+
+    void finalize();
+
+    // Indices of the inserted strands, other than strand, having a segment whose bounding box is within radius of the
+    // bounding box of one of the segments in dofs. Sorted, without repetitions.
+    void strandsNear( std::vector<int>& result, const int strand, const VecXd& dofs, const Scalar radius ) const;
+
+private:
+    struct Entry
+    {
+        int m_cell[3];
+        int m_strand;
+        int m_segment;
+
+        bool operator<( const Entry& other ) const
+        {
+            for ( int k = 0; k < 3; ++k )
+                if ( m_cell[k] != other.m_cell[k] )
+                    return m_cell[k] < other.m_cell[k];
+            return false;
+        }
+    };
+
+    int cellCoordinate( const Scalar x ) const;
+
+    Scalar m_cellSize;
+    std::vector<Entry> m_entries; // sorted by cell once finalized
+    std::vector<const VecXd*> m_dofs; // indexed by strand
+};
+
+}
+
+#endif /* SEGMENTINDEX_HH_ */
@@ -0,0 +1,472 @@
+/*
+ * StrandForceBatch.cc
+ *
+ *  Batched evaluation of the built-in forces of many strands.
+ */
+
+#include <algorithm>
+#include "StrandForceBatch.hh"
+#include "Forces/StretchingForce.hh"
+#include "Forces/TwistingForce.hh"
+#include "Forces/BendingForce.hh"
+#include "Forces/GravitationForce.hh"
+
+namespace strandsim
+{
+
+static const int W = StrandForceBatch::s_laneWidth;
+
+StrandForceBatch::StrandForceBatch( const std::vector<ElasticStrand*>& strands ) :
+    m_strands( strands ), m_numBlocks( ( static_cast<int> ( strands.size() ) + W - 1 ) / W ),
+            m_numVertices( 2 )
+{
+    for ( std::vector<ElasticStrand*>::const_iterator strand = m_strands.begin(); strand != m_strands.end(); ++strand )
+        m_numVertices = std::max( m_numVertices, static_cast<int> ( ( *strand )->m_numVertices ) );
+    m_numDofs = 4 * m_numVertices - 1;
+
+    m_ks.resize( m_numBlocks * W, 0.0 );
+    m_kt.resize( m_numBlocks * W, 0.0 );
+    for ( int k = 0; k < 4; ++k )
+        m_bendingMatrix[k].resize( m_numBlocks * W, 0.0 );
+    m_energy.resize( m_numBlocks * W, 0.0 );
+
+    m_vertexData.resize( m_numBlocks * m_numVertices * NUM_VERTEX_QUANTITIES * W, 0.0 );
+    m_forces.resize( m_numBlocks * m_numDofs * W, 0.0 );
+
+    // Padding lanes and rows keep unit lengths, and zero stiffnesses, masses and inverse lengths, so that they
+    // contribute nothing and do not divide by zero.
+    for ( int block = 0; block < m_numBlocks; ++block )
+        for ( int vtx = 0; vtx < m_numVertices; ++vtx )
+        {
+            std::fill( vertexData( block, vtx, LENGTH ), vertexData( block, vtx, LENGTH ) + W, 1.0 );
+            std::fill( vertexData( block, vtx, REST_LENGTH ), vertexData( block, vtx, REST_LENGTH ) + W, 1.0 );
+        }
+
+    for ( int i = 0; i < static_cast<int> ( m_strands.size() ); ++i )
+        gatherRestShape( i / W, i % W );
+}
+
+StrandForceBatch::~StrandForceBatch()
+{
+}
+
+void StrandForceBatch::computeBuiltInEFJ()
+{
+#pragma omp parallel for schedule(dynamic)
+    for ( int block = 0; block < m_numBlocks; ++block )
+        computeBuiltInEFJ( block );
+}
+
+void StrandForceBatch::computeBuiltInEF()
+{
+#pragma omp parallel for schedule(dynamic)
+    for ( int block = 0; block < m_numBlocks; ++block )
+        computeBuiltInEF( block );
+}
+
+void StrandForceBatch::computeBuiltInEFJ( const int block, const std::vector<char>* selected )
+{
+    if ( !hasSelected( block, selected ) )
+        return;
+
+    gatherGeometry( block, false, selected );
+    computeEF( block );
+    computeStretchingJacobian( block );
+    scatterEF( block, false, selected );
+    scatterJ( block, selected );
+}
+
+void StrandForceBatch::computeBuiltInEF( const int block, const std::vector<char>* selected )
+{
+    if ( !hasSelected( block, selected ) )
+        return;
+
+    gatherGeometry( block, true, selected );
+    computeEF( block );
+    scatterEF( block, true, selected );
+}
+
+bool StrandForceBatch::hasSelected( const int block, const std::vector<char>* selected ) const
+{
+    for ( int lane = 0; lane < numLanes( block ); ++lane )
+        if ( isSelected( block, lane, selected ) )
+            return true;
+
+    return false;
+}
+
+void StrandForceBatch::gatherRestShape( const int block, const int lane )
+{
+    const ElasticStrand& strand = *m_strands[block * W + lane];
+    const int numVertices = strand.m_numVertices;
+
+    m_ks[block * W + lane] = strand.m_parameters.m_ks;
+    m_kt[block * W + lane] = strand.m_parameters.m_kt;
+    m_bendingMatrix[0][block * W + lane] = strand.m_bendingMatrix( 0, 0 );
+    m_bendingMatrix[1][block * W + lane] = strand.m_bendingMatrix( 0, 1 );
+    m_bendingMatrix[2][block * W + lane] = strand.m_bendingMatrix( 1, 0 );
+    m_bendingMatrix[3][block * W + lane] = strand.m_bendingMatrix( 1, 1 );
+
+    for ( int vtx = 0; vtx < numVertices; ++vtx )
+        vertexData( block, vtx, MASS )[lane] = strand.m_vertexMasses[vtx];
+
+    for ( int vtx = 0; vtx < numVertices - 1; ++vtx )
+        vertexData( block, vtx, REST_LENGTH )[lane] = strand.m_restLengths[vtx];
+
+    for ( int vtx = 1; vtx < numVertices - 1; ++vtx )
+    {
+        vertexData( block, vtx, INV_VORONOI_LENGTH )[lane] = strand.m_invVoronoiLengths[vtx];
+        vertexData( block, vtx, REST_KAPPA )[lane] = strand.m_restBends[vtx][0];
+        vertexData( block, vtx, REST_KAPPA + 1 )[lane] = strand.m_restBends[vtx][1];
+        vertexData( block, vtx, REST_TWIST )[lane] = strand.m_restTwists[vtx];
+    }
+}
+
+// Strands are read one at a time, in order, while the block being filled stays in cache
+void StrandForceBatch::gatherGeometry( const int block, const bool future, const std::vector<char>* selected )
+{
+    for ( int lane = 0; lane < numLanes( block ); ++lane )
+    {
+        if ( !isSelected( block, lane, selected ) )
+            continue;
+
+        ElasticStrand& strand = *m_strands[block * W + lane];
+        const StrandGeometry& geometry = future ? *strand.m_futureGeometry : *strand.m_currentGeometry;
+        const int numVertices = strand.m_numVertices;
+
+        if ( !geometry.m_framesUpToDate )
+        {
+            if ( future )
+                strand.updateFutureFrames();
+            else
+                strand.m_currentGeometry->updateFrames();
+        }
+
+        for ( int vtx = 0; vtx < numVertices; ++vtx )
+        {
+            Scalar* data = vertexData( block, vtx, 0 ) + lane;
+            const Scalar* x = &geometry.m_degreesOfFreedom[4 * vtx];
+
+            for ( int k = 0; k < 3; ++k )
+                data[( POSITION + k ) * W] = x[k];
+
+            if ( vtx == numVertices - 1 )
+                break;
+
+            for ( int k = 0; k < 3; ++k )
+            {
+                data[( EDGE + k ) * W] = x[4 + k] - x[k];
+                data[( TANGENT + k ) * W] = geometry.m_tangents[vtx][k];
+                data[( MATERIAL_FRAME_1 + k ) * W] = geometry.m_materialFrames1[3 * vtx + k];
+                data[( MATERIAL_FRAME_2 + k ) * W] = geometry.m_materialFrames2[3 * vtx + k];
+            }
+            data[LENGTH * W] = geometry.m_lengths[vtx];
+
+            if ( vtx == 0 )
+                continue;
+
+            data[KAPPA * W] = geometry.m_kappa[vtx][0];
+            data[( KAPPA + 1 ) * W] = geometry.m_kappa[vtx][1];
+            data[TWIST * W] = geometry.m_twists[vtx];
+            for ( int k = 0; k < 3; ++k )
+                data[( CURVATURE_BINORMAL + k ) * W] = geometry.m_curvatureBinormals[vtx][k];
+        }
+    }
+}
+
+// The kernels below follow the per-vertex computations of the force classes, one vertex at a time, the inner loops
+// running across the lanes of the block.
+void StrandForceBatch::computeEF( const int block )
+{
+    Scalar* energy = &m_energy[block * W];
+    const Scalar* ks = &m_ks[block * W];
+    const Scalar* kt = &m_kt[block * W];
+    const Scalar* B00 = &m_bendingMatrix[0][block * W];
+    const Scalar* B01 = &m_bendingMatrix[1][block * W];
+    const Scalar* B10 = &m_bendingMatrix[2][block * W];
+    const Scalar* B11 = &m_bendingMatrix[3][block * W];
+
+    std::fill( energy, energy + W, 0.0 );
+    std::fill( forceData( block, 0 ), forceData( block, 0 ) + m_numDofs * W, 0.0 );
+
+    // Stretching
+    for ( int vtx = 0; vtx < m_numVertices - 1; ++vtx )
+    {
+        const Scalar* data = vertexData( block, vtx, 0 );
+        const Scalar* length = data + LENGTH * W;
+        const Scalar* restLength = data + REST_LENGTH * W;
+        Scalar* f = forceData( block, 4 * vtx );
+
+        for ( int lane = 0; lane < W; ++lane )
+        {
+            const Scalar strain = length[lane] / restLength[lane] - 1.0;
+            energy[lane] += 0.5 * ks[lane] * strain * strain * restLength[lane];
+        }
+
+        for ( int k = 0; k < 3; ++k )
+        {
+            const Scalar* e = data + ( EDGE + k ) * W;
+            Scalar* fFirst = f + k * W;
+            Scalar* fSecond = f + ( 4 + k ) * W;
+
+            for ( int lane = 0; lane < W; ++lane )
+            {
+                const Scalar fk = ks[lane] * ( length[lane] / restLength[lane] - 1.0 ) * ( e[lane] / length[lane] );
+                fFirst[lane] += fk;
+                fSecond[lane] += -fk;
+            }
+        }
+    }
+
+    // Twisting
+    for ( int vtx = 1; vtx < m_numVertices - 1; ++vtx )
+    {
+        const Scalar* data = vertexData( block, vtx, 0 );
+        const Scalar* ilen = data + INV_VORONOI_LENGTH * W;
+        const Scalar* twist = data + TWIST * W;
+        const Scalar* restTwist = data + REST_TWIST * W;
+        const Scalar* lengthE = vertexData( block, vtx - 1, LENGTH );
+        const Scalar* lengthF = data + LENGTH * W;
+        Scalar* f = forceData( block, 4 * ( vtx - 1 ) );
+
+        Scalar c[W];
+        for ( int lane = 0; lane < W; ++lane )
+        {
+            const Scalar d = twist[lane] - restTwist[lane];
+            energy[lane] += 0.5 * kt[lane] * d * d * ilen[lane];
+            c[lane] = -kt[lane] * ilen[lane] * d;
+        }
+
+        for ( int k = 0; k < 3; ++k )
+        {
+            const Scalar* kb = data + ( CURVATURE_BINORMAL + k ) * W;
+            Scalar* fE = f + k * W;
+            Scalar* fV = f + ( 4 + k ) * W;
+            Scalar* fF = f + ( 8 + k ) * W;
+
+            for ( int lane = 0; lane < W; ++lane )
+            {
+                const Scalar ge = -0.5 / lengthE[lane] * kb[lane];
+                const Scalar gf = 0.5 / lengthF[lane] * kb[lane];
+                fE[lane] += c[lane] * ge;
+                fV[lane] += c[lane] * -( ge + gf );
+                fF[lane] += c[lane] * gf;
+            }
+        }
+
+        Scalar* fThetaE = f + 3 * W;
+        Scalar* fThetaF = f + 7 * W;
+        for ( int lane = 0; lane < W; ++lane )
+        {
+            fThetaE[lane] += -c[lane];
+            fThetaF[lane] += c[lane];
+        }
+    }
+
+    // Bending, with the gradient of curvature computed as in StrandGeometry::computeGradKappa()
+    for ( int vtx = 1; vtx < m_numVertices - 1; ++vtx )
+    {
+        const Scalar* dataE = vertexData( block, vtx - 1, 0 );
+        const Scalar* dataF = vertexData( block, vtx, 0 );
+        const Scalar* ilen = dataF + INV_VORONOI_LENGTH * W;
+        Scalar* f = forceData( block, 4 * ( vtx - 1 ) );
+
+        // Rows of the force, up to the factor -ilen
+        Scalar g[11][W];
+
+        for ( int lane = 0; lane < W; ++lane )
+        {
+            Scalar te[3], tf[3], m1e[3], m2e[3], m1f[3], m2f[3], kb[3];
+            for ( int k = 0; k < 3; ++k )
+            {
+                te[k] = dataE[( TANGENT + k ) * W + lane];
+                tf[k] = dataF[( TANGENT + k ) * W + lane];
+                m1e[k] = dataE[( MATERIAL_FRAME_1 + k ) * W + lane];
+                m2e[k] = dataE[( MATERIAL_FRAME_2 + k ) * W + lane];
+                m1f[k] = dataF[( MATERIAL_FRAME_1 + k ) * W + lane];
+                m2f[k] = dataF[( MATERIAL_FRAME_2 + k ) * W + lane];
+                kb[k] = dataF[( CURVATURE_BINORMAL + k ) * W + lane];
+            }
+            const Scalar invLengthE = 1.0 / dataE[LENGTH * W + lane];
+            const Scalar invLengthF = 1.0 / dataF[LENGTH * W + lane];
+            const Scalar kappa0 = dataF[KAPPA * W + lane];
+            const Scalar kappa1 = dataF[( KAPPA + 1 ) * W + lane];
+
+            const Scalar d0 = kappa0 - dataF[REST_KAPPA * W + lane];
+            const Scalar d1 = kappa1 - dataF[( REST_KAPPA + 1 ) * W + lane];
+            const Scalar Bd0 = B00[lane] * d0 + B01[lane] * d1;
+            const Scalar Bd1 = B10[lane] * d0 + B11[lane] * d1;
+            energy[lane] += 0.5 * ilen[lane] * ( d0 * Bd0 + d1 * Bd1 );
+
+            const Scalar invChi = 1.0 / ( 1.0 + te[0] * tf[0] + te[1] * tf[1] + te[2] * tf[2] );
+            Scalar tildeT[3], tildeD1[3], tildeD2[3];
+            for ( int k = 0; k < 3; ++k )
+            {
+                tildeT[k] = ( te[k] + tf[k] ) * invChi;
+                tildeD1[k] = ( m1e[k] + m1f[k] ) * invChi;
+                tildeD2[k] = ( m2e[k] + m2f[k] ) * invChi;
+            }
+
+            for ( int k = 0; k < 3; ++k )
+            {
+                const int k1 = ( k + 1 ) % 3;
+                const int k2 = ( k + 2 ) % 3;
+                const Scalar tfCrossD2 = tf[k1] * tildeD2[k2] - tf[k2] * tildeD2[k1];
+                const Scalar teCrossD2 = te[k1] * tildeD2[k2] - te[k2] * tildeD2[k1];
+                const Scalar tfCrossD1 = tf[k1] * tildeD1[k2] - tf[k2] * tildeD1[k1];
+                const Scalar teCrossD1 = te[k1] * tildeD1[k2] - te[k2] * tildeD1[k1];
+
+                const Scalar Dkappa0De = invLengthE * ( -kappa0 * tildeT[k] + tfCrossD2 );
+                const Scalar Dkappa0Df = invLengthF * ( -kappa0 * tildeT[k] - teCrossD2 );
+                const Scalar Dkappa1De = invLengthE * ( -kappa1 * tildeT[k] - tfCrossD1 );
+                const Scalar Dkappa1Df = invLengthF * ( -kappa1 * tildeT[k] + teCrossD1 );
+
+                g[k][lane] = -Dkappa0De * Bd0 - Dkappa1De * Bd1;
+                g[4 + k][lane] = ( Dkappa0De - Dkappa0Df ) * Bd0 + ( Dkappa1De - Dkappa1Df ) * Bd1;
+                g[8 + k][lane] = Dkappa0Df * Bd0 + Dkappa1Df * Bd1;
+            }
+
+            const Scalar kbDotM1e = kb[0] * m1e[0] + kb[1] * m1e[1] + kb[2] * m1e[2];
+            const Scalar kbDotM2e = kb[0] * m2e[0] + kb[1] * m2e[1] + kb[2] * m2e[2];
+            const Scalar kbDotM1f = kb[0] * m1f[0] + kb[1] * m1f[1] + kb[2] * m1f[2];
+            const Scalar kbDotM2f = kb[0] * m2f[0] + kb[1] * m2f[1] + kb[2] * m2f[2];
+            g[3][lane] = -0.5 * ( kbDotM1e * Bd0 + kbDotM2e * Bd1 );
+            g[7][lane] = -0.5 * ( kbDotM1f * Bd0 + kbDotM2f * Bd1 );
+        }
+
+        for ( int r = 0; r < 11; ++r )
+        {
+            Scalar* fr = f + r * W;
+            for ( int lane = 0; lane < W; ++lane )
+                fr[lane] += -ilen[lane] * g[r][lane];
+        }
+    }
+
+    // Gravitation
+    const Vec3d& gravity = GravitationForce::getGravity();
+    for ( int vtx = 0; vtx < m_numVertices; ++vtx )
+    {
+        const Scalar* data = vertexData( block, vtx, 0 );
+        const Scalar* x = data + POSITION * W;
+        const Scalar* y = data + ( POSITION + 1 ) * W;
+        const Scalar* z = data + ( POSITION + 2 ) * W;
+        const Scalar* mass = data + MASS * W;
+        Scalar* f = forceData( block, 4 * vtx );
+
+        for ( int lane = 0; lane < W; ++lane )
+            energy[lane] += -mass[lane] * ( x[lane] * gravity[0] + y[lane] * gravity[1] + z[lane] * gravity[2] );
+
+        for ( int k = 0; k < 3; ++k )
+        {
+            Scalar* fk = f + k * W;
+            for ( int lane = 0; lane < W; ++lane )
+                fk[lane] += mass[lane] * gravity[k];
+        }
+    }
+}
+
+void StrandForceBatch::computeStretchingJacobian( const int block )
+{
+    const Scalar* ks = &m_ks[block * W];
+
+    for ( int vtx = 0; vtx < m_numVertices - 1; ++vtx )
+    {
+        Scalar* data = vertexData( block, vtx, 0 );
+        const Scalar* length = data + LENGTH * W;
+        const Scalar* restLength = data + REST_LENGTH * W;
+
+        int k = STRETCHING_JACOBIAN;
+        for ( int r = 0; r < 3; ++r )
+            for ( int s = r; s < 3; ++s, ++k )
+            {
+                const Scalar* er = data + ( EDGE + r ) * W;
+                const Scalar* es = data + ( EDGE + s ) * W;
+                Scalar* M = data + k * W;
+
+                for ( int lane = 0; lane < W; ++lane )
+                {
+                    const Scalar diagonal = r == s ? 1.0 / restLength[lane] - 1.0 / length[lane] : 0.0;
+                    M[lane] = ks[lane] * ( diagonal + er[lane] * es[lane] / ( length[lane] * length[lane]
+                            * length[lane] ) );
+                }
+            }
+    }
+}
+
+void StrandForceBatch::scatterEF( const int block, const bool future, const std::vector<char>* selected )
+{
+    for ( int lane = 0; lane < numLanes( block ); ++lane )
+    {
+        if ( !isSelected( block, lane, selected ) )
+            continue;
+
+        ElasticStrand& strand = *m_strands[block * W + lane];
+        StrandGeometry& geometry = future ? *strand.m_futureGeometry : *strand.m_currentGeometry;
+        const int numDofs = static_cast<int> ( geometry.m_degreesOfFreedom.size() );
+        const Scalar* f = forceData( block, 0 ) + lane;
+
+        geometry.m_totalEnergy = m_energy[block * W + lane];
+        for ( int dof = 0; dof < numDofs; ++dof )
+            geometry.m_totalForce[dof] = f[dof * W];
+
+        // The current geometry is done once its Jacobian is scattered too
+        if ( future )
+        {
+            strand.m_futureBuiltInForcesComputed = true;
+            strand.m_readyForExamining = false;
+        }
+    }
+}
+
+void StrandForceBatch::scatterJ( const int block, const std::vector<char>* selected )
+{
+    StretchingForce::LocalJacobianType stretchingJ;
+    TwistingForce::LocalJacobianType twistingJ;
+    BendingForce::LocalJacobianType bendingJ;
+
+    for ( int lane = 0; lane < numLanes( block ); ++lane )
+    {
+        if ( !isSelected( block, lane, selected ) )
+            continue;
+
+        ElasticStrand& strand = *m_strands[block * W + lane];
+        StrandGeometry& geometry = *strand.m_currentGeometry;
+        JacobianMatrixType& J = *geometry.m_totalJacobian;
+        const int numVertices = strand.m_numVertices;
+
+        J.setZero();
+
+        for ( int vtx = 0; vtx < numVertices - 1; ++vtx )
+        {
+            const Scalar* data = vertexData( block, vtx, STRETCHING_JACOBIAN ) + lane;
+            Mat3d M;
+            int k = 0;
+            for ( int r = 0; r < 3; ++r )
+                for ( int s = r; s < 3; ++s, ++k )
+                    M( r, s ) = M( s, r ) = data[k * W];
+
+            stretchingJ.block<3, 3> ( 0, 0 ) = stretchingJ.block<3, 3> ( 3, 3 ) = -M;
+            stretchingJ.block<3, 3> ( 0, 3 ) = stretchingJ.block<3, 3> ( 3, 0 ) = M;
+            StretchingForce::addInPosition( J, vtx, stretchingJ );
+        }
+
+        for ( IndexType vtx = 1; vtx < numVertices - 1; ++vtx )
+        {
+            TwistingForce::computeLocalJacobian( twistingJ, strand, geometry, vtx );
+            TwistingForce::addInPosition( J, vtx, twistingJ );
+        }
+
+        for ( IndexType vtx = 1; vtx < numVertices - 1; ++vtx )
+        {
+            BendingForce::computeLocalJacobian( bendingJ, strand, geometry, vtx );
+            BendingForce::addInPosition( J, vtx, bendingJ );
+        }
+
+        // The Jacobian of gravitation is zero
+
+        strand.m_currentBuiltInForcesComputed = true;
+        strand.m_readyForSolving = false;
+    }
+}
+
+}
@@ -0,0 +1,131 @@
+/*
+ * StrandForceBatch.hh
+ *
+ *  Batched evaluation of the built-in forces of many strands.
+ */
+
+#ifndef STRANDFORCEBATCH_HH_
+#define STRANDFORCEBATCH_HH_
+
+#include <algorithm>
+#include <vector>
+#include "ElasticStrand.hh"
+
+namespace strandsim
+{
+
+// Evaluates the built-in forces (stretching, twisting, bending and gravitation) of many strands at once, giving the
+// same results as calling ElasticStrand::computeBuiltInEFJ() or computeBuiltInEF() on each of them.
+//
+// Strands are packed s_laneWidth at a time into structure-of-arrays blocks: within a block, each quantity of each
+// vertex (or edge) is stored as a row with one value ("lane") per strand, so that the kernels run the same arithmetic
+// on consecutive lanes and can be vectorized across strands. Blocks are processed concurrently. Strands with fewer
+// vertices than the longest are padded with lanes that contribute nothing.
+//
+// The rest shape, masses and stiffnesses are packed on construction. Positions, edges, material frames, curvatures
+// and twists are packed on each evaluation, from the cached frames of each strand, which are brought up to date first
+// as prepareForSolving() or prepareForExamining() would; the gradients of curvature are recomputed in the batch rather
+// than packed. Energies, forces and the stretching Jacobian are computed in the batch; the bending and twisting
+// Jacobians need the full Hessians of curvature and twist, and are added strand by strand when the results are
+// scattered back.
+//
+// The results hold the built-in forces only. The next prepareForSolving() or prepareForExamining() of each strand
+// adds the external forces to them instead of recomputing everything.
+class StrandForceBatch
+{
+public:
+    static const int s_laneWidth = 16;
+
+    explicit StrandForceBatch( const std::vector<ElasticStrand*>& strands );
+
+    ~StrandForceBatch();
+
+    int getNumBlocks() const
+    {
+        return m_numBlocks;
+    }
+
+    // Reset the energy, force and Jacobian of every strand's current geometry to those of the built-in forces
+    void computeBuiltInEFJ();
+
+    // Reset the energy and force of every strand's future geometry to those of the built-in forces
+    void computeBuiltInEF();
+
+    // The same for the strands of one block (the s_laneWidth strands starting at block * s_laneWidth), so that callers
+    // can hand blocks out to their own threads. If selected is given, it holds one flag per strand and only the
+    // strands flagged are evaluated; a block without any does nothing.
+    void computeBuiltInEFJ( const int block, const std::vector<char>* selected = NULL );
+    void computeBuiltInEF( const int block, const std::vector<char>* selected = NULL );
+
+private:
+    void gatherRestShape( const int block, const int lane );
+    void gatherGeometry( const int block, const bool future, const std::vector<char>* selected );
+    void computeEF( const int block );
+    void computeStretchingJacobian( const int block );
+    void scatterEF( const int block, const bool future, const std::vector<char>* selected );
+    void scatterJ( const int block, const std::vector<char>* selected );
+
+    int numLanes( const int block ) const
+    {
+        return std::min( s_laneWidth, static_cast<int> ( m_strands.size() ) - block * s_laneWidth );
+    }
+
+    bool isSelected( const int block, const int lane, const std::vector<char>* selected ) const
+    {
+        return !selected || ( *selected )[block * s_laneWidth + lane];
+    }
+
+    bool hasSelected( const int block, const std::vector<char>* selected ) const;
+
+    // Quantities stored for each vertex, or for the edge starting at it
+    enum VertexQuantity
+    {
+        POSITION = 0, // 3 coordinates
+        MASS = 3,
+        EDGE = 4, // 3 coordinates
+        LENGTH = 7,
+        REST_LENGTH = 8,
+        TANGENT = 9, // 3 coordinates
+        MATERIAL_FRAME_1 = 12, // 3 coordinates
+        MATERIAL_FRAME_2 = 15, // 3 coordinates
+        STRETCHING_JACOBIAN = 18, // upper triangle of the 3x3 block
+        INV_VORONOI_LENGTH = 24,
+        KAPPA = 25, // 2 components
+        REST_KAPPA = 27, // 2 components
+        TWIST = 29,
+        REST_TWIST = 30,
+        CURVATURE_BINORMAL = 31, // 3 coordinates
+        NUM_VERTEX_QUANTITIES = 34
+    };
+
+    // The lanes of a quantity for a vertex of a block. All the quantities of a vertex are stored together, so that
+    // filling or reading one vertex touches a single contiguous range.
+    Scalar* vertexData( const int block, const int vtx, const int quantity )
+    {
+        return &m_vertexData[( ( block * m_numVertices + vtx ) * NUM_VERTEX_QUANTITIES + quantity ) * s_laneWidth];
+    }
+
+    // The lanes of a degree of freedom of a block
+    Scalar* forceData( const int block, const int dof )
+    {
+        return &m_forces[( block * m_numDofs + dof ) * s_laneWidth];
+    }
+
+    std::vector<ElasticStrand*> m_strands;
+    int m_numBlocks;
+    int m_numVertices; // of the longest strand
+    int m_numDofs;
+
+    // Per strand
+    std::vector<Scalar> m_ks;
+    std::vector<Scalar> m_kt;
+    std::vector<Scalar> m_bendingMatrix[4];
+    std::vector<Scalar> m_energy;
+
+    std::vector<Scalar> m_vertexData;
+    std::vector<Scalar> m_forces;
+};
+
+}
+
+#endif /* STRANDFORCEBATCH_HH_ */
@@ -6,13 +6,16 @@
  */
 
 #include "StrandStepManager.hh"
+#include "StrandForceBatch.hh"
+#include "Forces/GravitationForce.hh"
 
 namespace strandsim
 {
 
 template<typename StepperT>
-StrandStepManager<StepperT>::StrandStepManager(const std::vector<ElasticStrand*>& strands) :
-    m_strands(strands)
+StrandStepManager<StepperT>::StrandStepManager(const std::vector<ElasticStrand*>& strands, bool parallel) :
+    m_strands(strands), m_parallel(parallel), m_clumpingRadius(0.0), m_sleepThreshold(0.0), m_stepsBeforeSleeping(10),
+            m_numActiveStrands(0), m_gravity(GravitationForce::getGravity()), m_batchedForces(false), m_forceBatch(NULL)
 {
     // TODO Auto-generated constructor stub
 
@@ -21,16 +24,171 @@ StrandStepManager<StepperT>::StrandStepManager(const std::vector<ElasticStrand*>
 template<typename StepperT>
 StrandStepManager<StepperT>::~StrandStepManager()
 {
-    // TODO Auto-generated destructor stub
+    delete m_forceBatch;
+}
+
+template<typename StepperT>
+void StrandStepManager<StepperT>::setBatchedForces(bool batched)
+{
+    m_batchedForces = batched;
+    if (!batched)
+    {
+        delete m_forceBatch;
+        m_forceBatch = NULL;
+    }
+}
+
+template<typename StepperT>
+void StrandStepManager<StepperT>::matchStepperStates()
+{
+    typedef std::map<const ElasticStrand*, typename StepperT::StateType> StateMap;
+
+    StateMap previousStates;
+    for (size_t i = 0; i < m_stepperStrands.size(); ++i)
+        previousStates[m_stepperStrands[i]] = m_stepperStates[i];
+
+    // Strands new to the set start from a default state
+    m_stepperStates.assign(m_strands.size(), typename StepperT::StateType());
+    for (size_t i = 0; i < m_strands.size(); ++i)
+    {
+        typename StateMap::const_iterator previous = previousStates.find(m_strands[i]);
+        if (previous != previousStates.end())
+            m_stepperStates[i] = previous->second;
+    }
+
+    m_stepperStrands = m_strands;
 }
 
 template<typename StepperT>
 void StrandStepManager<StepperT>::execute()
 {
-    StepperT stepper;
+    const int numStrands = static_cast<int> (m_strands.size());
+    if (m_stepperStrands != m_strands)
+    {
+        matchStepperStates();
+        delete m_forceBatch;
+        m_forceBatch = NULL;
+    }
+    if (m_batchedForces && !m_forceBatch)
+        m_forceBatch = new StrandForceBatch(m_strands);
+    const bool batched = m_batchedForces;
+    const int numBlocks = batched ? m_forceBatch->getNumBlocks() : 0;
+    m_solved.assign(batched ? numStrands : 0, false);
+    const bool sleeping = m_sleepThreshold > 0.0;
+    const bool gravityChanged = GravitationForce::getGravity() != m_gravity;
+    m_gravity = GravitationForce::getGravity();
+    int numActiveStrands = 0;
+
+#pragma omp parallel if (m_parallel)
+    {
+        // First phase: publish every strand's positions for the clumping forces. The barrier at the end of the loop
+        // guarantees that no strand moves before all snapshots are stored.
+#pragma omp for schedule(static)
+        for (int i = 0; i < numStrands; ++i)
+            m_strands[i]->storeClumpingSnapshot();
+
+        // Gather the attractors of each strand from a grid of all snapshots. Every thread takes the same branch, as
+        // the radius is not changed during execute(). A strand whose attractors changed has its forces invalidated, so
+        // its trust region starts over on its next step.
+        if (m_clumpingRadius > 0.0)
+        {
+#pragma omp single
+            {
+                m_clumpingGrid.setCellSize(m_clumpingRadius);
+                m_clumpingGrid.clear();
+                for (int i = 0; i < numStrands; ++i)
+                    m_clumpingGrid.insert(i, m_strands[i]->getClumpingSnapshot());
+                m_clumpingGrid.finalize();
+            }
+
+            std::vector<int> nearStrands;
+            std::vector<const ElasticStrand*> attractors;
+
+#pragma omp for schedule(dynamic, 16)
+            for (int i = 0; i < numStrands; ++i)
+            {
+                m_clumpingGrid.strandsNear(nearStrands, i, m_strands[i]->getClumpingSnapshot(), m_clumpingRadius);
+
+                attractors.clear();
+                for (std::vector<int>::const_iterator other = nearStrands.begin(); other != nearStrands.end(); ++other)
+                    attractors.push_back(m_strands[*other]);
+                m_strands[i]->setClumpingAttractors(attractors);
+            }
+        }
+
+        // The built-in forces of all strands are about to be invalidated: compute them in the batch first, so that
+        // invalidateForces() only adds the external ones.
+        if (batched && gravityChanged)
+        {
+#pragma omp for schedule(dynamic)
+            for (int block = 0; block < numBlocks; ++block)
+                m_forceBatch->computeBuiltInEFJ(block);
+        }
+
+        // Second phase: step the strands, with one stepper (and solver workspace) per thread, loaded with each strand's
+        // own state. Strand lengths vary a lot, so strands are handed out dynamically in small chunks. Whether
+        // attractors are moving is read from their snapshots, which do not change during this phase. With batched
+        // forces, strands only solve for their new position here.
+        StepperT stepper;
+
+#pragma omp for schedule(dynamic, 16) reduction(+:numActiveStrands)
+        for (int i = 0; i < numStrands; ++i)
+        {
+            ElasticStrand& strand = *m_strands[i];
+
+            if (gravityChanged)
+                strand.invalidateForces();
+            else if (strand.isAsleep() && (!sleeping || strand.hasMovingClumpingAttractor()))
+                strand.wakeUp();
+            if (strand.isAsleep())
+                continue;
+
+            stepper.setState(m_stepperStates[i]);
+            if (batched)
+                m_solved[i] = stepper.solve(strand);
+            else
+                stepper.execute(strand);
+            m_stepperStates[i] = stepper.getState();
+            ++numActiveStrands;
+
+            if (sleeping && !batched)
+                strand.updateSleepState(m_sleepThreshold, m_stepsBeforeSleeping);
+        }
+
+        // With batched forces, the forces at the new positions of the strands solved for are computed block by block,
+        // and each strand then accepts or rejects its new position. The barriers at the end of the loops separate the
+        // phases.
+        if (batched)
+        {
+#pragma omp for schedule(dynamic)
+            for (int block = 0; block < numBlocks; ++block)
+                m_forceBatch->computeBuiltInEF(block, &m_solved);
+
+#pragma omp for schedule(dynamic, 16)
+            for (int i = 0; i < numStrands; ++i)
+            {
+                if (!m_solved[i])
+                    continue;
+
+                ElasticStrand& strand = *m_strands[i];
+
+                stepper.setState(m_stepperStates[i]);
+                stepper.examine(strand);
+                m_stepperStates[i] = stepper.getState();
+
+                if (sleeping)
+                    strand.updateSleepState(m_sleepThreshold, m_stepsBeforeSleeping);
+            }
+        }
+
+        // The snapshots are only valid during the step: strands stepped directly afterwards must be attracted to where
+        // the others actually are. The barrier at the end of the stepping loop ensures nobody reads them any more.
+#pragma omp for schedule(static)
+        for (int i = 0; i < numStrands; ++i)
+            m_strands[i]->clearClumpingSnapshot();
+    }
 
-    for (std::vector<ElasticStrand*>::const_iterator s = m_strands.begin(); s != m_strands.end(); ++s)
-        stepper.execute(**s);
+    m_numActiveStrands = numActiveStrands;
 }
 
 }
@@ -8,24 +8,120 @@
 #ifndef STRANDSTEPMANAGER_HH_
 #define STRANDSTEPMANAGER_HH_
 
+#include <map>
 #include <vector>
 #include "ElasticStrand.hh"
+#include "SegmentIndex.hh"
 
 namespace strandsim
 {
 
+class StrandForceBatch;
+
+// Steps a set of strands, concurrently unless the parallel mode is turned off. Each strand keeps its own stepper state
+// from one execute() to the next, and clumping forces read the positions other strands had before the step, so the
+// results do not depend on the order in which strands are stepped, nor on the number of threads. Stepper states follow
+// their strand if strands are added to, removed from or reordered in the set between steps.
+//
+// If a clumping radius is set, the clumping attractors of every strand are gathered before each step: they are the
+// other strands passing within that radius of it, found with a grid of all strand segments. Otherwise the attractors
+// are left as set on the strands.
+//
+// With batched forces turned on, each step is split in two around a batched evaluation of the built-in forces (see
+// StrandForceBatch): every strand solves for its new position, the batch then computes the forces there block by
+// block, and every strand accepts or rejects its position. The Jacobians recomputed when gravity changes are batched
+// too. Positions differ from the unbatched ones only by rounding.
+//
+// When gravity changes, the forces of every strand are invalidated. If a sleep threshold is set, strands whose total
+// force stays below it for a number of consecutive steps fall asleep and are skipped. A sleeping strand is woken up when
+// its forces are invalidated, when one of its attractors is moving, or when sleeping is turned off.
 template<typename StepperT>
 class StrandStepManager
 {
 public:
-    explicit StrandStepManager(const std::vector<ElasticStrand*>& strands);
+    explicit StrandStepManager(const std::vector<ElasticStrand*>& strands, bool parallel = true);
 
     virtual ~StrandStepManager();
 
+    void setParallel(bool parallel)
+    {
+        m_parallel = parallel;
+    }
+
+    bool isParallel() const
+    {
+        return m_parallel;
+    }
+
+    void setClumpingRadius(const Scalar radius)
+    {
+        m_clumpingRadius = radius;
+    }
+
+    Scalar getClumpingRadius() const
+    {
+        return m_clumpingRadius;
+    }
+
+    // Requires the stepper to provide solve() and examine(), as ElasticStrandStaticStepper does
+    void setBatchedForces(bool batched);
+
+    bool hasBatchedForces() const
+    {
+        return m_batchedForces;
+    }
+
+    // Norm of the total force under which a strand counts as at rest. Zero, the default, turns sleeping off.
+    void setSleepThreshold(const Scalar threshold)
+    {
+        m_sleepThreshold = threshold;
+    }
+
+    Scalar getSleepThreshold() const
+    {
+        return m_sleepThreshold;
+    }
+
+    // Number of consecutive steps at rest after which a strand falls asleep
+    void setStepsBeforeSleeping(const int numSteps)
+    {
+        m_stepsBeforeSleeping = numSteps;
+    }
+
+    int getStepsBeforeSleeping() const
+    {
+        return m_stepsBeforeSleeping;
+    }
+
     void execute();
 
+    // Number of strands actually stepped by the last execute()
+    int getNumActiveStrands() const
+    {
+        return m_numActiveStrands;
+    }
+
 private:
+    // Not copyable, as it owns its force batch
+    StrandStepManager(const StrandStepManager&);
+    StrandStepManager& operator=(const StrandStepManager&);
+
+    // Reorders the stepper states to follow m_strands, which may have changed since the last execute()
+    void matchStepperStates();
+
     const std::vector<ElasticStrand*>& m_strands;
+    bool m_parallel;
+    Scalar m_clumpingRadius;
+    SegmentGrid m_clumpingGrid;
+    std::vector<typename StepperT::StateType> m_stepperStates; // indexed like m_stepperStrands
+    std::vector<ElasticStrand*> m_stepperStrands; // m_strands as of the last execute()
+    Scalar m_sleepThreshold;
+    int m_stepsBeforeSleeping;
+    int m_numActiveStrands;
+    Vec3d m_gravity; // as of the last execute(), to invalidate all forces when it changes
+    bool m_batchedForces;
+    StrandForceBatch* m_forceBatch; // of m_stepperStrands, built on the first batched execute()
+    std::vector<char> m_solved; // whether each strand was solved for in the current batched step
 };
 
 }
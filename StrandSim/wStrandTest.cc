@@ -8,6 +8,8 @@
 #include "wStrandTest.hh"
 #include "ElasticStrand.hh"
 #include "ElasticStrandStaticStepper.hh"
+#include "StrandForceBatch.hh"
+#include "StrandStepManager.hh"
 #include "Forces/ClumpingForce.hh"
 #include "Forces/GravitationForce.hh"
 
@@ -31,6 +33,21 @@ static const Scalar baseRotation = 0.5;
 static const Vec3d gravity( 0.0, 0.0, -981.0 );
 static const int nIterations = 1000;
 
+// Batched forces benchmark
+static const int nBatchStrands = 10000;
+static const int nBatchVertices = 50;
+static const int nBatchIterations = 20;
+
+// Sleeping test
+static const int nSleepingStrands = 400;
+static const int nSleepingSteps = 300;
+static const Scalar sleepThreshold = 1.0e-6;
+static const Scalar maxSleepingDifference = 1.0e-6;
+
+// Batched stepping test, on the sleeping test's strands
+static const Scalar batchedClumpingRadius = 2.5;
+static const Scalar maxBatchedDifference = 1.0e-6;
+
 void testStrandSim( const std::vector<Vec3d>& i_vertices )
 {
     GravitationForce::setGravity( gravity );
@@ -114,6 +131,220 @@ void testBASim( const std::vector<Vec3d>& i_vertices )
 
 }
 
+// Evaluate the built-in forces of many strands one strand at a time, then batched, and compare results and timings
+void benchmarkBatchedForces()
+{
+    GravitationForce::setGravity( gravity );
+
+    ElasticStrandParameters params( radiusA, radiusB, YoungsModulus, shearModulus, density,
+            baseRotation );
+
+    std::vector<ElasticStrand*> strands;
+    VecXd dofs( 4 * nBatchVertices - 1 );
+    dofs.setZero();
+    for ( int s = 0; s < nBatchStrands; ++s )
+    {
+        const Scalar phase = 2.0 * M_PI * s / nBatchStrands;
+        for ( int i = 0; i < nBatchVertices; ++i )
+            dofs.segment<3> ( 4 * i ) = Vec3d( 0.2 * i, sin( 0.3 * i + phase ), 0.5 * cos( 0.2 * i
+                    + 3.0 * phase ) );
+        strands.push_back( new ElasticStrand( dofs, params ) );
+    }
+
+    // Give every strand a new position to examine, so that the future geometry and its frames differ from the current
+    for ( int s = 0; s < nBatchStrands; ++s )
+    {
+        VecXd& newDofs = strands[s]->getNewDegreesOfFreedom();
+        newDofs = strands[s]->getDegreesOfFreedom();
+        for ( int i = 1; i < nBatchVertices; ++i )
+            newDofs.segment<3> ( 4 * i ) += 0.01 * Vec3d( cos( 0.7 * i + s ), sin( 1.3 * i ), 0.0 );
+        for ( int i = 0; i < nBatchVertices - 1; ++i )
+            newDofs[4 * i + 3] += 0.1 * sin( 0.5 * i + s );
+        strands[s]->prepareForExamining();
+    }
+
+    START_TIMER("Per-strand forces");
+    for ( int i = 0; i < nBatchIterations; ++i )
+    {
+#pragma omp parallel for
+        for ( int s = 0; s < nBatchStrands; ++s )
+        {
+            strands[s]->computeBuiltInEFJ();
+            strands[s]->computeBuiltInEF();
+        }
+    }
+    STOP_TIMER("Per-strand forces");
+
+    std::vector<Scalar> energies( nBatchStrands );
+    std::vector<VecXd> forces( nBatchStrands );
+    std::vector<std::vector<Scalar> > Jacobians( nBatchStrands );
+    std::vector<Scalar> newEnergies( nBatchStrands );
+    std::vector<VecXd> newForces( nBatchStrands );
+    for ( int s = 0; s < nBatchStrands; ++s )
+    {
+        energies[s] = strands[s]->getTotalEnergy();
+        forces[s] = strands[s]->getTotalForces();
+        Jacobians[s] = strands[s]->getTotalJacobian().getData();
+        newEnergies[s] = strands[s]->getNewTotalEnergy();
+        newForces[s] = strands[s]->getNewTotalForces();
+    }
+
+    StrandForceBatch batch( strands );
+
+    START_TIMER("Batched forces");
+    for ( int i = 0; i < nBatchIterations; ++i )
+    {
+        batch.computeBuiltInEFJ();
+        batch.computeBuiltInEF();
+    }
+    STOP_TIMER("Batched forces");
+
+    Scalar maxEnergyError = 0.0;
+    Scalar maxForceError = 0.0;
+    Scalar maxJacobianError = 0.0;
+    Scalar maxNewEnergyError = 0.0;
+    Scalar maxNewForceError = 0.0;
+    for ( int s = 0; s < nBatchStrands; ++s )
+    {
+        maxEnergyError = std::max( maxEnergyError, fabs( strands[s]->getTotalEnergy() - energies[s] )
+                / std::max( 1.0, fabs( energies[s] ) ) );
+        maxForceError = std::max( maxForceError, ( strands[s]->getTotalForces() - forces[s] ).lpNorm<
+                Eigen::Infinity> () / std::max( 1.0, forces[s].lpNorm<Eigen::Infinity> () ) );
+
+        const std::vector<Scalar>& J = strands[s]->getTotalJacobian().getData();
+        for ( size_t k = 0; k < J.size(); ++k )
+            maxJacobianError = std::max( maxJacobianError, fabs( J[k] - Jacobians[s][k] ) / std::max( 1.0,
+                    fabs( Jacobians[s][k] ) ) );
+
+        maxNewEnergyError = std::max( maxNewEnergyError, fabs( strands[s]->getNewTotalEnergy() - newEnergies[s] )
+                / std::max( 1.0, fabs( newEnergies[s] ) ) );
+        maxNewForceError = std::max( maxNewForceError, ( strands[s]->getNewTotalForces() - newForces[s] ).lpNorm<
+                Eigen::Infinity> () / std::max( 1.0, newForces[s].lpNorm<Eigen::Infinity> () ) );
+    }
+
+    std::cout << nBatchStrands << " strands of " << nBatchVertices << " vertices, " << nBatchIterations
+            << " evaluations\n";
+    std::cout << "Relative differences, per-strand vs batched: energy " << maxEnergyError << ", force "
+            << maxForceError << ", Jacobian " << maxJacobianError << ", future energy " << maxNewEnergyError
+            << ", future force " << maxNewForceError << '\n';
+
+    for ( std::vector<ElasticStrand*>::iterator strand = strands.begin(); strand != strands.end(); ++strand )
+        delete *strand;
+}
+
+// Step a patch of hanging strands with and without sleeping, changing gravity halfway, and compare the positions
+void testStrandSleeping()
+{
+    GravitationForce::setGravity( gravity );
+
+    ElasticStrandParameters params( radiusA, radiusB, YoungsModulus, shearModulus, density,
+            baseRotation );
+
+    std::vector<ElasticStrand*> strands;
+    std::vector<ElasticStrand*> referenceStrands;
+    VecXd dofs( nDOFs );
+    dofs.setZero();
+    for ( int s = 0; s < nSleepingStrands; ++s )
+    {
+        const Vec3d root( 2.0 * ( s % 20 ), 2.0 * ( s / 20 ), 0.0 );
+        for ( int i = 0; i < nVertices; ++i )
+            dofs.segment<3> ( 4 * i ) = root + Vec3d( 0.1 * sin( 0.2 * i + s ), 0.0, -i * totalLength
+                    / ( nVertices - 1 ) );
+        strands.push_back( new ElasticStrand( dofs, params ) );
+        referenceStrands.push_back( new ElasticStrand( dofs, params ) );
+    }
+
+    StrandStepManager<ElasticStrandStaticStepper> manager( strands );
+    manager.setSleepThreshold( sleepThreshold );
+    StrandStepManager<ElasticStrandStaticStepper> referenceManager( referenceStrands );
+
+    Scalar maxDifference = 0.0;
+    for ( int i = 0; i < nSleepingSteps; ++i )
+    {
+        if ( i == nSleepingSteps / 2 )
+            GravitationForce::setGravity( 0.5 * gravity );
+
+        manager.execute();
+        referenceManager.execute();
+
+        Scalar difference = 0.0;
+        for ( int s = 0; s < nSleepingStrands; ++s )
+            difference = std::max( difference, ( strands[s]->getDegreesOfFreedom()
+                    - referenceStrands[s]->getDegreesOfFreedom() ).lpNorm<Eigen::Infinity> () );
+        maxDifference = std::max( maxDifference, difference );
+
+        if ( i % 25 == 0 || i == nSleepingSteps / 2 )
+            std::cout << "Step " << i << ": " << manager.getNumActiveStrands() << " active strands out of "
+                    << nSleepingStrands << ", position difference without sleeping " << difference << '\n';
+    }
+    std::cout << "Maximum position difference without sleeping: " << maxDifference << '\n';
+    assert( maxDifference < maxSleepingDifference );
+
+    for ( std::vector<ElasticStrand*>::iterator strand = strands.begin(); strand != strands.end(); ++strand )
+        delete *strand;
+    for ( std::vector<ElasticStrand*>::iterator strand = referenceStrands.begin(); strand
+            != referenceStrands.end(); ++strand )
+        delete *strand;
+}
+
+// Step a patch of clumping strands with and without batched forces, changing gravity halfway, and compare the
+// positions
+void testBatchedStepping()
+{
+    GravitationForce::setGravity( gravity );
+
+    ElasticStrandParameters params( radiusA, radiusB, YoungsModulus, shearModulus, density,
+            baseRotation );
+
+    std::vector<ElasticStrand*> strands;
+    std::vector<ElasticStrand*> referenceStrands;
+    VecXd dofs( nDOFs );
+    dofs.setZero();
+    for ( int s = 0; s < nSleepingStrands; ++s )
+    {
+        const Vec3d root( 2.0 * ( s % 20 ), 2.0 * ( s / 20 ), 0.0 );
+        for ( int i = 0; i < nVertices; ++i )
+            dofs.segment<3> ( 4 * i ) = root + Vec3d( 0.1 * sin( 0.2 * i + s ), 0.0, -i * totalLength
+                    / ( nVertices - 1 ) );
+        strands.push_back( new ElasticStrand( dofs, params ) );
+        strands.back()->addExternalForce( new ClumpingForce );
+        referenceStrands.push_back( new ElasticStrand( dofs, params ) );
+        referenceStrands.back()->addExternalForce( new ClumpingForce );
+    }
+
+    StrandStepManager<ElasticStrandStaticStepper> manager( strands );
+    manager.setBatchedForces( true );
+    manager.setClumpingRadius( batchedClumpingRadius );
+    StrandStepManager<ElasticStrandStaticStepper> referenceManager( referenceStrands );
+    referenceManager.setClumpingRadius( batchedClumpingRadius );
+
+    Scalar maxDifference = 0.0;
+    for ( int i = 0; i < nSleepingSteps; ++i )
+    {
+        if ( i == nSleepingSteps / 2 )
+            GravitationForce::setGravity( 0.5 * gravity );
+
+        START_TIMER("Batched stepping");
+        manager.execute();
+        STOP_TIMER("Batched stepping");
+        START_TIMER("Unbatched stepping");
+        referenceManager.execute();
+        STOP_TIMER("Unbatched stepping");
+
+        for ( int s = 0; s < nSleepingStrands; ++s )
+            maxDifference = std::max( maxDifference, ( strands[s]->getDegreesOfFreedom()
+                    - referenceStrands[s]->getDegreesOfFreedom() ).lpNorm<Eigen::Infinity> () );
+    }
+    std::cout << "Maximum position difference without batched forces: " << maxDifference << '\n';
+    assert( maxDifference < maxBatchedDifference );
+
+    for ( std::vector<ElasticStrand*>::iterator strand = strands.begin(); strand != strands.end(); ++strand )
+        delete *strand;
+    for ( std::vector<ElasticStrand*>::iterator strand = referenceStrands.begin(); strand
+            != referenceStrands.end(); ++strand )
+        delete *strand;
+}
+
 int main()
 {
     g_log = new TextLog( std::cerr, MsgInfo::kDebug, true );
@@ -147,6 +378,15 @@ int main()
     testBASim( i_vertices );
     STOP_TIMER("BASim");
 
+    std::cout << "Batched forces benchmark\n";
+    benchmarkBatchedForces();
+
+    std::cout << "Strand sleeping test\n";
+    testStrandSleeping();
+
+    std::cout << "Batched stepping test\n";
+    testBatchedStepping();
+
     BASim::Timer::report();
 
     return 0;